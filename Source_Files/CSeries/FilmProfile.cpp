@@ -2,6 +2,43 @@
 
 #include "Plugins.h"
 
+static FilmProfile alephone1_4 = {
+	true, // keyframe_fix
+	false, // damage_aggressor_last_in_tag
+	true, // swipe_nearby_items_fix
+	true, // initial_monster_fix
+	true, // long_distance_physics
+	true, // animate_items
+	true, // inexplicable_pin_change
+	false, // increased_dynamic_limits_1_0
+	true, // increased_dynamic_limits_1_1
+	true, // line_is_obstructed_fix
+	false, // a1_smg
+	true, // infinity_smg
+	true, // use_vertical_kick_threshold
+	true, // infinity_tag_fix
+	true, // adjacent_polygons_always_intersect
+	true, // early_object_initialization
+	true, // fix_sliding_on_platforms
+	true, // prevent_dead_projectile_owners
+	true, // validate_random_ranged_attack
+	true, // allow_short_kamikaze
+	true, // ketchup_fix
+	false, // lua_increments_rng
+	true, // destroy_players_ball_fix
+	true, // calculate_terminal_lines_correctly
+	true, // key_frame_zero_shrapnel_fix
+	true, // count_dead_dropped_items_correctly
+	true, // m1_low_gravity_projectiles
+	true, // m1_buggy_repair_goal
+	false, // find_action_key_target_has_side_effects
+	true,  // m1_object_unused
+	true, // m1_platform_flood
+	true, // m1_teleport_without_delay
+	true, // monster_ai_scheduler
+	true, // line_is_obstructed_pvs
+};
+
 static FilmProfile alephone1_3 = {
 	true, // keyframe_fix
 	false, // damage_aggressor_last_in_tag
@@ -35,6 +72,8 @@ static FilmProfile alephone1_3 = {
 	true,  // m1_object_unused
 	true, // m1_platform_flood
 	true, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
 static FilmProfile alephone1_2 = {
@@ -70,6 +109,8 @@ static FilmProfile alephone1_2 = {
 	false, // m1_object_unused
 	false, // m1_platform_flood
 	false, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
 static FilmProfile alephone1_1 = {
@@ -105,6 +146,8 @@ static FilmProfile alephone1_1 = {
 	false, // m1_object_unused
 	false, // m1_platform_flood
 	false, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
 static FilmProfile alephone1_0 = {
@@ -140,6 +183,8 @@ static FilmProfile alephone1_0 = {
 	false, // m1_object_unused
 	false, // m1_platform_flood
 	false, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
 static FilmProfile marathon2 = {
@@ -174,7 +219,9 @@ static FilmProfile marathon2 = {
 	false, // find_action_key_target_has_side_effects
 	false, // m1_object_unused
 	false, // m1_platform_flood
-	false  // m1_teleport_without_delay
+	false, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
 static FilmProfile marathon_infinity = {
@@ -210,9 +257,11 @@ static FilmProfile marathon_infinity = {
 	false, // m1_object_unused
 	false, // m1_platform_flood
 	false, // m1_teleport_without_delay
+	false, // monster_ai_scheduler
+	false, // line_is_obstructed_pvs
 };
 
-FilmProfile film_profile = alephone1_3;
+FilmProfile film_profile = alephone1_4;
 
 extern void LoadBaseMMLScripts();
 extern void ResetAllMMLValues();
@@ -222,7 +271,7 @@ void load_film_profile(FilmProfileType type, bool reload_mml)
 	switch (type)
 	{
 	case FILM_PROFILE_DEFAULT:
-		film_profile = alephone1_3;
+		film_profile = alephone1_4;
 		break;
 	case FILM_PROFILE_MARATHON_2:
 		film_profile = marathon2;
@@ -239,6 +288,9 @@ void load_film_profile(FilmProfileType type, bool reload_mml)
 	case FILM_PROFILE_ALEPH_ONE_1_2:
 		film_profile = alephone1_2;
 		break;
+	case FILM_PROFILE_ALEPH_ONE_1_3:
+		film_profile = alephone1_3;
+		break;
 	}
 
 	if (reload_mml)
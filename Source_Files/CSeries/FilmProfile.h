@@ -100,6 +100,10 @@ struct FilmProfile
 	bool m1_object_unused; // location.z and flags are unused in Marathon
 	bool m1_platform_flood; // checks more than just adjacent polygons
 	bool m1_teleport_without_delay; // Marathon terminals teleport immediately
+
+	// Aleph One 1.4 changes
+	bool monster_ai_scheduler; // more than one monster gets AI time per tick
+	bool line_is_obstructed_pvs; // line_is_obstructed trusts the polygons' visible sets
 };
 
 extern FilmProfile film_profile;
@@ -110,6 +114,7 @@ enum FilmProfileType {
 	FILM_PROFILE_MARATHON_INFINITY,
 	FILM_PROFILE_ALEPH_ONE_1_1,
 	FILM_PROFILE_ALEPH_ONE_1_2,
+	FILM_PROFILE_ALEPH_ONE_1_3,
 	FILM_PROFILE_DEFAULT,
 };
 
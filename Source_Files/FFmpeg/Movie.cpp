@@ -40,6 +40,7 @@
 
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
+#include "OGL_Setup.h"
 #endif
 
 #include "Movie.h"
@@ -67,7 +68,10 @@ void Movie::AddFrame(FrameType ftype) {}
 
 bool Movie::Setup() { return false; }
 int Movie::Movie_EncodeThread(void *arg) { return 0; }
+int Movie::Movie_ConvertThread(void *arg) { return 0; }
 void Movie::EncodeThread() {}
+void Movie::ConvertThread() {}
+void Movie::FinishReadbacks(size_t keep_pending) {}
 void Movie::EncodeVideo(bool last) {}
 void Movie::EncodeAudio(bool last) {}
 Movie::Movie() {}
@@ -130,12 +134,10 @@ struct libav_vars {
     uint8_t *audio_data;
     uint8_t *audio_data_conv;
     
-    AVFrame *video_frame;
     uint8_t *video_buf;
     int video_bufsize;
-    uint8_t *video_data;
     
-    struct SwsContext *sws_ctx;
+    struct movie_frame_ring *ring;
     AVFormatContext *fmt_ctx;
     int video_stream_idx;
     int audio_stream_idx;
@@ -145,6 +147,45 @@ struct libav_vars {
 };
 typedef struct libav_vars libav_vars_t;
 
+// the ring never holds more than this much captured and converted video
+#define MAX_FRAME_RING_BYTES (256 * 1024 * 1024)
+#define MIN_FRAME_SLOTS 3
+#define MAX_FRAME_SLOTS 8
+#define MAX_CONVERT_THREADS 4
+
+// OpenGL frames are read into pixel buffer objects and copied out this many
+// frames later, by which time the transfer has finished without a stall
+#define READBACK_DELAY 2
+
+struct movie_frame {
+    SDL_Surface *surface;       // captured pixels, 32-bit RGB
+    bool bottom_up;             // OpenGL rows are flipped during conversion
+    std::vector<uint8> audio;   // mixed audio for this frame, S16 stereo
+    
+    AVFrame *video_frame;       // converted picture
+    uint8_t *video_data;
+    SDL_sem *converted;         // posted once video_frame is ready to encode
+};
+
+struct movie_frame_ring {
+    std::vector<movie_frame> frames;
+    std::vector<struct SwsContext *> sws_ctxs;  // one per conversion worker
+    std::atomic<size_t> workers_started;
+    
+    // running frame counts; each frame uses slot (count % frames.size())
+    size_t captured;                    // game thread only
+    std::atomic<size_t> submitted;      // pixels are in the slot
+    std::atomic<size_t> converting;     // taken by a conversion worker
+    size_t encoded;                     // encoding thread only
+    
+#ifdef HAVE_OPENGL
+    std::vector<GLuint> pbos;           // empty without pixel buffer objects
+#endif
+    
+    movie_frame_ring() : workers_started(0), captured(0), submitted(0), converting(0), encoded(0) {}
+    movie_frame& slot(size_t count) { return frames[count % frames.size()]; }
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -329,12 +370,11 @@ int ScaleQuality(int quality, int zeroLevel, int fiftyLevel, int hundredLevel)
 
 Movie::Movie() :
   moviefile(""),
-  temp_surface(NULL),
   av(NULL),
   encodeThread(NULL),
-  encodeReady(NULL),
-  fillReady(NULL),
-  stillEncoding(0)
+  freeSlots(NULL),
+  convertReady(NULL),
+  stillEncoding(false)
 {
     av = new libav_vars_t;
     memset(av, 0, sizeof(libav_vars_t));
@@ -381,12 +421,6 @@ bool Movie::Setup()
 	view_rect.w *= scr->pixel_scale();
 	view_rect.h *= scr->pixel_scale();
 
-	temp_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, view_rect.w, view_rect.h, 32,
-										0x00ff0000, 0x0000ff00, 0x000000ff,
-										0);
-	success = (temp_surface != NULL);
-	if (!success) err_msg = "Could not create SDL surface";
-
     Mixer *mx = Mixer::instance();
     
     av_register_all();
@@ -476,27 +510,6 @@ bool Movie::Setup()
         success = av->video_buf;
         if (!success) err_msg = "Could not allocate video buffer";
     }
-    if (success)
-    {
-#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(55,28,0)
-        av->video_frame = avcodec_alloc_frame();
-#else
-        av->video_frame = av_frame_alloc();
-#endif
-        success = av->video_frame;
-        if (!success) err_msg = "Could not allocate video frame";
-    }
-    if (success)
-    {
-        int numbytes = avpicture_get_size(video_stream->codec->pix_fmt, view_rect.w, view_rect.h);
-        av->video_data = static_cast<uint8_t *>(av_malloc(numbytes));
-        success = av->video_data;
-        if (!success) err_msg = "Could not allocate video data buffer";
-    }
-    if (success)
-    {
-        avpicture_fill(reinterpret_cast<AVPicture *>(av->video_frame), av->video_data, video_stream->codec->pix_fmt, view_rect.w, view_rect.h);
-    }
     
     // Open output audio stream
     AVCodec *audio_codec;
@@ -565,18 +578,70 @@ bool Movie::Setup()
         if (!success) err_msg = "Could not allocate audio conversion buffer";
     }
     
-    // initialize conversion context
+    // set up the frame ring
+    if (success)
+    {
+        av->ring = new movie_frame_ring;
+        
+        int picture_bytes = avpicture_get_size(video_stream->codec->pix_fmt, view_rect.w, view_rect.h);
+        int slot_bytes = view_rect.w * view_rect.h * 4 + picture_bytes;
+        int slots = PIN(MAX_FRAME_RING_BYTES / slot_bytes, MIN_FRAME_SLOTS, MAX_FRAME_SLOTS);
+        av->ring->frames.resize(slots);
+        for (int i = 0; success && i < slots; i++)
+        {
+            movie_frame& frame = av->ring->frames[i];
+            frame.surface = SDL_CreateRGBSurface(SDL_SWSURFACE, view_rect.w, view_rect.h, 32,
+                                                 0x00ff0000, 0x0000ff00, 0x000000ff,
+                                                 0);
+            frame.bottom_up = false;
+            frame.audio.resize(2 * 2 * mx->obtained.freq / 30);
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(55,28,0)
+            frame.video_frame = avcodec_alloc_frame();
+#else
+            frame.video_frame = av_frame_alloc();
+#endif
+            frame.video_data = static_cast<uint8_t *>(av_malloc(picture_bytes));
+            frame.converted = SDL_CreateSemaphore(0);
+            success = frame.surface && frame.video_frame && frame.video_data && frame.converted;
+            if (!success) err_msg = "Could not allocate movie frame buffers";
+            else
+                avpicture_fill(reinterpret_cast<AVPicture *>(frame.video_frame), frame.video_data, video_stream->codec->pix_fmt, view_rect.w, view_rect.h);
+        }
+    }
+    
+    // initialize a conversion context for each worker
     if (success)
     {
-        av->sws_ctx = sws_getContext(temp_surface->w, temp_surface->h, AV_PIX_FMT_RGB32,
-                                     video_stream->codec->width,
-                                     video_stream->codec->height,
-                                     video_stream->codec->pix_fmt,
-                                     SWS_BILINEAR,
-                                     NULL, NULL, NULL);
-        success = av->sws_ctx;
-        if (!success) err_msg = "Could not create video conversion context";
+        int workers = PIN(get_cpu_count() / 2, 1, MAX_CONVERT_THREADS);
+        for (int i = 0; success && i < workers; i++)
+        {
+            struct SwsContext *sws_ctx = sws_getContext(view_rect.w, view_rect.h, AV_PIX_FMT_RGB32,
+                                                        video_stream->codec->width,
+                                                        video_stream->codec->height,
+                                                        video_stream->codec->pix_fmt,
+                                                        SWS_BILINEAR,
+                                                        NULL, NULL, NULL);
+            success = sws_ctx;
+            if (!success) err_msg = "Could not create video conversion context";
+            else av->ring->sws_ctxs.push_back(sws_ctx);
+        }
+    }
+    
+#ifdef HAVE_OPENGL
+    // read back asynchronously where we can
+    if (success && MainScreenIsOpenGL() && OGL_CheckExtension("GL_ARB_pixel_buffer_object"))
+    {
+        std::vector<GLuint>& pbos = av->ring->pbos;
+        pbos.resize(READBACK_DELAY + 1);
+        glGenBuffersARB(pbos.size(), &pbos.front());
+        for (size_t i = 0; i < pbos.size(); i++)
+        {
+            glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pbos[i]);
+            glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB, view_rect.w * view_rect.h * 4, NULL, GL_STREAM_READ_ARB);
+        }
+        glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
     }
+#endif
     
     // Start movie file
     if (success)
@@ -586,20 +651,22 @@ bool Movie::Setup()
         avformat_write_header(av->fmt_ctx, NULL);
     }
     
-    // set up our threads and intermediate storage
-    if (success)
-    {
-        videobuf.resize(av->video_bufsize);
-        audiobuf.resize(2 * 2 * mx->obtained.freq / 30);
-	}
+    // set up our threads
 	if (success)
 	{
-		encodeReady = SDL_CreateSemaphore(0);
-		fillReady = SDL_CreateSemaphore(1);
+		freeSlots = SDL_CreateSemaphore(av->ring->frames.size());
+		convertReady = SDL_CreateSemaphore(0);
 		stillEncoding = true;
-		success = encodeReady && fillReady;
+		success = freeSlots && convertReady;
 		if (!success) err_msg = "Could not create movie thread semaphores";
 	}
+	for (size_t i = 0; success && i < av->ring->sws_ctxs.size(); i++)
+	{
+		SDL_Thread *thread = SDL_CreateThread(Movie_ConvertThread, "MovieSetup_convertThread", this);
+		success = thread;
+		if (!success) err_msg = "Could not create movie conversion thread";
+		else convertThreads.push_back(thread);
+	}
 	if (success)
 	{
 		encodeThread = SDL_CreateThread(Movie_EncodeThread, "MovieSetup_encodeThread", this);
@@ -626,6 +693,12 @@ int Movie::Movie_EncodeThread(void *arg)
 	return 0;
 }
 
+int Movie::Movie_ConvertThread(void *arg)
+{
+	reinterpret_cast<Movie *>(arg)->ConvertThread();
+	return 0;
+}
+
 void Movie::EncodeVideo(bool last)
 {
     // convert video
@@ -635,13 +708,8 @@ void Movie::EncodeVideo(bool last)
     AVFrame *frame = NULL;
     if (!last)
     {
-        int pitch[] = { temp_surface->pitch, 0 };
-        const uint8_t *const pdata[] = { reinterpret_cast<uint8_t *>(temp_surface->pixels), NULL };
-    
-        sws_scale(av->sws_ctx, pdata, pitch, 0, temp_surface->h,
-                  av->video_frame->data, av->video_frame->linesize);
-        av->video_frame->pts = av->video_counter++;
-        frame = av->video_frame;
+        frame = av->ring->slot(av->ring->encoded).video_frame;
+        frame->pts = av->video_counter++;
     }
     
     bool done = false;
@@ -679,7 +747,11 @@ void Movie::EncodeAudio(bool last)
     AVCodecContext *acodec = astream->codec;
     
     
-    av_fifo_generic_write(av->audio_fifo, &audiobuf[0], audiobuf.size(), NULL);
+    if (!last)
+    {
+        std::vector<uint8>& audio = av->ring->slot(av->ring->encoded).audio;
+        av_fifo_generic_write(av->audio_fifo, &audio.front(), audio.size(), NULL);
+    }
     
     // bps: bytes per sample
     int channels = acodec->channels;
@@ -783,15 +855,15 @@ void Movie::EncodeAudio(bool last)
 
 void Movie::EncodeThread()
 {
+	movie_frame_ring *ring = av->ring;
 	av->video_counter = 0;
 	av->audio_counter = 0;
 	while (true)
 	{
-		SDL_SemWait(encodeReady);
-		if (!stillEncoding)
+		SDL_SemWait(ring->slot(ring->encoded).converted);
+		if (!stillEncoding && ring->encoded == ring->submitted)
 		{
-			// signal to quit
-			SDL_SemPost(fillReady);
+			// signal to quit; every submitted frame has been encoded
 			return;
 		}
         
@@ -799,7 +871,67 @@ void Movie::EncodeThread()
         EncodeVideo(false);
         EncodeAudio(false);
 		
-		SDL_SemPost(fillReady);
+		ring->encoded++;
+		SDL_SemPost(freeSlots);
+	}
+}
+
+void Movie::ConvertThread()
+{
+	movie_frame_ring *ring = av->ring;
+	struct SwsContext *sws_ctx = ring->sws_ctxs[ring->workers_started++];
+	while (true)
+	{
+		SDL_SemWait(convertReady);
+		
+		// StopRecording posts once more per worker after the last frame
+		size_t count = ring->converting++;
+		if (count >= ring->submitted)
+			return;
+		
+		movie_frame& frame = ring->slot(count);
+		SDL_Surface *surface = frame.surface;
+		const uint8_t *pixels = reinterpret_cast<uint8_t *>(surface->pixels);
+		int pitch = surface->pitch;
+		if (frame.bottom_up)
+		{
+			pixels += pitch * (surface->h - 1);
+			pitch = -pitch;
+		}
+		
+		int pitches[] = { pitch, 0 };
+		const uint8_t *const pdata[] = { pixels, NULL };
+		sws_scale(sws_ctx, pdata, pitches, 0, surface->h,
+				  frame.video_frame->data, frame.video_frame->linesize);
+		
+		SDL_SemPost(frame.converted);
+	}
+}
+
+// Hands captured frames on to the conversion workers, leaving the newest
+// keep_pending OpenGL readbacks in flight
+void Movie::FinishReadbacks(size_t keep_pending)
+{
+	movie_frame_ring *ring = av->ring;
+	while (ring->captured - ring->submitted > keep_pending)
+	{
+#ifdef HAVE_OPENGL
+		if (ring->pbos.size())
+		{
+			SDL_Surface *surface = ring->slot(ring->submitted).surface;
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, ring->pbos[ring->submitted % ring->pbos.size()]);
+			const uint8 *pixels = reinterpret_cast<const uint8 *>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB));
+			if (pixels)
+			{
+				for (int y = 0; y < view_rect.h; y++)
+					memcpy((uint8 *)surface->pixels + surface->pitch * y, pixels + view_rect.w * 4 * y, view_rect.w * 4);
+				glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+			}
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+		}
+#endif
+		ring->submitted++;
+		SDL_SemPost(convertReady);
 	}
 }
 
@@ -818,58 +950,78 @@ void Movie::AddFrame(FrameType ftype)
 	if (ftype == FRAME_FADE && get_keyboard_controller_status())
 		return;
 	
-	SDL_SemWait(fillReady);
-  	
+	// only waits when the encoder has fallen a whole ring behind
+	SDL_SemWait(freeSlots);
+	
+	movie_frame_ring *ring = av->ring;
+	movie_frame& frame = ring->slot(ring->captured);
+	size_t keep_pending = 0;
 	if (!MainScreenIsOpenGL())
 	{
 		SDL_Surface *video = MainScreenSurface();
-		SDL_BlitSurface(video, &view_rect, temp_surface, NULL);
+		SDL_BlitSurface(video, &view_rect, frame.surface, NULL);
+		frame.bottom_up = false;
 	}
 #ifdef HAVE_OPENGL
+	else if (ring->pbos.size())
+	{
+		// start the transfer; FinishReadbacks collects it a few frames on
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, ring->pbos[ring->captured % ring->pbos.size()]);
+		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+		frame.bottom_up = true;
+		keep_pending = READBACK_DELAY;
+	}
 	else
 	{
-		// Read OpenGL frame buffer
-		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, &videobuf.front());
-		
-		// Copy pixel buffer (which is upside-down) to surface
-		for (int y = 0; y < view_rect.h; y++)
-			memcpy((uint8 *)temp_surface->pixels + temp_surface->pitch * y, &videobuf.front() + view_rect.w * 4 * (view_rect.h - y - 1), view_rect.w * 4);
+		// Read OpenGL frame buffer (which is upside-down) straight into the slot
+		glPixelStorei(GL_PACK_ROW_LENGTH, frame.surface->pitch / 4);
+		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, frame.surface->pixels);
+		glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+		frame.bottom_up = true;
 	}
 #endif
 	
-	int audio_bytes_per_frame = audiobuf.size();
+	int audio_bytes_per_frame = frame.audio.size();
 	Mixer *mx = Mixer::instance();
 	float old_vol = mx->main_volume;
 	mx->SetVolume(sound_preferences->video_export_volume_db);
-	mx->Mix(&audiobuf.front(), audio_bytes_per_frame / 4, true, true, true);
+	mx->Mix(&frame.audio.front(), audio_bytes_per_frame / 4, true, true, true);
 	mx->main_volume = old_vol;
 	
-	SDL_SemPost(encodeReady);
+	ring->captured++;
+	FinishReadbacks(keep_pending);
 }
 
 void Movie::StopRecording()
 {
+	movie_frame_ring *ring = av->ring;
+	if (ring && convertReady)
+		FinishReadbacks(0);
+	
+	// let the workers drain the ring, then stop the encoder after the last
+	// submitted frame
+	stillEncoding = false;
+	for (size_t i = 0; i < convertThreads.size(); i++)
+		SDL_SemPost(convertReady);
+	for (size_t i = 0; i < convertThreads.size(); i++)
+		SDL_WaitThread(convertThreads[i], NULL);
+	convertThreads.clear();
 	if (encodeThread)
 	{
-		stillEncoding = false;
-		SDL_SemPost(encodeReady);
+		SDL_SemPost(ring->slot(ring->submitted).converted);
 		SDL_WaitThread(encodeThread, NULL);
 		encodeThread = NULL;
 	}
-	if (encodeReady)
-	{
-		SDL_DestroySemaphore(encodeReady);
-		encodeReady = NULL;
-	}
-	if (fillReady)
+	if (freeSlots)
 	{
-		SDL_DestroySemaphore(fillReady);
-		fillReady = NULL;
+		SDL_DestroySemaphore(freeSlots);
+		freeSlots = NULL;
 	}
-	if (temp_surface)
+	if (convertReady)
 	{
-		SDL_FreeSurface(temp_surface);
-		temp_surface = NULL;
+		SDL_DestroySemaphore(convertReady);
+		convertReady = NULL;
 	}
     
     if (av->inited)
@@ -904,21 +1056,29 @@ void Movie::StopRecording()
         av_free(av->video_buf);
         av->video_buf = NULL;
     }
-    if (av->video_data)
-    {
-        av_free(av->video_data);
-        av->video_data = NULL;
-    }
-    if (av->video_frame)
-    {
-        av_free(av->video_frame);
-        av->video_frame = NULL;
-    }
     
-    if (av->sws_ctx)
+    if (ring)
     {
-        av_free(av->sws_ctx);
-        av->sws_ctx = NULL;
+        for (size_t i = 0; i < ring->frames.size(); i++)
+        {
+            movie_frame& frame = ring->frames[i];
+            if (frame.surface)
+                SDL_FreeSurface(frame.surface);
+            if (frame.video_data)
+                av_free(frame.video_data);
+            if (frame.video_frame)
+                av_free(frame.video_frame);
+            if (frame.converted)
+                SDL_DestroySemaphore(frame.converted);
+        }
+        for (size_t i = 0; i < ring->sws_ctxs.size(); i++)
+            sws_freeContext(ring->sws_ctxs[i]);
+#ifdef HAVE_OPENGL
+        if (ring->pbos.size())
+            glDeleteBuffersARB(ring->pbos.size(), &ring->pbos.front());
+#endif
+        delete ring;
+        av->ring = NULL;
     }
 
     if (av->fmt_ctx)
@@ -27,6 +27,7 @@
 #include "cseries.h"
 #include <string.h>
 #include <vector>
+#include <atomic>
 #include <SDL_thread.h>
 
 class Movie
@@ -55,22 +56,26 @@ private:
   
   std::string moviefile;
   SDL_Rect view_rect;
-  SDL_Surface *temp_surface;
-  
-  std::vector<uint8> videobuf;
-  std::vector<uint8> audiobuf;
   
   struct libav_vars *av;
   
+  // Frames pass through a ring of slots: the game thread captures into a
+  // free slot, a pool of workers converts it to YUV, and one thread
+  // encodes the slots in order. AddFrame only waits when every slot is
+  // still in use.
   SDL_Thread *encodeThread;
-  SDL_sem *encodeReady;
-  SDL_sem *fillReady;
-  bool stillEncoding;
+  std::vector<SDL_Thread *> convertThreads;
+  SDL_sem *freeSlots;
+  SDL_sem *convertReady;
+  std::atomic<bool> stillEncoding;
   
   Movie();  
   bool Setup();
   static int Movie_EncodeThread(void *arg);
+  static int Movie_ConvertThread(void *arg);
   void EncodeThread();
+  void ConvertThread();
+  void FinishReadbacks(size_t keep_pending);
   void EncodeVideo(bool last);
   void EncodeAudio(bool last);
 };
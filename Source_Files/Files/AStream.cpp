@@ -38,35 +38,13 @@
  
 #include "AStream.h"
 #include <string.h>
+#include <SDL_endian.h>
 
 using namespace std;
 
-AIStream& AIStream::operator>>(uint8 &value)
-{
-	if(bound_check(1))
-	{
-		value = *(_M_stream_pos++);
-	}
-	return *this;
-}
-
-AIStream& AIStream::operator>>(int8 &value)
-{
-	uint8 UValue = 0;
-	operator>>(UValue);
-	value = int8(UValue);
-
-	return *this;
-}
-
-AIStream& AIStream::operator>>(bool &value)
-{
-  uint8 UValue = 0;
-  operator>>(UValue);
-  value = (UValue != 0);
-
-  return *this;
-}
+// the stream needn't be aligned
+static inline void store16(uint8 *p, uint16 value) { memcpy(p, &value, 2); }
+static inline void store32(uint8 *p, uint32 value) { memcpy(p, &value, 4); }
 
 AIStream& AIStream::read(char *ptr, uint32 count)
 {
@@ -78,228 +56,129 @@ AIStream& AIStream::read(char *ptr, uint32 count)
 	return *this;
 }
 
-AIStream& AIStream::ignore(uint32 count)
+// Copying the list in and swapping it in place lets the compiler vectorize
+// the swap
+AIStream& AIStream::read(uint16 *list, uint32 count)
 {
-	if(bound_check(count))
+	if(bound_check(count, 2))
 	{
-		_M_stream_pos += count;
+		memcpy(list, _M_stream_pos, 2 * count);
+		if(_M_big_endian)
+		{
+			for (uint32 k = 0; k < count; k++)
+				list[k] = SDL_SwapBE16(list[k]);
+		}
+		else
+		{
+			for (uint32 k = 0; k < count; k++)
+				list[k] = SDL_SwapLE16(list[k]);
+		}
+		_M_stream_pos += 2 * count;
 	}
 	return *this;
 }
 
-AOStream& AOStream::operator<<(uint8 value)
+AIStream& AIStream::read(uint32 *list, uint32 count)
 {
-	if(bound_check(1))
+	if(bound_check(count, 4))
 	{
-		*(_M_stream_pos++) = value;
+		memcpy(list, _M_stream_pos, 4 * count);
+		if(_M_big_endian)
+		{
+			for (uint32 k = 0; k < count; k++)
+				list[k] = SDL_SwapBE32(list[k]);
+		}
+		else
+		{
+			for (uint32 k = 0; k < count; k++)
+				list[k] = SDL_SwapLE32(list[k]);
+		}
+		_M_stream_pos += 4 * count;
 	}
 	return *this;
 }
 
-AOStream& AOStream::operator<<(int8 value)
-{
-	return operator<<(uint8(value));
-}
-
-AOStream& AOStream::operator<<(bool value)
-{
-  return operator<<(uint8(value ? 1 : 0));
-}
-
-AOStream& AOStream::write(char *ptr, uint32 count)
+AIStream& AIStream::ignore(uint32 count)
 {
 	if(bound_check(count))
 	{
-		memcpy(_M_stream_pos, ptr, count);
 		_M_stream_pos += count;
 	}
 	return *this;
 }
 
-AOStream& AOStream::ignore(uint32 count)
+AOStream& AOStream::write(char *ptr, uint32 count)
 {
 	if(bound_check(count))
 	{
+		memcpy(_M_stream_pos, ptr, count);
 		_M_stream_pos += count;
 	}
 	return *this;
 }
 
-//big endian
-
-AIStream& AIStreamBE::operator>>(uint16 &value)
-{
-	if(bound_check(2))
-	{
-		// Must be unsigned, so they will be zero-extended
-		uint16 Byte0 = uint16(*(_M_stream_pos++));
-		uint16 Byte1 = uint16(*(_M_stream_pos++));
-
-		value = (Byte0 << 8) | Byte1;
-	}
-	return *this;
-}
-
-AIStream& AIStreamBE::operator>>(int16 &value)
+AOStream& AOStream::write(uint16 *list, uint32 count)
 {
-	uint16 UValue = 0;
-	operator>>(UValue);
-	value = int16(UValue);
-  
-	return *this;
-}
-
-AIStream& AIStreamBE::operator>>(uint32 &value)
-{
-	if(bound_check(4))
+	if(bound_check(count, 2))
 	{
-		// Must be unsigned, so they will be zero-extended
-		uint32 Byte0 = uint32(*(_M_stream_pos++));
-		uint32 Byte1 = uint32(*(_M_stream_pos++));
-		uint32 Byte2 = uint32(*(_M_stream_pos++));
-		uint32 Byte3 = uint32(*(_M_stream_pos++));
-	
-		value = (Byte0 << 24) | (Byte1 << 16) | (Byte2 << 8) | Byte3;
-	}
-	return *this;
-}
-
-AIStream& AIStreamBE::operator>>(int32 &value)
-{
-	uint32 UValue = 0;
-	operator>>(UValue);
-	value = int32(UValue);
-  
-	return *this;
-}
-
-AOStream& AOStreamBE::operator<<(uint16 value)
-{
-	if(bound_check(2))
-	{
-		*(_M_stream_pos++) = uint8(value >> 8);
-		*(_M_stream_pos++) = uint8(value);
-	}
-	return *this;
-}
-
-AOStream& AOStreamBE::operator<<(int16 value)
-{
-	return operator<<(uint16(value));
-}
-
-AOStream& AOStreamBE::operator<<(uint32 value)
-{
-	if(bound_check(4))
-	{
-		*(_M_stream_pos++) = uint8(value >> 24);
-		*(_M_stream_pos++) = uint8(value >> 16);
-		*(_M_stream_pos++) = uint8(value >> 8);
-		*(_M_stream_pos++) = uint8(value);
-	}
-	return *this;
-}
-
-AOStream& AOStreamBE::operator<<(int32 value)
-{
-	return operator<<(uint32(value));
-}
-
-
-// little endian
-
-AIStream& AIStreamLE::operator>>(uint16 &value)
-{
-	if(bound_check(2))
-	{
-		// Must be unsigned, so they will be zero-extended
-		uint16 Byte0 = uint16(*(_M_stream_pos++));
-		uint16 Byte1 = uint16(*(_M_stream_pos++));
-	
-		value = (Byte1 << 8) | Byte0;
-	}
-	return *this;
-}
-
-AIStream& AIStreamLE::operator>>(int16 &value)
-{
-	uint16 UValue = 0;
-	operator>>(UValue);
-	value = int16(UValue);
-  
-	return *this;
-}
-
-AIStream& AIStreamLE::operator>>(uint32 &value)
-{
-	if(bound_check(4))
-	{
-		// Must be unsigned, so they will be zero-extended
-		uint32 Byte0 = uint32(*(_M_stream_pos++));
-		uint32 Byte1 = uint32(*(_M_stream_pos++));
-		uint32 Byte2 = uint32(*(_M_stream_pos++));
-		uint32 Byte3 = uint32(*(_M_stream_pos++));
-	
-		value = (Byte3 << 24) | (Byte2 << 16) | (Byte1 << 8) | Byte0;
+		uint8 *p = _M_stream_pos;
+		if(_M_big_endian)
+		{
+			for (uint32 k = 0; k < count; k++)
+				store16(p + 2 * k, SDL_SwapBE16(list[k]));
+		}
+		else
+		{
+			for (uint32 k = 0; k < count; k++)
+				store16(p + 2 * k, SDL_SwapLE16(list[k]));
+		}
+		_M_stream_pos += 2 * count;
 	}
 	return *this;
 }
 
-AIStream& AIStreamLE::operator>>(int32 &value)
+AOStream& AOStream::write(uint32 *list, uint32 count)
 {
-	uint32 UValue = 0;
-	operator>>(UValue);
-	value = int32(UValue);
-    
-	return *this;
-}
-
-AOStream& AOStreamLE::operator<<(uint16 value)
-{
-	if(bound_check(2))
+	if(bound_check(count, 4))
 	{
-		*(_M_stream_pos++) = uint8(value);
-		*(_M_stream_pos++) = uint8(value >> 8);
+		uint8 *p = _M_stream_pos;
+		if(_M_big_endian)
+		{
+			for (uint32 k = 0; k < count; k++)
+				store32(p + 4 * k, SDL_SwapBE32(list[k]));
+		}
+		else
+		{
+			for (uint32 k = 0; k < count; k++)
+				store32(p + 4 * k, SDL_SwapLE32(list[k]));
+		}
+		_M_stream_pos += 4 * count;
 	}
 	return *this;
 }
 
-AOStream& AOStreamLE::operator<<(int16 value)
-{
-	return operator<<(uint16(value));
-}
-
-AOStream& AOStreamLE::operator<<(uint32 value)
+AOStream& AOStream::ignore(uint32 count)
 {
-	if(bound_check(4))
+	if(bound_check(count))
 	{
-		*(_M_stream_pos++) = uint8(value);
-		*(_M_stream_pos++) = uint8(value >> 8);
-		*(_M_stream_pos++) = uint8(value >> 16);
-		*(_M_stream_pos++) = uint8(value >> 24);
+		_M_stream_pos += count;
 	}
 	return *this;
 }
 
-AOStream& AOStreamLE::operator<<(int32 value)
-{
-	return operator<<(uint32(value));
-}
-
 template<typename T>
-bool AStream::basic_astream<T>::bound_check(uint32 delta)
+void AStream::basic_astream<T>::bound_check_failed()
 {
-	if(_M_stream_pos + delta > _M_stream_end)
+	this->setstate(AStream::failbit);
+	if ((this->exceptions() & AStream::failbit) != 0)
 	{
-		this->setstate(AStream::failbit);
-		if ((this->exceptions() & AStream::failbit) != 0)
-		{
-			throw AStream::failure("serialization bound check failed");
-		}
+		throw AStream::failure("serialization bound check failed");
 	}
-	return !(this->fail());
 }
 
+template class AStream::basic_astream<const uint8>;
+template class AStream::basic_astream<uint8>;
+
 AStream::failure::failure(const std::string& str) noexcept
 {
 	_M_name = strdup(str.c_str());
@@ -73,10 +73,30 @@ namespace AStream
 		T *_M_stream_end;
 		iostate _M_state;
 		iostate _M_exception;
+		void
+		bound_check_failed();
 	protected:
 		T *_M_stream_pos;
 		bool
-		bound_check(uint32 __delta);
+		bound_check(uint32 __delta)
+		{
+			if(_M_stream_pos + __delta > _M_stream_end)
+				bound_check_failed();
+			return !this->fail();
+		}
+
+		// count elements of __size bytes each; checked before multiplying,
+		// so a huge count can't wrap around
+		bool
+		bound_check(uint32 __count, uint32 __size)
+		{
+			if(__count > (max_pos() - tell_pos()) / __size)
+			{
+				bound_check_failed();
+				return false;
+			}
+			return bound_check(__count * __size);
+		}
 		
 		uint32
 		tell_pos() const
@@ -129,12 +149,35 @@ namespace AStream
 
 /* Input Streams, deserializing */
 
+// The byte order is fixed when the stream is made, so reading a value is an
+// inline, non-virtual call whichever of AIStreamBE and AIStreamLE is behind
+// an AIStream&
 class AIStream : public AStream::basic_astream<const uint8>
 {
-public:
-	AIStream(const uint8* __stream, uint32 __length, uint32 __offset) :
-		AStream::basic_astream<const uint8>(__stream, __length, __offset) {}
+	bool _M_big_endian;
+
+	uint16
+	get16(const uint8 *__p) const
+	{
+		return _M_big_endian ?
+			uint16((uint16(__p[0]) << 8) | uint16(__p[1])) :
+			uint16((uint16(__p[1]) << 8) | uint16(__p[0]));
+	}
 
+	uint32
+	get32(const uint8 *__p) const
+	{
+		return _M_big_endian ?
+			(uint32(__p[0]) << 24) | (uint32(__p[1]) << 16) | (uint32(__p[2]) << 8) | uint32(__p[3]) :
+			(uint32(__p[3]) << 24) | (uint32(__p[2]) << 16) | (uint32(__p[1]) << 8) | uint32(__p[0]);
+	}
+
+protected:
+	AIStream(const uint8* __stream, uint32 __length, uint32 __offset, bool __big_endian) :
+		AStream::basic_astream<const uint8>(__stream, __length, __offset),
+		_M_big_endian(__big_endian) {}
+
+public:
 	uint32
 	tellg() const
 	{ return this->tell_pos(); }
@@ -144,25 +187,70 @@ public:
 	{ return this->max_pos(); }
 
 	AIStream&
-	operator>>(uint8 &__value);
+	operator>>(uint8 &__value)
+	{
+		if(bound_check(1))
+			__value = *(_M_stream_pos++);
+		return *this;
+	}
 	
 	AIStream&
-	operator>>(int8 &__value);
+	operator>>(int8 &__value)
+	{
+		uint8 UValue = 0;
+		operator>>(UValue);
+		__value = int8(UValue);
+		return *this;
+	}
 	
-	virtual AIStream&
-	  operator>>(bool &__value);
+	AIStream&
+	operator>>(bool &__value)
+	{
+		uint8 UValue = 0;
+		operator>>(UValue);
+		__value = (UValue != 0);
+		return *this;
+	}
   
-	virtual AIStream&
-	operator>>(uint16 &__value) = 0;
+	AIStream&
+	operator>>(uint16 &__value)
+	{
+		if(bound_check(2))
+		{
+			__value = get16(_M_stream_pos);
+			_M_stream_pos += 2;
+		}
+		return *this;
+	}
 	
-	virtual AIStream&
-	operator>>(int16 &__value) = 0;
+	AIStream&
+	operator>>(int16 &__value)
+	{
+		uint16 UValue = 0;
+		operator>>(UValue);
+		__value = int16(UValue);
+		return *this;
+	}
 	
-	virtual AIStream&
-	operator>>(uint32 &__value) = 0;
+	AIStream&
+	operator>>(uint32 &__value)
+	{
+		if(bound_check(4))
+		{
+			__value = get32(_M_stream_pos);
+			_M_stream_pos += 4;
+		}
+		return *this;
+	}
 	
-	virtual AIStream&
-	operator>>(int32 &__value) = 0;
+	AIStream&
+	operator>>(int32 &__value)
+	{
+		uint32 UValue = 0;
+		operator>>(UValue);
+		__value = int32(UValue);
+		return *this;
+	}
 
 	AIStream&
 	read(char *__ptr, uint32 __count);
@@ -174,6 +262,22 @@ public:
 	AIStream&
 	read(signed char * __ptr, uint32 __count)
 	{ return read((char *) __ptr, __count); }
+
+	// Bounds-checked once for the whole list, so nothing is read if it
+	// doesn't all fit
+	AIStream&
+	read(uint16 *__list, uint32 __count);
+
+	AIStream&
+	read(int16 *__list, uint32 __count)
+	{ return read(reinterpret_cast<uint16 *>(__list), __count); }
+
+	AIStream&
+	read(uint32 *__list, uint32 __count);
+
+	AIStream&
+	read(int32 *__list, uint32 __count)
+	{ return read(reinterpret_cast<uint32 *>(__list), __count); }
 	
 	AIStream&
 	ignore(uint32 __count);
@@ -196,64 +300,62 @@ class AIStreamBE : public AIStream
 {
 public:
 	AIStreamBE(const uint8* __stream, uint32 __length, uint32 __offset = 0) :
-		AIStream(__stream, __length, __offset) {};
-
-	AIStream& 
-	operator>>(uint8 &__value)
-		{ return AIStream::operator>>(__value); }
-
-	AIStream&
-	operator>>(int8 &__value)
-		{ return AIStream::operator>>(__value); }
-	
-	AIStream&
-	operator>>(uint16 &__value);
-	
-	AIStream&
-	operator>>(int16 &__value);
-	
-	AIStream&
-	operator>>(uint32 &__value);
-	
-	AIStream&
-	operator>>(int32 &__value);
+		AIStream(__stream, __length, __offset, true) {};
 };
 
 class AIStreamLE : public AIStream
 {
 public:
 	AIStreamLE(const uint8* __stream, uint32 __length, uint32 __offset = 0) :
-		AIStream(__stream, __length, __offset) {};
-
-  	AIStream& 
-	operator>>(uint8 &__value)
-		{ return AIStream::operator>>(__value); }
-
-	AIStream&
-	operator>>(int8 &__value)
-		{ return AIStream::operator>>(__value); }
-
-	AIStream&
-	operator>>(uint16 &__value);
-	
-	AIStream&
-	operator>>(int16 &__value);
-	
-	AIStream&
-	operator>>(uint32 &__value);
-	
-	AIStream&
-	operator>>(int32 &__value);
+		AIStream(__stream, __length, __offset, false) {};
 };
 
 /* Output Streams, serializing */
 
 class AOStream : public AStream::basic_astream<uint8>
 {
-public:
-	AOStream(uint8* __stream, uint32 __length, uint32 __offset) :
-		AStream::basic_astream<uint8>(__stream, __length, __offset) {}
+	bool _M_big_endian;
 
+	void
+	put16(uint8 *__p, uint16 __value) const
+	{
+		if(_M_big_endian)
+		{
+			__p[0] = uint8(__value >> 8);
+			__p[1] = uint8(__value);
+		}
+		else
+		{
+			__p[0] = uint8(__value);
+			__p[1] = uint8(__value >> 8);
+		}
+	}
+
+	void
+	put32(uint8 *__p, uint32 __value) const
+	{
+		if(_M_big_endian)
+		{
+			__p[0] = uint8(__value >> 24);
+			__p[1] = uint8(__value >> 16);
+			__p[2] = uint8(__value >> 8);
+			__p[3] = uint8(__value);
+		}
+		else
+		{
+			__p[0] = uint8(__value);
+			__p[1] = uint8(__value >> 8);
+			__p[2] = uint8(__value >> 16);
+			__p[3] = uint8(__value >> 24);
+		}
+	}
+
+protected:
+	AOStream(uint8* __stream, uint32 __length, uint32 __offset, bool __big_endian) :
+		AStream::basic_astream<uint8>(__stream, __length, __offset),
+		_M_big_endian(__big_endian) {}
+
+public:
 	uint32
 	tellp() const
 	{ return this->tell_pos(); }
@@ -263,25 +365,50 @@ public:
 	{ return this->max_pos(); }
 		
 	AOStream&
-	operator<<(uint8 __value);
+	operator<<(uint8 __value)
+	{
+		if(bound_check(1))
+			*(_M_stream_pos++) = __value;
+		return *this;
+	}
 	
 	AOStream&
-	operator<<(int8 __value);
+	operator<<(int8 __value)
+	{ return operator<<(uint8(__value)); }
 
-	virtual AOStream&
-        operator<<(bool __value);  
+	AOStream&
+	operator<<(bool __value)
+	{ return operator<<(uint8(__value ? 1 : 0)); }
 
-	virtual AOStream&
-	operator<<(uint16 __value) = 0;
+	AOStream&
+	operator<<(uint16 __value)
+	{
+		if(bound_check(2))
+		{
+			put16(_M_stream_pos, __value);
+			_M_stream_pos += 2;
+		}
+		return *this;
+	}
 	
-	virtual AOStream&
-	operator<<(int16 __value) = 0;
+	AOStream&
+	operator<<(int16 __value)
+	{ return operator<<(uint16(__value)); }
 	
-	virtual AOStream&
-	operator<<(uint32 __value) = 0;
+	AOStream&
+	operator<<(uint32 __value)
+	{
+		if(bound_check(4))
+		{
+			put32(_M_stream_pos, __value);
+			_M_stream_pos += 4;
+		}
+		return *this;
+	}
 	
-	virtual AOStream&
-	operator<<(int32 __value) = 0;
+	AOStream&
+	operator<<(int32 __value)
+	{ return operator<<(uint32(__value)); }
 
 
 	AOStream&
@@ -294,6 +421,22 @@ public:
 	AOStream&
 	write(signed char * __ptr, uint32 __count)
 	{ return write((char *) __ptr, __count); }
+
+	// Bounds-checked once for the whole list, so nothing is written if it
+	// doesn't all fit
+	AOStream&
+	write(uint16 *__list, uint32 __count);
+
+	AOStream&
+	write(int16 *__list, uint32 __count)
+	{ return write(reinterpret_cast<uint16 *>(__list), __count); }
+
+	AOStream&
+	write(uint32 *__list, uint32 __count);
+
+	AOStream&
+	write(int32 *__list, uint32 __count)
+	{ return write(reinterpret_cast<uint32 *>(__list), __count); }
 	
 	AOStream& ignore(uint32 __count);
 
@@ -314,54 +457,14 @@ class AOStreamBE: public AOStream
 {
 public:
 	AOStreamBE(uint8* __stream, uint32 __length, uint32 __offset = 0) :
-		AOStream(__stream, __length, __offset) {};
-
-	AOStream&
-	operator<<(uint8 __value)
-		{ return AOStream::operator<<(__value); }
-
-	AOStream&
-	operator<<(int8 __value)
-		{ return AOStream::operator<<(__value); }
-  
-	AOStream&
-	operator<<(uint16 __value);
-	
-	AOStream&
-	operator<<(int16 __value);
-	
-	AOStream&
-	operator<<(uint32 __value);
-	
-	AOStream&
-	operator<<(int32 __value);
+		AOStream(__stream, __length, __offset, true) {};
 };
 
 class AOStreamLE: public AOStream
 {
 public:
 	AOStreamLE(uint8* __stream, uint32 __length, uint32 __offset = 0) :
-		AOStream(__stream, __length, __offset) {}
-
-  	AOStream&
-	operator<<(uint8 __value)
-		{ return AOStream::operator<<(__value); }
-
-	AOStream&
-	operator<<(int8 __value)
-		{ return AOStream::operator<<(__value); }
- 
-	AOStream&
-	operator<<(uint16 __value);
-	
-	AOStream&
-	operator<<(int16 __value);
-	
-	AOStream&
-	operator<<(uint32 __value);
-	
-	AOStream&
-	operator<<(int32 __value);
+		AOStream(__stream, __length, __offset, false) {}
 };
 
 #endif
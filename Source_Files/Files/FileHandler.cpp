@@ -56,6 +56,7 @@
 #ifdef HAVE_ZZIP
 #include <zzip/lib.h>
 #include "SDL_rwops_zzip.h"
+#include "zip_archive_cache.h"
 #endif
 
 #if defined(__WIN32__)
@@ -416,8 +417,21 @@ bool FileSpecifier::Open(OpenedFile &OFile, bool Writable)
 #ifdef HAVE_ZZIP
 		if (!Writable)
 		{
-			f = OFile.f = SDL_RWFromZZIP(unix_path_separators(GetPath()).c_str(), &utf8_zzip_io());
+			// zip archives are indexed once for the whole process; zzip
+			// only reads what the index can't
+			f = OFile.f = SDL_RWFromFile(GetPath(), "rb");
 			err = f ? 0 : errno;
+			if (!f)
+			{
+				const auto n = unix_path_separators(GetPath());
+				f = OFile.f = open_zip_archive_member(n);
+				if (!f && errno == ENOTSUP)
+					f = OFile.f = SDL_RWFromZZIP(n.c_str(), &utf8_zzip_io());
+				if (f)
+					err = 0;
+				else if (errno != ENOENT || err == 0)
+					err = errno;
+			}
 		} 
 		else {
 			f = OFile.f = SDL_RWFromFile(GetPath(), "wb+");
@@ -492,8 +506,13 @@ bool FileSpecifier::Exists()
 #ifdef HAVE_ZZIP
 	if (err)
 	{
-		// Check whether zzip can open the file (slow!)
 		const auto n = unix_path_separators(name);
+		if (zip_archive_member_exists(n))
+			return true;
+		else if (errno != ENOTSUP)
+			return false;
+
+		// Check whether zzip can open the file (slow!)
 		ZZIP_FILE* file = zzip_open_ext_io(n.c_str(), O_RDONLY|o_binary, ZZIP_ONLYZIP, nullptr, &utf8_zzip_io());
 		if (file)
 		{
@@ -526,6 +545,15 @@ TimeType FileSpecifier::GetDate()
 	return err == 0 ? mtime : 0;
 }
 
+// Set modification date
+bool FileSpecifier::SetDate(TimeType Date)
+{
+	sys::error_code ec;
+	fs::last_write_time(utf8_to_path(name), Date, ec);
+	err = to_posix_code_or_unknown(ec);
+	return err == 0;
+}
+
 static const char * alephone_extensions[] = {
 	".sceA",
 	".sgaA",
@@ -945,6 +973,14 @@ bool FileSpecifier::ReadZIP(vector<string> &vec)
 	vec.clear();
 	
 #ifdef HAVE_ZZIP
+	if (read_zip_archive_directory(unix_path_separators(name), vec))
+		return true;
+	else if (errno != ENOTSUP)
+	{
+		err = errno;
+		return false;
+	}
+
 	const auto zip = zzip_dir_open_ext_io(unix_path_separators(name).c_str(), nullptr, nullptr, &utf8_zzip_io());
 	if (!zip)
 	{
@@ -286,6 +286,9 @@ public:
 	
 	// Gets the modification date
 	TimeType GetDate();
+
+	// Sets the modification date
+	bool SetDate(TimeType Date);
 	
 	// Returns _typecode_unknown if the type could not be identified;
 	// the types returned are the _typecode_stuff in tags.h
@@ -146,3 +146,59 @@
     ValueToStreamLE(Stream,uint32(Value));
 }
 
+
+// 16-bit lists, in loops simple enough for the compiler to vectorize
+
+ void StreamToListBE(uint8* &Stream, uint16* List, size_t Count)
+{
+    for (size_t k = 0; k < Count; k++)
+        List[k] = uint16((uint16(Stream[2*k]) << 8) | uint16(Stream[2*k+1]));
+    Stream += 2*Count;
+}
+
+ void StreamToListBE(uint8* &Stream, int16* List, size_t Count)
+{
+    StreamToListBE(Stream,reinterpret_cast<uint16*>(List),Count);
+}
+
+ void ListToStreamBE(uint8* &Stream, uint16* List, size_t Count)
+{
+    for (size_t k = 0; k < Count; k++)
+    {
+        Stream[2*k] = uint8(List[k] >> 8);
+        Stream[2*k+1] = uint8(List[k]);
+    }
+    Stream += 2*Count;
+}
+
+ void ListToStreamBE(uint8* &Stream, int16* List, size_t Count)
+{
+    ListToStreamBE(Stream,reinterpret_cast<uint16*>(List),Count);
+}
+
+ void StreamToListLE(uint8* &Stream, uint16* List, size_t Count)
+{
+    for (size_t k = 0; k < Count; k++)
+        List[k] = uint16((uint16(Stream[2*k+1]) << 8) | uint16(Stream[2*k]));
+    Stream += 2*Count;
+}
+
+ void StreamToListLE(uint8* &Stream, int16* List, size_t Count)
+{
+    StreamToListLE(Stream,reinterpret_cast<uint16*>(List),Count);
+}
+
+ void ListToStreamLE(uint8* &Stream, uint16* List, size_t Count)
+{
+    for (size_t k = 0; k < Count; k++)
+    {
+        Stream[2*k] = uint8(List[k]);
+        Stream[2*k+1] = uint8(List[k] >> 8);
+    }
+    Stream += 2*Count;
+}
+
+ void ListToStreamLE(uint8* &Stream, int16* List, size_t Count)
+{
+    ListToStreamLE(Stream,reinterpret_cast<uint16*>(List),Count);
+}
@@ -53,6 +53,9 @@
 
 Aug 27, 2002 (Alexander Strange):
 	Moved functions to Packing.cpp to get around inlining issues.
+
+	Lists of 16-bit values, which is most of a map, are converted in a single call to
+	Packing.cpp instead of one call per value.
 */
 
 #include "cstypes.h"
@@ -73,11 +76,15 @@ Aug 27, 2002 (Alexander Strange):
 #ifdef PACKED_DATA_IS_BIG_ENDIAN
 #define StreamToValue StreamToValueBE
 #define ValueToStream ValueToStreamBE
+#define StreamToList StreamToListBE
+#define ListToStream ListToStreamBE
 #endif
 
 #ifdef PACKED_DATA_IS_LITTLE_ENDIAN
 #define StreamToValue StreamToValueLE
 #define ValueToStream ValueToStreamLE
+#define StreamToList StreamToListLE
+#define ListToStream ListToStreamLE
 #endif
 
 extern void StreamToValue(uint8* &Stream, uint16 &Value);
@@ -89,6 +96,12 @@ extern void ValueToStream(uint8* &Stream, int16 Value);
 extern void ValueToStream(uint8* &Stream, uint32 Value);
 extern void ValueToStream(uint8* &Stream, int32 Value);
 
+// Preferred over the templates below for 16-bit lists
+extern void StreamToList(uint8* &Stream, uint16* List, size_t Count);
+extern void StreamToList(uint8* &Stream, int16* List, size_t Count);
+extern void ListToStream(uint8* &Stream, uint16* List, size_t Count);
+extern void ListToStream(uint8* &Stream, int16* List, size_t Count);
+
 #ifndef PACKING_INTERNAL
 template<class T> inline static void StreamToList(uint8* &Stream, T* List, size_t Count)
 {
@@ -612,15 +612,14 @@ bool get_indexed_entry_point(
 		// Old style wad, find the index
 		for(actual_index= *index; !success && actual_index<header.wad_count; ++actual_index)
 		{
-			struct wad_data *wad;
+			size_t length;
+			uint8 *p;
 
-			/* Read the file */
-			wad= read_indexed_wad_from_file(MapFile, &header, actual_index, true);
-			if (wad)
+			/* Read just the map info */
+			p = (uint8 *)read_type_from_indexed_wad(MapFile, &header, actual_index, MAP_INFO_TAG, &length);
+			if (p)
 			{
 				/* IF this has the proper type.. */
-				size_t length;
-				uint8 *p = (uint8 *)extract_type_from_wad(wad, MAP_INFO_TAG, &length);
 				assert(length == SIZEOF_static_data);
 				static_data map_info;
 				unpack_static_data(p, &map_info, 1);
@@ -650,7 +649,7 @@ bool get_indexed_entry_point(
 					success= true;
 				}
 				
-				free_wad(wad);
+				free(p);
 			}
 		}
 	}
@@ -706,13 +705,12 @@ bool get_entry_points(vector<entry_point> &vec, int32 type)
 		// Old style wad
 		for (int i=0; i<header.wad_count; i++) {
 
-			wad_data *wad = read_indexed_wad_from_file(MapFile, &header, i, true);
-			if (!wad)
+			// Read just the map_info data
+			size_t length;
+			uint8 *p = (uint8 *)read_type_from_indexed_wad(MapFile, &header, i, MAP_INFO_TAG, &length);
+			if (!p)
 				continue;
 
-			// Read map_info data
-			size_t length;
-			uint8 *p = (uint8 *)extract_type_from_wad(wad, MAP_INFO_TAG, &length);
 			assert(length == SIZEOF_static_data);
 			static_data map_info;
 			unpack_static_data(p, &map_info, 1);
@@ -742,7 +740,7 @@ bool get_entry_points(vector<entry_point> &vec, int32 type)
 				success = true;
 			}
 				
-			free_wad(wad);
+			free(p);
 		}
 	}
 
@@ -1299,6 +1297,86 @@ bool revert_game(
 	return successful;
 }
 
+/* A film keyframe is a saved game that never leaves memory */
+struct wad_data *build_film_keyframe_wad(
+	void)
+{
+	struct wad_header header;
+	int32 wad_length;
+
+	dynamic_world->random_seed= get_random_seed();
+
+	obj_clear(header);
+	header.version= CURRENT_WADFILE_VERSION;
+	header.data_version= EDITOR_MAP_VERSION;
+	header.wad_count= 1;
+
+	return build_save_game_wad(&header, &wad_length);
+}
+
+/* Loads a keyframe the way load_game_from_file() loads a saved game, then undoes the parts of
+	entering a map that a saved game wants but a film doesn't: the film was recorded without
+	the monsters forgetting their paths or the scenery being reshuffled. Films only get
+	keyframes while no script is running, so there is no init(true) to run again here. */
+bool restore_film_keyframe_wad(
+	struct wad_data *wad)
+{
+	dynamic_data keyframe_world;
+	short viewed_player_index= current_player_index;
+	size_t data_length;
+	uint8 *data;
+	bool success;
+
+	get_dynamic_data_from_wad(wad, &keyframe_world);
+
+	leaving_map();
+	if (keyframe_world.current_level_number!=dynamic_world->current_level_number)
+	{
+		SoundManager::instance()->UnloadAllSounds();
+		ResetLevelScript();
+		RunLevelScript(keyframe_world.current_level_number);
+	}
+
+	ResetPassedLua();
+	if (!process_map_wad(wad, true, EDITOR_MAP_VERSION)) return false;
+
+	short SavedType, SavedError = get_game_error(&SavedType);
+	if (dynamic_world->player_count==1)
+	{
+		LoadSoloLua();
+	}
+	else
+	{
+		LoadReplayNetLua();
+	}
+	LoadStatsLua();
+	set_game_error(SavedType,SavedError);
+
+	Music::instance()->PreloadLevelMusic();
+	RunLuaScript();
+	success= entering_map(true /*restoring game*/);
+
+	data= (uint8 *)extract_type_from_wad(wad, MONSTERS_STRUCTURE_TAG, &data_length);
+	unpack_monster_data(data,monsters,data_length/SIZEOF_monster_data);
+	data= (uint8 *)extract_type_from_wad(wad, OBJECT_STRUCTURE_TAG, &data_length);
+	unpack_object_data(data,objects,data_length/SIZEOF_object_data);
+	invalidate_all_polygon_collidable_objects();
+	set_random_seed(dynamic_world->random_seed);
+
+	if (viewed_player_index<dynamic_world->player_count) set_current_player_index(viewed_player_index);
+
+	if (success)
+	{
+		update_interface(NONE);
+		ChaseCam_Reset();
+		ResetFieldOfView();
+		reset_messages();
+		ReloadViewContext();
+	}
+
+	return success;
+}
+
 bool export_level(FileSpecifier& File)
 {
 	struct wad_header header;
@@ -1631,6 +1709,7 @@ bool process_map_wad(
 				map_polygons[count].first_object= NONE;
 			}
 		}
+		invalidate_all_polygon_collidable_objects();
 	}
 
 	/* Extract the annotations */
@@ -2630,6 +2709,8 @@ static void complete_restoring_level(
 	ok_to_reset_scenery_solidity = false;
 	/* Loading games needs this done. */
 	reset_action_queues();
+	/* The object lists came straight out of the saved game */
+	invalidate_all_polygon_collidable_objects();
 }
 
 
@@ -2641,25 +2722,15 @@ FileSpecifier& get_map_file()
 
 void level_has_embedded_physics_lua(int Level, bool& HasPhysics, bool& HasLua)
 {
-	// load the wad file and look for chunks !!??
+	// look for chunks in the level's entry headers, without reading the level
 	wad_header header;
-	wad_data* wad;
 	OpenedFile MapFile;
 	if (open_wad_file_for_reading(get_map_file(), MapFile))
 	{
 		if (read_wad_header(MapFile, &header))
 		{
-			wad = read_indexed_wad_from_file(MapFile, &header, Level, true);
-			if (wad)
-			{
-				size_t data_length;
-				extract_type_from_wad(wad, PHYSICS_PHYSICS_TAG, &data_length);
-				HasPhysics = data_length > 0;
-
-				extract_type_from_wad(wad, LUAS_TAG, &data_length);
-				HasLua = data_length > 0;
-				free_wad(wad);
-			}
+			HasPhysics = length_of_type_in_indexed_wad(MapFile, &header, Level, PHYSICS_PHYSICS_TAG) > 0;
+			HasLua = length_of_type_in_indexed_wad(MapFile, &header, Level, LUAS_TAG) > 0;
 		}
 		close_wad_file(MapFile);
 	}
@@ -54,6 +54,10 @@ void set_saved_game_name_to_default();
 // ZZZ: exposed this for netgame-resuming code
 bool process_map_wad(struct wad_data *wad, bool restoring_game, short version);
 
+// in-memory saved games for seeking through films
+struct wad_data *build_film_keyframe_wad(void);
+bool restore_film_keyframe_wad(struct wad_data *wad);
+
 bool match_checksum_with_map(short vRefNum, long dirID, uint32 checksum, 
 	FileSpecifier& File);
 void set_map_file(FileSpecifier& File, bool runScript = true);
@@ -0,0 +1,362 @@
+/*
+ *  map_index_cache.cpp -- disk cache of precalculated map indexes
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+*/
+
+#include "map_index_cache.h"
+
+#include "cseries.h"
+#include "crc.h"
+#include "FileHandler.h"
+#include "FilmProfile.h"
+#include "Logging.h"
+#include "map.h"
+#include "Packing.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+// a scenario's levels plus a rotation of net maps; a file is tens of
+// kilobytes
+enum { kMaximumCachedLevels = 128 };
+
+// change this whenever precalculate_map_indexes() finds anything different
+// from the same map
+enum { kMapIndexCacheVersion = 1 };
+
+// per polygon: first_exclusion_zone_index, line_exclusion_zone_count,
+// point_exclusion_zone_count, first_neighbor_index, neighbor_count and
+// sound_source_indexes
+enum { kFieldsPerPolygon = 6 };
+
+// key crc and length, polygon count, index count ... crc of the rest
+enum { kHeaderSize = 4 + 4 + 2 + 4, kTrailerSize = 4 };
+
+// a partial file this old was left by a write that will never finish
+enum { kAbandonedWriteAge = 60 * 60 };
+
+static const char *kCacheDirectoryName = "Map Index Cache";
+
+// partial files are named <key name>.part-<random>
+static const char *kPartialFileMarker = ".part-";
+
+struct map_index_key
+{
+	uint32 crc;
+	uint32 length;
+};
+
+static DirectorySpecifier cache_directory()
+{
+	DirectorySpecifier dir;
+	dir.SetToLocalDataDir();
+	dir.AddPart(kCacheDirectoryName);
+	return dir;
+}
+
+static std::string name_for_key(const map_index_key& key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%08x-%u", key.crc, key.length);
+	return name;
+}
+
+static bool is_key_name(const std::string& name)
+{
+	unsigned int crc, length;
+	int consumed = 0;
+	return sscanf(name.c_str(), "%8x-%u%n", &crc, &length, &consumed) == 2 && consumed == static_cast<int>(name.size());
+}
+
+// everything precalculate_map_indexes() reads from the map
+static map_index_key key_for_current_map()
+{
+	std::vector<int16> fields;
+
+	fields.push_back(kMapIndexCacheVersion);
+	fields.push_back(film_profile.adjacent_polygons_always_intersect);
+	fields.push_back(dynamic_world->polygon_count);
+	fields.push_back(dynamic_world->line_count);
+	fields.push_back(dynamic_world->endpoint_count);
+
+	for (short i = 0; i < dynamic_world->polygon_count; ++i)
+	{
+		polygon_data *polygon = map_polygons + i;
+		fields.push_back(polygon->type);
+		fields.push_back(polygon->flags);
+		fields.push_back(polygon->vertex_count);
+		fields.push_back(polygon->floor_height);
+		fields.push_back(polygon->ceiling_height);
+		fields.insert(fields.end(), polygon->endpoint_indexes, polygon->endpoint_indexes + polygon->vertex_count);
+		fields.insert(fields.end(), polygon->line_indexes, polygon->line_indexes + polygon->vertex_count);
+		fields.insert(fields.end(), polygon->adjacent_polygon_indexes, polygon->adjacent_polygon_indexes + polygon->vertex_count);
+	}
+
+	for (short i = 0; i < dynamic_world->line_count; ++i)
+	{
+		line_data *line = map_lines + i;
+		fields.push_back(line->endpoint_indexes[0]);
+		fields.push_back(line->endpoint_indexes[1]);
+		fields.push_back(line->flags);
+		fields.push_back(line->highest_adjacent_floor);
+		fields.push_back(line->lowest_adjacent_ceiling);
+		fields.push_back(line->clockwise_polygon_owner);
+		fields.push_back(line->counterclockwise_polygon_owner);
+	}
+
+	for (short i = 0; i < dynamic_world->endpoint_count; ++i)
+	{
+		fields.push_back(map_endpoints[i].vertex.x);
+		fields.push_back(map_endpoints[i].vertex.y);
+	}
+
+	for (short i = 0; i < dynamic_world->initial_objects_count; ++i)
+	{
+		if (saved_objects[i].type == _saved_sound_source)
+		{
+			fields.push_back(i);
+			fields.push_back(saved_objects[i].location.x);
+			fields.push_back(saved_objects[i].location.y);
+		}
+	}
+
+	std::vector<uint8> packed(fields.size() * 2);
+	uint8 *stream = packed.data();
+	ListToStream(stream, fields.data(), fields.size());
+
+	map_index_key key;
+	key.crc = calculate_data_crc(packed.data(), static_cast<int32>(packed.size()));
+	key.length = static_cast<uint32>(packed.size());
+	return key;
+}
+
+static bool newer_entry(const dir_entry& a, const dir_entry& b)
+{
+	return a.date > b.date;
+}
+
+// keeps the most recently used entries, and partial files until they are
+// abandoned, since another copy of the game may still be writing them;
+// leaves anything else alone
+static void trim_cache(DirectorySpecifier& dir)
+{
+	std::vector<dir_entry> entries;
+	if (!dir.ReadDirectory(entries))
+		return;
+
+	std::sort(entries.begin(), entries.end(), newer_entry);
+	time_t now = time(NULL);
+	int kept = 0;
+	for (std::vector<dir_entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+	{
+		if (it->is_directory)
+			continue;
+
+		bool remove;
+		if (is_key_name(it->name))
+			remove = kept++ >= kMaximumCachedLevels;
+		else
+			remove = it->name.find(kPartialFileMarker) != std::string::npos && now - it->date > kAbandonedWriteAge;
+
+		if (remove)
+		{
+			FileSpecifier file = dir;
+			file.AddPart(it->name);
+			file.Delete();
+		}
+	}
+}
+
+static bool restore_map_indexes(const map_index_key& key, std::vector<uint8>& buffer)
+{
+	if (buffer.size() < kHeaderSize + kTrailerSize)
+		return false;
+
+	size_t body_length = buffer.size() - kTrailerSize;
+	uint8 *stream = buffer.data() + body_length;
+	uint32 crc;
+	StreamToValue(stream, crc);
+	if (crc != calculate_data_crc(buffer.data(), static_cast<int32>(body_length)))
+		return false;
+
+	stream = buffer.data();
+	uint32 key_crc, key_length;
+	int16 polygon_count;
+	uint32 index_count;
+	StreamToValue(stream, key_crc);
+	StreamToValue(stream, key_length);
+	StreamToValue(stream, polygon_count);
+	StreamToValue(stream, index_count);
+	if (key_crc != key.crc || key_length != key.length || polygon_count != dynamic_world->polygon_count)
+		return false;
+
+	size_t polygon_fields = static_cast<size_t>(polygon_count) * kFieldsPerPolygon;
+	if (body_length != kHeaderSize + 2 * (polygon_fields + index_count))
+		return false;
+
+	size_t first_map_index = MapIndexList.size();
+	assert(first_map_index == static_cast<size_t>(dynamic_world->map_index_count));
+	if (first_map_index + index_count > INT16_MAX)
+		return false;
+
+	std::vector<int16> fields(polygon_fields);
+	StreamToList(stream, fields.data(), polygon_fields);
+
+	// check every list fits before touching the map
+	for (short i = 0; i < polygon_count; ++i)
+	{
+		const int16 *f = &fields[i * kFieldsPerPolygon];
+		if (f[0] < 0 || f[1] < 0 || f[2] < 0 || f[3] < 0 || f[4] < 0 || f[5] < 0)
+			return false;
+		if (!POLYGON_IS_DETACHED(map_polygons + i) &&
+		    (f[0] + f[1] + f[2] > static_cast<int32>(index_count) || f[3] + f[4] > static_cast<int32>(index_count)))
+			return false;
+		if (f[5] >= static_cast<int32>(index_count))
+			return false;
+	}
+
+	MapIndexList.resize(first_map_index + index_count);
+	StreamToList(stream, MapIndexList.data() + first_map_index, index_count);
+	dynamic_world->map_index_count = static_cast<int16>(first_map_index + index_count);
+
+	for (short i = 0; i < polygon_count; ++i)
+	{
+		polygon_data *polygon = map_polygons + i;
+		const int16 *f = &fields[i * kFieldsPerPolygon];
+		if (!POLYGON_IS_DETACHED(polygon))
+		{
+			polygon->first_exclusion_zone_index = static_cast<int16>(first_map_index + f[0]);
+			polygon->line_exclusion_zone_count = f[1];
+			polygon->point_exclusion_zone_count = f[2];
+			polygon->first_neighbor_index = static_cast<int16>(first_map_index + f[3]);
+			polygon->neighbor_count = f[4];
+		}
+		polygon->sound_source_indexes = static_cast<int16>(first_map_index + f[5]);
+	}
+
+	return true;
+}
+
+bool load_cached_map_indexes(void)
+{
+	map_index_key key = key_for_current_map();
+
+	FileSpecifier file = cache_directory();
+	file.AddPart(name_for_key(key));
+
+	OpenedFile of;
+	if (!file.Open(of))
+		return false;
+
+	int32 length;
+	if (!of.GetLength(length) || length < 0)
+		return false;
+
+	std::vector<uint8> buffer(length);
+	if (!of.Read(length, buffer.data()) || !restore_map_indexes(key, buffer))
+	{
+		logWarning("discarding damaged map index cache entry %s", file.GetPath());
+		of.Close();
+		file.Delete();
+		return false;
+	}
+
+	// entries are trimmed by date, so a hit keeps this one
+	of.Close();
+	file.SetDate(time(NULL));
+	return true;
+}
+
+void store_cached_map_indexes(short first_map_index)
+{
+	assert(first_map_index >= 0 && static_cast<size_t>(first_map_index) <= MapIndexList.size());
+	if (MapIndexList.size() > INT16_MAX)
+		return;
+
+	DirectorySpecifier dir = cache_directory();
+	if (!dir.Exists() && !dir.CreateDirectory())
+	{
+		logWarning("could not create map index cache directory");
+		return;
+	}
+
+	map_index_key key = key_for_current_map();
+	FileSpecifier file = dir;
+	file.AddPart(name_for_key(key));
+	if (file.Exists())
+		return;
+
+	std::vector<int16> fields;
+	for (short i = 0; i < dynamic_world->polygon_count; ++i)
+	{
+		polygon_data *polygon = map_polygons + i;
+		if (POLYGON_IS_DETACHED(polygon))
+		{
+			fields.insert(fields.end(), kFieldsPerPolygon - 1, 0);
+		}
+		else
+		{
+			fields.push_back(polygon->first_exclusion_zone_index - first_map_index);
+			fields.push_back(polygon->line_exclusion_zone_count);
+			fields.push_back(polygon->point_exclusion_zone_count);
+			fields.push_back(polygon->first_neighbor_index - first_map_index);
+			fields.push_back(polygon->neighbor_count);
+		}
+		fields.push_back(polygon->sound_source_indexes - first_map_index);
+	}
+
+	uint32 index_count = static_cast<uint32>(MapIndexList.size() - first_map_index);
+	std::vector<uint8> buffer(kHeaderSize + 2 * (fields.size() + index_count) + kTrailerSize);
+	uint8 *stream = buffer.data();
+	ValueToStream(stream, key.crc);
+	ValueToStream(stream, key.length);
+	ValueToStream(stream, dynamic_world->polygon_count);
+	ValueToStream(stream, index_count);
+	ListToStream(stream, fields.data(), fields.size());
+	ListToStream(stream, MapIndexList.data() + first_map_index, index_count);
+	ValueToStream(stream, calculate_data_crc(buffer.data(), static_cast<int32>(stream - buffer.data())));
+	assert(stream == buffer.data() + buffer.size());
+
+	// write under a temporary name so a partial file is never mistaken for
+	// a cache entry
+	FileSpecifier partial = dir;
+	partial.AddPart(name_for_key(key) + kPartialFileMarker);
+	FileSpecifier temp;
+	temp.SetTempName(partial);
+	if (!temp.Create(_typecode_unknown))
+		return;
+
+	bool written = false;
+	{
+		OpenedFile of;
+		if (temp.Open(of, true))
+			written = of.Write(static_cast<int32>(buffer.size()), buffer.data());
+	}
+
+	if (!written || !temp.Rename(file))
+	{
+		logWarning("could not write %s to map index cache", file.GetPath());
+		temp.Delete();
+		return;
+	}
+
+	trim_cache(dir);
+}
@@ -0,0 +1,36 @@
+/*
+ *  map_index_cache.h -- disk cache of precalculated map indexes
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	The exclusion zones, neighbors and sound sources precalculate_map_indexes()
+	finds for a level are kept in the local data directory, named by a checksum
+	of the geometry and sound sources they are found from, so loading the same
+	level again (or reverting it) reads them back instead.
+*/
+
+#ifndef MAP_INDEX_CACHE_H
+#define MAP_INDEX_CACHE_H
+
+// adds the cached map indexes of the level being loaded to the map indexes,
+// and points its polygons at them; false if they aren't cached
+bool load_cached_map_indexes(void);
+
+// caches the map indexes precalculate_map_indexes() added from first_map_index on
+void store_cached_map_indexes(short first_map_index);
+
+#endif
@@ -111,6 +111,8 @@ static short get_entry_header_length(struct wad_header *header);
 static bool read_indexed_directory_data(OpenedFile& OFile, struct wad_header *header,
 	short index, struct directory_entry *entry);
 static int32 calculate_raw_wad_length(struct wad_header *file_header, uint8 *wad);
+static bool find_type_in_indexed_wad(OpenedFile& OFile, struct wad_header *header, short index,
+	WadDataType type, int32 *offset, int32 *length);
 static bool read_indexed_wad_from_file_into_buffer(OpenedFile& OFile, 
 	struct wad_header *header, short index, void *buffer, int32 *length);
 static short count_raw_tags(uint8 *raw_wad);
@@ -235,6 +237,49 @@ struct wad_data *read_indexed_wad_from_file(
 	return read_wad;
 }
 
+void *read_type_from_indexed_wad(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	WadDataType type,
+	size_t *length)
+{
+	int32 offset, tag_length;
+	void *data= NULL;
+	
+	*length= 0;
+	if (find_type_in_indexed_wad(OFile, header, index, type, &offset, &tag_length) && tag_length>0)
+	{
+		data= malloc(tag_length);
+		if (!data)
+		{
+			set_game_error(systemError, memory_error());
+		}
+		else if (!read_from_file(OFile, offset, data, tag_length))
+		{
+			free(data);
+			data= NULL;
+		}
+		else
+		{
+			*length= tag_length;
+		}
+	}
+	
+	return data;
+}
+
+size_t length_of_type_in_indexed_wad(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	WadDataType type)
+{
+	int32 offset, length;
+	
+	return find_type_in_indexed_wad(OFile, header, index, type, &offset, &length) ? length : 0;
+}
+
 void *extract_type_from_wad(
 	struct wad_data *wad,
 	WadDataType type, 
@@ -1137,6 +1182,54 @@ static bool read_indexed_directory_data(
 	return false;
 }
 
+/* Walks the entry headers of the indexed wad in the file, reading nothing else; offset is from
+	the start of the file */
+static bool find_type_in_indexed_wad(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	WadDataType type,
+	int32 *offset,
+	int32 *length)
+{
+	struct directory_entry entry;
+	short entry_header_size= get_entry_header_length(header);
+	int32 entry_offset= 0;
+	
+	if (!read_indexed_directory_data(OFile, header, index, &entry)) return false;
+	
+	while (entry_offset+entry_header_size<=entry.length)
+	{
+		// Will work OK for Marathon 1, whose entry headers are shorter; the rest is zeroed
+		// when the shorter header is the last thing in the wad
+		uint8 buffer[SIZEOF_entry_header];
+		entry_header tag_header;
+		
+		obj_clear(buffer);
+		if (!read_from_file(OFile, entry.offset_to_start+entry_offset, buffer,
+				MIN(SIZEOF_entry_header, entry.length-entry_offset)))
+			return false;
+		unpack_entry_header(buffer, &tag_header, 1);
+		
+		if (tag_header.tag==type)
+		{
+			/* This MUST be a base! */
+			assert(header->version<WADFILE_SUPPORTS_OVERLAYS || tag_header.offset == 0);
+			if (tag_header.length<0 || tag_header.length>entry.length-entry_offset-entry_header_size) return false;
+			
+			*offset= entry.offset_to_start+entry_offset+entry_header_size;
+			*length= tag_header.length;
+			return true;
+		}
+		
+		/* entry headers only ever point forward */
+		if (tag_header.next_offset<=entry_offset) break;
+		entry_offset= tag_header.next_offset;
+	}
+	
+	return false;
+}
+
 /* Internal function.. */
 static bool read_indexed_wad_from_file_into_buffer(
 	OpenedFile& OFile, 
@@ -151,6 +151,15 @@ bool read_wad_header(OpenedFile& OFile, struct wad_header *header);
 struct wad_data *read_indexed_wad_from_file(OpenedFile& OFile, 
 	struct wad_header *header, short index, bool read_only);
 
+/* Read one tag of the indexed wad from the file, skipping the rest of the wad; returns a
+	malloc()ed copy of the tag's data, or NULL (and a length of zero) if it isn't there */
+void *read_type_from_indexed_wad(OpenedFile& OFile, struct wad_header *header, short index,
+	WadDataType type, size_t *length);
+
+/* The length of one tag of the indexed wad, without reading any of the wad's data */
+size_t length_of_type_in_indexed_wad(OpenedFile& OFile, struct wad_header *header, short index,
+	WadDataType type);
+
 /* Properly deal with the memory.. */
 void free_wad(struct wad_data *wad);
 
@@ -0,0 +1,606 @@
+/*
+ *  zip_archive_cache.cpp -- shared, indexed zip archives for plugin files
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+*/
+
+#include "zip_archive_cache.h"
+
+#include "cseries.h"
+
+#define PACKED_DATA_IS_LITTLE_ENDIAN
+#include "Packing.h"
+
+#include <SDL_mutex.h>
+#include <zlib.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <errno.h>
+#include <memory>
+#include <unordered_map>
+
+namespace fs = boost::filesystem;
+
+enum {
+	kEndOfCentralDirectorySignature = 0x06054b50,
+	kCentralDirectorySignature = 0x02014b50,
+	kLocalHeaderSignature = 0x04034b50
+};
+
+enum {
+	kEndOfCentralDirectorySize = 22,
+	kMaximumCommentSize = 0xffff,
+	kCentralDirectoryEntrySize = 46,
+	kLocalHeaderSize = 30
+};
+
+enum {
+	kStored = 0,
+	kDeflated = 8
+};
+
+enum { kEncryptedFlag = 0x0001 };
+
+// how much compressed data a deflated member reads at a time
+enum { kInputBufferSize = 16 * 1024 };
+
+// tried in this order, like zziplib's default extensions
+static const char *kArchiveExtensions[] = { ".zip", ".ZIP" };
+
+struct zip_member
+{
+	Sint64 header_offset;	// of its local header
+	uint32 compressed_size;
+	uint32 size;
+	uint16 method;
+	bool supported;
+
+	// found from the local header when the member is first opened
+	Sint64 data_offset;
+};
+
+struct zip_archive
+{
+	std::string path;
+	std::time_t date;
+	uintmax_t length;
+
+	// false if the archive is there but its directory can't be read here
+	bool indexed;
+
+	SDL_RWops *file;
+	SDL_mutex *mutex;	// guards file and the members' data_offset
+
+	std::vector<std::string> names;
+	std::unordered_map<std::string, zip_member> members;
+
+	zip_archive() : date(0), length(0), indexed(false), file(NULL), mutex(NULL) {}
+	~zip_archive() {
+		if (file)
+			SDL_RWclose(file);
+		if (mutex)
+			SDL_DestroyMutex(mutex);
+	}
+};
+
+typedef std::shared_ptr<zip_archive> zip_archive_ptr;
+
+static std::unordered_map<std::string, zip_archive_ptr> archives;
+
+static SDL_mutex *archives_mutex()
+{
+	static SDL_mutex *mutex = SDL_CreateMutex();
+	return mutex;
+}
+
+#ifdef __WIN32__
+static fs::path utf8_to_path(const std::string& utf8) { return utf8_to_wide(utf8); }
+#else
+static fs::path utf8_to_path(const std::string& utf8) { return utf8; }
+#endif
+
+static bool stat_archive(const std::string& path, std::time_t& date, uintmax_t& length)
+{
+	boost::system::error_code ec;
+	fs::path p = utf8_to_path(path);
+	if (!fs::is_regular_file(p, ec))
+		return false;
+
+	length = fs::file_size(p, ec);
+	if (ec)
+		return false;
+
+	date = fs::last_write_time(p, ec);
+	return !ec;
+}
+
+static bool read_archive_data(zip_archive& archive, Sint64 offset, void *buffer, size_t length)
+{
+	return SDL_RWseek(archive.file, offset, RW_SEEK_SET) == offset &&
+		SDL_RWread(archive.file, buffer, 1, length) == length;
+}
+
+// reads the central directory; false if the archive is damaged, or uses
+// zip64 or spans disks
+static bool index_archive(zip_archive& archive)
+{
+	Sint64 length = static_cast<Sint64>(archive.length);
+	if (length < kEndOfCentralDirectorySize)
+		return false;
+
+	// the end of central directory record is followed by a comment of up
+	// to 64K
+	size_t tail_length = static_cast<size_t>(std::min<Sint64>(length, kEndOfCentralDirectorySize + kMaximumCommentSize));
+	Sint64 tail_offset = length - tail_length;
+	std::vector<uint8> tail(tail_length);
+	if (!read_archive_data(archive, tail_offset, tail.data(), tail_length))
+		return false;
+
+	size_t end_of_directory = tail_length - kEndOfCentralDirectorySize + 1;
+	while (end_of_directory-- > 0)
+	{
+		uint8 *p = tail.data() + end_of_directory;
+		uint32 signature;
+		StreamToValue(p, signature);
+		if (signature == kEndOfCentralDirectorySignature)
+			break;
+	}
+	if (end_of_directory == static_cast<size_t>(-1))
+		return false;
+
+	uint8 *p = tail.data() + end_of_directory + 4;
+	uint16 disk, directory_disk, disk_entry_count, entry_count;
+	uint32 directory_length, directory_offset;
+	StreamToValue(p, disk);
+	StreamToValue(p, directory_disk);
+	StreamToValue(p, disk_entry_count);
+	StreamToValue(p, entry_count);
+	StreamToValue(p, directory_length);
+	StreamToValue(p, directory_offset);
+	if (disk != 0 || directory_disk != 0 || disk_entry_count != entry_count)
+		return false;
+	if (entry_count == 0xffff || directory_length == 0xffffffff || directory_offset == 0xffffffff)
+		return false;
+
+	// anything prepended to the archive (a self-extractor) moves every
+	// offset in it
+	Sint64 directory_start = tail_offset + static_cast<Sint64>(end_of_directory) - directory_length;
+	Sint64 base = directory_start - directory_offset;
+	if (directory_start < 0 || base < 0)
+		return false;
+
+	std::vector<uint8> directory(directory_length);
+	if (directory_length && !read_archive_data(archive, directory_start, directory.data(), directory_length))
+		return false;
+
+	archive.names.reserve(entry_count);
+	archive.members.reserve(entry_count);
+
+	p = directory.data();
+	uint8 *directory_end = directory.data() + directory_length;
+	for (int i = 0; i < entry_count; ++i)
+	{
+		if (directory_end - p < kCentralDirectoryEntrySize)
+			return false;
+
+		uint32 signature, crc, compressed_size, size, header_offset;
+		uint16 version_made_by, version_needed, flags, method, time, date;
+		uint16 name_length, extra_length, comment_length, start_disk, internal_attributes;
+		uint32 external_attributes;
+		StreamToValue(p, signature);
+		StreamToValue(p, version_made_by);
+		StreamToValue(p, version_needed);
+		StreamToValue(p, flags);
+		StreamToValue(p, method);
+		StreamToValue(p, time);
+		StreamToValue(p, date);
+		StreamToValue(p, crc);
+		StreamToValue(p, compressed_size);
+		StreamToValue(p, size);
+		StreamToValue(p, name_length);
+		StreamToValue(p, extra_length);
+		StreamToValue(p, comment_length);
+		StreamToValue(p, start_disk);
+		StreamToValue(p, internal_attributes);
+		StreamToValue(p, external_attributes);
+		StreamToValue(p, header_offset);
+		if (signature != kCentralDirectorySignature)
+			return false;
+		if (directory_end - p < name_length + extra_length + comment_length)
+			return false;
+
+		std::string name(reinterpret_cast<char *>(p), name_length);
+		p += name_length + extra_length + comment_length;
+
+		zip_member member;
+		member.header_offset = base + header_offset;
+		member.compressed_size = compressed_size;
+		member.size = size;
+		member.method = method;
+		member.supported = !(flags & kEncryptedFlag) &&
+			(method == kStored || method == kDeflated) &&
+			compressed_size != 0xffffffff && size != 0xffffffff && header_offset != 0xffffffff;
+		member.data_offset = -1;
+
+		// the first of any duplicate names is the one found
+		if (archive.members.emplace(name, member).second)
+			archive.names.push_back(name);
+	}
+
+	return true;
+}
+
+static zip_archive_ptr read_archive(const std::string& path, std::time_t date, uintmax_t length)
+{
+	zip_archive_ptr archive = std::make_shared<zip_archive>();
+	archive->path = path;
+	archive->date = date;
+	archive->length = length;
+	archive->file = SDL_RWFromFile(path.c_str(), "rb");
+	archive->mutex = SDL_CreateMutex();
+	if (!archive->file || !archive->mutex)
+		return zip_archive_ptr();
+
+	archive->indexed = index_archive(*archive);
+	if (!archive->indexed)
+	{
+		archive->names.clear();
+		archive->members.clear();
+	}
+	return archive;
+}
+
+// the archive at path, read again if it has changed since it was cached
+static zip_archive_ptr find_archive(const std::string& path)
+{
+	std::time_t date;
+	uintmax_t length;
+	if (!stat_archive(path, date, length))
+		return zip_archive_ptr();
+
+	SDL_LockMutex(archives_mutex());
+	zip_archive_ptr& cached = archives[path];
+	if (!cached || cached->date != date || cached->length != length)
+		cached = read_archive(path, date, length);
+	zip_archive_ptr archive = cached;
+	if (!archive)
+		archives.erase(path);
+	SDL_UnlockMutex(archives_mutex());
+
+	return archive;
+}
+
+// the archive path is a member of, and its name in there
+static zip_archive_ptr find_archive_containing(const std::string& path, std::string& name)
+{
+	for (size_t slash = path.rfind('/'); slash != std::string::npos && slash > 0; slash = path.rfind('/', slash - 1))
+	{
+		std::string prefix = path.substr(0, slash);
+		for (size_t i = 0; i < sizeof(kArchiveExtensions) / sizeof(kArchiveExtensions[0]); ++i)
+		{
+			zip_archive_ptr archive = find_archive(prefix + kArchiveExtensions[i]);
+			if (archive)
+			{
+				name = path.substr(slash + 1);
+				return archive;
+			}
+		}
+	}
+
+	return zip_archive_ptr();
+}
+
+// where the member's data starts, from its local header; -1 if it's damaged
+static Sint64 find_member_data(zip_archive& archive, zip_member& member)
+{
+	SDL_LockMutex(archive.mutex);
+	if (member.data_offset < 0)
+	{
+		uint8 header[kLocalHeaderSize];
+		if (read_archive_data(archive, member.header_offset, header, sizeof(header)))
+		{
+			uint8 *p = header;
+			uint32 signature;
+			uint16 name_length, extra_length;
+			StreamToValue(p, signature);
+			p = header + 26;
+			StreamToValue(p, name_length);
+			StreamToValue(p, extra_length);
+
+			Sint64 data_offset = member.header_offset + kLocalHeaderSize + name_length + extra_length;
+			if (signature == kLocalHeaderSignature &&
+			    data_offset + member.compressed_size <= static_cast<Sint64>(archive.length))
+				member.data_offset = data_offset;
+		}
+	}
+	Sint64 data_offset = member.data_offset;
+	SDL_UnlockMutex(archive.mutex);
+
+	return data_offset;
+}
+
+struct zip_member_stream
+{
+	zip_archive_ptr archive;
+	Sint64 data_offset;
+	uint32 compressed_size;
+	uint32 size;
+	uint16 method;
+
+	uint32 position;
+
+	// deflated members only
+	z_stream inflater;
+	uint32 compressed_position;
+	uint8 input[kInputBufferSize];
+};
+
+static bool read_member_data(zip_member_stream *stream, uint32 offset, void *buffer, size_t length)
+{
+	SDL_LockMutex(stream->archive->mutex);
+	bool read = read_archive_data(*stream->archive, stream->data_offset + offset, buffer, length);
+	SDL_UnlockMutex(stream->archive->mutex);
+	return read;
+}
+
+static size_t read_stored(zip_member_stream *stream, uint8 *buffer, size_t length)
+{
+	if (!read_member_data(stream, stream->position, buffer, length))
+		return 0;
+
+	stream->position += static_cast<uint32>(length);
+	return length;
+}
+
+static size_t read_deflated(zip_member_stream *stream, uint8 *buffer, size_t length)
+{
+	z_stream& z = stream->inflater;
+	z.next_out = buffer;
+	z.avail_out = static_cast<uInt>(length);
+	while (z.avail_out > 0)
+	{
+		// once all the input is in, inflate() may still have output held back
+		if (z.avail_in == 0 && stream->compressed_position < stream->compressed_size)
+		{
+			uint32 input_length = std::min<uint32>(kInputBufferSize, stream->compressed_size - stream->compressed_position);
+			if (!read_member_data(stream, stream->compressed_position, stream->input, input_length))
+				break;
+
+			stream->compressed_position += input_length;
+			z.next_in = stream->input;
+			z.avail_in = input_length;
+		}
+
+		if (inflate(&z, Z_NO_FLUSH) != Z_OK)
+			break;
+	}
+
+	size_t inflated = length - z.avail_out;
+	stream->position += static_cast<uint32>(inflated);
+	return inflated;
+}
+
+static size_t read_member(zip_member_stream *stream, uint8 *buffer, size_t length)
+{
+	length = std::min<size_t>(length, stream->size - stream->position);
+	if (length == 0)
+		return 0;
+
+	if (stream->method == kStored)
+		return read_stored(stream, buffer, length);
+	else
+		return read_deflated(stream, buffer, length);
+}
+
+static Sint64 member_size(struct SDL_RWops *context)
+{
+	zip_member_stream *stream = static_cast<zip_member_stream *>(context->hidden.unknown.data1);
+	return stream->size;
+}
+
+static Sint64 member_seek(struct SDL_RWops *context, Sint64 offset, int whence)
+{
+	zip_member_stream *stream = static_cast<zip_member_stream *>(context->hidden.unknown.data1);
+
+	Sint64 position;
+	switch (whence)
+	{
+		case RW_SEEK_SET:
+			position = offset;
+			break;
+		case RW_SEEK_CUR:
+			position = stream->position + offset;
+			break;
+		case RW_SEEK_END:
+			position = stream->size + offset;
+			break;
+		default:
+			return SDL_SetError("Unknown value for 'whence'");
+	}
+	if (position < 0 || position > stream->size)
+		return SDL_SetError("Seek outside of zip archive member");
+
+	if (stream->method == kStored)
+	{
+		stream->position = static_cast<uint32>(position);
+		return position;
+	}
+
+	// deflated data can only be skipped through, so going back starts over
+	if (position < stream->position)
+	{
+		inflateReset(&stream->inflater);
+		stream->inflater.avail_in = 0;
+		stream->compressed_position = 0;
+		stream->position = 0;
+	}
+
+	uint8 skipped[4096];
+	while (stream->position < position)
+	{
+		size_t length = static_cast<size_t>(std::min<Sint64>(sizeof(skipped), position - stream->position));
+		if (read_deflated(stream, skipped, length) != length)
+			return SDL_SetError("Error reading zip archive member");
+	}
+	return position;
+}
+
+static size_t member_read(struct SDL_RWops *context, void *ptr, size_t size, size_t maxnum)
+{
+	zip_member_stream *stream = static_cast<zip_member_stream *>(context->hidden.unknown.data1);
+	if (size == 0)
+		return 0;
+
+	return read_member(stream, static_cast<uint8 *>(ptr), size * maxnum) / size;
+}
+
+static size_t member_write(struct SDL_RWops *context, const void *ptr, size_t size, size_t num)
+{
+	SDL_SetError("Zip archive members are read-only");
+	return 0;
+}
+
+static int member_close(struct SDL_RWops *context)
+{
+	if (context)
+	{
+		zip_member_stream *stream = static_cast<zip_member_stream *>(context->hidden.unknown.data1);
+		if (stream->method == kDeflated)
+			inflateEnd(&stream->inflater);
+		delete stream;
+		SDL_FreeRW(context);
+	}
+	return 0;
+}
+
+SDL_RWops *open_zip_archive_member(const std::string& path)
+{
+	std::string name;
+	zip_archive_ptr archive = find_archive_containing(path, name);
+	if (!archive)
+	{
+		errno = ENOENT;
+		return NULL;
+	}
+
+	// leave anything this can't read to zziplib
+	if (!archive->indexed)
+	{
+		errno = ENOTSUP;
+		return NULL;
+	}
+
+	std::unordered_map<std::string, zip_member>::iterator it = archive->members.find(name);
+	if (it == archive->members.end())
+	{
+		errno = ENOENT;
+		return NULL;
+	}
+
+	zip_member& member = it->second;
+	if (!member.supported)
+	{
+		errno = ENOTSUP;
+		return NULL;
+	}
+
+	Sint64 data_offset = find_member_data(*archive, member);
+	if (data_offset < 0)
+	{
+		errno = EIO;
+		return NULL;
+	}
+
+	zip_member_stream *stream = new zip_member_stream;
+	stream->archive = archive;
+	stream->data_offset = data_offset;
+	stream->compressed_size = member.compressed_size;
+	stream->size = member.size;
+	stream->method = member.method;
+	stream->position = 0;
+	stream->compressed_position = 0;
+
+	if (member.method == kDeflated)
+	{
+		memset(&stream->inflater, 0, sizeof(stream->inflater));
+		if (inflateInit2(&stream->inflater, -MAX_WBITS) != Z_OK)
+		{
+			delete stream;
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	SDL_RWops *ops = SDL_AllocRW();
+	if (!ops)
+	{
+		if (member.method == kDeflated)
+			inflateEnd(&stream->inflater);
+		delete stream;
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ops->size = member_size;
+	ops->seek = member_seek;
+	ops->read = member_read;
+	ops->write = member_write;
+	ops->close = member_close;
+	ops->type = SDL_RWOPS_UNKNOWN;
+	ops->hidden.unknown.data1 = stream;
+	return ops;
+}
+
+bool zip_archive_member_exists(const std::string& path)
+{
+	std::string name;
+	zip_archive_ptr archive = find_archive_containing(path, name);
+	if (!archive)
+	{
+		errno = ENOENT;
+		return false;
+	}
+	if (!archive->indexed)
+	{
+		errno = ENOTSUP;
+		return false;
+	}
+
+	errno = archive->members.count(name) ? 0 : ENOENT;
+	return errno == 0;
+}
+
+bool read_zip_archive_directory(const std::string& archive_path, std::vector<std::string>& names)
+{
+	zip_archive_ptr archive = find_archive(archive_path);
+	if (!archive)
+	{
+		errno = ENOENT;
+		return false;
+	}
+	if (!archive->indexed)
+	{
+		errno = ENOTSUP;
+		return false;
+	}
+
+	names = archive->names;
+	return true;
+}
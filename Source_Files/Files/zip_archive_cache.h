@@ -0,0 +1,51 @@
+/*
+ *  zip_archive_cache.h -- shared, indexed zip archives for plugin files
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Paths are resolved the way zziplib resolves them: X/Foo/sub/bar.png is
+	the member sub/bar.png of X/Foo.zip (or X/Foo.ZIP), trying the longest
+	prefix first. Each archive is opened once, and its central directory read
+	once, for the whole process; members are read through the archive's one
+	file handle, and deflated members are inflated as they are read. An
+	archive is read again if its size or modification date changes.
+
+	Paths use '/' as the separator.
+*/
+
+#ifndef ZIP_ARCHIVE_CACHE_H
+#define ZIP_ARCHIVE_CACHE_H
+
+#include <SDL_rwops.h>
+
+#include <string>
+#include <vector>
+
+// opens a member of a zip archive for reading; returns NULL and sets errno if
+// there is no such member, or to ENOTSUP if the member uses something other
+// than storing or deflating (or zip64 or encryption)
+SDL_RWops *open_zip_archive_member(const std::string& path);
+
+// whether path names a member of a zip archive; false with errno set to
+// ENOTSUP if its archive can't be read here
+bool zip_archive_member_exists(const std::string& path);
+
+// the names of the members of the zip archive at archive_path, in the order
+// they are in its central directory; false and sets errno if it can't be read
+bool read_zip_archive_directory(const std::string& archive_path, std::vector<std::string>& names);
+
+#endif
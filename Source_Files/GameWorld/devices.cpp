@@ -73,6 +73,7 @@ Feb 3, 2003 (Woody Zenfell):
 //MH: Lua scripting
 #include "lua_script.h"
 #include "InfoTree.h"
+#include "world_snapshot.h"
 
 #include <string.h>
 #include <limits.h>
@@ -467,6 +468,7 @@ void assume_correct_switch_position(
 			if (switch_type==definition->_class)
 			{
 				play_control_panel_sound(side_index, new_state ? _activating_sound : _deactivating_sound);
+				snapshot_side(side_index);
 				SET_CONTROL_PANEL_STATUS(side, new_state);
 				set_control_panel_texture(side);
 			}
@@ -490,6 +492,7 @@ void try_and_toggle_control_panel(
 			bool should_destroy_switch;
 			if (switch_can_be_toggled(side_index, false, &should_destroy_switch))
 			{
+				snapshot_side(side_index);
 				if (should_destroy_switch) SET_SIDE_CONTROL_PANEL(side, false);
 				bool make_sound = false, state= GET_CONTROL_PANEL_STATUS(side);
 				struct control_panel_definition *definition= get_control_panel_definition(side->control_panel_type);
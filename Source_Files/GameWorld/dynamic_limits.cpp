@@ -51,7 +51,9 @@ static uint16 m2_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 		// doesn't affect film playback)
 	16,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
 	64,	// Global collision buffer (projectiles with other objects)
-	4096 // Ephemeral objects (render effects)
+	4096, // Ephemeral objects (render effects)
+	8,	// NPC target searches per tick (only with the monster AI scheduler)
+	2	// NPC paths built per tick (only with the monster AI scheduler)
 };
 
 // expanded defaults up to 1.0
@@ -65,7 +67,9 @@ static uint16 a1_1_0_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 	1024,	// Number of objects to render
 	64,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
 	256,	// Global collision buffer (projectiles with other objects)
-	4096 // Ephemeral objects (render effects)
+	4096, // Ephemeral objects (render effects)
+	8,	// NPC target searches per tick (only with the monster AI scheduler)
+	2	// NPC paths built per tick (only with the monster AI scheduler)
 };
 
 // 1.1 reverts paths for classic scenario compatibility
@@ -79,7 +83,9 @@ static uint16 a1_1_1_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 	1024,	// Number of objects to render
 	64,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
 	256,	// Global collision buffer (projectiles with other objects)
-	4096 // Ephemeral objects (render effects)
+	4096, // Ephemeral objects (render effects)
+	8,	// NPC target searches per tick (only with the monster AI scheduler)
+	2	// NPC paths built per tick (only with the monster AI scheduler)
 };
 
 static std::vector<uint16> dynamic_limits(NUMBER_OF_DYNAMIC_LIMITS);
@@ -126,6 +132,8 @@ void parse_mml_dynamic_limits(const InfoTree& root)
 	parse_limit_value(root, "local_collision", _dynamic_limit_local_collision);
 	parse_limit_value(root, "global_collision", _dynamic_limit_global_collision);
 	parse_limit_value(root, "ephemera", _dynamic_limit_ephemera);
+	parse_limit_value(root, "monster_targets", _dynamic_limit_monster_targets);
+	parse_limit_value(root, "monster_paths", _dynamic_limit_monster_paths);
 
 	// Resize the arrays of objects, monsters, effects, and projectiles
 	EffectList.resize(MAXIMUM_EFFECTS_PER_MAP);
@@ -41,6 +41,7 @@ Aug 30, 2000 (Loren Petrich):
 #include "effects.h"
 #include "SoundManager.h"
 #include "lua_script.h"
+#include "world_snapshot.h"
 
 #include "Packing.h"
 
@@ -74,6 +75,7 @@ effect_data *get_effect_data(
 	
 	vassert(effect, csprintf(temporary, "effect index #%d is out of range", effect_index));
 	vassert(SLOT_IS_USED(effect), csprintf(temporary, "effect index #%d (%p) is unused", effect_index, (void*)effect));
+	snapshot_effect(effect_index);
 	
 	return effect;
 }
@@ -121,6 +123,7 @@ short new_effect(
 					{
 						struct object_data *object= get_object_data(object_index);
 						
+						snapshot_effect(effect_index);
 						effect->type= type;
 						effect->flags= 0;
 						effect->object_index= object_index;
@@ -164,6 +167,7 @@ void update_effects(
 			// LP change: idiot-proofing
 			if (!definition) continue;
 			
+			snapshot_effect(effect_index);
 			if (effect->delay)
 			{
 				/* handle invisible, delayed effects */
@@ -32,6 +32,13 @@ Jan 30, 2000 (Loren Petrich):
 
 Feb. 4, 2000 (Loren Petrich):
 	Changed halt() to assert(false) for better debugging
+
+	_best_first now pops unexpanded nodes off an indexed binary heap instead of scanning every
+	node, and visited_polygons is stamped with a flood generation instead of being cleared for
+	every flood.  Ties are still broken by lowest node index, so the expansion order is unchanged.
+
+	The flood state lives in a flood_map_context; the old interface uses a static one, and callers
+	that flood from several threads at once (precalculate_map_indexes()) each bring their own.
 */
 
 /*
@@ -71,15 +78,48 @@ struct node_data /* 16 bytes */
 	int32 user_flags;
 };
 
+/* visited_polygons entries left over from earlier floods have a stale generation */
+struct visited_polygon_data
+{
+	uint16 generation;
+	int16 node_index;
+};
+
 /* ---------- globals */
 
-static short node_count= 0, last_node_index_expanded= NONE;
-static struct node_data *nodes = NULL;
-static short *visited_polygons = NULL;
+struct flood_map_context
+{
+	short node_count, last_node_index_expanded;
+	struct node_data *nodes;
+	struct visited_polygon_data *visited_polygons;
+	size_t visited_polygon_count;
+	uint16 flood_generation;
+	
+	/* unexpanded nodes, ordered by cost and then by node index (which is what the old linear
+		search for the cheapest node amounted to); heap_positions[node] is NONE once it is expanded */
+	short heap_count;
+	short *node_heap;
+	short *heap_positions;
+};
+
+/* for flood_map() without a context, and reverse_flood_map(), flood_depth() and
+	choose_random_flood_node() */
+static struct flood_map_context flood_context;
 
 /* ---------- private prototypes */
 
-static void add_node(short parent_node_index, short polygon_index, short depth, int32 cost, int32 user_flags);
+static void allocate_flood_map_context(struct flood_map_context *context);
+static void free_flood_map_context(struct flood_map_context *context);
+
+static void add_node(struct flood_map_context *context, short parent_node_index, short polygon_index, short depth, int32 cost, int32 user_flags);
+
+static short get_visited_node(struct flood_map_context *context, short polygon_index);
+
+static bool heap_node_precedes(struct flood_map_context *context, short node_index, short other_node_index);
+static void heap_insert(struct flood_map_context *context, short node_index);
+static void heap_remove(struct flood_map_context *context, short node_index);
+static void heap_sift_up(struct flood_map_context *context, short position);
+static void heap_sift_down(struct flood_map_context *context, short position);
 
 /* ---------- code */
 
@@ -87,11 +127,25 @@ void allocate_flood_map_memory(
 	void)
 {
 	// Made reentrant because this must be called every time a map is loaded
-	if (nodes) delete []nodes;
-	nodes= new node_data[MAXIMUM_FLOOD_NODES];
-	if (visited_polygons) delete []visited_polygons;
-	visited_polygons= new short[MAXIMUM_POLYGONS_PER_MAP];
-	assert(nodes&&visited_polygons);
+	free_flood_map_context(&flood_context);
+	allocate_flood_map_context(&flood_context);
+}
+
+struct flood_map_context *new_flood_map_context(
+	void)
+{
+	struct flood_map_context *context= new flood_map_context;
+	
+	allocate_flood_map_context(context);
+	
+	return context;
+}
+
+void delete_flood_map_context(
+	struct flood_map_context *context)
+{
+	free_flood_map_context(context);
+	delete context;
 }
 
 /* returns next polygon index or NONE if there are no more polygons left cheaper than maximum_cost */
@@ -101,6 +155,17 @@ short flood_map(
 	cost_proc_ptr cost_proc,
 	short flood_mode,
 	void *caller_data)
+{
+	return flood_map(&flood_context, first_polygon_index, maximum_cost, cost_proc, flood_mode, caller_data);
+}
+
+short flood_map(
+	struct flood_map_context *context,
+	short first_polygon_index,
+	int32 maximum_cost,
+	cost_proc_ptr cost_proc,
+	short flood_mode,
+	void *caller_data)
 {
 	short lowest_cost_node_index, node_index;
 	struct node_data *node;
@@ -110,12 +175,18 @@ short flood_map(
 	/* initialize ourselves if first_polygon_index!=NONE */
 	if (first_polygon_index!=NONE)
 	{
-		/* clear the visited polygon array */
-		objlist_set(visited_polygons, NONE, MAXIMUM_POLYGONS_PER_MAP);
+		/* start a new generation of the visited polygon array, only clearing it when the
+			generation wraps around */
+		if (++context->flood_generation==0)
+		{
+			objlist_clear(context->visited_polygons, context->visited_polygon_count);
+			context->flood_generation= 1;
+		}
 		
-		node_count= 0;
-		last_node_index_expanded= NONE;
-		add_node(NONE, first_polygon_index, 0, 0, (flood_mode==_flagged_breadth_first) ? *((int32*)caller_data) : 0);
+		context->node_count= 0;
+		context->heap_count= 0;
+		context->last_node_index_expanded= NONE;
+		add_node(context, NONE, first_polygon_index, 0, 0, (flood_mode==_flagged_breadth_first) ? *((int32*)caller_data) : 0);
 	}
 	
 	switch (flood_mode)
@@ -123,25 +194,22 @@ short flood_map(
 		case _best_first:
 			/* find the unexpanded node with the lowest cost */
 			lowest_cost= maximum_cost, lowest_cost_node_index= NONE;
-			for (node= nodes, node_index= 0; node_index<node_count; ++node_index, ++node)
+			if (context->heap_count && context->nodes[context->node_heap[0]].cost<lowest_cost)
 			{
-				if (NODE_IS_UNEXPANDED(node)&&node->cost<lowest_cost)
-				{
-					lowest_cost_node_index= node_index;
-					lowest_cost= node->cost;
-				}
+				lowest_cost_node_index= context->node_heap[0];
+				lowest_cost= context->nodes[lowest_cost_node_index].cost;
 			}
 			break;
 		
 		case _breadth_first:
 		case _flagged_breadth_first:
 			/* find the next unexpanded node in the list under maximum_cost */
-			node_index= (last_node_index_expanded==NONE) ? 0 : (last_node_index_expanded+1);
-			for (node= nodes+node_index; node_index<node_count; ++node_index, ++node)
+			node_index= (context->last_node_index_expanded==NONE) ? 0 : (context->last_node_index_expanded+1);
+			for (node= context->nodes+node_index; node_index<context->node_count; ++node_index, ++node)
 			{
 				if (node->cost<maximum_cost) break;
 			}
-			if (node_index==node_count)
+			if (node_index==context->node_count)
 			{
 				lowest_cost_node_index= NONE;
 				lowest_cost= maximum_cost;
@@ -170,30 +238,31 @@ short flood_map(
 		short i;
 		
 		/* for flood_depth() and reverse_flood_map(), remember which node we successfully expanded last */
-		last_node_index_expanded= lowest_cost_node_index;
+		context->last_node_index_expanded= lowest_cost_node_index;
 
 		/* get pointer to lowest cost node */
-		assert(lowest_cost_node_index>=0&&lowest_cost_node_index<node_count);
-		node= nodes+lowest_cost_node_index;
+		assert(lowest_cost_node_index>=0&&lowest_cost_node_index<context->node_count);
+		node= context->nodes+lowest_cost_node_index;
 
 		polygon= get_polygon_data(node->polygon_index);
 		assert(!POLYGON_IS_DETACHED(polygon));
 
 		/* mark node as expanded */
 		MARK_NODE_AS_EXPANDED(node);
+		heap_remove(context, lowest_cost_node_index);
 
 		for (i= 0; i<polygon->vertex_count; ++i)		
 		{
 			short destination_polygon_index= polygon->adjacent_polygon_indexes[i];
 			
 			if (destination_polygon_index!=NONE &&
-				(maximum_cost!=INT32_MAX || visited_polygons[destination_polygon_index]==UNVISITED))
+				(maximum_cost!=INT32_MAX || get_visited_node(context, destination_polygon_index)==UNVISITED))
 			{
 				int32 new_user_flags= node->user_flags;
 				int32 cost= cost_proc ? cost_proc(node->polygon_index, polygon->line_indexes[i], destination_polygon_index, (flood_mode==_flagged_breadth_first) ? &new_user_flags : caller_data) : polygon->area;
 				
 				/* polygons with zero or negative costs are not added to the node list */
-				if (cost>0) add_node(lowest_cost_node_index, destination_polygon_index, node->depth+1, lowest_cost+cost, new_user_flags);
+				if (cost>0) add_node(context, lowest_cost_node_index, destination_polygon_index, node->depth+1, lowest_cost+cost, new_user_flags);
 			}
 		}
 		
@@ -215,16 +284,17 @@ short flood_map(
 short reverse_flood_map(
 	void)
 {
+	struct flood_map_context *context= &flood_context;
 	short polygon_index= NONE;
 	
-	if (last_node_index_expanded!=NONE)
+	if (context->last_node_index_expanded!=NONE)
 	{
 		struct node_data *node;
 		
-		assert(last_node_index_expanded>=0&&last_node_index_expanded<node_count);
-		node= nodes+last_node_index_expanded;
+		assert(context->last_node_index_expanded>=0&&context->last_node_index_expanded<context->node_count);
+		node= context->nodes+context->last_node_index_expanded;
 
-		last_node_index_expanded= node->parent_node_index;
+		context->last_node_index_expanded= node->parent_node_index;
 		polygon_index= node->polygon_index;
 	}
 	
@@ -235,9 +305,11 @@ short reverse_flood_map(
 short flood_depth(
 	void)
 {
-	assert(last_node_index_expanded>=0&&last_node_index_expanded<node_count);
+	struct flood_map_context *context= &flood_context;
+	
+	assert(context->last_node_index_expanded>=0&&context->last_node_index_expanded<context->node_count);
 
-	return last_node_index_expanded==NONE ? 0 : nodes[last_node_index_expanded].depth;
+	return context->last_node_index_expanded==NONE ? 0 : context->nodes[context->last_node_index_expanded].depth;
 }
 
 #define MAXIMUM_BIASED_RETRIES 10
@@ -247,12 +319,13 @@ short flood_depth(
 void choose_random_flood_node(
 	world_vector2d *bias)
 {
+	struct flood_map_context *context= &flood_context;
 	world_point2d origin;
 	
-	assert(node_count>=1);
-	find_center_of_polygon(nodes[0].polygon_index, &origin);
+	assert(context->node_count>=1);
+	find_center_of_polygon(context->nodes[0].polygon_index, &origin);
 	
-	if (node_count>1)
+	if (context->node_count>1)
 	{
 		bool suitable;
 		short retries= MAXIMUM_BIASED_RETRIES;
@@ -261,9 +334,9 @@ void choose_random_flood_node(
 		{
 			do
 			{
-				last_node_index_expanded= global_random()%node_count;
+				context->last_node_index_expanded= global_random()%context->node_count;
 			}
-			while (NODE_IS_UNEXPANDED(nodes+last_node_index_expanded));
+			while (NODE_IS_UNEXPANDED(context->nodes+context->last_node_index_expanded));
 
 			/* if we have no bias, this node is automatically suitable if it has been expanded;
 				if we have a bias, this node is only suitable if it is in the same general
@@ -271,7 +344,7 @@ void choose_random_flood_node(
 			suitable= true;
 			if (bias && (retries-= 1)>=0)
 			{
-				struct node_data *node= nodes+last_node_index_expanded;
+				struct node_data *node= context->nodes+context->last_node_index_expanded;
 				world_point2d destination;
 				
 				find_center_of_polygon(node->polygon_index, &destination);
@@ -284,43 +357,78 @@ void choose_random_flood_node(
 
 /* ---------- private code */
 
+static void allocate_flood_map_context(
+	struct flood_map_context *context)
+{
+	context->nodes= new node_data[MAXIMUM_FLOOD_NODES];
+	context->visited_polygon_count= MAXIMUM_POLYGONS_PER_MAP;
+	context->visited_polygons= new visited_polygon_data[context->visited_polygon_count];
+	context->node_heap= new short[MAXIMUM_FLOOD_NODES];
+	context->heap_positions= new short[MAXIMUM_FLOOD_NODES];
+	assert(context->nodes&&context->visited_polygons&&context->node_heap&&context->heap_positions);
+	
+	objlist_clear(context->visited_polygons, context->visited_polygon_count);
+	context->flood_generation= 0;
+	context->node_count= 0;
+	context->last_node_index_expanded= NONE;
+	context->heap_count= 0;
+}
+
+static void free_flood_map_context(
+	struct flood_map_context *context)
+{
+	delete []context->nodes;
+	delete []context->visited_polygons;
+	delete []context->node_heap;
+	delete []context->heap_positions;
+	context->nodes= NULL;
+	context->visited_polygons= NULL;
+	context->node_heap= NULL;
+	context->heap_positions= NULL;
+	context->visited_polygon_count= 0;
+}
+
 /* checks to see if the given node is already in the node list */
 static void add_node(
+	struct flood_map_context *context,
 	short parent_node_index,
 	short polygon_index,
 	short depth,
 	int32 cost,
 	int32 user_flags)
 {
-	if (node_count<MAXIMUM_FLOOD_NODES)
+	if (context->node_count<MAXIMUM_FLOOD_NODES)
 	{
 		struct node_data *node;
 		short node_index;
 		
 		/* see if this polygon already exists in the node list anywhere */
 		assert(polygon_index>=0&&polygon_index<dynamic_world->polygon_count);
-		if ((node_index= visited_polygons[polygon_index])!=UNVISITED)
+		if ((node_index= get_visited_node(context, polygon_index))!=UNVISITED)
 		{
 			/* there is already a node referencing this polygon; if it has a higher cost
 				than the cost we are attempting to add, replace it (because we are doing
 				a best-first search, we are guarenteed never to find a better path to an
 				expanded node, and in fact if we find a path to a node we have already
 				expanded were backtracking and can ignore the node) */
-			assert(node_index>=0&&node_index<node_count);
-			node= nodes+node_index;
+			assert(node_index>=0&&node_index<context->node_count);
+			node= context->nodes+node_index;
 			if (NODE_IS_EXPANDED(node)||node->cost<=cost) node= (struct node_data *) NULL;
 		}
 		else
 		{
-			node_index= node_count;
-			node= nodes + node_index;
+			node_index= context->node_count;
+			node= context->nodes + node_index;
 		}
 		
 		if (node)
 		{
-			if (node_index==node_count)
+			bool new_node= false;
+			
+			if (node_index==context->node_count)
 			{
-				node_count+= 1;
+				context->node_count+= 1;
+				new_node= true;
 			}
 			
 			node->flags= 0;
@@ -331,9 +439,115 @@ static void add_node(
 			node->user_flags= user_flags;
 			
 			assert(polygon_index>=0&&polygon_index<dynamic_world->polygon_count);
-			visited_polygons[polygon_index]= node_index;
+			context->visited_polygons[polygon_index].generation= context->flood_generation;
+			context->visited_polygons[polygon_index].node_index= node_index;
+			
+			/* a replaced node only ever gets cheaper */
+			if (new_node)
+			{
+				heap_insert(context, node_index);
+			}
+			else
+			{
+				heap_sift_up(context, context->heap_positions[node_index]);
+			}
 			
 //			dprintf("added polygon #%d to node #%d (nodes=%p,visited=%p)", polygon_index, node_index, nodes, visited_polygons);
 		}
 	}
 }
+
+static short get_visited_node(
+	struct flood_map_context *context,
+	short polygon_index)
+{
+	struct visited_polygon_data *visited= context->visited_polygons + polygon_index;
+	
+	return visited->generation==context->flood_generation ? visited->node_index : UNVISITED;
+}
+
+/* true if node_index should be expanded before other_node_index */
+static bool heap_node_precedes(
+	struct flood_map_context *context,
+	short node_index,
+	short other_node_index)
+{
+	int32 cost= context->nodes[node_index].cost, other_cost= context->nodes[other_node_index].cost;
+	
+	return cost<other_cost || (cost==other_cost && node_index<other_node_index);
+}
+
+static void heap_insert(
+	struct flood_map_context *context,
+	short node_index)
+{
+	assert(context->heap_count<MAXIMUM_FLOOD_NODES);
+	context->node_heap[context->heap_count]= node_index;
+	context->heap_positions[node_index]= context->heap_count;
+	heap_sift_up(context, context->heap_count++);
+}
+
+static void heap_remove(
+	struct flood_map_context *context,
+	short node_index)
+{
+	short position= context->heap_positions[node_index];
+	
+	assert(position>=0&&position<context->heap_count);
+	context->heap_positions[node_index]= NONE;
+	if (position!=--context->heap_count)
+	{
+		context->node_heap[position]= context->node_heap[context->heap_count];
+		context->heap_positions[context->node_heap[position]]= position;
+		if (position>0 && heap_node_precedes(context, context->node_heap[position], context->node_heap[(position-1)/2]))
+		{
+			heap_sift_up(context, position);
+		}
+		else
+		{
+			heap_sift_down(context, position);
+		}
+	}
+}
+
+static void heap_sift_up(
+	struct flood_map_context *context,
+	short position)
+{
+	short node_index= context->node_heap[position];
+	
+	while (position>0)
+	{
+		short parent= (position-1)/2;
+		
+		if (!heap_node_precedes(context, node_index, context->node_heap[parent])) break;
+		context->node_heap[position]= context->node_heap[parent];
+		context->heap_positions[context->node_heap[position]]= position;
+		position= parent;
+	}
+	
+	context->node_heap[position]= node_index;
+	context->heap_positions[node_index]= position;
+}
+
+static void heap_sift_down(
+	struct flood_map_context *context,
+	short position)
+{
+	short node_index= context->node_heap[position];
+	
+	for (;;)
+	{
+		short child= 2*position+1;
+		
+		if (child>=context->heap_count) break;
+		if (child+1<context->heap_count && heap_node_precedes(context, context->node_heap[child+1], context->node_heap[child])) child+= 1;
+		if (!heap_node_precedes(context, context->node_heap[child], node_index)) break;
+		context->node_heap[position]= context->node_heap[child];
+		context->heap_positions[context->node_heap[position]]= position;
+		position= child;
+	}
+	
+	context->node_heap[position]= node_index;
+	context->heap_positions[node_index]= position;
+}
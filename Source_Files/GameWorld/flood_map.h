@@ -28,6 +28,8 @@ Saturday, June 18, 1994 8:07:35 PM
 
 /* ---------- constants */
 
+#define MAXIMUM_POINTS_PER_PATH 63
+
 enum /* flood modes */
 {
 	_depth_first, /* unsupported */
@@ -36,6 +38,17 @@ enum /* flood modes */
 	_best_first
 };
 
+/* ---------- structures */
+
+struct path_definition /* 256 bytes */
+{
+	/* NONE is an empty path */
+	short current_step;
+	short step_count;
+	
+	world_point2d points[MAXIMUM_POINTS_PER_PATH];
+};
+
 /* ---------- typedefs */
 
 typedef int32 (*cost_proc_ptr)(short source_polygon_index, short line_index, short destination_polygon_index, void *caller_data);
@@ -51,6 +64,14 @@ short new_path(world_point2d *source_point, short source_polygon_index,
 bool move_along_path(short path_index, world_point2d *p);
 void delete_path(short path_index);
 
+size_t get_paths_length(void);
+void get_paths(void *buffer);
+void set_paths(const void *buffer);
+
+/* for restoring single paths after a speculative update */
+struct path_definition *get_path_list(void);
+short GetNumberOfPaths(void);
+
 /* ---------- prototypes/FLOOD_MAP.C */
 
 void allocate_flood_map_memory(void);
@@ -63,5 +84,13 @@ short flood_depth(void);
 
 void choose_random_flood_node(world_vector2d *bias);
 
+/* flood_map() with state of its own, so floods can run on several threads at once (as long as
+	nothing changes the map meanwhile); a context is sized for the map loaded when it was made */
+struct flood_map_context;
+
+struct flood_map_context *new_flood_map_context(void);
+void delete_flood_map_context(struct flood_map_context *context);
+short flood_map(struct flood_map_context *context, short first_polygon_index, int32 maximum_cost, cost_proc_ptr cost_proc, short flood_mode, void *caller_data);
+
 #endif
 
@@ -82,6 +82,8 @@ Feb 11, 2001 (Loren Petrich):
 #include <string.h>
 #include <limits.h>
 
+#include "world_snapshot.h"
+
 //MH: Lua scripting
 #include "lua_script.h"
 
@@ -175,7 +177,7 @@ short new_item(
 			else if ((get_item_kind(type) == _ball) && !static_world->ball_in_play)
 			{
 				static_world->ball_in_play = true;
-				SoundManager::instance()->PlayLocalSound(_snd_got_ball);
+				if (!speculative_update_in_progress()) SoundManager::instance()->PlayLocalSound(_snd_got_ball);
 			}
 			
 			/* let PLACEMENT.C keep track of how many there are */
@@ -551,6 +553,9 @@ bool try_and_add_player_item(
 	// LP change: added idiot-proofing
 	if (!definition) return false;
 	
+	// inventories, weapons and the HUD only change on real ticks
+	if (speculative_update_in_progress()) return false;
+	
 	struct player_data *player= get_player_data(player_index);
 	short grabbed_sound_index= NONE;
 	bool success= false;
@@ -48,6 +48,7 @@ Jul 3, 2002 (Loren Petrich):
 #include "map.h"
 #include "lightsource.h"
 #include "Packing.h"
+#include "world_snapshot.h"
 
 //MH: Lua scripting
 #include "lua_script.h"
@@ -151,6 +152,7 @@ light_data *get_light_data(
 	
 	if (!light) return NULL;
 	if (!SLOT_IS_USED(light)) return NULL;
+	snapshot_light(static_cast<short>(light_index));
 	
 	return light;
 }
@@ -175,6 +177,7 @@ short new_light(
 	{
 		if (SLOT_IS_FREE(light))
 		{
+			snapshot_light(light_index);
 			light->static_data= *data;
 //			light->flags= 0;
 			MARK_SLOT_AS_USED(light);
@@ -217,6 +220,7 @@ void update_lights(
 	{
 		if (SLOT_IS_USED(light))
 		{
+			snapshot_light(light_index);
 			/* update light phase; if weve overflowed our period change to the next state */
 			light->phase+= 1;
 			rephase_light(light_index);
@@ -118,6 +118,7 @@ find_line_crossed leaving polygon could be sped up considerable by reversing the
 #include "Console.h"
 #include "InfoTree.h"
 #include "flood_map.h"
+#include "world_snapshot.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -267,6 +268,7 @@ object_data *get_object_data(
 	
 	vassert(object, csprintf(temporary, "object index #%d is out of range", object_index));
 	vassert(SLOT_IS_USED(object), csprintf(temporary, "object index #%d is unused", object_index));
+	snapshot_object(object_index);
 	
 	return object;
 }
@@ -413,6 +415,8 @@ void initialize_map_for_new_level(
 
 	obj_clear(*static_world);
 	Console::instance()->clear_saves();
+	invalidate_all_polygon_collidable_objects();
+	invalidate_potentially_visible_sets();
 	
 	// Clear all these out -- supposed to be none of the contents of these when starting a level.
 	objlist_clear(automap_lines, AutomapLineList.size());
@@ -652,6 +656,8 @@ void reconnect_map_object_list(
 			polygon->first_object= i;
 		}
 	}
+	
+	invalidate_all_polygon_collidable_objects();
 }
 
 bool valid_point2d(
@@ -735,8 +741,10 @@ short new_map_object3d(
 		object->location= *location;
 
 		/* insert at head of linked list */
+		snapshot_polygon(polygon_index);
 		object->next_object= polygon->first_object;
 		polygon->first_object= object_index;
+		invalidate_polygon_collidable_objects(polygon_index);
 	}
 	
 	return object_index;
@@ -827,6 +835,7 @@ void remove_map_object(
 	SoundManager::instance()->OrphanSound(object_index);
 	L_Invalidate_Object(object_index);
 	*next_object= object->next_object;
+	invalidate_polygon_collidable_objects(object->polygon);
 	MARK_SLOT_AS_FREE(object);
 }
 
@@ -841,15 +850,26 @@ remove_object_from_polygon_object_list(short object_index, short polygon_index)
 	polygon_data* polygon= get_polygon_data(polygon_index);
 	short* next_object= &polygon->first_object;
 
+	short previous_object_index= NONE;
+
 	assert(*next_object != NONE);
 
 	while (*next_object!=object_index)
 	{
+		previous_object_index= *next_object;
 		next_object= &get_object_data(*next_object)->next_object;
 		assert(*next_object != NONE);
 	}
 
+	// the link being rewritten is in the polygon or in the object before this one
+	if (previous_object_index==NONE)
+		snapshot_polygon(polygon_index);
+	else
+		snapshot_object(previous_object_index);
+	snapshot_object(object_index);
+
 	*next_object= object->next_object;
+	invalidate_polygon_collidable_objects(polygon_index);
 
 	object->polygon= NONE;
 }
@@ -869,8 +889,12 @@ add_object_to_polygon_object_list(short object_index, short polygon_index)
 	struct object_data* object = get_object_data(object_index);
 	struct polygon_data* polygon= get_polygon_data(polygon_index);
 
+	snapshot_object(object_index);
+	snapshot_polygon(polygon_index);
+
 	object->next_object= polygon->first_object;
 	polygon->first_object= object_index;
+	invalidate_polygon_collidable_objects(polygon_index);
 
 	object->polygon= polygon_index;
 }
@@ -913,6 +937,7 @@ perform_deferred_polygon_object_list_manipulations()
 				{
 					object->next_object = *next_object_index_p;
 					*next_object_index_p = object_to_insert_index;
+					invalidate_polygon_collidable_objects(object->polygon);
 					inserted = true;
 				}
 
@@ -949,6 +974,56 @@ perform_deferred_polygon_object_list_manipulations()
 
 
 
+struct polygon_collidable_objects
+{
+	bool valid;
+	vector<short> object_indexes;
+};
+
+static vector<polygon_collidable_objects> PolygonCollidableObjects;
+
+const vector<short>&
+get_polygon_collidable_objects(short polygon_index)
+{
+	if (PolygonCollidableObjects.size() < PolygonList.size())
+		PolygonCollidableObjects.resize(PolygonList.size());
+
+	polygon_collidable_objects& collidable_objects = PolygonCollidableObjects[polygon_index];
+	if (!collidable_objects.valid)
+	{
+		collidable_objects.object_indexes.clear();
+		for (short object_index = get_polygon_data(polygon_index)->first_object; object_index != NONE; object_index = get_object_data(object_index)->next_object)
+		{
+			switch (GET_OBJECT_OWNER(get_object_data(object_index)))
+			{
+				case _object_is_monster:
+				case _object_is_scenery:
+					collidable_objects.object_indexes.push_back(object_index);
+					break;
+			}
+		}
+		collidable_objects.valid = true;
+	}
+
+	return collidable_objects.object_indexes;
+}
+
+void
+invalidate_polygon_collidable_objects(short polygon_index)
+{
+	if (polygon_index >= 0 && static_cast<size_t>(polygon_index) < PolygonCollidableObjects.size())
+		PolygonCollidableObjects[polygon_index].valid = false;
+}
+
+void
+invalidate_all_polygon_collidable_objects()
+{
+	for (size_t i = 0; i < PolygonCollidableObjects.size(); ++i)
+		PolygonCollidableObjects[i].valid = false;
+}
+
+
+
 /* if a new polygon index is supplied, it will be used, otherwise well try to find the new
 	polygon index ourselves */
 bool translate_map_object(
@@ -2128,6 +2203,7 @@ bool change_polygon_height(
 		}
 
 		/* slam the polygon heights, directly */
+		snapshot_polygon(polygon_index);
 		polygon->floor_height= new_floor_height;
 		polygon->ceiling_height= new_ceiling_height;
 		
@@ -2203,7 +2279,8 @@ bool point_is_monster_visible(
 	return *distance!=INT32_MAX;
 }
 
-bool line_is_obstructed(
+/* walks the line from polygon to polygon */
+static bool walk_line_is_obstructed(
 	short polygon_index1,
 	world_point2d *p1,
 	short polygon_index2,
@@ -2279,6 +2356,24 @@ bool line_is_obstructed(
 	return obstructed;
 }
 
+bool line_is_obstructed(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	/* don't bother walking toward a polygon the walk can't reach; films from before the sets
+		keep walking */
+	if (film_profile.line_is_obstructed_pvs && !polygon_may_see_polygon(polygon_index1, p1, polygon_index2, p2))
+	{
+		fc_vassert(walk_line_is_obstructed(polygon_index1, p1, polygon_index2, p2),
+			csprintf(temporary, "PVS says polygon %d can't see polygon %d, but the walk says it can", polygon_index1, polygon_index2));
+		return true;
+	}
+	
+	return walk_line_is_obstructed(polygon_index1, p1, polygon_index2, p2);
+}
+
 #define MAXIMUM_GARBAGE_OBJECTS_PER_MAP 256
 #define MAXIMUM_GARBAGE_OBJECTS_PER_POLYGON 10
 
@@ -2413,6 +2508,7 @@ static short _new_map_object(
 		{
 			/* initialize the object_data structure.  the defaults result in a normal (i.e., scenery),
 				non-solid object.  the rendered, animated and status flags are initially clear. */
+			snapshot_object(object_index);
 			object->polygon= NONE;
 			object->shape= shape;
 			object->facing= facing;
@@ -2470,10 +2566,14 @@ bool line_has_variable_height(
 
 /* ---------- sound code */
 
+/* a predicted tick stays quiet; the real tick plays its sounds when it gets there */
+
 void play_object_sound(
 	short object_index,
 	short sound_code)
 {
+	if (speculative_update_in_progress()) return;
+
 	struct object_data *object= get_object_data(object_index);
 	world_location3d *location= GET_OBJECT_OWNER(object)==_object_is_monster ?
 		(world_location3d *) &get_monster_data(object->permutation)->sound_location : 
@@ -2486,6 +2586,8 @@ void play_polygon_sound(
 	short polygon_index,
 	short sound_code)
 {
+	if (speculative_update_in_progress()) return;
+
 	struct polygon_data *polygon= get_polygon_data(polygon_index);
 	world_location3d source;
 	
@@ -2501,6 +2603,8 @@ void _play_side_sound(
 	short sound_code,
 	_fixed pitch)
 {
+	if (speculative_update_in_progress()) return;
+
 	struct side_data *side= get_side_data(side_index);
 	world_location3d source;
 
@@ -2515,6 +2619,8 @@ void play_world_sound(
 	world_point3d *origin,
 	short sound_code)
 {
+	if (speculative_update_in_progress()) return;
+
 	world_location3d source;
 	
 	source.point= *origin;
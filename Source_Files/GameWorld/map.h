@@ -367,7 +367,7 @@ enum /* object scale flags */
 #define TOGGLE_OBJECT_STATUS(o) ((o)->flags^=(uint16)8)
 
 #define GET_OBJECT_OWNER(o) ((o)->flags&(uint16)7)
-#define SET_OBJECT_OWNER(o,n) { assert((n)>=0&&(n)<=7); (o)->flags&= (uint16)~7; (o)->flags|= (n); }
+#define SET_OBJECT_OWNER(o,n) { assert((n)>=0&&(n)<=7); (o)->flags&= (uint16)~7; (o)->flags|= (n); invalidate_polygon_collidable_objects((o)->polygon); }
 enum /* object owners (8) */
 {
 	_object_is_normal, /* normal */
@@ -1087,6 +1087,60 @@ std::pair<bool, int16> update_world(void);
 void reset_intermediate_action_queues();
 void set_prediction_wanted(bool inPrediction);
 
+// the subsystems update_world() runs each tick, in the order they are run
+enum {
+	_world_subsystem_lua_idle,
+	_world_subsystem_lights,
+	_world_subsystem_medias,
+	_world_subsystem_platforms,
+	_world_subsystem_control_panels,
+	_world_subsystem_players,
+	_world_subsystem_projectiles,
+	_world_subsystem_monsters,
+	_world_subsystem_effects,
+	_world_subsystem_recreate_objects,
+	_world_subsystem_random_sounds,
+	_world_subsystem_scenery,
+	_world_subsystem_ephemera,
+	_world_subsystem_items,
+	_world_subsystem_animated_textures,
+	_world_subsystem_chase_cam,
+	_world_subsystem_motion_sensor,
+	_world_subsystem_m1_exploration,
+	_world_subsystem_net_game,
+	_world_subsystem_lua_postidle,
+	NUMBER_OF_WORLD_SUBSYSTEMS
+};
+
+// every subsystem call is timed; the totals run from the last reset, while
+// the histogram only covers the most recent WORLD_PROFILE_WINDOW calls
+enum {
+	WORLD_PROFILE_WINDOW = 10 * TICKS_PER_SECOND,
+	NUMBER_OF_WORLD_PROFILE_BUCKETS = 16
+};
+
+struct world_subsystem_window
+{
+	int16 call_count;
+	uint32 total_microseconds;
+	uint32 maximum_microseconds;
+	
+	// bucket 0 counts calls under 1us, bucket n calls of [2^(n-1), 2^n) us;
+	// the last bucket is open-ended
+	int16 buckets[NUMBER_OF_WORLD_PROFILE_BUCKETS];
+};
+
+void reset_world_subsystem_timing(void);
+const char *get_world_subsystem_name(short subsystem);
+int32 get_world_subsystem_calls(short subsystem);
+double get_world_subsystem_seconds(short subsystem);
+void get_world_subsystem_window(short subsystem, struct world_subsystem_window *window);
+
+// CRC of the packed dynamic world, players, objects, monsters, projectiles,
+// effects, platforms and lights; equal between two runs only if their
+// simulations matched
+uint32 calculate_game_state_checksum(void);
+
 /* Called to activate lights, platforms, etc. (original polygon may be NONE) */
 void changed_polygon(short original_polygon_index, short new_polygon_index, short player_index);
 
@@ -1134,6 +1188,14 @@ extern void deferred_add_object_to_polygon_object_list(short object_index, short
 // deferred_add_object_to_polygon_object_list() was called!
 extern void perform_deferred_polygon_object_list_manipulations();
 
+// the monster and scenery objects in a polygon's object list, in list order; cached per polygon, so
+// proximity queries don't walk past every item, projectile, effect and corpse.  the list functions
+// above invalidate a polygon's cache; anything else that rewrites object lists or owners wholesale
+// (loading, rolling back prediction) must invalidate them all
+const vector<short>& get_polygon_collidable_objects(short polygon_index);
+void invalidate_polygon_collidable_objects(short polygon_index);
+void invalidate_all_polygon_collidable_objects(void);
+
 
 
 struct shape_and_transfer_mode
@@ -1209,6 +1271,12 @@ bool change_polygon_height(short polygon_index, world_distance new_floor_height,
 	world_distance new_ceiling_height, struct damage_definition *damage);
 
 bool line_is_obstructed(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+
+/* false only if line_is_obstructed() is sure to find the line from p1 to p2 obstructed (see
+	map_constructors.cpp); each polygon's set is computed the first time it's needed after the map
+	changes */
+bool polygon_may_see_polygon(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+void invalidate_potentially_visible_sets(void);
 bool point_is_player_visible(short max_players, short polygon_index, world_point2d *p, int32 *distance);
 bool point_is_monster_visible(short polygon_index, world_point2d *p, int32 *distance);
 
@@ -55,6 +55,7 @@ const bool DoIncorrectCountVWarn = true;
 #include "flood_map.h"
 #include "platforms.h"
 #include "Packing.h"
+#include "map_index_cache.h"
 
 #include <limits.h>
 #include <vector>
@@ -74,17 +75,9 @@ maps of one polygon don
 
 struct intersecting_flood_data
 {
-	// This stuff now global:
-	/*
-	short *line_indexes;
-	short line_count;
-	
-	short *endpoint_indexes;
-	short endpoint_count;
-	
-	short *polygon_indexes;
-	short polygon_count;
-	*/
+	vector<short> line_indexes;
+	vector<short> endpoint_indexes;
+	vector<short> polygon_indexes;
 	
 	short original_polygon_index;
 	world_point2d center;
@@ -92,15 +85,26 @@ struct intersecting_flood_data
 	int32 minimum_separation_squared;
 };
 
+/* what precalculate_map_indexes() finds for one polygon, before it's added to the map indexes */
+struct polygon_map_indexes
+{
+	vector<short> line_indexes;
+	vector<short> endpoint_indexes;
+	vector<short> neighbor_indexes;
+	vector<short> sound_source_indexes;
+};
+
+/* polygons are handed out one at a time to every thread precalculate_map_indexes() starts */
+struct map_index_jobs
+{
+	SDL_atomic_t next;
+	vector<polygon_map_indexes> polygons;
+	vector<short> sound_source_object_indexes;
+};
+
 /* ---------- globals */
 static int32 map_index_buffer_count= 0l; /* Added due to the dynamic nature of maps */
 
-// LP: Temporary areas for nearby endpoint/line/polygon finding;
-// OK for this to be global since they replace only single instances.
-static vector<short> LineIndices(MAXIMUM_INTERSECTING_INDEXES);
-static vector<short> EndpointIndices(MAXIMUM_INTERSECTING_INDEXES);
-static vector<short> PolygonIndices(MAXIMUM_INTERSECTING_INDEXES);
-
 
 /* ---------- private prototypes */
 
@@ -110,11 +114,17 @@ static void calculate_adjacent_sides(short polygon_index, short *side_indexes);
 static int32 calculate_polygon_area(short polygon_index);
 
 static void add_map_index(short index, short *count);
-static void find_intersecting_endpoints_and_lines(short polygon_index, world_distance minimum_separation);
+static int map_index_job_thread(void *data);
+static void calculate_polygon_map_indexes(short polygon_index, struct flood_map_context *context,
+	struct intersecting_flood_data *data, const vector<short> &sound_source_object_indexes,
+	struct polygon_map_indexes *indexes);
+static void find_intersecting_endpoints_and_lines(short polygon_index, world_distance minimum_separation,
+	struct flood_map_context *context, struct intersecting_flood_data *data);
 static int32 intersecting_flood_proc(short source_polygon_index, short line_index,
 	short destination_polygon_index, void *data);
 
-static void precalculate_polygon_sound_sources(void);
+static void find_polygon_sound_sources(short polygon_index, const vector<short> &sound_source_object_indexes,
+	vector<short> &object_indexes);
 
 /* ---------- code */
 
@@ -609,74 +619,143 @@ static int32 calculate_polygon_area(
 
 /* ---------- precalculate map indexes */
 
+/* the exclusion zones and neighbors of every polygon are found with a flood from it, which is
+	done for several polygons at once on as many threads as there are processors; the results are
+	added to the map indexes afterwards in polygon order, so they come out the same as they would
+	one polygon at a time.  a level that's been loaded before reads all of it back from the cache */
 void precalculate_map_indexes(
 	void)
 {
-	short polygon_index = 0;
-	struct polygon_data *polygon = map_polygons;
+	short first_map_index= dynamic_world->map_index_count;
+	short polygon_index;
+	struct polygon_data *polygon;
+	
+	if (load_cached_map_indexes()) return;
+	
+	struct map_index_jobs jobs;
+	short object_index;
+	struct map_object *object;
+	
+	for (object_index= 0, object= saved_objects; object_index<dynamic_world->initial_objects_count; ++object, ++object_index)
+	{
+		if (object->type==_saved_sound_source) jobs.sound_source_object_indexes.push_back(object_index);
+	}
 	
-	for (;polygon_index< dynamic_world->polygon_count;++polygon,++polygon_index)
+	jobs.polygons.resize(dynamic_world->polygon_count);
+	SDL_AtomicSet(&jobs.next, 0);
+	
+	vector<SDL_Thread *> threads;
+	for (int i= 1; i<MIN(SDL_GetCPUCount(), dynamic_world->polygon_count); ++i)
+	{
+		SDL_Thread *thread= SDL_CreateThread(map_index_job_thread, "MapIndexes_floodThread", &jobs);
+		
+		if (!thread) break;
+		threads.push_back(thread);
+	}
+	
+	map_index_job_thread(&jobs);
+	
+	for (size_t i= 0; i<threads.size(); ++i)
+	{
+		SDL_WaitThread(threads[i], NULL);
+	}
+	
+	for (polygon_index= 0, polygon= map_polygons; polygon_index<dynamic_world->polygon_count; ++polygon_index, ++polygon)
 	{
 		if (!POLYGON_IS_DETACHED(polygon)) /* well handle detached polygons during the second pass */
 		{
-			// short line_indexes[MAXIMUM_INTERSECTING_INDEXES], endpoint_indexes[MAXIMUM_INTERSECTING_INDEXES],
-			// 	polygon_indexes[MAXIMUM_INTERSECTING_INDEXES];
-			// short line_count, endpoint_count, polygon_count;
-	
-//			if (polygon_index==17) dprintf("polygon #%d at %p", polygon_index, polygon);
-						
+			struct polygon_map_indexes &indexes= jobs.polygons[polygon_index];
+			
 			polygon->first_exclusion_zone_index= dynamic_world->map_index_count;
 			polygon->line_exclusion_zone_count= polygon->point_exclusion_zone_count= 0;
-			find_intersecting_endpoints_and_lines(polygon_index, MINIMUM_SEPARATION_FROM_WALL);
-			//	line_indexes, &line_count, endpoint_indexes, &endpoint_count, polygon_indexes,
-			//	&polygon_count);
-			
-			size_t line_count = LineIndices.size();
-			size_t endpoint_count = EndpointIndices.size();
-			
-			for (size_t i=0;i<line_count;++i)	
+			for (size_t i= 0; i<indexes.line_indexes.size(); ++i)
 			{
-				add_map_index(LineIndices[i], &polygon->line_exclusion_zone_count);
+				add_map_index(indexes.line_indexes[i], &polygon->line_exclusion_zone_count);
 			}
-			
-			for (size_t i=0;i<endpoint_count;++i)
+			for (size_t i= 0; i<indexes.endpoint_indexes.size(); ++i)
 			{
-				add_map_index(EndpointIndices[i], &polygon->point_exclusion_zone_count);
+				add_map_index(indexes.endpoint_indexes[i], &polygon->point_exclusion_zone_count);
 			}
 			
 			polygon->first_neighbor_index= dynamic_world->map_index_count;
 			polygon->neighbor_count= 0;
-			find_intersecting_endpoints_and_lines(polygon_index, MINIMUM_SEPARATION_FROM_PROJECTILE);
-			//	line_indexes, &line_count, endpoint_indexes, &endpoint_count, polygon_indexes,
-			//	&polygon_count);
-			
-//			if (polygon_index==155) dprintf("polygon index #%d has %d neighbors:;dm %x %x;", polygon_index, polygon_count, polygon_indexes, sizeof(short)*polygon_count);
-			
-			size_t polygon_count = PolygonIndices.size();
-
-			for (size_t i=0;i<polygon_count;++i)
+			for (size_t i= 0; i<indexes.neighbor_indexes.size(); ++i)
 			{
-				add_map_index(PolygonIndices[i], &polygon->neighbor_count);
+				add_map_index(indexes.neighbor_indexes[i], &polygon->neighbor_count);
 			}
 		}
 	}
+	
+	/* sound sources go after every polygon's exclusion zones and neighbors */
+	for (polygon_index= 0, polygon= map_polygons; polygon_index<dynamic_world->polygon_count; ++polygon_index, ++polygon)
+	{
+		struct polygon_map_indexes &indexes= jobs.polygons[polygon_index];
+		short sound_sources= 0;
+		
+		polygon->sound_source_indexes= dynamic_world->map_index_count;
+		for (size_t i= 0; i<indexes.sound_source_indexes.size(); ++i)
+		{
+			add_map_index(indexes.sound_source_indexes[i], &sound_sources);
+		}
+		add_map_index(NONE, &sound_sources);
+	}
+	
+	store_cached_map_indexes(first_map_index);
+}
 
-	precalculate_polygon_sound_sources();
+static int map_index_job_thread(
+	void *vdata)
+{
+	struct map_index_jobs *jobs= (struct map_index_jobs *) vdata;
+	struct flood_map_context *context= new_flood_map_context();
+	struct intersecting_flood_data data;
+	int polygon_count= static_cast<int>(jobs->polygons.size());
+	
+	for (int polygon_index= SDL_AtomicAdd(&jobs->next, 1); polygon_index<polygon_count; polygon_index= SDL_AtomicAdd(&jobs->next, 1))
+	{
+		calculate_polygon_map_indexes(polygon_index, context, &data, jobs->sound_source_object_indexes,
+			&jobs->polygons[polygon_index]);
+	}
+	
+	delete_flood_map_context(context);
+	
+	return 0;
 }
 
-static void find_intersecting_endpoints_and_lines(
+/* only reads the map, so it can run for several polygons at once */
+static void calculate_polygon_map_indexes(
 	short polygon_index,
-	world_distance minimum_separation)
+	struct flood_map_context *context,
+	struct intersecting_flood_data *data,
+	const vector<short> &sound_source_object_indexes,
+	struct polygon_map_indexes *indexes)
 {
-	struct intersecting_flood_data data;
+	if (!POLYGON_IS_DETACHED(get_polygon_data(polygon_index)))
+	{
+		find_intersecting_endpoints_and_lines(polygon_index, MINIMUM_SEPARATION_FROM_WALL, context, data);
+		indexes->line_indexes.swap(data->line_indexes);
+		indexes->endpoint_indexes.swap(data->endpoint_indexes);
+		
+		find_intersecting_endpoints_and_lines(polygon_index, MINIMUM_SEPARATION_FROM_PROJECTILE, context, data);
+		indexes->neighbor_indexes.swap(data->polygon_indexes);
+	}
+	
+	find_polygon_sound_sources(polygon_index, sound_source_object_indexes, indexes->sound_source_indexes);
+}
 
-	data.original_polygon_index= polygon_index;
-	LineIndices.clear();
-	EndpointIndices.clear();
-	PolygonIndices.clear();
+static void find_intersecting_endpoints_and_lines(
+	short polygon_index,
+	world_distance minimum_separation,
+	struct flood_map_context *context,
+	struct intersecting_flood_data *data)
+{
+	data->original_polygon_index= polygon_index;
+	data->line_indexes.clear();
+	data->endpoint_indexes.clear();
+	data->polygon_indexes.clear();
 
-	data.minimum_separation_squared= minimum_separation*minimum_separation;
-	find_center_of_polygon(polygon_index, &data.center);
+	data->minimum_separation_squared= minimum_separation*minimum_separation;
+	find_center_of_polygon(polygon_index, &data->center);
 	
 	if (film_profile.adjacent_polygons_always_intersect)
 	{
@@ -686,15 +765,15 @@ static void find_intersecting_endpoints_and_lines(
 			short adjacent_polygon_index = find_adjacent_polygon(polygon_index, polygon->line_indexes[i]);
 			if (adjacent_polygon_index != NONE)
 			{
-				PolygonIndices.push_back(adjacent_polygon_index);
+				data->polygon_indexes.push_back(adjacent_polygon_index);
 			}
 		}
 	}
 
-	polygon_index= flood_map(polygon_index, INT32_MAX, intersecting_flood_proc, _breadth_first, &data);
+	polygon_index= flood_map(context, polygon_index, INT32_MAX, intersecting_flood_proc, _breadth_first, data);
 	while (polygon_index!=NONE)
 	{
-		polygon_index= flood_map(NONE, INT32_MAX, intersecting_flood_proc, _breadth_first, &data);
+		polygon_index= flood_map(context, NONE, INT32_MAX, intersecting_flood_proc, _breadth_first, data);
 	}
 }
 
@@ -881,16 +960,16 @@ static int32 intersecting_flood_proc(
 		for (i=0;i<polygon->vertex_count;++i)
 		{
 			/* add this line if it isnt already in the intersecting line list */
-			for (j=0;j<LineIndices.size();++j)
+			for (j=0;j<data->line_indexes.size();++j)
 			{
-				if (LineIndices[j]==polygon->line_indexes[i] ||
-					-LineIndices[j]-1==polygon->line_indexes[i])
+				if (data->line_indexes[j]==polygon->line_indexes[i] ||
+					-data->line_indexes[j]-1==polygon->line_indexes[i])
 				{
 					keep_searching= true;
 					break; /* found duplicate, stop */
 				}
 			}
-			if (j==LineIndices.size())
+			if (j==data->line_indexes.size())
 			{
 				short line_index= polygon->line_indexes[i];
 				struct line_data *line= get_line_data(line_index);
@@ -913,7 +992,7 @@ static int32 intersecting_flood_proc(
 						{
 							bool clockwise= !!((((b->x-a->x)*(data->center.y-b->y)) - ((b->y-a->y)*(data->center.x-b->x)))>0);
 							
-							LineIndices.push_back(clockwise ? polygon->line_indexes[i] : (-polygon->line_indexes[i]-1));
+							data->line_indexes.push_back(clockwise ? polygon->line_indexes[i] : (-polygon->line_indexes[i]-1));
 							keep_searching= true;
 							break;
 						}
@@ -922,15 +1001,15 @@ static int32 intersecting_flood_proc(
 			}
 			
 			/* add this endpoint if it isnt already in the intersecting endpoint list */
-			for (j=0;j<EndpointIndices.size();++j)
+			for (j=0;j<data->endpoint_indexes.size();++j)
 			{
-				if (EndpointIndices[j]==polygon->endpoint_indexes[i])
+				if (data->endpoint_indexes[j]==polygon->endpoint_indexes[i])
 				{
 					keep_searching= true;
 					break; /* found duplicate, ignore (but keep looking for others) */
 				}
 			}
-			if (j==EndpointIndices.size())
+			if (j==data->endpoint_indexes.size())
 			{
 				world_point2d *p= &(get_endpoint_data(polygon->endpoint_indexes[i])->vertex);
 				
@@ -944,7 +1023,7 @@ static int32 intersecting_flood_proc(
 		
 					if (point_to_line_segment_distance_squared(p, a, b)<data->minimum_separation_squared)
 					{
-						EndpointIndices.push_back(polygon->endpoint_indexes[i]);
+						data->endpoint_indexes.push_back(polygon->endpoint_indexes[i]);
 						break;
 					}
 				}
@@ -955,23 +1034,23 @@ static int32 intersecting_flood_proc(
 	/* if any part of this polygon is close enough to our original polygon, remember its index */
 	if (keep_searching)
 	{
-		for (j=0;j<PolygonIndices.size();++j)
+		for (j=0;j<data->polygon_indexes.size();++j)
 		{
-			if (PolygonIndices[j]==source_polygon_index)
+			if (data->polygon_indexes[j]==source_polygon_index)
 			{
 				break; /* found duplicate, ignore */
 			}
 		}
-		if (j==PolygonIndices.size())
+		if (j==data->polygon_indexes.size())
 		{
 			short detached_twin_index= NONE; //find_undetached_polygons_twin(source_polygon_index);
 			
-			PolygonIndices.push_back(source_polygon_index);
+			data->polygon_indexes.push_back(source_polygon_index);
 			
 			/* if this polygon has a detached twin, add it too */
 			if (detached_twin_index!=NONE)
 			{
-				PolygonIndices.push_back(detached_twin_index);
+				data->polygon_indexes.push_back(detached_twin_index);
 			}
 		}
 	}
@@ -1133,68 +1212,522 @@ static void add_map_index(
 
 #define ZERO_VOLUME_DISTANCE (10*WORLD_ONE)
 
-static void precalculate_polygon_sound_sources(
-	void)
+/* object_indexes gets every sound source (of the saved objects in sound_source_object_indexes)
+	close enough to be heard in the given polygon */
+static void find_polygon_sound_sources(
+	short polygon_index,
+	const vector<short> &sound_source_object_indexes,
+	vector<short> &object_indexes)
 {
-	short polygon_index;
-	struct polygon_data *polygon;
+	struct polygon_data *polygon= get_polygon_data(polygon_index);
 	
-	for (polygon_index= 0, polygon= map_polygons; polygon_index<dynamic_world->polygon_count; ++polygon_index, ++polygon)
+	object_indexes.clear();
+	for (size_t j= 0; j<sound_source_object_indexes.size(); ++j)
 	{
-		short object_index;
-		struct map_object *object;
-		short sound_sources= 0;
+		short object_index= sound_source_object_indexes[j];
+		struct map_object *object= saved_objects+object_index;
+		short i;
+		bool close= false;
 		
-		polygon->sound_source_indexes= dynamic_world->map_index_count;
+		for (i= 0; i<polygon->vertex_count; ++i)
+		{
+			struct endpoint_data *endpoint= get_endpoint_data(polygon->endpoint_indexes[i]);
+			struct line_data *line= get_line_data(polygon->line_indexes[i]);
+			
+			if (guess_distance2d((world_point2d *)&object->location, &endpoint->vertex)<ZERO_VOLUME_DISTANCE ||
+				point_to_line_segment_distance_squared((world_point2d *)&object->location,
+					&get_endpoint_data(line->endpoint_indexes[0])->vertex,
+					&get_endpoint_data(line->endpoint_indexes[1])->vertex)<ZERO_VOLUME_DISTANCE)
+			{
+				close= true;
+				break;
+			}
+		}
 		
-		for (object_index= 0, object= saved_objects; object_index<dynamic_world->initial_objects_count; ++object, ++object_index)
+		if (close) object_indexes.push_back(object_index);
+	}
+}
+
+/* ---------- potentially visible sets */
+
+/* for every polygon, a bit for every polygon line_is_obstructed() might walk to from it; clearing
+	a bit is a promise that the walk would say the pair is obstructed, so anything in doubt stays
+	set.  each polygon's row is built the first time it's asked about after a level is loaded, so
+	the cost is spread over the level and polygons nothing ever looks from cost nothing.
+
+	the walk follows the directed line through p1 and p2, which we write as w= (dx, dy, k) with
+	d= p2-p1 and k= p1.x*dy - p1.y*dx.  it leaves a polygon by edge e0e1 only if the line passes
+	on or right of e0 and on or left of e1, and both of those tests are n.w>=0 for an integer n
+	made from the endpoint.  so a chain of polygons can be walked only if the cone of w satisfying
+	every crossing in it has something in it besides zero.  the cones are kept exactly, as the
+	planes bounding them and the rays spanning them, each ray the cross product of two planes; with
+	the coordinates limited below none of the products overflow, and the walk's own int32
+	arithmetic doesn't either, so the sets agree with the walk on every machine.  (the walk also
+	needs p2 past each edge; leaving that out only makes the sets bigger.)
+
+	a line with dx= dy= 0 (p1==p2) walks toward p2 by any edge p2 is outside of, which a cone of
+	lines can't describe, and a point outside the coordinate limits might overflow the walk, so
+	polygon_may_see_polygon() says yes to both. */
+
+#define MAXIMUM_PVS_POLYGONS 8192 /* past this a map gets no sets (8M of bits) */
+#define MAXIMUM_PVS_WORK_PER_POLYGON 4000 /* crossings tried before a polygon sees everything */
+#define MAXIMUM_PVS_COORDINATE 16383 /* past this a map gets no sets (see above) */
+#define MAXIMUM_PVS_CONE_PLANES 24 /* past this a polygon sees everything */
+#define MAXIMUM_PVS_CONES_PER_CROSSING 4 /* cones remembered for each side of each line */
+
+struct pvs_vector
+{
+	int64_t x, y, z;
+};
+
+/* everything whose dot product with each plane is >= 0; the cones are never allowed to hold a
+	whole line (every ray r with -r), so they are spanned by their extreme rays */
+struct pvs_cone
+{
+	short plane_count; /* 0 for the whole space */
+	short ray_count; /* 0 (with planes) for nothing but zero */
+	pvs_vector planes[MAXIMUM_PVS_CONE_PLANES];
+	pvs_vector rays[MAXIMUM_PVS_CONE_PLANES];
+};
+
+struct pvs_frame
+{
+	short polygon_index;
+	short entry_line_index;
+	short next_vertex;
+	pvs_cone cone; /* the lines that can have walked this far */
+};
+
+/* a line walked through a second time with no lines that weren't in an earlier cone there can only
+	reach what was already reached, so the walk ends even though it doesn't keep track of the path
+	it took */
+struct pvs_context
+{
+	vector<pvs_frame> stack;
+	vector<pvs_cone> crossed_cones;
+	vector<int32> crossed_cone_indexes; /* MAXIMUM_PVS_CONES_PER_CROSSING for each side of each line */
+	vector<uint8> crossed_counts; /* two per line */
+	vector<size_t> crossed_used;
+	vector<vector<short> > endpoint_polygons;
+	vector<uint32> touching;
+	pvs_cone next_cone;
+};
+
+static bool potentially_visible_sets_valid= false;
+static size_t pvs_row_words= 0; /* 0 if there are no sets for this map */
+static vector<uint32> pvs_bits;
+static vector<bool> pvs_row_built;
+static pvs_context pvs_scratch;
+
+static inline bool line_is_passable_for_pvs(
+	short polygon_index,
+	short line_index,
+	short *adjacent_polygon_index)
+{
+	struct line_data *line= get_line_data(line_index);
+
+	*adjacent_polygon_index= find_adjacent_polygon(polygon_index, line_index);
+
+	/* platforms can change the solidity of variable elevation lines during the game */
+	return *adjacent_polygon_index!=NONE && (!LINE_IS_SOLID(line) || LINE_IS_VARIABLE_ELEVATION(line));
+}
+
+static inline int64_t pvs_dot(
+	const pvs_vector &a,
+	const pvs_vector &b)
+{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static inline pvs_vector pvs_cross(
+	const pvs_vector &a,
+	const pvs_vector &b)
+{
+	pvs_vector c= {a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x};
+
+	return c;
+}
+
+static inline bool pvs_is_zero(
+	const pvs_vector &v)
+{
+	return !v.x && !v.y && !v.z;
+}
+
+static inline bool pvs_same_ray(
+	const pvs_vector &a,
+	const pvs_vector &b)
+{
+	return pvs_is_zero(pvs_cross(a, b)) && pvs_dot(a, b)>0;
+}
+
+static bool pvs_cone_allows(
+	const pvs_vector *planes,
+	short plane_count,
+	const pvs_vector &ray)
+{
+	for (short i= 0; i<plane_count; ++i) if (pvs_dot(planes[i], ray)<0) return false;
+
+	return true;
+}
+
+/* the two planes the walk's test for leaving polygon by its edge i puts on w */
+static void pvs_crossing_planes(
+	struct polygon_data *polygon,
+	short i,
+	pvs_vector *planes)
+{
+	world_point2d *e0= &get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+	world_point2d *e1= &get_endpoint_data(polygon->endpoint_indexes[i==polygon->vertex_count-1 ? 0 : i+1])->vertex;
+
+	/* (e0-p1) cross d >= 0 and (e1-p1) cross d <= 0 */
+	planes[0].x= -e0->y, planes[0].y= e0->x, planes[0].z= -1;
+	planes[1].x= e1->y, planes[1].y= -e1->x, planes[1].z= 1;
+}
+
+/* cuts cone down by more planes; false if nothing but zero is left, or if the result is too big to
+	keep, in which case *too_complex is set.  every extreme ray of the result is either an extreme
+	ray of cone or lies on a new plane and one other, so those are the only candidates */
+static bool clip_pvs_cone(
+	const pvs_cone &cone,
+	const pvs_vector *new_planes,
+	short new_plane_count,
+	pvs_cone &result,
+	bool *too_complex)
+{
+	pvs_vector planes[MAXIMUM_PVS_CONE_PLANES+4];
+	pvs_vector candidates[MAXIMUM_PVS_CONE_PLANES + 2*4*(MAXIMUM_PVS_CONE_PLANES+4)];
+	short plane_count= 0, old_plane_count, candidate_count= 0;
+	short i, j;
+
+	assert(new_plane_count<=4);
+
+	/* planes every extreme ray is on the right side of don't cut the cone at all */
+	if (cone.plane_count)
+	{
+		for (i= 0; i<cone.ray_count; ++i) if (!pvs_cone_allows(new_planes, new_plane_count, cone.rays[i])) break;
+		if (i==cone.ray_count)
+		{
+			result= cone;
+			return true;
+		}
+	}
+
+	for (i= 0; i<cone.plane_count; ++i) planes[plane_count++]= cone.planes[i];
+	old_plane_count= plane_count;
+	for (i= 0; i<new_plane_count; ++i)
+	{
+		for (j= 0; j<plane_count; ++j)
+		{
+			if (planes[j].x==new_planes[i].x && planes[j].y==new_planes[i].y && planes[j].z==new_planes[i].z) break;
+		}
+		if (j==plane_count) planes[plane_count++]= new_planes[i];
+	}
+
+	for (i= 0; i<cone.ray_count; ++i)
+	{
+		if (pvs_cone_allows(planes+old_plane_count, plane_count-old_plane_count, cone.rays[i]))
 		{
-			if (object->type==_saved_sound_source)
+			candidates[candidate_count++]= cone.rays[i];
+		}
+	}
+	for (i= old_plane_count; i<plane_count; ++i)
+	{
+		for (j= 0; j<i; ++j)
+		{
+			pvs_vector ray= pvs_cross(planes[i], planes[j]);
+
+			if (pvs_is_zero(ray)) continue;
+			for (short sign= 0; sign<2; ++sign)
 			{
-				short i;
-				bool close= false;
-				
-				for (i= 0; i<polygon->vertex_count; ++i)
+				if (sign) ray.x= -ray.x, ray.y= -ray.y, ray.z= -ray.z;
+				if (!pvs_cone_allows(planes, plane_count, ray)) continue;
+
+				short k;
+				for (k= 0; k<candidate_count; ++k) if (pvs_same_ray(candidates[k], ray)) break;
+				if (k==candidate_count) candidates[candidate_count++]= ray;
+			}
+		}
+	}
+
+	/* keep the extreme rays, the ones on two planes which aren't the same plane */
+	result.plane_count= 0;
+	result.ray_count= 0;
+	for (i= 0; i<candidate_count; ++i)
+	{
+		short first_plane= NONE;
+		bool extreme= false;
+
+		for (j= 0; j<plane_count && !extreme; ++j)
+		{
+			if (pvs_dot(planes[j], candidates[i])) continue;
+			if (first_plane==NONE) first_plane= j;
+			else extreme= !pvs_is_zero(pvs_cross(planes[first_plane], planes[j]));
+		}
+		if (!extreme) continue;
+
+		if (result.ray_count==MAXIMUM_PVS_CONE_PLANES)
+		{
+			*too_complex= true;
+			return false;
+		}
+		result.rays[result.ray_count++]= candidates[i];
+	}
+	if (!result.ray_count) return false;
+
+	/* a plane no extreme ray lies on is positive everywhere else in the cone, so it can't touch
+		any smaller cone either */
+	for (j= 0; j<plane_count; ++j)
+	{
+		for (i= 0; i<result.ray_count; ++i) if (!pvs_dot(planes[j], result.rays[i])) break;
+		if (i==result.ray_count) continue;
+
+		if (result.plane_count==MAXIMUM_PVS_CONE_PLANES)
+		{
+			*too_complex= true;
+			return false;
+		}
+		result.planes[result.plane_count++]= planes[j];
+	}
+
+	return true;
+}
+
+static bool pvs_cone_contains(
+	const pvs_cone &outer,
+	const pvs_cone &inner)
+{
+	for (short i= 0; i<inner.ray_count; ++i)
+	{
+		if (!pvs_cone_allows(outer.planes, outer.plane_count, inner.rays[i])) return false;
+	}
+
+	return true;
+}
+
+/* false if the lines in cone have all crossed this side of this line already */
+static bool note_pvs_crossing(
+	pvs_context &context,
+	size_t crossed_index,
+	const pvs_cone &cone)
+{
+	int32 *indexes= &context.crossed_cone_indexes[crossed_index*MAXIMUM_PVS_CONES_PER_CROSSING];
+	uint8 &count= context.crossed_counts[crossed_index];
+
+	for (uint8 i= 0; i<count; ++i)
+	{
+		if (pvs_cone_contains(context.crossed_cones[indexes[i]], cone)) return false;
+	}
+
+	if (!count) context.crossed_used.push_back(crossed_index);
+	if (count<MAXIMUM_PVS_CONES_PER_CROSSING)
+	{
+		indexes[count++]= static_cast<int32>(context.crossed_cones.size());
+		context.crossed_cones.push_back(cone);
+	}
+
+	return true;
+}
+
+/* walks every chain of passable lines a single directed line could cross in order, starting from
+	each passable line of the source polygon; every direction lies in one of the four closed
+	quadrants, and limiting each walk to one keeps its cones from holding a whole line */
+static void build_polygon_pvs(
+	short source_polygon_index,
+	uint32 *row,
+	pvs_context &context)
+{
+	struct polygon_data *source_polygon= get_polygon_data(source_polygon_index);
+	vector<pvs_frame> &stack= context.stack;
+	pvs_cone &next_cone= context.next_cone;
+	int32 work= 0;
+	bool too_complex= false;
+	short quadrant, i;
+
+	row[source_polygon_index>>5]|= 1u<<(source_polygon_index&31);
+
+	for (size_t j= 0; j<context.crossed_used.size(); ++j) context.crossed_counts[context.crossed_used[j]]= 0;
+	context.crossed_used.clear();
+	context.crossed_cones.clear();
+
+	for (quadrant= 0; quadrant<4 && !too_complex; ++quadrant)
+	{
+		for (i= 0; i<source_polygon->vertex_count && !too_complex; ++i)
+		{
+			short line_index= source_polygon->line_indexes[i];
+			short adjacent_polygon_index;
+
+			if (!line_is_passable_for_pvs(source_polygon_index, line_index, &adjacent_polygon_index)) continue;
+
+			pvs_vector planes[4]= {{(quadrant&1) ? -1 : 1, 0, 0}, {0, (quadrant&2) ? -1 : 1, 0}};
+			pvs_cone everything;
+			everything.plane_count= everything.ray_count= 0;
+			pvs_crossing_planes(source_polygon, i, planes+2);
+			if (!clip_pvs_cone(everything, planes, 4, next_cone, &too_complex)) continue;
+
+			struct line_data *line= get_line_data(line_index);
+			if (!note_pvs_crossing(context, 2*line_index + (adjacent_polygon_index==line->clockwise_polygon_owner ? 0 : 1), next_cone)) continue;
+			row[adjacent_polygon_index>>5]|= 1u<<(adjacent_polygon_index&31);
+
+			stack.resize(1);
+			stack.back().polygon_index= adjacent_polygon_index;
+			stack.back().entry_line_index= line_index;
+			stack.back().next_vertex= 0;
+			stack.back().cone= next_cone;
+			while (!stack.empty() && !too_complex)
+			{
+				pvs_frame &frame= stack.back();
+				struct polygon_data *polygon= get_polygon_data(frame.polygon_index);
+
+				if (frame.next_vertex>=polygon->vertex_count)
 				{
-					struct endpoint_data *endpoint= get_endpoint_data(polygon->endpoint_indexes[i]);
-					struct line_data *line= get_line_data(polygon->line_indexes[i]);
-					
-					if (guess_distance2d((world_point2d *)&object->location, &endpoint->vertex)<ZERO_VOLUME_DISTANCE ||
-						point_to_line_segment_distance_squared((world_point2d *)&object->location,
-							&get_endpoint_data(line->endpoint_indexes[0])->vertex,
-							&get_endpoint_data(line->endpoint_indexes[1])->vertex)<ZERO_VOLUME_DISTANCE)
-					{
-						close= true;
-						break;
-					}
+					stack.pop_back();
+					continue;
 				}
-				
-				if (close) add_map_index(object_index, &sound_sources);
+
+				short vertex= frame.next_vertex++;
+				short next_line_index= polygon->line_indexes[vertex];
+				short next_polygon_index;
+
+				/* going back needs a line along the entry line, and then p2 can't be past it */
+				if (next_line_index==frame.entry_line_index) continue;
+				if (!line_is_passable_for_pvs(frame.polygon_index, next_line_index, &next_polygon_index)) continue;
+
+				if (++work>MAXIMUM_PVS_WORK_PER_POLYGON)
+				{
+					too_complex= true;
+					break;
+				}
+
+				pvs_crossing_planes(polygon, vertex, planes);
+				if (!clip_pvs_cone(frame.cone, planes, 2, next_cone, &too_complex)) continue;
+
+				struct line_data *next_line= get_line_data(next_line_index);
+				if (!note_pvs_crossing(context, 2*next_line_index + (next_polygon_index==next_line->clockwise_polygon_owner ? 0 : 1), next_cone)) continue;
+				row[next_polygon_index>>5]|= 1u<<(next_polygon_index&31);
+
+				short entry_line_index= next_line_index;
+				stack.resize(stack.size()+1); /* invalidates frame */
+				stack.back().polygon_index= next_polygon_index;
+				stack.back().entry_line_index= entry_line_index;
+				stack.back().next_vertex= 0;
+				stack.back().cone= next_cone;
 			}
 		}
-		
-		add_map_index(NONE, &sound_sources);
 	}
+
+	if (too_complex)
+	{
+		/* give up and let this polygon see everything */
+		for (size_t word= 0; word<pvs_row_words; ++word) row[word]= 0xffffffff;
+	}
+	stack.clear();
 }
 
-uint8 *unpack_endpoint_data(uint8 *Stream, endpoint_data *Objects, size_t Count)
+static void prepare_potentially_visible_sets(
+	void)
 {
-	uint8* S = Stream;
-	endpoint_data* ObjPtr = Objects;
-     
-     for (size_t k = 0; k < Count; k++, ObjPtr++)
+	size_t polygon_count= dynamic_world->polygon_count;
+	pvs_context &context= pvs_scratch;
+
+	potentially_visible_sets_valid= true;
+	pvs_row_words= 0;
+	pvs_bits.clear();
+	pvs_row_built.clear();
+
+	if (polygon_count>MAXIMUM_PVS_POLYGONS) return;
+	for (short endpoint_index= 0; endpoint_index<dynamic_world->endpoint_count; ++endpoint_index)
 	{
-		StreamToValue(S,ObjPtr->flags);
-		StreamToValue(S,ObjPtr->highest_adjacent_floor_height);
-		StreamToValue(S,ObjPtr->lowest_adjacent_ceiling_height);
-		
-		StreamToValue(S,ObjPtr->vertex.x);
-		StreamToValue(S,ObjPtr->vertex.y);
-		StreamToValue(S,ObjPtr->transformed.x);
-		StreamToValue(S,ObjPtr->transformed.y);
-		
-		StreamToValue(S,ObjPtr->supporting_polygon_index);
+		world_point2d *vertex= &get_endpoint_data(endpoint_index)->vertex;
+
+		if (ABS(vertex->x)>MAXIMUM_PVS_COORDINATE || ABS(vertex->y)>MAXIMUM_PVS_COORDINATE) return;
 	}
+
+	pvs_row_words= (polygon_count+31)>>5;
+	pvs_bits.assign(polygon_count*pvs_row_words, 0);
+	pvs_row_built.assign(polygon_count, false);
+
+	context.crossed_cone_indexes.resize(2*dynamic_world->line_count*MAXIMUM_PVS_CONES_PER_CROSSING);
+	context.crossed_counts.assign(2*dynamic_world->line_count, 0);
+	context.crossed_used.clear();
+	context.touching.resize(pvs_row_words);
+
+	context.endpoint_polygons.assign(dynamic_world->endpoint_count, vector<short>());
+	for (size_t polygon_index= 0; polygon_index<polygon_count; ++polygon_index)
+	{
+		struct polygon_data *polygon= get_polygon_data(static_cast<short>(polygon_index));
+
+		for (short i= 0; i<polygon->vertex_count; ++i)
+		{
+			context.endpoint_polygons[polygon->endpoint_indexes[i]].push_back(static_cast<short>(polygon_index));
+		}
+	}
+}
+
+static void build_pvs_row(
+	short polygon_index)
+{
+	size_t polygon_count= dynamic_world->polygon_count;
+	pvs_context &context= pvs_scratch;
+	uint32 *row= &pvs_bits[polygon_index*pvs_row_words];
+	vector<uint32> &touching= context.touching;
+
+	build_polygon_pvs(polygon_index, row, context);
+
+	/* line_is_obstructed() forgives ending up in a polygon which shares an endpoint with the
+		destination, so anything touching a visible polygon is visible too */
+	touching.assign(pvs_row_words, 0);
+	for (size_t visible_index= 0; visible_index<polygon_count; ++visible_index)
+	{
+		if (!(row[visible_index>>5] & (1u<<(visible_index&31)))) continue;
+
+		struct polygon_data *polygon= get_polygon_data(static_cast<short>(visible_index));
+		for (short i= 0; i<polygon->vertex_count; ++i)
+		{
+			vector<short> &owners= context.endpoint_polygons[polygon->endpoint_indexes[i]];
+
+			for (size_t j= 0; j<owners.size(); ++j) touching[owners[j]>>5]|= 1u<<(owners[j]&31);
+		}
+	}
+	for (size_t word= 0; word<pvs_row_words; ++word) row[word]|= touching[word];
+
+	pvs_row_built[polygon_index]= true;
+}
+
+bool polygon_may_see_polygon(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	if (p1->x==p2->x && p1->y==p2->y) return true;
+	if (ABS(p1->x)>MAXIMUM_PVS_COORDINATE || ABS(p1->y)>MAXIMUM_PVS_COORDINATE ||
+		ABS(p2->x)>MAXIMUM_PVS_COORDINATE || ABS(p2->y)>MAXIMUM_PVS_COORDINATE) return true;
+
+	if (!potentially_visible_sets_valid) prepare_potentially_visible_sets();
+	if (!pvs_row_words) return true;
+	if (!pvs_row_built[polygon_index1]) build_pvs_row(polygon_index1);
+
+	return (pvs_bits[polygon_index1*pvs_row_words + (polygon_index2>>5)] & (1u<<(polygon_index2&31))) != 0;
+}
+
+void invalidate_potentially_visible_sets(
+	void)
+{
+	potentially_visible_sets_valid= false;
+}
+
+// Endpoints, lines and map objects are nothing but 16-bit fields in file order, so a whole
+// list of them is converted as one list of values
+static_assert(sizeof(endpoint_data) == SIZEOF_endpoint_data, "endpoint_data must match its packed layout");
+static_assert(sizeof(line_data) == SIZEOF_line_data, "line_data must match its packed layout");
+static_assert(sizeof(map_object) == SIZEOF_map_object, "map_object must match its packed layout");
+
+uint8 *unpack_endpoint_data(uint8 *Stream, endpoint_data *Objects, size_t Count)
+{
+	uint8* S = Stream;
+	
+	StreamToList(S,reinterpret_cast<int16 *>(Objects),Count*SIZEOF_endpoint_data/2);
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_endpoint_data));
 	return S;
@@ -1227,25 +1760,9 @@ uint8 *pack_endpoint_data(uint8 *Stream, endpoint_data *Objects, size_t Count)
 uint8 *unpack_line_data(uint8 *Stream, line_data *Objects, size_t Count)
 {
 	uint8* S = Stream;
-	line_data* ObjPtr = Objects;
 	
-	for (size_t k = 0; k < Count; k++, ObjPtr++)
-	{
-		StreamToList(S,ObjPtr->endpoint_indexes,2);
-		StreamToValue(S,ObjPtr->flags);
-		
-		StreamToValue(S,ObjPtr->length);
-		StreamToValue(S,ObjPtr->highest_adjacent_floor);
-		StreamToValue(S,ObjPtr->lowest_adjacent_ceiling);
-		
-		StreamToValue(S,ObjPtr->clockwise_polygon_side_index);
-		StreamToValue(S,ObjPtr->counterclockwise_polygon_side_index);
-		
-		StreamToValue(S,ObjPtr->clockwise_polygon_owner);
-		StreamToValue(S,ObjPtr->counterclockwise_polygon_owner);
-		
-		S += 6*2;
-	}
+	// (this brings the unused fields along too)
+	StreamToList(S,reinterpret_cast<int16 *>(Objects),Count*SIZEOF_line_data/2);
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_line_data));
 	return S;
@@ -1571,25 +2088,14 @@ uint8 *unpack_map_object(uint8 *Stream, map_object* Objects, size_t Count, int v
 	uint8* S = Stream;
 	map_object* ObjPtr = Objects;
 	
-	for (size_t k = 0; k < Count; k++, ObjPtr++)
+	StreamToList(S,reinterpret_cast<int16 *>(Objects),Count*SIZEOF_map_object/2);
+	if (version == MARATHON_ONE_DATA_VERSION &&
+		film_profile.m1_object_unused)
 	{
-		StreamToValue(S,ObjPtr->type);
-		StreamToValue(S,ObjPtr->index);
-		StreamToValue(S,ObjPtr->facing);
-		StreamToValue(S,ObjPtr->polygon_index);
-		StreamToValue(S,ObjPtr->location.x);
-		StreamToValue(S,ObjPtr->location.y);
-		if (version == MARATHON_ONE_DATA_VERSION &&
-			film_profile.m1_object_unused)
+		for (size_t k = 0; k < Count; k++, ObjPtr++)
 		{
-		    ObjPtr->location.z = 0;
+		    ObjPtr->location.z = 0; // short unused[2]
 		    ObjPtr->flags = 0;
-		    S += 2*2; // short unused[2]
-		}
-		else
-		{
-		    StreamToValue(S,ObjPtr->location.z);
-		    StreamToValue(S,ObjPtr->flags);
 		}
 	}
 	
@@ -124,6 +124,8 @@ Feb 8, 2003 (Woody Zenfell):
 #include <limits.h>
 
 #include "ephemera.h"
+#include "crc.h"
+#include "world_snapshot.h"
 
 /* ---------- constants */
 
@@ -196,38 +198,20 @@ set_prediction_wanted(bool inPrediction)
 	sPredictionWanted= inPrediction;
 }
 
-static player_data sSavedPlayerData[MAXIMUM_NUMBER_OF_PLAYERS];
-static monster_data sSavedPlayerMonsterData[MAXIMUM_NUMBER_OF_PLAYERS];
-static object_data sSavedPlayerObjectData[MAXIMUM_NUMBER_OF_PLAYERS];
-static object_data sSavedPlayerParasiticObjectData[MAXIMUM_NUMBER_OF_PLAYERS];
-static short sSavedPlayerObjectNextObject[MAXIMUM_NUMBER_OF_PLAYERS];
-
 // For sanity-checking...
 static int32 sSavedTickCount;
 static uint16 sSavedRandomSeed;
 
 
 // ZZZ: If not already in predictive mode, save off partial game-state for later restoration.
+// The snapshot copies the players and *dynamic_world up front; everything else is
+// saved slot by slot as the predicted ticks write it.
 static void
 enter_predictive_mode()
 {
 	if(sPredictedTicks == 0)
 	{
-		for(short i = 0; i < dynamic_world->player_count; i++)
-		{
-			sSavedPlayerData[i] = *get_player_data(i);
-			if(sSavedPlayerData[i].monster_index != NONE)
-			{
-				sSavedPlayerMonsterData[i] = *get_monster_data(sSavedPlayerData[i].monster_index);
-				if(sSavedPlayerMonsterData[i].object_index != NONE)
-				{
-					sSavedPlayerObjectData[i] = *get_object_data(sSavedPlayerMonsterData[i].object_index);
-					sSavedPlayerObjectNextObject[i] = sSavedPlayerObjectData[i].next_object;
-					if(sSavedPlayerObjectData[i].parasitic_object != NONE)
-						sSavedPlayerParasiticObjectData[i] = *get_object_data(sSavedPlayerObjectData[i].parasitic_object);
-				}
-			}
-		}
+		take_world_snapshot();
 		
 		// Sanity checking
 		sSavedTickCount = dynamic_world->tick_count;
@@ -274,60 +258,38 @@ compare_memory(const char* inChunk1, const char* inChunk2, size_t inSize, size_t
 }
 #endif
 
-// ZZZ: if in predictive mode, restore the saved partial game-state (it'd better take us back
+// ZZZ: if in predictive mode, restore the saved game-state (it'd better take us back
 // to _exactly_ the same full game-state we saved earlier, else problems.)
 static void
 exit_predictive_mode()
 {
 	if(sPredictedTicks > 0)
 	{
+		// We *don't* restore this tiny part of the game-state back because
+		// otherwise the player can't use [] to scroll the inventory panel.
+		// [] scrolling happens outside the normal input/update system, so that's
+		// enough to persuade me that not restoring this won't OOS any more often
+		// than []-scrolling did before prediction.  :)
+		int16 saved_interface_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+		int16 saved_interface_decay[MAXIMUM_NUMBER_OF_PLAYERS];
+		
 		for(short i = 0; i < dynamic_world->player_count; i++)
 		{
-			player_data* player = get_player_data(i);
-			
-			assert(player->monster_index == sSavedPlayerData[i].monster_index);
+			saved_interface_flags[i] = get_player_data(i)->interface_flags;
+			saved_interface_decay[i] = get_player_data(i)->interface_decay;
+		}
 
-			{
-				// We *don't* restore this tiny part of the game-state back because
-				// otherwise the player can't use [] to scroll the inventory panel.
-				// [] scrolling happens outside the normal input/update system, so that's
-				// enough to persuade me that not restoring this won't OOS any more often
-				// than []-scrolling did before prediction.  :)
-				int16 saved_interface_flags = player->interface_flags;
-				int16 saved_interface_decay = player->interface_decay;
-				
-				*player = sSavedPlayerData[i];
-
-				player->interface_flags = saved_interface_flags;
-				player->interface_decay = saved_interface_decay;
-			}
+		// Only the slots prediction wrote get copied back; the object records and
+		// polygons holding each rewritten link come back together, so the polygon
+		// object lists end up exactly as they were, and the tick count and random
+		// seed come back with *dynamic_world.
+		restore_world_snapshot();
 
-			if(sSavedPlayerData[i].monster_index != NONE)
-			{
-				assert(get_monster_data(sSavedPlayerData[i].monster_index)->object_index == sSavedPlayerMonsterData[i].object_index);
-
-				*get_monster_data(sSavedPlayerData[i].monster_index) = sSavedPlayerMonsterData[i];
-				
-				if(sSavedPlayerMonsterData[i].object_index != NONE)
-				{
-					assert(get_object_data(sSavedPlayerMonsterData[i].object_index)->parasitic_object == sSavedPlayerObjectData[i].parasitic_object);
-
-					remove_object_from_polygon_object_list(sSavedPlayerMonsterData[i].object_index);
-					
-					*get_object_data(sSavedPlayerMonsterData[i].object_index) = sSavedPlayerObjectData[i];
-
-					// We have to defer this insertion since the object lists could still have other players
-					// in their predictive locations etc. - we need to reconstruct everything exactly as it
-					// was when we entered predictive mode.
-					deferred_add_object_to_polygon_object_list(sSavedPlayerMonsterData[i].object_index, sSavedPlayerObjectNextObject[i]);
-					
-					if(sSavedPlayerObjectData[i].parasitic_object != NONE)
-						*get_object_data(sSavedPlayerObjectData[i].parasitic_object) = sSavedPlayerParasiticObjectData[i];
-				}
-			}
+		for(short i = 0; i < dynamic_world->player_count; i++)
+		{
+			get_player_data(i)->interface_flags = saved_interface_flags[i];
+			get_player_data(i)->interface_decay = saved_interface_decay[i];
 		}
-
-		perform_deferred_polygon_object_list_manipulations();
 		
 		sPredictedTicks = 0;
 
@@ -379,6 +341,124 @@ overlay_queue_with_queue_into_queue(ActionQueues* inBaseQueues, ActionQueues* in
 }
 
 
+// Per-subsystem timing of the world update; always on, since reading the
+// performance counter costs little next to any of the subsystems
+static int32 sWorldSubsystemCalls[NUMBER_OF_WORLD_SUBSYSTEMS];
+static uint64_t sWorldSubsystemTime[NUMBER_OF_WORLD_SUBSYSTEMS];
+
+// the rolling window keeps the duration of each recent call, so the oldest
+// one can be taken back out of the histogram when it is overwritten
+struct world_subsystem_history
+{
+	uint32 microseconds[WORLD_PROFILE_WINDOW];
+	int16 next;
+	int16 count;
+	int16 buckets[NUMBER_OF_WORLD_PROFILE_BUCKETS];
+};
+static world_subsystem_history sWorldSubsystemHistory[NUMBER_OF_WORLD_SUBSYSTEMS];
+
+static const char *sWorldSubsystemNames[NUMBER_OF_WORLD_SUBSYSTEMS] = {
+	"lua idle",
+	"lights",
+	"medias",
+	"platforms",
+	"control panels",
+	"players",
+	"projectiles",
+	"monsters",
+	"effects",
+	"recreate objects",
+	"random sounds",
+	"scenery",
+	"ephemera",
+	"items",
+	"animated textures",
+	"chase cam",
+	"motion sensor",
+	"m1 exploration",
+	"net game",
+	"lua postidle"
+};
+
+static short world_profile_bucket(uint32 microseconds)
+{
+	short bucket = 0;
+	while (microseconds && bucket < NUMBER_OF_WORLD_PROFILE_BUCKETS - 1)
+	{
+		microseconds >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static void record_world_subsystem_time(short subsystem, uint64_t counter)
+{
+	static const uint64_t frequency = SDL_GetPerformanceFrequency();
+
+	sWorldSubsystemCalls[subsystem]++;
+	sWorldSubsystemTime[subsystem] += counter;
+
+	world_subsystem_history& history = sWorldSubsystemHistory[subsystem];
+	if (history.count == WORLD_PROFILE_WINDOW)
+		history.buckets[world_profile_bucket(history.microseconds[history.next])]--;
+	else
+		history.count++;
+
+	uint32 microseconds = static_cast<uint32>(std::min<uint64_t>(counter * 1000000 / frequency, UINT32_MAX));
+	history.microseconds[history.next] = microseconds;
+	history.buckets[world_profile_bucket(microseconds)]++;
+	if (++history.next == WORLD_PROFILE_WINDOW)
+		history.next = 0;
+}
+
+#define TIME_WORLD_SUBSYSTEM(subsystem, call) \
+	do { \
+		uint64_t start_counter = SDL_GetPerformanceCounter(); \
+		call; \
+		record_world_subsystem_time(subsystem, SDL_GetPerformanceCounter() - start_counter); \
+	} while (0)
+
+void reset_world_subsystem_timing(void)
+{
+	objlist_clear(sWorldSubsystemCalls, NUMBER_OF_WORLD_SUBSYSTEMS);
+	objlist_clear(sWorldSubsystemTime, NUMBER_OF_WORLD_SUBSYSTEMS);
+	objlist_clear(sWorldSubsystemHistory, NUMBER_OF_WORLD_SUBSYSTEMS);
+}
+
+const char *get_world_subsystem_name(short subsystem)
+{
+	assert(subsystem >= 0 && subsystem < NUMBER_OF_WORLD_SUBSYSTEMS);
+	return sWorldSubsystemNames[subsystem];
+}
+
+int32 get_world_subsystem_calls(short subsystem)
+{
+	assert(subsystem >= 0 && subsystem < NUMBER_OF_WORLD_SUBSYSTEMS);
+	return sWorldSubsystemCalls[subsystem];
+}
+
+double get_world_subsystem_seconds(short subsystem)
+{
+	assert(subsystem >= 0 && subsystem < NUMBER_OF_WORLD_SUBSYSTEMS);
+	return static_cast<double>(sWorldSubsystemTime[subsystem]) / SDL_GetPerformanceFrequency();
+}
+
+void get_world_subsystem_window(short subsystem, world_subsystem_window *window)
+{
+	assert(subsystem >= 0 && subsystem < NUMBER_OF_WORLD_SUBSYSTEMS);
+	const world_subsystem_history& history = sWorldSubsystemHistory[subsystem];
+
+	window->call_count = history.count;
+	window->total_microseconds = 0;
+	window->maximum_microseconds = 0;
+	for (short i = 0; i < history.count; ++i)
+	{
+		window->total_microseconds += history.microseconds[i];
+		window->maximum_microseconds = std::max(window->maximum_microseconds, history.microseconds[i]);
+	}
+	objlist_copy(window->buckets, history.buckets, NUMBER_OF_WORLD_PROFILE_BUCKETS);
+}
+
 // Return values for update_world_elements_one_tick()
 enum {
         kUpdateNormalCompletion,
@@ -397,38 +477,38 @@ update_world_elements_one_tick(bool& call_postidle)
 	} 
 	else
 	{
-		L_Call_Idle();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_lua_idle, L_Call_Idle());
 		call_postidle = true;
 		
-		update_lights();
-		update_medias();
-		update_platforms();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_lights, update_lights());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_medias, update_medias());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_platforms, update_platforms());
 		
-		update_control_panels(); // don't put after update_players
-		update_players(GameQueue, false);
-		move_projectiles();
-		move_monsters();
-		update_effects();
-		recreate_objects();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_control_panels, update_control_panels()); // don't put after update_players
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_players, update_players(GameQueue, false));
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_projectiles, move_projectiles());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_monsters, move_monsters());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_effects, update_effects());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_recreate_objects, recreate_objects());
 		
-		handle_random_sound_image();
-		animate_scenery();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_random_sounds, handle_random_sound_image());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_scenery, animate_scenery());
 
-		update_ephemera();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_ephemera, update_ephemera());
 		
 		// LP additions:
 		if (film_profile.animate_items)
 		{
-			animate_items();
+			TIME_WORLD_SUBSYSTEM(_world_subsystem_items, animate_items());
 		}
 		
-		AnimTxtr_Update();
-		ChaseCam_Update();
-		motion_sensor_scan();
-		check_m1_exploration();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_animated_textures, AnimTxtr_Update());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_chase_cam, ChaseCam_Update());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_motion_sensor, motion_sensor_scan());
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_m1_exploration, check_m1_exploration());
 		
 #if !defined(DISABLE_NETWORKING)
-		update_net_game();
+		TIME_WORLD_SUBSYSTEM(_world_subsystem_net_game, update_net_game());
 #endif // !defined(DISABLE_NETWORKING)
 	}
 
@@ -451,6 +531,32 @@ update_world_elements_one_tick(bool& call_postidle)
         return kUpdateNormalCompletion;
 }
 
+// The predictive counterpart of update_world_elements_one_tick(): everything that moves
+// by itself, so the world the local player sees ahead of the network is the one the
+// real ticks will produce.  Scripts, control panels, scenery and item animation and
+// level changes wait for the real tick, and world_snapshot.h lists what the
+// simulation itself holds back while this runs.
+static void
+update_world_elements_one_predicted_tick(ActionQueues* inActionQueues)
+{
+	begin_speculative_update();
+	
+	update_lights();
+	update_medias();
+	update_platforms();
+	
+	// update_players() will dequeue the elements our caller just put in there
+	update_players(inActionQueues, true);
+	move_projectiles();
+	move_monsters();
+	update_effects();
+	
+	dynamic_world->tick_count+= 1;
+	dynamic_world->game_information.game_time_remaining-= 1;
+	
+	end_speculative_update();
+}
+
 // ZZZ: new formulation of update_world(), should be simpler and clearer I hope.
 // Now returns (whether something changed, number of real ticks elapsed) since, with
 // prediction, something can change even if no real ticks have elapsed.
@@ -473,6 +579,8 @@ update_world()
                 // Note that GameQueue should be stocked evenly (i.e. every player has the same # of flags)
                 if(GameQueue->countActionFlags(0) == 0)
                 {
+                        // Between ticks with nothing in the GameQueue is where a film can be picked up again
+                        record_film_keyframe();
                         canUpdate = overlay_queue_with_queue_into_queue(GetRealActionQueues(), GetLuaActionQueues(), GameQueue);
                 }
 
@@ -510,7 +618,7 @@ update_world()
                 theElapsedTime++;
 
                 if (call_postidle)
-                        L_Call_PostIdle();
+                        TIME_WORLD_SUBSYSTEM(_world_subsystem_lua_postidle, L_Call_PostIdle());
                 if(theUpdateResult != kUpdateNormalCompletion || Movie::instance()->IsRecording())
                 {
                         canUpdate = false;
@@ -563,8 +671,7 @@ update_world()
 				thePredictiveQueues.enqueueActionFlags(thePlayerIndex, &theFlags, 1);
 			}
 			
-			// update_players() will dequeue the elements we just put in there
-			update_players(&thePredictiveQueues, true);
+			update_world_elements_one_predicted_tick(&thePredictiveQueues);
 
 			didPredict = true;
 			
@@ -576,6 +683,35 @@ update_world()
         return std::pair<bool, int16>(didPredict || theElapsedTime != 0, theElapsedTime);
 }
 
+uint32 calculate_game_state_checksum(
+	void)
+{
+	// pack everything the way a saved game would, so that struct padding
+	// and in-memory layout don't leak into the checksum
+	size_t length = SIZEOF_dynamic_data +
+		dynamic_world->player_count * SIZEOF_player_data +
+		dynamic_world->object_count * SIZEOF_object_data +
+		dynamic_world->monster_count * SIZEOF_monster_data +
+		dynamic_world->projectile_count * SIZEOF_projectile_data +
+		dynamic_world->effect_count * SIZEOF_effect_data +
+		dynamic_world->platform_count * SIZEOF_platform_data +
+		dynamic_world->light_count * SIZEOF_light_data;
+	std::vector<uint8> buffer(length);
+
+	uint8 *S = buffer.data();
+	S = pack_dynamic_data(S, dynamic_world, 1);
+	S = pack_player_data(S, players, dynamic_world->player_count);
+	S = pack_object_data(S, objects, dynamic_world->object_count);
+	S = pack_monster_data(S, monsters, dynamic_world->monster_count);
+	S = pack_projectile_data(S, projectiles, dynamic_world->projectile_count);
+	S = pack_effect_data(S, effects, dynamic_world->effect_count);
+	S = pack_platform_data(S, platforms, dynamic_world->platform_count);
+	S = pack_light_data(S, lights, dynamic_world->light_count);
+	assert(S == buffer.data() + length);
+
+	return calculate_data_crc(buffer.data(), static_cast<int32>(length));
+}
+
 /* call this function before leaving the old level, but DO NOT call it when saving the player.
 	it should be called when you're leaving the game (i.e., quitting or reverting, etc.) */
 void leaving_map(
@@ -631,6 +767,9 @@ bool entering_map(bool restoring_saved)
 {
 	bool success= true;
 
+	/* the map is fully loaded (platforms and all), so line visibility can be worked out afresh */
+	invalidate_potentially_visible_sets();
+
 	/* if any active monsters think they have paths, we'll make them reconsider */
 	initialize_monsters_for_new_level();
 
@@ -51,6 +51,7 @@ Feb 8, 2001 (Loren Petrich):
 #include "InfoTree.h"
 
 #include "Packing.h"
+#include "world_snapshot.h"
 
 #include <string.h>
 
@@ -87,6 +88,7 @@ media_data *get_media_data(
 	
 	if (!media) return NULL;
 	if (!(SLOT_IS_USED(media))) return NULL;
+	snapshot_media(static_cast<short>(media_index));
 	
 	return media;
 }
@@ -146,6 +148,7 @@ void update_medias(
 	{
 		if (SLOT_IS_USED(media))
 		{
+			snapshot_media(static_cast<short>(media_index));
 			update_one_media(media_index, false);
 			
 			media->origin.x= WORLD_FRACTIONAL_PART(media->origin.x + ((cosine_table[media->current_direction]*media->current_magnitude)>>TRIG_SHIFT));
@@ -114,6 +114,7 @@ Jan 12, 2003 (Loren Petrich)
 #include "lua_script.h"
 #include "Logging.h"
 #include "InfoTree.h"
+#include "world_snapshot.h"
 
 
 /*
@@ -240,6 +241,16 @@ struct damage_kick_definition damage_kick_definitions[NUMBER_OF_DAMAGE_TYPES] =
 // LP addition: growable list of intersected objects
 static vector<short> IntersectedObjects;
 
+// monsters the AI scheduler picked to get time this tick, and its list of candidates
+struct monster_time_candidate
+{
+	short monster_index;
+	int32 priority;
+	short order; /* round-robin position after last_monster_index_to_get_time */
+};
+static vector<bool> ScheduledMonsters;
+static vector<monster_time_candidate> MonsterTimeCandidates;
+
 /* ---------- private prototypes */
 
 static monster_definition *get_monster_definition(
@@ -287,6 +298,10 @@ static int32 nearest_goal_cost_function(short source_polygon_index, short line_i
 
 static void cause_shrapnel_damage(short monster_index);
 
+static bool monster_wants_time(struct monster_data *monster);
+static world_distance nearest_player_distance(world_point3d *location);
+static void schedule_monster_time(void);
+
 // For external use
 monster_definition *get_monster_definition_external(const short type);
 
@@ -319,6 +334,7 @@ monster_data *get_monster_data(
 	
 	vassert(monster, csprintf(temporary, "monster index #%d is out of range", monster_index));
 	vassert(SLOT_IS_USED(monster), csprintf(temporary, "monster index #%d (%p) is unused", monster_index, (void*)monster));
+	snapshot_monster(monster_index);
 	
 	return monster;
 }
@@ -401,6 +417,7 @@ short new_monster(
 				{
 					struct object_data *object= get_object_data(object_index);
 
+					snapshot_monster(monster_index);
 					/* not doing this in !DEBUG resulted in sync errors; mmm... random data, so tasty */
 					obj_set(*monster, 0x80);
 	
@@ -412,6 +429,7 @@ short new_monster(
 						because the monster is initially inactive (and they will be initialized when the
 						monster is activated) */
 					monster->type= monster_type;
+					monster->ai_ticks_waited= 0;
 					monster->activation_bias= DECODE_ACTIVATION_BIAS(location->flags);
 					monster->vitality= NONE; /* if a monster is activated with vitality==NONE, it will be properly initialized */
 					monster->object_index= object_index;
@@ -464,15 +482,28 @@ void move_monsters(
 {
 	struct monster_data *monster;
 	bool monster_got_time= false;
-	bool monster_built_path= (dynamic_world->tick_count&3) ? true : false;
+	short paths_left;
 	short monster_index;
 
+	/* originally one monster got time (and one path was built) every fourth tick, going round-robin;
+		the AI scheduler hands out as many of each as the dynamic limits allow every tick */
+	if (film_profile.monster_ai_scheduler)
+	{
+		schedule_monster_time();
+		paths_left= get_dynamic_limit(_dynamic_limit_monster_paths);
+	}
+	else
+	{
+		paths_left= (dynamic_world->tick_count&3) ? 0 : 1;
+	}
+
 	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
 	{
 		if (SLOT_IS_USED(monster) && !MONSTER_IS_PLAYER(monster))
 		{
 			struct object_data *object= get_object_data(monster->object_index);
 			
+			snapshot_monster(monster_index);
 			if (MONSTER_IS_ACTIVE(monster))
 			{
 				if (!OBJECT_IS_INVISIBLE(object))
@@ -499,7 +530,8 @@ void move_monsters(
 					animation_flags= GET_OBJECT_ANIMATION_FLAGS(object);
 		
 					/* give this monster time, if we can and he needs it */
-					if (!monster_got_time && monster_index>dynamic_world->last_monster_index_to_get_time && !MONSTER_IS_DYING(monster))
+					if ((film_profile.monster_ai_scheduler ? ScheduledMonsters[monster_index] :
+						(!monster_got_time && monster_index>dynamic_world->last_monster_index_to_get_time)) && !MONSTER_IS_DYING(monster))
 					{
 						switch (monster->mode)
 						{
@@ -523,19 +555,19 @@ void move_monsters(
 						}
 						
 						/* if we gave this guy time, make room for the next guy */
-						if (monster_got_time) dynamic_world->last_monster_index_to_get_time= monster_index;
+						if (monster_got_time && !film_profile.monster_ai_scheduler) dynamic_world->last_monster_index_to_get_time= monster_index;
 					}
 		
 					/* if this monster needs a path, generate one (unless weve already generated a
 						path this frame in which case well wait until next frame, UNLESS the monster
 						has no path in which case it needs one regardless) */
 					if (MONSTER_NEEDS_PATH(monster) && !MONSTER_IS_DYING(monster) && !MONSTER_IS_ATTACKING(monster) &&
-						((!monster_built_path && monster_index>dynamic_world->last_monster_index_to_build_path) || monster->path==NONE))
+						((paths_left>0 && monster_index>dynamic_world->last_monster_index_to_build_path) || monster->path==NONE))
 					{
 						generate_new_path_for_monster(monster_index);
-						if (!monster_built_path)
+						if (paths_left>0)
 						{
-							monster_built_path= true;
+							paths_left-= 1;
 							dynamic_world->last_monster_index_to_build_path= monster_index;
 						}
 					}
@@ -639,13 +671,14 @@ void move_monsters(
 			else
 			{
 				/* all inactive monsters get time to scan for targets */
-				if (!monster_got_time && !MONSTER_IS_BLIND(monster) && monster_index>dynamic_world->last_monster_index_to_get_time)
+				if ((film_profile.monster_ai_scheduler ? ScheduledMonsters[monster_index] :
+					(!monster_got_time && monster_index>dynamic_world->last_monster_index_to_get_time)) && !MONSTER_IS_BLIND(monster))
 				{
 					change_monster_target(monster_index, find_closest_appropriate_target(monster_index, false));
 					if (MONSTER_HAS_VALID_TARGET(monster)) activate_nearby_monsters(monster->target_index, monster_index, _pass_one_zone_border, MONSTER_ALERT_ACTIVATION_RANGE);
 					
 					monster_got_time= true;
-					dynamic_world->last_monster_index_to_get_time= monster_index;
+					if (!film_profile.monster_ai_scheduler) dynamic_world->last_monster_index_to_get_time= monster_index;
 				}
 			}
 		}
@@ -657,8 +690,8 @@ void move_monsters(
 	
 	/* either there are no unlocked monsters or dynamic_world->last_monster_index_to_get_time is higher than
 		all of them (so we reset it to zero) ... same for paths */
-	if (!monster_got_time) dynamic_world->last_monster_index_to_get_time= -1;
-	if (!monster_built_path) dynamic_world->last_monster_index_to_build_path= -1;
+	if (!monster_got_time && !film_profile.monster_ai_scheduler) dynamic_world->last_monster_index_to_get_time= -1;
+	if (paths_left>0) dynamic_world->last_monster_index_to_build_path= -1;
 
 	if (dynamic_world->civilians_killed_by_players)
 	{
@@ -712,6 +745,7 @@ void monster_died(
 		{
 			short closest_target_index= find_closest_appropriate_target(monster_index, true);
 
+			snapshot_monster(monster_index);
 			monster->target_index= NONE;
 			monster_needs_path(monster_index, false);
 			
@@ -1157,14 +1191,17 @@ bool possible_intersecting_monsters(
 
 	for (short i=0;i<polygon->neighbor_count;++i)
 	{
-		struct polygon_data *neighboring_polygon= get_polygon_data(*neighbor_indexes++);
+		short neighbor_index= *neighbor_indexes++;
+		struct polygon_data *neighboring_polygon= get_polygon_data(neighbor_index);
 		
 		if (!POLYGON_IS_DETACHED(neighboring_polygon))
 		{
-			short object_index= neighboring_polygon->first_object;
+			// only monsters and scenery can be solid, so skip the rest of the object list
+			const vector<short>& object_indexes= get_polygon_collidable_objects(neighbor_index);
 			
-			while (object_index!=NONE)
+			for (size_t k= 0; k<object_indexes.size(); ++k)
 			{
+				short object_index= object_indexes[k];
 				struct object_data *object= get_object_data(object_index);
 				bool solid_object= false;
 				
@@ -1207,8 +1244,6 @@ bool possible_intersecting_monsters(
 						}
 					}
 				}
-				
-				object_index= object->next_object;
 			}
 		}
 	}
@@ -1243,6 +1278,7 @@ void monster_moved(
 		/* look for active monsters locked (or losing lock) on the given target_index */
 		if (SLOT_IS_USED(monster) && MONSTER_HAS_VALID_TARGET(monster) && monster->target_index==target_index)
 		{
+			snapshot_monster(monster_index);
 			if (clear_line_of_sight(monster_index, target_index, true))
 			{
 				if (monster->mode==_monster_losing_lock) set_monster_mode(monster_index, _monster_locked, monster->target_index);
@@ -1819,6 +1855,118 @@ short get_monster_melee_impact_effect(
 
 /* ---------- private code */
 
+/* true if this monster would use AI time this tick: inactive monsters scan for targets, and
+	active monsters that are unlocked or losing their lock look for a (new) target */
+static bool monster_wants_time(
+	struct monster_data *monster)
+{
+	bool wants_time= false;
+	
+	if (MONSTER_IS_ACTIVE(monster))
+	{
+		if (!OBJECT_IS_INVISIBLE(get_object_data(monster->object_index)) && !MONSTER_IS_DYING(monster))
+		{
+			switch (monster->mode)
+			{
+				case _monster_unlocked:
+				case _monster_lost_lock:
+				case _monster_losing_lock:
+					wants_time= true;
+					break;
+			}
+		}
+	}
+	else
+	{
+		wants_time= !MONSTER_IS_BLIND(monster);
+	}
+	
+	return wants_time;
+}
+
+static world_distance nearest_player_distance(
+	world_point3d *location)
+{
+	world_distance nearest_distance= INT16_MAX;
+	short player_index;
+	
+	for (player_index= 0; player_index<dynamic_world->player_count; ++player_index)
+	{
+		struct player_data *player= get_player_data(player_index);
+		
+		if (!PLAYER_IS_TOTALLY_DEAD(player))
+		{
+			world_distance distance= guess_distance2d((world_point2d *) location, (world_point2d *) &player->location);
+			
+			if (distance<nearest_distance) nearest_distance= distance;
+		}
+	}
+	
+	return nearest_distance;
+}
+
+/* picks the monsters that get AI time this tick, up to the _dynamic_limit_monster_targets limit.
+	a monster's priority is how many ticks it has been waiting, less one for every WORLD_ONE it
+	is from the nearest player, so nearby monsters react first but nobody waits forever; ties
+	go round-robin starting after last_monster_index_to_get_time */
+static void schedule_monster_time(
+	void)
+{
+	size_t budget= get_dynamic_limit(_dynamic_limit_monster_targets);
+	struct monster_data *monster;
+	short monster_index;
+	
+	ScheduledMonsters.assign(MAXIMUM_MONSTERS_PER_MAP, false);
+	MonsterTimeCandidates.clear();
+	
+	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
+	{
+		if (SLOT_IS_USED(monster) && !MONSTER_IS_PLAYER(monster))
+		{
+			if (monster_wants_time(monster))
+			{
+				struct object_data *object= get_object_data(monster->object_index);
+				monster_time_candidate candidate;
+				
+				candidate.monster_index= monster_index;
+				candidate.priority= monster->ai_ticks_waited - nearest_player_distance(&object->location)/WORLD_ONE;
+				candidate.order= (monster_index - dynamic_world->last_monster_index_to_get_time - 1 + MAXIMUM_MONSTERS_PER_MAP) % MAXIMUM_MONSTERS_PER_MAP;
+				MonsterTimeCandidates.push_back(candidate);
+			}
+			else
+			{
+				snapshot_monster(monster_index);
+				monster->ai_ticks_waited= 0;
+			}
+		}
+	}
+	
+	if (MonsterTimeCandidates.size()>budget)
+	{
+		std::partial_sort(MonsterTimeCandidates.begin(), MonsterTimeCandidates.begin() + budget, MonsterTimeCandidates.end(),
+			[](const monster_time_candidate& a, const monster_time_candidate& b) {
+				return a.priority!=b.priority ? a.priority>b.priority : a.order<b.order;
+			});
+	}
+	
+	for (size_t i= 0; i<MonsterTimeCandidates.size(); ++i)
+	{
+		monster_index= MonsterTimeCandidates[i].monster_index;
+		monster= get_monster_data(monster_index);
+		
+		if (i<budget)
+		{
+			ScheduledMonsters[monster_index]= true;
+			monster->ai_ticks_waited= 0;
+			dynamic_world->last_monster_index_to_get_time= monster_index;
+		}
+		else if (monster->ai_ticks_waited<SHRT_MAX)
+		{
+			monster->ai_ticks_waited+= 1;
+		}
+	}
+}
+
 static void cause_shrapnel_damage(
 	short monster_index)
 {
@@ -2613,7 +2761,7 @@ void set_monster_action(
 			}
 		}
 		
-		if ((definition->flags&_monster_has_nuclear_hard_death) && action==_monster_is_dying_hard)
+		if ((definition->flags&_monster_has_nuclear_hard_death) && action==_monster_is_dying_hard && !speculative_update_in_progress())
 		{
 			start_fade(_fade_long_bright);
 			SoundManager::instance()->PlayLocalSound(Sound_Exploding());
@@ -3187,8 +3335,6 @@ int32 monster_pathfinding_cost_function(
 	struct polygon_data *source_polygon= get_polygon_data(source_polygon_index);
 	struct line_data *line= get_line_data(line_index);
 	bool respect_polygon_heights= true;
-	struct object_data *object;
-	short object_index;
 	int32 cost;
 		
 	/* base cost is the area of the polygon were leaving */
@@ -3199,9 +3345,10 @@ int32 monster_pathfinding_cost_function(
 
 	/* count up the monsters in destination_polygon and add a constant cost, MONSTER_PATHFINDING_OBSTRUCTION_PENALTY,
 		for each of them to discourage overcrowding */
-	for (object_index= destination_polygon->first_object; object_index!=NONE; object_index=  object->next_object)
+	const vector<short>& object_indexes= get_polygon_collidable_objects(destination_polygon_index);
+	for (size_t i= 0; i<object_indexes.size(); ++i)
 	{
-		object= get_object_data(object_index);
+		struct object_data *object= get_object_data(object_indexes[i]);
 		if (GET_OBJECT_OWNER(object)==_object_is_monster) cost+= MONSTER_PATHFINDING_OBSTRUCTION_COST;
 	}
 
@@ -3580,7 +3727,9 @@ uint8 *unpack_monster_data(uint8 *Stream, monster_data *Objects, size_t Count)
 		
 		StreamToValue(S,ObjPtr->random_desired_height);
 		
-		S += 7*2;
+		StreamToValue(S,ObjPtr->ai_ticks_waited);
+		
+		S += 6*2;
 	}
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_monster_data));
@@ -3628,7 +3777,9 @@ uint8 *pack_monster_data(uint8 *Stream, monster_data *Objects, size_t Count)
 		
 		ValueToStream(S,ObjPtr->random_desired_height);
 		
-		S += 7*2;
+		ValueToStream(S,ObjPtr->ai_ticks_waited);
+		
+		S += 6*2;
 	}
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_monster_data));
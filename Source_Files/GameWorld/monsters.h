@@ -252,7 +252,9 @@ struct monster_data /* 64 bytes */
 
 	short random_desired_height;
 	
-	short unused[7];
+	short ai_ticks_waited; /* ticks spent waiting for the monster AI scheduler to give us time */
+	
+	short unused[6];
 };
 const int SIZEOF_monster_data = 64;
 
@@ -44,6 +44,7 @@ Feb 10, 2000 (Loren Petrich):
 #include "map.h"
 #include "flood_map.h"
 #include "dynamic_limits.h"
+#include "world_snapshot.h"
 
 #ifdef DEBUG
 //#define VALIDATE_PATH_SPACE
@@ -64,21 +65,9 @@ we should cut corners instead of blindly following map geometry (i.e., separate
 
 // LP change: made this settable from the resource fork
 #define MAXIMUM_PATHS (get_dynamic_limit(_dynamic_limit_paths))
-#define MAXIMUM_POINTS_PER_PATH 63
 
 #define PATH_VALIDATION_AREA_SIZE 64*1024
 
-/* ---------- structures */
-
-struct path_definition /* 256 bytes */
-{
-	/* NONE is an empty path */
-	short current_step;
-	short step_count;
-	
-	world_point2d points[MAXIMUM_POINTS_PER_PATH];
-};
-
 /* ---------- globals */
 
 static struct path_definition *paths = NULL;
@@ -222,6 +211,7 @@ short new_path(
 			struct path_definition *path= paths+path_index;
 			short last_polygon_index;
 
+			snapshot_path(path_index);
 //#ifdef DEBUG
 			obj_set(*path, 0x80);
 //#endif
@@ -296,6 +286,7 @@ bool move_along_path(
 	
 	assert(path_index>=0&&path_index<MAXIMUM_PATHS);
 	path= paths+path_index;
+	snapshot_path(path_index);
 
 	assert(path->step_count!=NONE);
 	vassert(path->current_step>=0&&path->current_step<=path->step_count, csprintf(temporary, "invalid current path step: #%d/#%d", path->current_step, path->step_count));
@@ -321,9 +312,36 @@ void delete_path(
 	assert(paths[path_index].step_count!=NONE);
 	vassert(paths[path_index].current_step>=0&&paths[path_index].current_step<=paths[path_index].step_count, csprintf(temporary, "invalid current path step: #%d/#%d", paths[path_index].current_step, paths[path_index].step_count));
 	
+	snapshot_path(path_index);
 	paths[path_index].step_count= NONE;
 }
 
+/* a film seek puts the world back the way it was at a keyframe, and the monsters have to find
+	the paths they were following then */
+size_t get_paths_length(
+	void)
+{
+	return MAXIMUM_PATHS*sizeof(struct path_definition);
+}
+
+void get_paths(
+	void *buffer)
+{
+	memcpy(buffer, paths, get_paths_length());
+}
+
+void set_paths(
+	const void *buffer)
+{
+	memcpy(paths, buffer, get_paths_length());
+}
+
+struct path_definition *get_path_list(
+	void)
+{
+	return paths;
+}
+
 /* ---------- private code */
 
 static void calculate_midpoint_of_shared_line(
@@ -76,6 +76,7 @@ Jun 30, 2002 (tiennou):
 // LP addition: XML parser for damage
 #include "items.h"
 #include "Packing.h"
+#include "world_snapshot.h"
 
 //MH: Lua scripting
 #include "lua_script.h"
@@ -120,6 +121,7 @@ platform_data *get_platform_data(
 	struct platform_data *platform = GetMemberWithBounds(platforms,platform_index,dynamic_world->platform_count);
 	
 	vassert(platform, csprintf(temporary, "platform index #%d is out of range", platform_index));
+	snapshot_platform(platform_index);
 	
 	return platform;
 }
@@ -257,6 +259,7 @@ void update_platforms(
 	
 	for (platform_index= 0, platform= platforms; platform_index<dynamic_world->platform_count; ++platform_index, ++platform)
 	{
+		snapshot_platform(platform_index);
 		CLEAR_PLATFORM_WAS_JUST_ACTIVATED_OR_DEACTIVATED(platform);
 		
 		if (PLATFORM_IS_ACTIVE(platform))
@@ -399,6 +402,7 @@ void update_platforms(
 				{
 					short side_index = polygon->side_indexes[i];
 					if (side_index == NONE) continue;
+					snapshot_side(side_index);
 					guess_side_lightsource_indexes(side_index);
 				}
 			}
@@ -868,6 +872,9 @@ void adjust_platform_endpoint_and_line_heights(
 		struct polygon_data *adjacent_polygon;
 		short j;
 		
+		snapshot_endpoint(polygon->endpoint_indexes[i]);
+		snapshot_line(polygon->line_indexes[i]);
+		
 		/* adjust line heights and set proper line transparency and solidity */
 		// Skip this step if line indexes were not found
 		if (polygon->adjacent_polygon_indexes[i]!=NONE && line_indexes)
@@ -1066,6 +1073,7 @@ static void adjust_platform_sides(
 			if (side_index!=NONE)
 			{
 				side= get_side_data(side_index);
+				snapshot_side(side_index);
 				switch (side->type)
 				{
 					case _full_side:
@@ -1084,6 +1092,7 @@ static void adjust_platform_sides(
 			world_distance top_of_side_height;
 			
 			side= get_side_data(side_index);
+			snapshot_side(side_index);
 			switch (side->type)
 			{
 				case _split_side: /* secondary */
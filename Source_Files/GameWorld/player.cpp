@@ -169,6 +169,7 @@ May 22, 2003 (Woody Zenfell):
 
 // ZZZ additions:
 #include "ActionQueues.h"
+#include "world_snapshot.h"
 
 // jkvw addition:
 #include "lua_script.h"
@@ -794,6 +795,9 @@ void damage_player(
 
 	(void) (aggressor_type);
 	
+	// dying goes through scoring, fades and the console, so players are only hurt by real ticks
+	if (speculative_update_in_progress()) return;
+	
 	// LP change: made this more general
 	if (player->invincibility_duration && damage->type!=player_settings.Vulnerability)
 	{
@@ -98,6 +98,7 @@ Oct 13, 2000 (Loren Petrich)
 #include "Packing.h"
 
 #include "lua_script.h"
+#include "world_snapshot.h"
 
 /*
 //translate_projectile() must set _projectile_hit_landscape bit
@@ -162,6 +163,7 @@ projectile_data *get_projectile_data(
 	
 	vassert(projectile, csprintf(temporary, "projectile index #%d is out of range", projectile_index));
 	vassert(SLOT_IS_USED(projectile), csprintf(temporary, "projectile index #%d (%p) is unused", projectile_index, (void*)projectile));
+	snapshot_projectile(projectile_index);
 	
 	return projectile;
 }
@@ -284,6 +286,7 @@ short new_projectile(
 			{
 				object= get_object_data(object_index);
 				
+				snapshot_projectile(projectile_index);
 				projectile->type= (definition->flags&_alien_projectile) ?
 					(alien_projectile_override==NONE ? type : alien_projectile_override) :
 					(human_projectile_override==NONE ? type : human_projectile_override);
@@ -329,6 +332,7 @@ void move_projectiles(
 		{
 			struct object_data *object= get_object_data(projectile->object_index);
 			
+			snapshot_projectile(projectile_index);
 //			if (!OBJECT_IS_INVISIBLE(object))
 			{
 				struct projectile_definition *definition= get_projectile_definition(projectile->type);
@@ -608,6 +612,7 @@ void orphan_projectiles(
 	/* first, adjust all current projectile's .owner fields */
 	for (projectile_index=0,projectile=projectiles;projectile_index<MAXIMUM_PROJECTILES_PER_MAP;++projectile_index,++projectile)
 	{
+		if (projectile->owner_index==monster_index || projectile->target_index==monster_index) snapshot_projectile(projectile_index);
 		if (projectile->owner_index==monster_index) projectile->owner_index= NONE;
 		if (projectile->target_index==monster_index) projectile->target_index= NONE;
 	}
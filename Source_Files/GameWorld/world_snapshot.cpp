@@ -0,0 +1,254 @@
+/*
+	Copyright (C) 2021 and beyond by the "Aleph One" developers.
+ 
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+*/
+
+#include "world_snapshot.h"
+
+#include <utility>
+#include <vector>
+
+#include "cseries.h"
+#include "map.h"
+#include "effects.h"
+#include "flood_map.h"
+#include "lightsource.h"
+#include "media.h"
+#include "monsters.h"
+#include "platforms.h"
+#include "player.h"
+#include "projectiles.h"
+
+template <typename T>
+class SnapshotSlots {
+public:
+	// copies live[index] the first time it is saved
+	void save(T* live, std::size_t count, short index) {
+		if (index < 0 || static_cast<std::size_t>(index) >= count)
+			return;
+
+		if (saved_flags_.size() < count)
+			saved_flags_.resize(count, false);
+		if (saved_flags_[index])
+			return;
+
+		saved_flags_[index] = true;
+		saved_.push_back(std::make_pair(index, live[index]));
+	}
+
+	template <typename F>
+	std::size_t restore(T* live, F restored) {
+		for (typename std::vector<std::pair<short, T> >::const_iterator it = saved_.begin(); it != saved_.end(); ++it)
+		{
+			live[it->first] = it->second;
+			saved_flags_[it->first] = false;
+			restored(it->first);
+		}
+
+		std::size_t count = saved_.size();
+		saved_.clear();
+		return count;
+	}
+
+private:
+	std::vector<std::pair<short, T> > saved_;
+	std::vector<bool> saved_flags_;
+};
+
+static bool sTakingSnapshot = false;
+static bool sSpeculating = false;
+
+static dynamic_data sDynamicWorld;
+static uint16 sRandomSeed;
+static bool sBallInPlay;
+static damage_record sTeamDamageGiven[NUMBER_OF_TEAM_COLORS];
+static damage_record sTeamDamageTaken[NUMBER_OF_TEAM_COLORS];
+static damage_record sTeamMonsterDamageTaken[NUMBER_OF_TEAM_COLORS];
+static damage_record sTeamMonsterDamageGiven[NUMBER_OF_TEAM_COLORS];
+static damage_record sTeamFriendlyFire[NUMBER_OF_TEAM_COLORS];
+
+static SnapshotSlots<player_data> sPlayers;
+static SnapshotSlots<monster_data> sMonsters;
+static SnapshotSlots<object_data> sObjects;
+static SnapshotSlots<projectile_data> sProjectiles;
+static SnapshotSlots<effect_data> sEffects;
+static SnapshotSlots<platform_data> sPlatforms;
+static SnapshotSlots<light_data> sLights;
+static SnapshotSlots<media_data> sMedias;
+static SnapshotSlots<polygon_data> sPolygons;
+static SnapshotSlots<line_data> sLines;
+static SnapshotSlots<side_data> sSides;
+static SnapshotSlots<endpoint_data> sEndpoints;
+static SnapshotSlots<path_definition> sPaths;
+
+static void nothing_to_do(short) { }
+
+static void restored_object(short object_index)
+{
+	// owners and flags may have come back as well as links; the slot may
+	// also have been free before the update created something in it
+	object_data *object = &ObjectList[object_index];
+	if (SLOT_IS_USED(object) && object->polygon != NONE)
+		invalidate_polygon_collidable_objects(object->polygon);
+}
+
+void take_world_snapshot()
+{
+	assert(!sTakingSnapshot);
+	sTakingSnapshot = true;
+
+	sDynamicWorld = *dynamic_world;
+	sRandomSeed = get_random_seed();
+	sBallInPlay = static_world->ball_in_play;
+	objlist_copy(sTeamDamageGiven, team_damage_given, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(sTeamDamageTaken, team_damage_taken, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(sTeamMonsterDamageTaken, team_monster_damage_taken, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(sTeamMonsterDamageGiven, team_monster_damage_given, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(sTeamFriendlyFire, team_friendly_fire, NUMBER_OF_TEAM_COLORS);
+
+	for (short player_index = 0; player_index < dynamic_world->player_count; ++player_index)
+		sPlayers.save(players, dynamic_world->player_count, player_index);
+}
+
+std::size_t restore_world_snapshot()
+{
+	assert(sTakingSnapshot);
+	assert(!sSpeculating);
+	sTakingSnapshot = false;
+
+	// the list counts live here, so this goes back before the slots do
+	*dynamic_world = sDynamicWorld;
+	set_random_seed(sRandomSeed);
+	static_world->ball_in_play = sBallInPlay;
+	objlist_copy(team_damage_given, sTeamDamageGiven, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(team_damage_taken, sTeamDamageTaken, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(team_monster_damage_taken, sTeamMonsterDamageTaken, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(team_monster_damage_given, sTeamMonsterDamageGiven, NUMBER_OF_TEAM_COLORS);
+	objlist_copy(team_friendly_fire, sTeamFriendlyFire, NUMBER_OF_TEAM_COLORS);
+
+	std::size_t restored = 0;
+	restored += sPlayers.restore(players, nothing_to_do);
+	restored += sMonsters.restore(MonsterList.data(), nothing_to_do);
+	restored += sProjectiles.restore(ProjectileList.data(), nothing_to_do);
+	restored += sEffects.restore(EffectList.data(), nothing_to_do);
+	restored += sPlatforms.restore(PlatformList.data(), nothing_to_do);
+	restored += sLights.restore(LightList.data(), nothing_to_do);
+	restored += sMedias.restore(MediaList.data(), nothing_to_do);
+	restored += sLines.restore(LineList.data(), nothing_to_do);
+	restored += sSides.restore(SideList.data(), nothing_to_do);
+	restored += sEndpoints.restore(EndpointList.data(), nothing_to_do);
+	restored += sPaths.restore(get_path_list(), nothing_to_do);
+	restored += sPolygons.restore(PolygonList.data(), invalidate_polygon_collidable_objects);
+	restored += sObjects.restore(ObjectList.data(), restored_object);
+
+	return restored;
+}
+
+void begin_speculative_update()
+{
+	assert(sTakingSnapshot);
+	assert(!sSpeculating);
+	sSpeculating = true;
+}
+
+void end_speculative_update()
+{
+	assert(sSpeculating);
+	sSpeculating = false;
+}
+
+bool speculative_update_in_progress()
+{
+	return sSpeculating;
+}
+
+void snapshot_player(short player_index)
+{
+	if (sSpeculating)
+		sPlayers.save(players, dynamic_world->player_count, player_index);
+}
+
+void snapshot_monster(short monster_index)
+{
+	if (sSpeculating)
+		sMonsters.save(MonsterList.data(), MonsterList.size(), monster_index);
+}
+
+void snapshot_object(short object_index)
+{
+	if (sSpeculating)
+		sObjects.save(ObjectList.data(), ObjectList.size(), object_index);
+}
+
+void snapshot_projectile(short projectile_index)
+{
+	if (sSpeculating)
+		sProjectiles.save(ProjectileList.data(), ProjectileList.size(), projectile_index);
+}
+
+void snapshot_effect(short effect_index)
+{
+	if (sSpeculating)
+		sEffects.save(EffectList.data(), EffectList.size(), effect_index);
+}
+
+void snapshot_platform(short platform_index)
+{
+	if (sSpeculating)
+		sPlatforms.save(PlatformList.data(), PlatformList.size(), platform_index);
+}
+
+void snapshot_light(short light_index)
+{
+	if (sSpeculating)
+		sLights.save(LightList.data(), LightList.size(), light_index);
+}
+
+void snapshot_media(short media_index)
+{
+	if (sSpeculating)
+		sMedias.save(MediaList.data(), MediaList.size(), media_index);
+}
+
+void snapshot_polygon(short polygon_index)
+{
+	if (sSpeculating)
+		sPolygons.save(PolygonList.data(), PolygonList.size(), polygon_index);
+}
+
+void snapshot_line(short line_index)
+{
+	if (sSpeculating)
+		sLines.save(LineList.data(), LineList.size(), line_index);
+}
+
+void snapshot_side(short side_index)
+{
+	if (sSpeculating)
+		sSides.save(SideList.data(), SideList.size(), side_index);
+}
+
+void snapshot_endpoint(short endpoint_index)
+{
+	if (sSpeculating)
+		sEndpoints.save(EndpointList.data(), EndpointList.size(), endpoint_index);
+}
+
+void snapshot_path(short path_index)
+{
+	if (sSpeculating)
+		sPaths.save(get_path_list(), GetNumberOfPaths(), path_index);
+}
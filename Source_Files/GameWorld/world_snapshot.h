@@ -0,0 +1,69 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+/*
+	Copyright (C) 2021 and beyond by the "Aleph One" developers.
+ 
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+*/
+
+#include <cstddef>
+
+// A record of the world slots a speculative update such as prediction
+// writes, so the update can be undone afterwards.
+//
+// take_world_snapshot() copies the small state nearly every tick writes (the
+// players, *dynamic_world, the random seed and the team damage records) and
+// starts a snapshot; everything else is copied only when a slot is about to be
+// written. Whatever writes one calls the matching snapshot_*() first, which
+// saves the slot the first time and does nothing otherwise. Slots are only
+// recorded between begin_speculative_update() and end_speculative_update(),
+// so renderer and interface reads between predicted ticks cost nothing.
+// restore_world_snapshot() copies back just the saved slots and ends the
+// snapshot, so both ends cost what the update touched; the return value is
+// how many slots that was.
+//
+// The accessors of the object, monster, projectile, effect, platform, light
+// and media lists record the slot they hand out, since most callers write
+// through it; the loops that walk those lists directly, and the few places
+// that write map geometry or paths, call snapshot_*() themselves.
+//
+// While a speculative update runs, whatever would leave the world (sounds,
+// Lua triggers, player damage and pickups) checks
+// speculative_update_in_progress() and holds back: those only happen once
+// the real tick gets there.
+
+void take_world_snapshot();
+std::size_t restore_world_snapshot();
+
+void begin_speculative_update();
+void end_speculative_update();
+bool speculative_update_in_progress();
+
+void snapshot_player(short player_index);
+void snapshot_monster(short monster_index);
+void snapshot_object(short object_index);
+void snapshot_projectile(short projectile_index);
+void snapshot_effect(short effect_index);
+void snapshot_platform(short platform_index);
+void snapshot_light(short light_index);
+void snapshot_media(short media_index);
+void snapshot_polygon(short polygon_index);
+void snapshot_line(short line_index);
+void snapshot_side(short side_index);
+void snapshot_endpoint(short endpoint_index);
+void snapshot_path(short path_index);
+
+#endif
@@ -109,6 +109,7 @@ extern "C"
 #include "preferences.h"
 #include "BStream.h"
 #include "Plugins.h"
+#include "world_snapshot.h"
 
 #include "lua_script.h"
 #include "lua_ephemera.h"
@@ -147,6 +148,60 @@ int GetLuaScoringMode() {
 	return game_scoring_mode;
 }
 
+static const char *sLuaTriggerNames[NUMBER_OF_LUA_TRIGGERS] = {
+	"init",
+	"cleanup",
+	"idle",
+	"postidle",
+	"start_refuel",
+	"end_refuel",
+	"tag_switch",
+	"light_switch",
+	"platform_switch",
+	"projectile_switch",
+	"terminal_enter",
+	"terminal_exit",
+	"pattern_buffer",
+	"got_item",
+	"light_activated",
+	"platform_activated",
+	"player_revived",
+	"player_killed",
+	"monster_killed",
+	"monster_damaged",
+	"player_damaged",
+	"projectile_detonated",
+	"projectile_created",
+	"item_created"
+};
+
+static int32 sLuaTriggerCalls[NUMBER_OF_LUA_TRIGGERS];
+static uint64_t sLuaTriggerTime[NUMBER_OF_LUA_TRIGGERS];
+
+void reset_lua_trigger_timing()
+{
+	objlist_clear(sLuaTriggerCalls, NUMBER_OF_LUA_TRIGGERS);
+	objlist_clear(sLuaTriggerTime, NUMBER_OF_LUA_TRIGGERS);
+}
+
+const char *get_lua_trigger_name(short trigger)
+{
+	assert(trigger >= 0 && trigger < NUMBER_OF_LUA_TRIGGERS);
+	return sLuaTriggerNames[trigger];
+}
+
+int32 get_lua_trigger_calls(short trigger)
+{
+	assert(trigger >= 0 && trigger < NUMBER_OF_LUA_TRIGGERS);
+	return sLuaTriggerCalls[trigger];
+}
+
+double get_lua_trigger_seconds(short trigger)
+{
+	assert(trigger >= 0 && trigger < NUMBER_OF_LUA_TRIGGERS);
+	return static_cast<double>(sLuaTriggerTime[trigger]) / SDL_GetPerformanceFrequency();
+}
+
 #ifndef HAVE_LUA
 
 void L_Call_Init(bool) {}
@@ -187,6 +242,7 @@ bool RunLuaScript() {
 		use_lua_compass [i] = false;
 	return false;
 }
+bool LuaRunning() { return false; }
 void CloseLuaScript() {}
 
 void ToggleLuaMute() {}
@@ -245,7 +301,7 @@ class LuaState
 {
 	friend bool CollectLuaStats(std::map<std::string, std::string>&, std::map<std::string, std::string>&);
 public:
-	LuaState() : running_(false), num_scripts_(0) {
+	LuaState() : running_(false), num_scripts_(0), triggers_name_(LUA_NOREF), trigger_(NONE) {
 		state_.reset(luaL_newstate(), lua_close);
 	}
 
@@ -296,6 +352,15 @@ public:
 		lua_newtable(State());
 		lua_settable(State(), LUA_REGISTRYINDEX);
 
+		// intern the names GetTrigger() looks up, rather than on each call
+		lua_pushstring(State(), "Triggers");
+		triggers_name_ = luaL_ref(State(), LUA_REGISTRYINDEX);
+		for (short i = 0; i < NUMBER_OF_LUA_TRIGGERS; ++i)
+		{
+			lua_pushstring(State(), get_lua_trigger_name(i));
+			trigger_names_[i] = luaL_ref(State(), LUA_REGISTRYINDEX);
+		}
+
 		RegisterFunctions();
 		LoadCompatibility();
 	}
@@ -305,7 +370,7 @@ public:
 	}
 
 protected:
-	bool GetTrigger(const char *trigger);
+	bool GetTrigger(short trigger);
 	void CallTrigger(int numArgs = 0);
 
 	virtual void RegisterFunctions();
@@ -353,6 +418,14 @@ public:
 private:
 	bool running_;
 	int num_scripts_;
+
+	// registry references to the interned trigger names
+	int triggers_name_;
+	int trigger_names_[NUMBER_OF_LUA_TRIGGERS];
+
+	// the trigger GetTrigger() last pushed, for CallTrigger() to time;
+	// NONE once it has been called
+	short trigger_;
 };
 
 typedef LuaState EmbeddedLuaState;
@@ -371,19 +444,25 @@ public:
 	}
 };
 
-bool LuaState::GetTrigger(const char* trigger)
+bool LuaState::GetTrigger(short trigger)
 {
 	if (!running_)
 		return false;
 
-	lua_getglobal(State(), "Triggers");
+	// the same lookups as lua_getglobal() and lua_getfield(), but with
+	// keys interned in Initialize(); scripts replace Triggers and assign
+	// to it at any time, so the functions themselves can't be cached
+	lua_rawgeti(State(), LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+	lua_rawgeti(State(), LUA_REGISTRYINDEX, triggers_name_);
+	lua_gettable(State(), -2);
+	lua_remove(State(), -2);
 	if (!lua_istable(State(), -1))
 	{
 		lua_pop(State(), 1);
 		return false;
 	}
 
-	lua_pushstring(State(), trigger);
+	lua_rawgeti(State(), LUA_REGISTRYINDEX, trigger_names_[trigger]);
 	lua_gettable(State(), -2);
 	if (!lua_isfunction(State(), -1))
 	{
@@ -392,18 +471,28 @@ bool LuaState::GetTrigger(const char* trigger)
 	}
 
 	lua_remove(State(), -2);
+	trigger_ = trigger;
 	return true;
 }
 
 void LuaState::CallTrigger(int numArgs)
 {
+	// read it now; the call itself may fire other triggers
+	short trigger = trigger_;
+	assert(trigger != NONE);
+	trigger_ = NONE;
+
+	uint64_t start_counter = SDL_GetPerformanceCounter();
 	if (lua_pcall(State(), numArgs, 0, 0) == LUA_ERRRUN)
 		L_Error(lua_tostring(State(), -1));
+
+	sLuaTriggerCalls[trigger]++;
+	sLuaTriggerTime[trigger] += SDL_GetPerformanceCounter() - start_counter;
 }
 
 void LuaState::Init(bool fRestoringSaved)
 {
-	if (GetTrigger("init"))
+	if (GetTrigger(_lua_trigger_init))
 	{
 		lua_pushboolean(State(), fRestoringSaved);
 		CallTrigger(1);
@@ -412,25 +501,25 @@ void LuaState::Init(bool fRestoringSaved)
 
 void LuaState::Idle()
 {
-	if (GetTrigger("idle"))
+	if (GetTrigger(_lua_trigger_idle))
 		CallTrigger();
 }
 
 void LuaState::Cleanup()
 {
-	if (GetTrigger("cleanup"))
+	if (GetTrigger(_lua_trigger_cleanup))
 		CallTrigger();
 }
 
 void LuaState::PostIdle()
 {
-	if (GetTrigger("postidle"))
+	if (GetTrigger(_lua_trigger_postidle))
 		CallTrigger();
 }
 
 void LuaState::StartRefuel(short type, short player_index, short panel_side_index)
 {
-	if (GetTrigger("start_refuel"))
+	if (GetTrigger(_lua_trigger_start_refuel))
 	{
 		Lua_ControlPanelClass::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -441,7 +530,7 @@ void LuaState::StartRefuel(short type, short player_index, short panel_side_inde
 
 void LuaState::EndRefuel(short type, short player_index, short panel_side_index)
 {
-	if (GetTrigger("end_refuel"))
+	if (GetTrigger(_lua_trigger_end_refuel))
 	{
 		Lua_ControlPanelClass::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -452,7 +541,7 @@ void LuaState::EndRefuel(short type, short player_index, short panel_side_index)
 
 void LuaState::TagSwitch(short tag, short player_index, short side_index)
 {
-	if (GetTrigger("tag_switch"))
+	if (GetTrigger(_lua_trigger_tag_switch))
 	{
 		Lua_Tag::Push(State(), tag);
 		Lua_Player::Push(State(), player_index);
@@ -463,7 +552,7 @@ void LuaState::TagSwitch(short tag, short player_index, short side_index)
 
 void LuaState::LightSwitch(short light, short player_index, short side_index)
 {
-	if (GetTrigger("light_switch"))
+	if (GetTrigger(_lua_trigger_light_switch))
 	{
 		Lua_Light::Push(State(), light);
 		Lua_Player::Push(State(), player_index);
@@ -474,7 +563,7 @@ void LuaState::LightSwitch(short light, short player_index, short side_index)
 
 void LuaState::PlatformSwitch(short platform, short player_index, short side_index)
 {
-	if (GetTrigger("platform_switch"))
+	if (GetTrigger(_lua_trigger_platform_switch))
 	{
 		Lua_Polygon::Push(State(), platform);
 		Lua_Player::Push(State(), player_index);
@@ -485,7 +574,7 @@ void LuaState::PlatformSwitch(short platform, short player_index, short side_ind
 
 void LuaState::ProjectileSwitch(short side_index, short projectile_index)
 {
-	if (GetTrigger("projectile_switch"))
+	if (GetTrigger(_lua_trigger_projectile_switch))
 	{
 		Lua_Projectile::Push(State(), projectile_index);
 		Lua_Side::Push(State(), side_index);
@@ -495,7 +584,7 @@ void LuaState::ProjectileSwitch(short side_index, short projectile_index)
 
 void LuaState::TerminalEnter(short terminal_id, short player_index)
 {
-	if (GetTrigger("terminal_enter"))
+	if (GetTrigger(_lua_trigger_terminal_enter))
 	{
 		Lua_Terminal::Push(State(), terminal_id);
 		Lua_Player::Push(State(), player_index);
@@ -505,7 +594,7 @@ void LuaState::TerminalEnter(short terminal_id, short player_index)
 
 void LuaState::TerminalExit(short terminal_id, short player_index)
 {
-	if (GetTrigger("terminal_exit"))
+	if (GetTrigger(_lua_trigger_terminal_exit))
 	{
 		Lua_Terminal::Push(State(), terminal_id);
 		Lua_Player::Push(State(), player_index);
@@ -515,7 +604,7 @@ void LuaState::TerminalExit(short terminal_id, short player_index)
 
 void LuaState::PatternBuffer(short side_index, short player_index)
 {
-	if (GetTrigger("pattern_buffer"))
+	if (GetTrigger(_lua_trigger_pattern_buffer))
 	{
 		Lua_Side::Push(State(), side_index);
 		Lua_Player::Push(State(), player_index);
@@ -525,7 +614,7 @@ void LuaState::PatternBuffer(short side_index, short player_index)
 
 void LuaState::GotItem(short type, short player_index)
 {
-	if (GetTrigger("got_item"))
+	if (GetTrigger(_lua_trigger_got_item))
 	{
 		Lua_ItemType::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -535,7 +624,7 @@ void LuaState::GotItem(short type, short player_index)
 
 void LuaState::LightActivated(short index)
 {
-	if (GetTrigger("light_activated"))
+	if (GetTrigger(_lua_trigger_light_activated))
 	{
 		Lua_Light::Push(State(), index);
 		CallTrigger(1);
@@ -544,7 +633,7 @@ void LuaState::LightActivated(short index)
 
 void LuaState::PlatformActivated(short index)
 {
-	if (GetTrigger("platform_activated"))
+	if (GetTrigger(_lua_trigger_platform_activated))
 	{
 		Lua_Polygon::Push(State(), index);
 		CallTrigger(1);
@@ -553,7 +642,7 @@ void LuaState::PlatformActivated(short index)
 
 void LuaState::PlayerRevived (short player_index)
 {
-	if (GetTrigger("player_revived"))
+	if (GetTrigger(_lua_trigger_player_revived))
 	{
 		Lua_Player::Push(State(), player_index);
 		CallTrigger(1);
@@ -562,7 +651,7 @@ void LuaState::PlayerRevived (short player_index)
 
 void LuaState::PlayerKilled (short player_index, short aggressor_player_index, short action, short projectile_index)
 {
-	if (GetTrigger("player_killed"))
+	if (GetTrigger(_lua_trigger_player_killed))
 	{
 		Lua_Player::Push(State(), player_index);
 
@@ -583,7 +672,7 @@ void LuaState::PlayerKilled (short player_index, short aggressor_player_index, s
 
 void LuaState::MonsterKilled (short monster_index, short aggressor_player_index, short projectile_index)
 {
-	if (GetTrigger("monster_killed"))
+	if (GetTrigger(_lua_trigger_monster_killed))
 	{
 		Lua_Monster::Push(State(), monster_index);
 		if (aggressor_player_index != -1)
@@ -602,7 +691,7 @@ void LuaState::MonsterKilled (short monster_index, short aggressor_player_index,
 
 void LuaState::MonsterDamaged(short monster_index, short aggressor_monster_index, int16 damage_type, short damage_amount, short projectile_index)
 {
-	if (GetTrigger("monster_damaged"))
+	if (GetTrigger(_lua_trigger_monster_damaged))
 	{
 		Lua_Monster::Push(State(), monster_index);
 		if (aggressor_monster_index != -1) 
@@ -625,7 +714,7 @@ void LuaState::MonsterDamaged(short monster_index, short aggressor_monster_index
 
 void LuaState::PlayerDamaged (short player_index, short aggressor_player_index, short aggressor_monster_index, int16 damage_type, short damage_amount, short projectile_index)
 {
-	if (GetTrigger("player_damaged"))
+	if (GetTrigger(_lua_trigger_player_damaged))
 	{
 		Lua_Player::Push(State(), player_index);
 
@@ -653,7 +742,7 @@ void LuaState::PlayerDamaged (short player_index, short aggressor_player_index,
 
 void LuaState::ProjectileDetonated(short type, short owner_index, short polygon, world_point3d location) 
 {
-	if (GetTrigger("projectile_detonated"))
+	if (GetTrigger(_lua_trigger_projectile_detonated))
 	{
 		Lua_ProjectileType::Push(State(), type);
 		if (owner_index != -1)
@@ -671,7 +760,7 @@ void LuaState::ProjectileDetonated(short type, short owner_index, short polygon,
 
 void LuaState::ProjectileCreated (short projectile_index)
 {
-	if (GetTrigger("projectile_created"))
+	if (GetTrigger(_lua_trigger_projectile_created))
 	{
 		Lua_Projectile::Push(State(), projectile_index);
 		CallTrigger(1);
@@ -680,7 +769,7 @@ void LuaState::ProjectileCreated (short projectile_index)
 
 void LuaState::ItemCreated (short item_index)
 {
-	if (GetTrigger("item_created"))
+	if (GetTrigger(_lua_trigger_item_created))
 	{
 		Lua_Item::Push(State(), item_index);
 		CallTrigger(1);
@@ -1182,7 +1271,7 @@ L_Do_Call(const char* inLuaFunctionName, int inNumArgs = 0, int inNumResults = 0
 }
 */
 
-static bool LuaRunning()
+bool LuaRunning()
 {
 	for (state_map::iterator it = states.begin(); it != states.end(); ++it)
 	{
@@ -1199,6 +1288,10 @@ static bool LuaRunning()
 template<class UnaryFunction>
 void L_Dispatch(const UnaryFunction& f)
 {
+	// scripts only see the world as real ticks leave it, never a predicted one
+	if (speculative_update_in_progress())
+		return;
+
 	for (state_map::iterator it = states.begin(); it != states.end(); ++it)
 	{
 		f(it->second);
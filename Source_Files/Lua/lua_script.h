@@ -64,6 +64,42 @@ void L_Invalidate_Projectile(short projectile_index);
 void L_Invalidate_Object(short object_index);
 void L_Invalidate_Ephemera(short ephemera_index);
 
+// the triggers scripts can define, named as in the Triggers table
+enum {
+	_lua_trigger_init,
+	_lua_trigger_cleanup,
+	_lua_trigger_idle,
+	_lua_trigger_postidle,
+	_lua_trigger_start_refuel,
+	_lua_trigger_end_refuel,
+	_lua_trigger_tag_switch,
+	_lua_trigger_light_switch,
+	_lua_trigger_platform_switch,
+	_lua_trigger_projectile_switch,
+	_lua_trigger_terminal_enter,
+	_lua_trigger_terminal_exit,
+	_lua_trigger_pattern_buffer,
+	_lua_trigger_got_item,
+	_lua_trigger_light_activated,
+	_lua_trigger_platform_activated,
+	_lua_trigger_player_revived,
+	_lua_trigger_player_killed,
+	_lua_trigger_monster_killed,
+	_lua_trigger_monster_damaged,
+	_lua_trigger_player_damaged,
+	_lua_trigger_projectile_detonated,
+	_lua_trigger_projectile_created,
+	_lua_trigger_item_created,
+	NUMBER_OF_LUA_TRIGGERS
+};
+
+// every trigger call is counted and timed, summed over all running
+// scripts; the totals run from the last reset
+void reset_lua_trigger_timing();
+const char *get_lua_trigger_name(short trigger);
+int32 get_lua_trigger_calls(short trigger);
+double get_lua_trigger_seconds(short trigger);
+
 enum ScriptType {
 	_embedded_lua_script,
 	_lua_netscript,
@@ -75,6 +111,7 @@ void *L_Persistent_Table_Key();
 
 bool LoadLuaScript(const char *buffer, size_t len, ScriptType type);
 bool RunLuaScript();
+bool LuaRunning();
 void CloseLuaScript();
 void ResetPassedLua();
 
@@ -19,6 +19,11 @@ LUA_SERIALIZE.CPP
 
 	Serializes Lua objects
 	Based on Pluto, but far less clever
+
+	Version 2 writes integral numbers, lengths and references as varints,
+	and interns strings: each distinct string is written once and later
+	occurrences refer back to it, the way repeated tables always have.
+	Version 1 data (from older saves and Game.serialize) still restores.
 */
 
 #include "lua_serialize.h"
@@ -26,8 +31,17 @@ LUA_SERIALIZE.CPP
 
 #include "BStream.h"
 
+#include <math.h>
+#include <stdint.h>
+#include <sstream>
+#include <vector>
+
 const static int SAVED_REFERENCE_PSEUDOTYPE = -2;
-const uint16 kVersion = 1;
+const static int SAVED_INTEGER_PSEUDOTYPE = -3;
+const uint16 kVersion = 2;
+
+// integers beyond this are not exact in a double anyway
+const static double kMaximumSavedInteger = 9007199254740992.0; // 2^53
 
 static bool valid_key(int type)
 {
@@ -38,49 +52,159 @@ static bool valid_key(int type)
 		type == LUA_TUSERDATA);
 }
 
-static void save(lua_State *L, BOStreamBE& s, uint32& counter)
+static void write_varint(BOStreamBE& s, uint64_t value)
 {
-	// if the object has already been written, write a reference to it
+	while (value >= 0x80)
+	{
+		s << static_cast<uint8>((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	s << static_cast<uint8>(value);
+}
 
-	lua_pushvalue(L, -1);
-	lua_rawget(L, 1);
-	if (!lua_isnil(L, -1))
+static uint64_t read_varint(BIStreamBE& s)
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		uint8 b;
+		s >> b;
+		value |= static_cast<uint64_t>(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return value;
+	}
+
+	throw basic_bstream::failure("malformed varint");
+}
+
+// objects already written, by address, and the reference number each was
+// given; everything saved is reachable from the root object, so nothing is
+// collected or moved while we save. Lua interns short strings, so equal
+// strings share an address; a long string repeated under another address
+// is simply written again
+class reference_map
+{
+public:
+	reference_map() : m_slots(1024), m_count(0) { }
+
+	uint32 find(const void* address) const {
+		for (size_t i = slot_for(address); m_slots[i].address; i = (i + 1) & (m_slots.size() - 1))
+		{
+			if (m_slots[i].address == address)
+				return m_slots[i].reference;
+		}
+		return 0;
+	}
+
+	// returns the new reference number
+	uint32 add(const void* address) {
+		if ((m_count + 1) * 2 > m_slots.size())
+			grow();
+		insert(address, ++m_count);
+		return m_count;
+	}
+
+	uint32 size() const { return m_count; }
+
+private:
+	struct slot {
+		const void* address;
+		uint32 reference;
+	};
+
+	size_t slot_for(const void* address) const {
+		uint64_t h = reinterpret_cast<uintptr_t>(address) * UINT64_C(0x9e3779b97f4a7c15);
+		return static_cast<size_t>(h >> 32) & (m_slots.size() - 1);
+	}
+
+	void insert(const void* address, uint32 reference) {
+		size_t i = slot_for(address);
+		while (m_slots[i].address)
+			i = (i + 1) & (m_slots.size() - 1);
+		m_slots[i].address = address;
+		m_slots[i].reference = reference;
+	}
+
+	void grow() {
+		std::vector<slot> old(m_slots.size() * 2);
+		old.swap(m_slots);
+		for (std::vector<slot>::const_iterator it = old.begin(); it != old.end(); ++it)
+		{
+			if (it->address)
+				insert(it->address, it->reference);
+		}
+	}
+
+	std::vector<slot> m_slots;
+	uint32 m_count;
+};
+
+static const void* object_address(lua_State *L, int type)
+{
+	return type == LUA_TSTRING ? lua_tostring(L, -1) : lua_topointer(L, -1);
+}
+
+static void add_reference(lua_State *L, int type, reference_map& references)
+{
+	references.add(object_address(L, type));
+}
+
+static void save(lua_State *L, BOStreamBE& s, reference_map& references)
+{
+	int type = lua_type(L, -1);
+
+	// if the object has already been written, write a reference to it
+	if (type == LUA_TSTRING || type == LUA_TTABLE || type == LUA_TUSERDATA)
 	{
-		s << static_cast<int8>(SAVED_REFERENCE_PSEUDOTYPE)
-		  << static_cast<uint32>(lua_tonumber(L, -1));
-		lua_pop(L, 1);
-		return;
+		uint32 reference = references.find(object_address(L, type));
+		if (reference)
+		{
+			s << static_cast<int8>(SAVED_REFERENCE_PSEUDOTYPE);
+			write_varint(s, reference);
+			return;
+		}
 	}
-	lua_pop(L, 1);
 
-	s << static_cast<int8>(lua_type(L, -1));
-	switch (lua_type(L, -1))
+	switch (type)
 	{
 		case LUA_TNIL:
+			s << static_cast<int8>(type);
 			break;
 		case LUA_TNUMBER:
 			{
-				s << static_cast<double>(lua_tonumber(L, -1));
+				double d = lua_tonumber(L, -1);
+				if (d == floor(d) && fabs(d) <= kMaximumSavedInteger && !(d == 0 && signbit(d)))
+				{
+					// zigzag, so small negative numbers stay short
+					int64_t i = static_cast<int64_t>(d);
+					s << static_cast<int8>(SAVED_INTEGER_PSEUDOTYPE);
+					write_varint(s, (static_cast<uint64_t>(i) << 1) ^ static_cast<uint64_t>(i >> 63));
+				}
+				else
+				{
+					s << static_cast<int8>(type) << d;
+				}
 			}
 			break;
 		case LUA_TBOOLEAN:
-			s << static_cast<uint8>(lua_toboolean(L, -1) ? 1 : 0);
+			s << static_cast<int8>(type)
+			  << static_cast<uint8>(lua_toboolean(L, -1) ? 1 : 0);
 			break;
 		case LUA_TSTRING: 
 			{
-				s << static_cast<uint32>(lua_rawlen(L, -1));
-				s.write(lua_tostring(L, -1), lua_rawlen(L, -1));
+				size_t length;
+				const char *str = lua_tolstring(L, -1, &length);
+				s << static_cast<int8>(type);
+				write_varint(s, length);
+				s.write(str, length);
+
+				add_reference(L, type, references);
 			}
 			break;
 		case LUA_TTABLE:
 			{
-				// add to the reference table
-				lua_pushvalue(L, -1);
-				lua_pushnumber(L, static_cast<lua_Number>(++counter));
-				lua_rawset(L, 1);
-
-				// write the reference
-				s << counter;
+				s << static_cast<int8>(type);
+				add_reference(L, type, references);
 
 				// write all k/v pairs
 				lua_pushnil(L);
@@ -90,48 +214,42 @@ static void save(lua_State *L, BOStreamBE& s, uint32& counter)
 						// another key
 						lua_pushvalue(L, -2);
 						
-						save(L, s, counter);
+						save(L, s, references);
 						lua_pop(L, 1);
 						
-						save(L, s, counter);
+						save(L, s, references);
 						lua_pop(L, 1);
 					} else {
 						lua_pop(L, 1);
 					}
 				}
 
-				lua_pushnil(L);
-				save(L, s, counter);
-				lua_pop(L, 1);
+				s << static_cast<int8>(LUA_TNIL);
 			}
 			break;
 		case LUA_TUSERDATA:
 			{
-				// add to the reference table
-				lua_pushvalue(L, -1);
-				lua_pushnumber(L, static_cast<lua_Number>(++counter));
-				lua_rawset(L, 1);
-
-				// write the reference
-				s << counter;
+				s << static_cast<int8>(type);
 
 				// assume that this is one of our userdata
 				lua_getmetatable(L, -1);
 				lua_gettable(L, LUA_REGISTRYINDEX);
-
-				s << static_cast<uint8>(lua_rawlen(L, -1));
-				s.write(lua_tostring(L, -1), lua_rawlen(L, -1));
+				save(L, s, references);
 				lua_pop(L, 1);
 
 				lua_getfield(L, -1, "index");
-				
-				s << static_cast<uint32>(lua_tonumber(L, -1));
+				write_varint(s, static_cast<uint32>(lua_tonumber(L, -1)));
 				lua_pop(L, 1);
+
+				// the restorer can't reference the userdata until it has
+				// read the name and index
+				add_reference(L, type, references);
 			}
 			break;
 		
 		default:
 			// we silently ignore other types
+			s << static_cast<int8>(LUA_TNIL);
 			break;
 	}
 }
@@ -140,18 +258,20 @@ bool lua_save(lua_State *L, std::streambuf* sb)
 {
 	lua_assert(lua_gettop(L) == 1);
 
-	// create a references table
-	lua_newtable(L);
-
-	// put it at the bottom of the stack
-	lua_insert(L, 1);
-	
-	uint32 counter = 0;
+	reference_map references;
 	BOStreamBE s(sb);
 	try 
 	{
+		// the reference count goes first, so the restorer can size its
+		// reference table up front
+		std::stringbuf body;
+		BOStreamBE b(&body);
+		save(L, b, references);
+
+		const std::string& data = body.str();
 		s << kVersion;
-		save(L, s, counter);
+		write_varint(s, references.size());
+		s.write(data.data(), data.size());
 	}
 	catch (const basic_bstream::failure& e)
 	{
@@ -160,12 +280,11 @@ bool lua_save(lua_State *L, std::streambuf* sb)
 		return false;
 	}
 
-	// remove the reference table
-	lua_remove(L, 1);
 	return true;
 }
 
-static int restore(lua_State *L, BIStreamBE& s)
+// restores version 1 data, which stored every reference explicitly
+static int restore_v1(lua_State *L, BIStreamBE& s)
 {
 	int8 type;
 	s >> type;
@@ -191,9 +310,11 @@ static int restore(lua_State *L, BIStreamBE& s)
 			{
 				uint32 length;
 				s >> length;
+				if (length > static_cast<uint64_t>(s.maxg() - s.tellg()))
+					throw basic_bstream::failure("serialization bound check failed");
 				std::vector<char> v(length);
-				s.read(&v[0], v.size());
-				lua_pushlstring(L, &v[0], v.size());
+				s.read(v.data(), v.size());
+				lua_pushlstring(L, v.data(), v.size());
 			}
 			break;
 		case LUA_TTABLE:
@@ -207,10 +328,10 @@ static int restore(lua_State *L, BIStreamBE& s)
 				lua_pushvalue(L, -2);
 				lua_rawset(L, 1);
 
-				int key_type = restore(L, s);
+				int key_type = restore_v1(L, s);
 				while (key_type != LUA_TNIL)
 				{
-					restore(L, s); // value
+					restore_v1(L, s); // value
 					if (lua_isnil(L, -2)) 
 					{
 						// maybe an invalid userdata?
@@ -220,7 +341,7 @@ static int restore(lua_State *L, BIStreamBE& s)
 					{
 						lua_rawset(L, -3);
 					}
-					key_type = restore(L, s); // next key
+					key_type = restore_v1(L, s); // next key
 				}
 				lua_pop(L, 1);
 			}
@@ -233,8 +354,8 @@ static int restore(lua_State *L, BIStreamBE& s)
 				uint8 length;
 				s >> length;
 				std::vector<char> v(length);
-				s.read(&v[0], v.size());
-				lua_pushlstring(L, &v[0], v.size());
+				s.read(v.data(), v.size());
+				lua_pushlstring(L, v.data(), v.size());
 
 				uint32 index;
 				s >> index;
@@ -275,6 +396,118 @@ static int restore(lua_State *L, BIStreamBE& s)
 	return type;
 }
 
+// adds the object on top of the stack to the reference table, numbering
+// references in the order save() assigned them
+static void restore_reference(lua_State *L, uint32& counter)
+{
+	lua_pushvalue(L, -1);
+	lua_rawseti(L, 1, ++counter);
+}
+
+static int restore(lua_State *L, BIStreamBE& s, uint32& counter)
+{
+	int8 type;
+	s >> type;
+
+	switch (type) 
+	{
+		case LUA_TNIL:
+			lua_pushnil(L);
+			break;
+		case LUA_TBOOLEAN:
+			uint8 b;
+			s >> b;			
+			lua_pushboolean(L, b == 1);
+			break;
+		case LUA_TNUMBER:
+			{
+				double d;
+				s >> d;
+				lua_pushnumber(L, static_cast<lua_Number>(d));
+			}
+			break;
+		case SAVED_INTEGER_PSEUDOTYPE:
+			{
+				uint64_t u = read_varint(s);
+				int64_t i = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+				lua_pushnumber(L, static_cast<lua_Number>(i));
+			}
+			break;
+		case LUA_TSTRING:
+			{
+				// check it against what's left before allocating, so a
+				// damaged length can't ask for gigabytes
+				uint64_t length = read_varint(s);
+				if (length > static_cast<uint64_t>(s.maxg() - s.tellg()))
+					throw basic_bstream::failure("serialization bound check failed");
+
+				std::vector<char> v(length);
+				s.read(v.data(), v.size());
+				lua_pushlstring(L, v.data(), v.size());
+
+				restore_reference(L, counter);
+			}
+			break;
+		case LUA_TTABLE:
+			{
+				lua_newtable(L);
+				restore_reference(L, counter);
+
+				int key_type = restore(L, s, counter);
+				while (key_type != LUA_TNIL)
+				{
+					restore(L, s, counter); // value
+					if (lua_isnil(L, -2)) 
+					{
+						// maybe an invalid userdata?
+						lua_pop(L, 2);
+					} 
+					else
+					{
+						lua_rawset(L, -3);
+					}
+					key_type = restore(L, s, counter); // next key
+				}
+				lua_pop(L, 1);
+			}
+			break;
+		case LUA_TUSERDATA:
+			{
+				restore(L, s, counter); // metatable name
+				uint32 index = static_cast<uint32>(read_varint(s));
+				
+				// get the metatable
+				lua_gettable(L, LUA_REGISTRYINDEX);
+				// get the accessor we added
+				lua_getfield(L, -1, "__new");
+				if (lua_isfunction(L, -1))
+				{
+					lua_pushnumber(L, static_cast<lua_Number>(index));
+					lua_call(L, 1, 1);
+				}
+
+				lua_remove(L, -2);
+				
+				restore_reference(L, counter);
+			}
+			break;
+				
+		case SAVED_REFERENCE_PSEUDOTYPE:
+			{
+				uint64_t index = read_varint(s);
+				if (index > counter)
+					throw basic_bstream::failure("reference to an unsaved object");
+				lua_rawgeti(L, 1, static_cast<int>(index));
+			}
+			break;
+		default:
+			lua_pushnil(L);
+			break;
+	}
+
+	return type;
+}
+
 bool lua_restore(lua_State *L, std::streambuf* sb)
 {
 	// create a reference table
@@ -293,7 +526,23 @@ bool lua_restore(lua_State *L, std::streambuf* sb)
 			return false;
 		}
 
-		restore(L, s);
+		if (version < 2)
+		{
+			restore_v1(L, s);
+		}
+		else
+		{
+			// every reference takes at least a byte
+			uint64_t references = read_varint(s);
+			if (references > static_cast<uint64_t>(s.maxg() - s.tellg()))
+				throw basic_bstream::failure("serialization bound check failed");
+
+			lua_createtable(L, static_cast<int>(references), 0);
+			lua_replace(L, 1);
+
+			uint32 counter = 0;
+			restore(L, s, counter);
+		}
 	}
 	catch (const basic_bstream::failure& e)
 	{
@@ -40,17 +40,26 @@
 #include "FileHandler.h"
 #include "game_wad.h"
 
+// for world profiling
+#include "map.h"
+
+// for film seeking
+#include "interface.h"
+
 #include <boost/algorithm/string/predicate.hpp>
 
 using namespace std;
 
 extern bool game_is_networked;
+extern DirectorySpecifier log_dir;
 
 Console::Console() : m_active(false), m_carnage_messages_exist(false), m_use_lua_console(true)
 {
 	m_command_iter = m_prev_commands.end();
 	m_carnage_messages.resize(NUMBER_OF_PROJECTILE_TYPES);
 	register_save_commands();
+	register_profile_commands();
+	register_film_commands();
 }
 
 Console *Console::instance() {
@@ -456,6 +465,177 @@ void Console::clear_saves()
 	last_level.clear();
 }
 
+struct show_world_profile
+{
+	void operator() (const std::string&) const {
+		// only the busiest subsystems fit on screen
+		const size_t max_lines = 5;
+
+		world_subsystem_window windows[NUMBER_OF_WORLD_SUBSYSTEMS];
+		std::vector<short> order;
+		uint32 total_microseconds = 0;
+		for (short i = 0; i < NUMBER_OF_WORLD_SUBSYSTEMS; ++i)
+		{
+			get_world_subsystem_window(i, &windows[i]);
+			total_microseconds += windows[i].total_microseconds;
+			if (windows[i].call_count)
+				order.push_back(i);
+		}
+
+		if (order.empty())
+		{
+			screen_printf("No world updates profiled yet");
+			return;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&windows](short a, short b) {
+			return windows[a].total_microseconds > windows[b].total_microseconds;
+		});
+		if (order.size() > max_lines)
+			order.resize(max_lines);
+
+		for (short i : order)
+		{
+			const world_subsystem_window& window = windows[i];
+			screen_printf("%s: %.0f%%, avg %uus, max %uus",
+				      get_world_subsystem_name(i),
+				      total_microseconds ? 100.0 * window.total_microseconds / total_microseconds : 0.0,
+				      window.total_microseconds / window.call_count,
+				      window.maximum_microseconds);
+		}
+	}
+};
+
+struct dump_world_profile
+{
+	void operator() (const std::string& arg) const {
+		std::string filename = arg;
+		if (filename == "")
+			filename = "World Profile.csv";
+		else if (!boost::algorithm::ends_with(filename, ".csv"))
+			filename += ".csv";
+
+		FileSpecifier fs = log_dir;
+		fs += filename;
+#ifdef __WIN32__
+		FILE *file = _wfopen(utf8_to_wide(fs.GetPath()).c_str(), L"w");
+#else
+		FILE *file = fopen(fs.GetPath(), "w");
+#endif
+		if (!file)
+		{
+			screen_printf("Couldn't write %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+			return;
+		}
+
+		fprintf(file, "subsystem,calls,total_ms,window_calls,window_mean_us,window_max_us");
+		for (int bucket = 0; bucket < NUMBER_OF_WORLD_PROFILE_BUCKETS; ++bucket)
+		{
+			if (bucket == NUMBER_OF_WORLD_PROFILE_BUCKETS - 1)
+				fprintf(file, ",>=%dus", 1 << (bucket - 1));
+			else
+				fprintf(file, ",<%dus", 1 << bucket);
+		}
+		fprintf(file, "\n");
+
+		for (short i = 0; i < NUMBER_OF_WORLD_SUBSYSTEMS; ++i)
+		{
+			world_subsystem_window window;
+			get_world_subsystem_window(i, &window);
+
+			fprintf(file, "%s,%d,%.3f,%d,%.1f,%u",
+				get_world_subsystem_name(i),
+				get_world_subsystem_calls(i),
+				get_world_subsystem_seconds(i) * 1000.0,
+				window.call_count,
+				window.call_count ? static_cast<double>(window.total_microseconds) / window.call_count : 0.0,
+				window.maximum_microseconds);
+			for (int bucket = 0; bucket < NUMBER_OF_WORLD_PROFILE_BUCKETS; ++bucket)
+				fprintf(file, ",%d", window.buckets[bucket]);
+			fprintf(file, "\n");
+		}
+		fclose(file);
+
+		screen_printf("Saved %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+	}
+};
+
+struct reset_world_profile
+{
+	void operator() (const std::string&) const {
+		reset_world_subsystem_timing();
+		screen_printf("World profile reset");
+	}
+};
+
+void Console::register_profile_commands()
+{
+	CommandParser profileParser;
+	profileParser.register_command("show", show_world_profile());
+	profileParser.register_command("dump", dump_world_profile());
+	profileParser.register_command("reset", reset_world_profile());
+	register_command("profile", profileParser);
+}
+
+// seconds, or minutes:seconds
+static bool parse_film_time(const std::string& arg, int32& ticks)
+{
+	int minutes = 0, seconds = 0;
+	char extra;
+	if (sscanf(arg.c_str(), "%d:%d %c", &minutes, &seconds, &extra) != 2)
+	{
+		minutes = 0;
+		if (sscanf(arg.c_str(), "%d %c", &seconds, &extra) != 1)
+			return false;
+	}
+	if (minutes < 0 || seconds < 0)
+		return false;
+
+	ticks = (minutes * 60 + seconds) * TICKS_PER_SECOND;
+	return true;
+}
+
+struct seek_film
+{
+	// 0 seeks to a time from the start of the film, -1 and 1 by a time from here
+	explicit seek_film(int direction) : m_direction(direction) { }
+
+	void operator() (const std::string& arg) const {
+		if (get_game_controller() != _replay)
+		{
+			screen_printf("Not watching a film");
+			return;
+		}
+
+		int32 ticks;
+		if (!parse_film_time(arg, ticks))
+		{
+			screen_printf("Give a time in seconds or minutes:seconds");
+			return;
+		}
+
+		int32 tick = m_direction ? dynamic_world->tick_count + m_direction * ticks : ticks;
+		if (seek_replay(tick))
+		{
+			int32 seconds = dynamic_world->tick_count / TICKS_PER_SECOND;
+			screen_printf("Film at %d:%02d", seconds / 60, seconds % 60);
+		}
+		else
+			screen_printf("Couldn't seek the film there");
+	}
+
+	int m_direction;
+};
+
+void Console::register_film_commands()
+{
+	CommandParser filmParser;
+	filmParser.register_command("seek", seek_film(0));
+	filmParser.register_command("back", seek_film(-1));
+	filmParser.register_command("forward", seek_film(1));
+	register_command("film", filmParser);
+}
+
 void reset_mml_console()
 {
 	Console *console = Console::instance();
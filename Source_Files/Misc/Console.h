@@ -111,6 +111,8 @@ private:
 	bool m_use_lua_console;
 
 	void register_save_commands();
+	void register_profile_commands();
+	void register_film_commands();
 };
 
 class InfoTree;
@@ -173,9 +173,10 @@ enum recording_version {
 	RECORDING_VERSION_ALEPH_ONE_1_1 = 8,
 	RECORDING_VERSION_ALEPH_ONE_1_2 = 9,
 	RECORDING_VERSION_ALEPH_ONE_1_3 = 10,
+	RECORDING_VERSION_ALEPH_ONE_1_4 = 11,
 };
-const short default_recording_version = RECORDING_VERSION_ALEPH_ONE_1_3;
-const short max_handled_recording= RECORDING_VERSION_ALEPH_ONE_1_3;
+const short default_recording_version = RECORDING_VERSION_ALEPH_ONE_1_4;
+const short max_handled_recording= RECORDING_VERSION_ALEPH_ONE_1_4;
 
 #include "screen_definitions.h"
 #include "interface_menus.h"
@@ -306,6 +307,8 @@ static struct color_table *current_picture_clut= NULL;
 extern short interface_bit_depth;
 extern short bit_depth;
 extern bool insecure_lua;
+extern bool option_timedemo;
+extern bool option_dedicated;
 extern bool shapes_file_is_m1();
 
 /* ----------- prototypes/PREPROCESS_MAP_MAC.C */
@@ -1196,7 +1199,7 @@ bool idle_game_state(uint32 time)
 		std::pair<bool, int16> theUpdateResult= update_world();
 		short ticks_elapsed= theUpdateResult.second;
 
-		if (get_keyboard_controller_status())
+		if (get_keyboard_controller_status() && !option_dedicated)
 		{
 			// ZZZ: I don't know for sure that render_screen works best with the number of _real_
 			// ticks elapsed rather than the number of (potentially predictive) ticks elapsed.
@@ -2093,6 +2096,9 @@ static bool begin_game(
 						load_film_profile(FILM_PROFILE_ALEPH_ONE_1_2);
 						break;
 					case RECORDING_VERSION_ALEPH_ONE_1_3:
+						load_film_profile(FILM_PROFILE_ALEPH_ONE_1_3);
+						break;
+					case RECORDING_VERSION_ALEPH_ONE_1_4:
 						load_film_profile(FILM_PROFILE_DEFAULT);
 						break;
 					default:
@@ -2351,7 +2357,9 @@ static void finish_game(
 
 		change_screen_mode(_screentype_menu);
 		force_system_colors();
-		display_net_game_stats();
+		// the postgame carnage report waits for a click nobody will make
+		if (!option_dedicated)
+			display_net_game_stats();
 		exit_networking();
 	} 
 	else
@@ -2454,6 +2462,26 @@ static void handle_network_game(
 #endif // !defined(DISABLE_NETWORKING)
 }
 
+// Gathers the given number of joiners with no dialogs and starts the game,
+// with the local player sitting out; returns false if it couldn't
+bool host_dedicated_network_game(
+	int player_count)
+{
+#if !defined(DISABLE_NETWORKING)
+	game_state.state= _displaying_network_game_dialogs;
+	if (network_gather_dedicated(player_count) && NetStart())
+	{
+		if (begin_game(_network_player, false))
+			return true;
+	}
+	else
+	{
+		display_main_menu();
+	}
+#endif // !defined(DISABLE_NETWORKING)
+	return false;
+}
+
 static void handle_save_film(
 	void)
 {
@@ -2726,7 +2754,7 @@ static void try_and_display_chapter_screen(
 	bool interface_table_is_valid,
 	bool text_block)
 {
-	if (Movie::instance()->IsRecording())
+	if (Movie::instance()->IsRecording() || option_timedemo || option_dedicated)
 		return;
 	
 	short pict_resource_number = get_screen_data(_display_chapter_heading)->screen_base + level;
@@ -3070,7 +3098,7 @@ extern bool option_nosound;
 
 void show_movie(short index)
 {
-	if (Movie::instance()->IsRecording())
+	if (Movie::instance()->IsRecording() || option_timedemo || option_dedicated)
 		return;
 	
 #if defined(HAVE_FFMPEG) || defined(HAVE_SMPEG)
@@ -259,6 +259,7 @@ void set_game_state(short new_state);
 short get_game_state(void);
 short get_game_controller(void);
 bool current_netgame_allows_microphone();
+bool host_dedicated_network_game(int player_count);
 void set_change_level_destination(short level_number);
 bool check_level_change(void);
 void pause_game(void);
@@ -379,6 +380,8 @@ void check_recording_replaying(void);
 bool has_recording_file(void);
 void increment_replay_speed(void);
 void decrement_replay_speed(void);
+void record_film_keyframe(void);
+bool seek_replay(int32 tick); /* replays keep keyframes, so this costs at most the time between two */
 void reset_recording_and_playback_queues(void);
 uint32 parse_keymap(void);
 
@@ -403,6 +406,7 @@ enum {	// Results for network_join
 };
 
 bool network_gather(bool inResumingGame);
+bool network_gather_dedicated(int inPlayerCount); /* gathers without dialogs, for a headless host */
 int network_join(void);
 
 /* ---------- prototypes/NETWORK_MICROPHONE.C */
@@ -98,6 +98,15 @@ Feb 20, 2002 (Woody Zenfell):
 #include "joystick.h"
 #include "Movie.h"
 #include "InfoTree.h"
+#include "game_wad.h"
+#include "wad.h"
+#include "flood_map.h"
+#include "monsters.h"
+#include "lua_script.h"
+#include "SoundManager.h"
+#include "crc.h"
+
+#include <vector>
 
 /* ---------- constants */
 
@@ -108,6 +117,8 @@ Feb 20, 2002 (Woody Zenfell):
 #define DISK_CACHE_SIZE             ((sizeof(int16)+sizeof(uint32))*100)
 #define MAXIMUM_REPLAY_SPEED         5
 #define MINIMUM_REPLAY_SPEED        -5
+#define FILM_KEYFRAME_INTERVAL      (30*TICKS_PER_SECOND) // to begin with; doubles when the list fills
+#define MAXIMUM_FILM_KEYFRAMES      128
 
 /* ---------- macros */
 
@@ -129,8 +140,32 @@ static timer_task_proc input_task;
 static FileSpecifier FilmFileSpec;
 static OpenedFile FilmFile;
 
+/* everything needed to pick a replay up again at a tick: the world as a saved game, plus what
+	the world doesn't know about, which is where the monsters were going and which flags had
+	been read from the film but not yet used */
+struct film_keyframe
+{
+	int32 tick;
+	struct wad_data *wad;
+	std::vector<byte> paths;
+	uint32 crc; // of the wad and the paths, to check a seek against
+	std::vector<uint32> recorded_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+	std::vector<uint32> queued_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+	std::vector<uint32> queued_lua_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+	int32 heartbeat_lead;
+	bool have_read_last_chunk;
+	int32 film_position; // of the file, or into the resource
+	std::vector<char> film_cache;
+};
+
+static std::vector<film_keyframe> film_keyframes; // in tick order
+static int32 film_keyframe_interval= FILM_KEYFRAME_INTERVAL;
+static int32 film_keyframe_checked_tick= NONE; // update_world() comes by more than once a tick
+
 struct replay_private_data replay;
 
+extern bool option_timedemo;
+
 #ifdef DEBUG
 ActionQueue *get_player_recording_queue(
 	short player_index)
@@ -149,6 +184,11 @@ static void read_recording_queue_chunks(void);
 static bool pull_flags_from_recording(short count);
 // LP modifications for object-oriented file handling; returns a test for end-of-file
 static bool vblFSRead(OpenedFile& File, int32 *count, void *dest, bool& HitEOF);
+static void discard_film_keyframes(void);
+static uint32 calculate_film_keyframe_crc(struct wad_data *wad, const std::vector<byte>& paths);
+static void verify_film_keyframe(const film_keyframe& keyframe);
+static bool restore_film_keyframe(const film_keyframe& keyframe);
+static void fast_forward_replay(int32 tick);
 static void record_action_flags(short player_identifier, const uint32 *action_flags, short count);
 static short get_recording_queue_size(short which_queue);
 
@@ -759,11 +799,286 @@ void stop_replay(
 		close_stream_file();
 #endif
 	}
+	discard_film_keyframes();
 
 	/* Unecessary, because reset_player_queues calls this. */
 	replay.valid= false;
 }
 
+/* ---------- film keyframes */
+
+static void copy_action_queues(
+	ActionQueues *queues,
+	std::vector<uint32> *flags)
+{
+	for (short player_index= 0; player_index<dynamic_world->player_count; player_index++)
+	{
+		unsigned int count= queues->countActionFlags(player_index);
+
+		flags[player_index].resize(count);
+		for (unsigned int index= 0; index<count; index++)
+		{
+			flags[player_index][index]= queues->peekActionFlags(player_index, index);
+		}
+	}
+}
+
+static void refill_action_queues(
+	ActionQueues *queues,
+	const std::vector<uint32> *flags)
+{
+	queues->reset();
+	for (short player_index= 0; player_index<dynamic_world->player_count; player_index++)
+	{
+		if (!flags[player_index].empty())
+		{
+			queues->enqueueActionFlags(player_index, flags[player_index].data(), static_cast<int>(flags[player_index].size()));
+		}
+	}
+}
+
+/* Called from update_world() between ticks, when nothing is half way into the game queue.
+	Coming back to the tick of a keyframe after a seek checks the world against it instead. */
+void record_film_keyframe(
+	void)
+{
+	int32 tick= dynamic_world->tick_count;
+	short player_index;
+
+	if (!replay.game_is_being_replayed) return;
+
+	/* nobody seeks a film that is being timed or exported */
+	if (option_timedemo || Movie::instance()->IsRecording()) return;
+
+	/* a script's state is more than a saved game keeps, and restoring one would run its init
+		again, so films with scripts only play forward */
+	if (LuaRunning()) return;
+
+	if (tick==film_keyframe_checked_tick) return;
+	film_keyframe_checked_tick= tick;
+
+	if (!film_keyframes.empty() && tick<film_keyframes.back().tick+film_keyframe_interval)
+	{
+		for (size_t index= film_keyframes.size(); index>0 && film_keyframes[index-1].tick>=tick; index--)
+		{
+			if (film_keyframes[index-1].tick==tick)
+			{
+				verify_film_keyframe(film_keyframes[index-1]);
+				break;
+			}
+		}
+		return;
+	}
+
+	film_keyframe keyframe;
+	keyframe.tick= tick;
+	keyframe.wad= build_film_keyframe_wad();
+	if (!keyframe.wad) return;
+
+	keyframe.paths.resize(get_paths_length());
+	get_paths(keyframe.paths.data());
+	keyframe.crc= calculate_film_keyframe_crc(keyframe.wad, keyframe.paths);
+
+	for (player_index= 0; player_index<dynamic_world->player_count; player_index++)
+	{
+		ActionQueue *queue= get_player_recording_queue(player_index);
+		short index= queue->read_index;
+
+		while (index!=queue->write_index)
+		{
+			keyframe.recorded_flags[player_index].push_back(queue->buffer[index]);
+			INCREMENT_QUEUE_COUNTER(index);
+		}
+	}
+	copy_action_queues(GetRealActionQueues(), keyframe.queued_flags);
+	copy_action_queues(GetLuaActionQueues(), keyframe.queued_lua_flags);
+	keyframe.heartbeat_lead= heartbeat_count-tick;
+
+	keyframe.have_read_last_chunk= replay.have_read_last_chunk;
+	if (replay.resource_data)
+	{
+		keyframe.film_position= replay.film_resource_offset;
+	}
+	else
+	{
+		FilmFile.GetPosition(keyframe.film_position);
+		keyframe.film_cache.assign(replay.location_in_cache, replay.location_in_cache+replay.bytes_in_cache);
+	}
+
+	film_keyframes.push_back(keyframe);
+
+	/* a long film keeps every other keyframe rather than all of them */
+	if (film_keyframes.size()>MAXIMUM_FILM_KEYFRAMES)
+	{
+		size_t kept= 0;
+
+		for (size_t index= 0; index<film_keyframes.size(); index++)
+		{
+			if (index&1)
+			{
+				free_wad(film_keyframes[index].wad);
+			}
+			else
+			{
+				film_keyframes[kept++]= film_keyframes[index];
+			}
+		}
+		film_keyframes.resize(kept);
+		film_keyframe_interval*= 2;
+	}
+}
+
+static uint32 calculate_film_keyframe_crc(
+	struct wad_data *wad,
+	const std::vector<byte>& paths)
+{
+	std::vector<byte> data(paths);
+
+	for (short index= 0; index<wad->tag_count; index++)
+	{
+		const struct tag_data& tag= wad->tag_data[index];
+		data.insert(data.end(), tag.data, tag.data+tag.length);
+	}
+
+	return calculate_data_crc(data.data(), static_cast<int32>(data.size()));
+}
+
+/* the world at a keyframe's tick, reached by seeking, should be the one the film had when it
+	played straight through to it */
+static void verify_film_keyframe(
+	const film_keyframe& keyframe)
+{
+	struct wad_data *wad= build_film_keyframe_wad();
+	if (!wad) return;
+
+	std::vector<byte> paths(get_paths_length());
+	get_paths(paths.data());
+
+	if (calculate_film_keyframe_crc(wad, paths)!=keyframe.crc)
+	{
+		logWarning("film out of sync after seeking: the world at tick %d differs from the keyframe", keyframe.tick);
+	}
+	free_wad(wad);
+}
+
+static void discard_film_keyframes(
+	void)
+{
+	for (size_t index= 0; index<film_keyframes.size(); index++)
+	{
+		free_wad(film_keyframes[index].wad);
+	}
+	film_keyframes.clear();
+	film_keyframe_interval= FILM_KEYFRAME_INTERVAL;
+	film_keyframe_checked_tick= NONE;
+}
+
+static bool restore_film_keyframe(
+	const film_keyframe& keyframe)
+{
+	short player_index;
+
+	if (!restore_film_keyframe_wad(keyframe.wad)) return false;
+	film_keyframe_checked_tick= NONE;
+
+	if (keyframe.paths.size()==get_paths_length())
+	{
+		set_paths(keyframe.paths.data());
+	}
+	else
+	{
+		/* MML changed the number of paths since; let the monsters look again */
+		initialize_monsters_for_new_level();
+		reset_paths();
+	}
+
+	for (player_index= 0; player_index<dynamic_world->player_count; player_index++)
+	{
+		ActionQueue *queue= get_player_recording_queue(player_index);
+		const std::vector<uint32>& flags= keyframe.recorded_flags[player_index];
+
+		queue->read_index= queue->write_index= 0;
+		for (size_t index= 0; index<flags.size(); index++)
+		{
+			queue->buffer[queue->write_index]= flags[index];
+			INCREMENT_QUEUE_COUNTER(queue->write_index);
+		}
+	}
+	refill_action_queues(GetRealActionQueues(), keyframe.queued_flags);
+	refill_action_queues(GetLuaActionQueues(), keyframe.queued_lua_flags);
+	heartbeat_count= dynamic_world->tick_count+keyframe.heartbeat_lead;
+
+	replay.have_read_last_chunk= keyframe.have_read_last_chunk;
+	if (replay.resource_data)
+	{
+		replay.film_resource_offset= keyframe.film_position;
+	}
+	else
+	{
+		FilmFile.SetPosition(keyframe.film_position);
+		if (!keyframe.film_cache.empty())
+		{
+			memcpy(replay.fsread_buffer, keyframe.film_cache.data(), keyframe.film_cache.size());
+		}
+		replay.location_in_cache= replay.fsread_buffer;
+		replay.bytes_in_cache= static_cast<int32>(keyframe.film_cache.size());
+	}
+
+	return true;
+}
+
+/* runs the world as fast as it will go, drawing nothing, until it reaches the tick */
+static void fast_forward_replay(
+	int32 tick)
+{
+	while (dynamic_world->tick_count<tick && get_game_state()==_game_in_progress)
+	{
+		if (dynamic_world->tick_count>=heartbeat_count)
+		{
+			if (!pull_flags_from_recording(1))
+			{
+				if (replay.have_read_last_chunk) break;
+
+				read_recording_queue_chunks();
+				if (!pull_flags_from_recording(1)) break;
+			}
+			heartbeat_count++;
+		}
+		update_world();
+	}
+
+	/* whatever started playing on the way is from the wrong moment */
+	SoundManager::instance()->StopAllSounds();
+}
+
+/* Seeking backward, or forward past a keyframe, starts from the latest keyframe before the tick;
+	otherwise the replay just runs ahead from where it is. Returns false if it couldn't get to the
+	tick, because there was no keyframe early enough or the level or the film ended first. */
+bool seek_replay(
+	int32 tick)
+{
+	if (!replay.game_is_being_replayed) return false;
+	if (tick<0) tick= 0;
+
+	size_t keyframe_index= film_keyframes.size();
+	for (size_t index= 0; index<film_keyframes.size() && film_keyframes[index].tick<=tick; index++)
+	{
+		keyframe_index= index;
+	}
+
+	/* a keyframe can't be restored over a running script without running its init again, so
+		with one the replay can only run ahead */
+	if (keyframe_index!=film_keyframes.size() && !LuaRunning() &&
+		(tick<dynamic_world->tick_count || film_keyframes[keyframe_index].tick>dynamic_world->tick_count))
+	{
+		if (!restore_film_keyframe(film_keyframes[keyframe_index])) return false;
+	}
+	if (tick<dynamic_world->tick_count) return false;
+
+	fast_forward_replay(tick);
+	return dynamic_world->tick_count>=tick;
+}
+
 static void read_recording_queue_chunks(
 	void)
 {
@@ -23,9 +23,14 @@
  *  Created by Woody Zenfell, III on Mon Sep 24 2001.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include "SDL_netx.h"
 
 #include <sys/types.h>
+#include <string.h>
 
 #if defined(WIN32)
 # define WIN32_LEAN_AND_MEAN
@@ -39,6 +44,7 @@
 #  define BSD_COMP 1 // This is required to get SIOC* under Solaris
 # endif
 # include <sys/ioctl.h>
+# include <errno.h>
 #endif
 
 // PREPROCESSOR MACROS
@@ -235,3 +241,62 @@ SDLNetxint_CollectBroadcastAddresses(UDPsocket inSocket) {
     return sNumberOfBroadcastAddresses;
 }
 #endif
+
+
+
+// recvmmsg() (Linux) fills many packets per call; elsewhere, we drain the socket one
+// SDLNet_UDP_Recv() at a time, which still saves a wakeup per datagram.
+int
+SDLNetx_UDP_RecvBatch(UDPsocket inSocket, UDPpacket** inPackets, int inCount) {
+#if defined(HAVE_RECVMMSG)
+    enum { kMaxBatch = 64 };
+    if(inCount > kMaxBatch)
+        inCount = kMaxBatch;
+
+    // XXX: this depends on intimate carnal knowledge of the SDL_net struct _UDPsocket,
+    // as do the broadcast routines above
+    int	theSocketFD = ((int*)inSocket)[1];
+    if(theSocketFD < 0)
+        return -1;
+
+    struct mmsghdr	theHeaders[kMaxBatch];
+    struct iovec	theVectors[kMaxBatch];
+    struct sockaddr_in	theAddresses[kMaxBatch];
+
+    memset(theHeaders, 0, sizeof(theHeaders[0]) * inCount);
+    for(int i = 0; i < inCount; i++) {
+        theVectors[i].iov_base		= inPackets[i]->data;
+        theVectors[i].iov_len		= inPackets[i]->maxlen;
+        theHeaders[i].msg_hdr.msg_iov	= &theVectors[i];
+        theHeaders[i].msg_hdr.msg_iovlen	= 1;
+        theHeaders[i].msg_hdr.msg_name	= &theAddresses[i];
+        theHeaders[i].msg_hdr.msg_namelen	= sizeof(theAddresses[i]);
+    }
+
+    int theResult = recvmmsg(theSocketFD, theHeaders, inCount, MSG_DONTWAIT, NULL);
+    if(theResult < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+    // SDL_net keeps addresses in network byte order, just as sockaddr_in does
+    for(int i = 0; i < theResult; i++) {
+        inPackets[i]->channel		= -1;
+        inPackets[i]->len		= theHeaders[i].msg_len;
+        inPackets[i]->status		= theHeaders[i].msg_len;
+        inPackets[i]->address.host	= theAddresses[i].sin_addr.s_addr;
+        inPackets[i]->address.port	= theAddresses[i].sin_port;
+    }
+
+    return theResult;
+#else
+    int	theCount = 0;
+    while(theCount < inCount) {
+        int theResult = SDLNet_UDP_Recv(inSocket, inPackets[theCount]);
+        if(theResult < 0)
+            return (theCount > 0) ? theCount : -1;
+        if(theResult == 0)
+            break;
+        theCount++;
+    }
+    return theCount;
+#endif
+}
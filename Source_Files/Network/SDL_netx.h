@@ -55,4 +55,14 @@ int	SDLNetx_DisableBroadcast(UDPsocket inSocket);
 int	SDLNetx_UDP_Broadcast(UDPsocket inSocket, UDPpacket* inPacket);
 
 
+// SDLNetx_UDP_RecvBatch - receive whatever datagrams are waiting on inSocket, up to inCount, with a
+//     single system call where the platform has one (recvmmsg)
+//   inputs: UDPsocket inSocket - the socket to receive on.  Channels are ignored.
+//           UDPpacket** inPackets - packets to receive into; their data and maxlen must be set up.
+//           int inCount - number of packets in inPackets
+//   outputs: return value - number of packets received; 0 if none were waiting; -1 on error
+//            inPackets[0..return value) - len and address filled in, as by SDLNet_UDP_Recv
+int	SDLNetx_UDP_RecvBatch(UDPsocket inSocket, UDPpacket** inPackets, int inCount);
+
+
 #endif//SDL_NETX_H
@@ -139,8 +139,12 @@ StarGameProtocol::Sync(NetTopology* inTopology, int32 inSmallestGameTick, size_t
 	else
 		sHubIsLocal = false;
 
+	// A host that isn't playing (see game_info) still runs a spoke, since
+	// everyone expects flags from the server player
+	bool theLocalPlayerObserves = sHubIsLocal && !sTopology->game_data.server_is_playing;
+
         spoke_initialize(sTopology->players[inServerPlayerIndex].ddpAddress, inSmallestGameTick, sTopology->player_count,
-                         sStarQueues, theConnectedPlayerStatus, inLocalPlayerIndex, sHubIsLocal);
+                         sStarQueues, theConnectedPlayerStatus, inLocalPlayerIndex, sHubIsLocal, theLocalPlayerObserves);
 
         *sNetStatePtr = netActive;
 
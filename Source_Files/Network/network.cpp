@@ -356,6 +356,7 @@ Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_co
 	mAcceptJoinMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleAcceptJoinMessage));
 	mChatMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleChatMessage));
 	mChangeColorsMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleChangeColorsMessage));
+	mCachedDataListMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleCachedDataListMessage));
 	mUnexpectedMessageHandler.reset(newMessageHandlerMethod(this, &Client::unexpectedMessageHandler));
 	mDispatcher->setDefaultHandler(mUnexpectedMessageHandler.get());
 	mDispatcher->setHandlerForType(mJoinerInfoMessageHandler.get(), JoinerInfoMessage::kType);
@@ -363,6 +364,7 @@ Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_co
 	mDispatcher->setHandlerForType(mAcceptJoinMessageHandler.get(), AcceptJoinMessage::kType);
 	mDispatcher->setHandlerForType(mChatMessageHandler.get(), NetworkChatMessage::kType);
 	mDispatcher->setHandlerForType(mChangeColorsMessageHandler.get(), ChangeColorsMessage::kType);
+	mDispatcher->setHandlerForType(mCachedDataListMessageHandler.get(), CachedDataListMessage::kType);
 	channel->setMessageHandler(mDispatcher.get());
 }
 
@@ -682,6 +684,14 @@ void Client::handleChangeColorsMessage(ChangeColorsMessage *changeColorsMessage,
 	}
 }
 
+void Client::handleCachedDataListMessage(CachedDataListMessage *cachedDataListMessage,
+					 CommunicationsChannel *)
+{
+	// the joiner sends these on connecting, and as it stores what we sent it,
+	// which may be after the game has started
+	cached_data.insert(cachedDataListMessage->mKeys.begin(), cachedDataListMessage->mKeys.end());
+}
+
 void Client::handleChatMessage(NetworkChatMessage* netChatMessage, 
 			       CommunicationsChannel *)
 {
@@ -742,6 +752,17 @@ void Client::unexpectedMessageHandler(Message *message, CommunicationsChannel *)
 
 
 static short handlerState;
+static bool gatherer_uses_data_cache = false;
+
+// the gatherer trusts us to have a blob only once we say it is stored
+static void store_in_network_data_cache(const byte *buffer, size_t length)
+{
+	network_data_key key = network_data_key_for(buffer, length);
+	if (network_data_cache_store(key, buffer, length)) {
+		CachedDataListMessage cachedDataListMessage(std::vector<network_data_key>(1, key));
+		connection_to_server->enqueueOutgoingMessage(cachedDataListMessage);
+	}
+}
 
 static void handleHelloMessage(HelloMessage* helloMessage, CommunicationsChannel*)
 {
@@ -784,6 +805,17 @@ static void handleCapabilitiesMessage(CapabilitiesMessage* capabilitiesMessage,
 			// everything else is version 1
 			CapabilitiesMessage capabilitiesMessageReply(my_capabilities);
 			connection_to_server->enqueueOutgoingMessage(capabilitiesMessageReply);
+
+			// tell the gatherer which maps and physics it needn't send
+			gatherer_uses_data_cache = (capabilities[Capabilities::kDataCache] >= Capabilities::kDataCacheVersion);
+			if (gatherer_uses_data_cache) {
+				std::vector<network_data_key> keys;
+				network_data_cache_keys(keys);
+				if (keys.size()) {
+					CachedDataListMessage cachedDataListMessage(keys);
+					connection_to_server->enqueueOutgoingMessage(cachedDataListMessage);
+				}
+			}
 		}
 		
 	} else {
@@ -873,6 +905,8 @@ static void handleMapMessage(BigChunkOfDataMessage *mapMessage, CommunicationsCh
 		if (handlerMapLength > 0) {
 			handlerMapBuffer = reinterpret_cast<byte*>(malloc(handlerMapLength));
 			memcpy(handlerMapBuffer, mapMessage->buffer(), handlerMapLength);
+			if (gatherer_uses_data_cache)
+				store_in_network_data_cache(handlerMapBuffer, handlerMapLength);
 		}
 	} else {
 		logAnomaly("unexpected map message received (netState is %i)", netState);
@@ -935,12 +969,37 @@ static void handlePhysicsMessage(BigChunkOfDataMessage *physicsMessage, Communic
 		if (handlerPhysicsLength > 0) {
 			handlerPhysicsBuffer = reinterpret_cast<byte*>(malloc(handlerPhysicsLength));
 			memcpy(handlerPhysicsBuffer, physicsMessage->buffer(), handlerPhysicsLength);
+			if (gatherer_uses_data_cache)
+				store_in_network_data_cache(handlerPhysicsBuffer, handlerPhysicsLength);
 		}
 	} else {
 		logAnomaly("unexpected physics message received (netState is %i)", netState);
 	}
 }
 
+static void handleCachedDataMessage(CachedDataMessage *cachedDataMessage, CommunicationsChannel *channel) {
+	if (netState == netStartingUp || netState == netDown) {
+		byte *buffer = network_data_cache_load(cachedDataMessage->key());
+		if (!buffer) {
+			// the gatherer will send the data itself
+			logNote("gatherer sent a key for %s data that is not in the cache", cachedDataMessage->kind() == CachedDataMessage::kMap ? "map" : "physics");
+		}
+
+		CachedDataReplyMessage cachedDataReplyMessage(cachedDataMessage->key(), buffer != NULL);
+		channel->enqueueOutgoingMessage(cachedDataReplyMessage);
+
+		byte **handlerBuffer = (cachedDataMessage->kind() == CachedDataMessage::kMap) ? &handlerMapBuffer : &handlerPhysicsBuffer;
+		size_t *handlerLength = (cachedDataMessage->kind() == CachedDataMessage::kMap) ? &handlerMapLength : &handlerPhysicsLength;
+		if (*handlerBuffer) {
+			free(*handlerBuffer);
+		}
+		*handlerBuffer = buffer;
+		*handlerLength = buffer ? cachedDataMessage->key().length : 0;
+	} else {
+		logAnomaly("unexpected cached data message received (netState is %i)", netState);
+	}
+}
+
 /*
 static void handleScriptMessage(ScriptMessage* scriptMessage, CommunicationsChannel*) {
   if (netState == netJoining) {
@@ -1058,6 +1117,7 @@ static TypedMessageHandlerFunction<ServerWarningMessage> serverWarningMessageHan
 static TypedMessageHandlerFunction<ClientInfoMessage> clientInfoMessageHandler(&handleClientInfoMessage);
 static TypedMessageHandlerFunction<NetworkStatsMessage> networkStatsMessageHandler(&handleNetworkStatsMessage);
 static TypedMessageHandlerFunction<GameSessionMessage> gameSessionMessageHandler(&handleGameSessionMessage);
+static TypedMessageHandlerFunction<CachedDataMessage> cachedDataMessageHandler(&handleCachedDataMessage);
 static TypedMessageHandlerFunction<Message> unexpectedMessageHandler(&handleUnexpectedMessage);
 
 void NetSetGatherCallbacks(GatherCallbacks *gc) {
@@ -1197,6 +1257,9 @@ bool NetEnter(void)
 		inflater->learnPrototype(ClientInfoMessage());
 		inflater->learnPrototype(NetworkStatsMessage());
 		inflater->learnPrototype(GameSessionMessage());
+		inflater->learnPrototype(CachedDataListMessage());
+		inflater->learnPrototype(CachedDataMessage());
+		inflater->learnPrototype(CachedDataReplyMessage());
 	}
   
 	if (!joinDispatcher) {
@@ -1218,6 +1281,7 @@ bool NetEnter(void)
 		joinDispatcher->setHandlerForType(&topologyMessageHandler, TopologyMessage::kType);
 		joinDispatcher->setHandlerForType(&networkStatsMessageHandler, NetworkStatsMessage::kType);
 		joinDispatcher->setHandlerForType(&gameSessionMessageHandler, GameSessionMessage::kType);
+		joinDispatcher->setHandlerForType(&cachedDataMessageHandler, CachedDataMessage::kType);
 	}
 
 	my_capabilities.clear();
@@ -1236,6 +1300,7 @@ bool NetEnter(void)
 	my_capabilities[Capabilities::kZippedData] = Capabilities::kZippedDataVersion;
 	my_capabilities[Capabilities::kNetworkStats] = Capabilities::kNetworkStatsVersion;
 	my_capabilities[Capabilities::kRugby] = Capabilities::kRugbyVersion;
+	my_capabilities[Capabilities::kDataCache] = Capabilities::kDataCacheVersion;
 
 	// net commands!
 	sIgnoredPlayers.clear();
@@ -2000,6 +2065,85 @@ void SetNetscriptStatus (bool status)
         do_netscript = status;
 }
 
+// how long a joiner has to say whether it could load a cached blob, in ms
+static const Uint32 kCachedDataReplyTimeout = 30000;
+
+// Joiners that have announced this blob are sent its key instead, and say
+// whether they could load it; the rest, and any that couldn't, get the data,
+// zipped if they can take it.
+template <typename tZippedMessage, typename tMessage>
+static void distribute_cacheable_game_data(const std::vector<Client *>& clients, byte *buffer, int32 length, CachedDataMessage::Kind kind)
+{
+	network_data_key key = network_data_key_for(buffer, length);
+
+	std::vector<Client *> cachedClients;
+	std::vector<CommunicationsChannel *> cachedChannels;
+	for (std::vector<Client *>::const_iterator it = clients.begin(); it != clients.end(); ++it)
+	{
+		Client *client = *it;
+		if (client->capabilities[Capabilities::kDataCache] >= Capabilities::kDataCacheVersion && client->cached_data.count(key))
+		{
+			cachedClients.push_back(client);
+			cachedChannels.push_back(client->channel);
+		}
+	}
+
+	if (cachedChannels.size())
+	{
+		CachedDataMessage cachedDataMessage(kind, key);
+		std::for_each(cachedChannels.begin(), cachedChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, cachedDataMessage));
+		CommunicationsChannel::multipleFlushOutgoingMessages(cachedChannels, false, kCachedDataReplyTimeout, kCachedDataReplyTimeout);
+
+		for (std::vector<Client *>::const_iterator it = cachedClients.begin(); it != cachedClients.end(); ++it)
+		{
+			Client *client = *it;
+			std::unique_ptr<CachedDataReplyMessage> reply(client->channel->receiveSpecificMessage<CachedDataReplyMessage>(kCachedDataReplyTimeout, kCachedDataReplyTimeout));
+			if (!reply.get() || !(reply->key() == key) || !reply->loaded())
+			{
+				// it has lost it; stop trusting the key until it is
+				// stored again
+				logNote("a joiner could not load cached %s data; sending it", kind == CachedDataMessage::kMap ? "map" : "physics");
+				client->cached_data.erase(key);
+			}
+		}
+	}
+
+	std::vector<CommunicationsChannel *> zipCapableChannels;
+	std::vector<CommunicationsChannel *> zipIncapableChannels;
+	for (std::vector<Client *>::const_iterator it = clients.begin(); it != clients.end(); ++it)
+	{
+		Client *client = *it;
+		if (client->capabilities[Capabilities::kDataCache] >= Capabilities::kDataCacheVersion && client->cached_data.count(key))
+		{
+			continue;
+		}
+		else if (client->capabilities[Capabilities::kZippedData] >= my_capabilities[Capabilities::kZippedData])
+		{
+			zipCapableChannels.push_back(client->channel);
+		}
+		else
+		{
+			zipIncapableChannels.push_back(client->channel);
+		}
+	}
+
+	if (zipCapableChannels.size())
+	{
+		tZippedMessage zippedMessage(buffer, length);
+		// zipped messages are compressed when deflated
+		// since we may have to send this to multiple joiners,
+		// deflate it now so that compression only happens once
+		std::unique_ptr<UninflatedMessage> uninflatedMessage(zippedMessage.deflate());
+		std::for_each(zipCapableChannels.begin(), zipCapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, *uninflatedMessage));
+	}
+
+	if (zipIncapableChannels.size())
+	{
+		tMessage message(buffer, length);
+		std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, message));
+	}
+}
+
 // ZZZ this "ought" to distribute to all players simultaneously (by interleaving send calls)
 // in case the server bandwidth is much greater than the others' bandwidths.  But that would
 // take a fair amount of reworking of the streaming system, which only groks talking with one
@@ -2028,6 +2172,7 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 		physics_buffer= (unsigned char *)get_network_physics_buffer(&physics_length);
 	
 	// build a list of players to send to
+	std::vector<Client *> clients;
 	std::vector<CommunicationsChannel *> channels;
 
 	// also a list of who and who can not take compressed data
@@ -2043,6 +2188,7 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 		if (!player.net_dead && player.identifier != NONE && playerIndex != localPlayerIndex) 
 		{
 			Client *client = connections_to_clients[player.stream_id];
+			clients.push_back(client);
 			channels.push_back(client->channel);
 			if (client->capabilities[Capabilities::kZippedData] >= my_capabilities[Capabilities::kZippedData])
 			{
@@ -2062,38 +2208,10 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 	
 	if (physics_buffer)
 	{
-		if (zipCapableChannels.size())
-		{
-			ZippedPhysicsMessage zippedPhysicsMessage(physics_buffer, physics_length);
-			std::unique_ptr<UninflatedMessage> uninflatedMessage(zippedPhysicsMessage.deflate());
-			std::for_each(zipCapableChannels.begin(), zipCapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, *uninflatedMessage));
-		}
-
-		if (zipIncapableChannels.size())
-		{
-			PhysicsMessage physicsMessage(physics_buffer, physics_length);
-			std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, physicsMessage));
-		}
+		distribute_cacheable_game_data<ZippedPhysicsMessage, PhysicsMessage>(clients, physics_buffer, physics_length, CachedDataMessage::kPhysics);
 	}
 	
-	{
-		// send zipped map to anyone who can accept it
-		if (zipCapableChannels.size())
-		{
-			ZippedMapMessage zippedMapMessage(wad_buffer, wad_length);
-			// zipped messages are compressed when deflated
-			// since we may have to send this to multiple joiners,
-			// deflate it now so that compression only happens once
-			std::unique_ptr<UninflatedMessage> uninflatedMessage(zippedMapMessage.deflate());
-			std::for_each(zipCapableChannels.begin(), zipCapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, *uninflatedMessage));
-		}
-
-		if (zipIncapableChannels.size())
-		{
-			MapMessage mapMessage(wad_buffer, wad_length);
-			std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, mapMessage));
-		}
-	}
+	distribute_cacheable_game_data<ZippedMapMessage, MapMessage>(clients, wad_buffer, wad_length, CachedDataMessage::kMap);
 
 	if (do_netscript)
 	{
@@ -0,0 +1,196 @@
+/*
+ *  network_data_cache.cpp -- joiner-side disk cache of maps and physics
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+*/
+
+#include "network_data_cache.h"
+
+#include "crc.h"
+#include "FileHandler.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// a rotation of maps plus a few physics models; a file is a few hundred
+// kilobytes to a few megabytes
+enum { kMaximumCachedBlobs = 48 };
+
+// a partial file this old was left by a write that will never finish; a
+// younger one may still be being written by another copy of the game
+enum { kAbandonedWriteAge = 60 * 60 };
+
+static const char *kCacheDirectoryName = "Network Cache";
+
+// partial files are named <key name>.part-<random>
+static const char *kPartialFileMarker = ".part-";
+
+static DirectorySpecifier cache_directory()
+{
+	DirectorySpecifier dir;
+	dir.SetToLocalDataDir();
+	dir.AddPart(kCacheDirectoryName);
+	return dir;
+}
+
+static std::string name_for_key(const network_data_key& key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%08x-%u", key.crc, key.length);
+	return name;
+}
+
+static bool key_for_name(const std::string& name, network_data_key& key)
+{
+	unsigned int crc, length;
+	int consumed = 0;
+	if (sscanf(name.c_str(), "%8x-%u%n", &crc, &length, &consumed) != 2 || consumed != static_cast<int>(name.size()))
+		return false;
+
+	key.crc = crc;
+	key.length = length;
+	return true;
+}
+
+network_data_key network_data_key_for(const byte *buffer, size_t length)
+{
+	network_data_key key;
+	key.crc = calculate_data_crc(const_cast<byte *>(buffer), static_cast<int32>(length));
+	key.length = static_cast<uint32>(length);
+	return key;
+}
+
+bool network_data_cache_store(const network_data_key& key, const byte *buffer, size_t length)
+{
+	if (!buffer || !length)
+		return false;
+
+	DirectorySpecifier dir = cache_directory();
+	if (!dir.Exists() && !dir.CreateDirectory())
+	{
+		logWarning("could not create network cache directory");
+		return false;
+	}
+
+	FileSpecifier file = dir;
+	file.AddPart(name_for_key(key));
+	if (file.Exists())
+		return true;
+
+	// write under a temporary name so a partial file is never mistaken for
+	// a cached blob
+	FileSpecifier partial = dir;
+	partial.AddPart(name_for_key(key) + kPartialFileMarker);
+	FileSpecifier temp;
+	temp.SetTempName(partial);
+	if (!temp.Create(_typecode_unknown))
+		return false;
+
+	bool written = false;
+	{
+		OpenedFile of;
+		if (temp.Open(of, true))
+			written = of.Write(static_cast<int32>(length), const_cast<byte *>(buffer));
+	}
+
+	if (!written || !temp.Rename(file))
+	{
+		logWarning("could not write %s to network cache", file.GetPath());
+		temp.Delete();
+		return false;
+	}
+
+	return true;
+}
+
+byte *network_data_cache_load(const network_data_key& key)
+{
+	FileSpecifier file = cache_directory();
+	file.AddPart(name_for_key(key));
+
+	OpenedFile of;
+	if (!file.Open(of))
+		return NULL;
+
+	int32 length;
+	if (!of.GetLength(length) || static_cast<uint32>(length) != key.length)
+		return NULL;
+
+	byte *buffer = reinterpret_cast<byte *>(malloc(length));
+	if (!buffer)
+		return NULL;
+
+	if (!of.Read(length, buffer) || !(network_data_key_for(buffer, length) == key))
+	{
+		logWarning("discarding damaged network cache entry %s", file.GetPath());
+		free(buffer);
+		of.Close();
+		file.Delete();
+		return NULL;
+	}
+
+	return buffer;
+}
+
+static bool newer_entry(const dir_entry& a, const dir_entry& b)
+{
+	return a.date > b.date;
+}
+
+void network_data_cache_keys(std::vector<network_data_key>& keys)
+{
+	keys.clear();
+
+	DirectorySpecifier dir = cache_directory();
+	std::vector<dir_entry> entries;
+	if (!dir.ReadDirectory(entries))
+		return;
+
+	std::sort(entries.begin(), entries.end(), newer_entry);
+	time_t now = time(NULL);
+	for (std::vector<dir_entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+	{
+		if (it->is_directory)
+			continue;
+
+		// keep the newest blobs, and partial files until they are
+		// abandoned; leave anything else alone
+		network_data_key key;
+		bool remove;
+		if (key_for_name(it->name, key))
+		{
+			remove = keys.size() >= kMaximumCachedBlobs;
+			if (!remove)
+				keys.push_back(key);
+		}
+		else
+		{
+			remove = it->name.find(kPartialFileMarker) != std::string::npos && now - it->date > kAbandonedWriteAge;
+		}
+
+		if (remove)
+		{
+			FileSpecifier file = dir;
+			file.AddPart(it->name);
+			file.Delete();
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ *  network_data_cache.h -- joiner-side disk cache of maps and physics
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Maps and physics received from a gatherer are kept in the local data
+	directory, named by the CRC and length of the blob as transferred. A
+	joiner announces what it has when it connects, and each blob it stores
+	afterwards; the gatherer sends only the key for blobs the joiner has
+	announced, and sends the blob itself if the joiner then can't load it.
+*/
+
+#ifndef NETWORK_DATA_CACHE_H
+#define NETWORK_DATA_CACHE_H
+
+#include "cseries.h"
+
+#include <vector>
+
+struct network_data_key
+{
+	uint32 crc;
+	uint32 length;
+
+	bool operator<(const network_data_key& other) const {
+		return crc < other.crc || (crc == other.crc && length < other.length);
+	}
+	bool operator==(const network_data_key& other) const {
+		return crc == other.crc && length == other.length;
+	}
+};
+
+network_data_key network_data_key_for(const byte *buffer, size_t length);
+
+// writes the blob, whose key is key, to the cache unless it is already there;
+// whether it is there now
+bool network_data_cache_store(const network_data_key& key, const byte *buffer, size_t length);
+
+// returns a malloc()ed copy of the cached blob, or NULL if it is missing
+// or does not match its key
+byte *network_data_cache_load(const network_data_key& key);
+
+// lists the cached blobs, first trimming the cache to its size limit
+void network_data_cache_keys(std::vector<network_data_key>& keys);
+
+#endif
@@ -283,6 +283,72 @@ bool network_gather(bool inResumingGame)
 	return successful;
 }
 
+static void game_information_from_preferences(player_info *player_information, game_info *game_information, const network_preferences_data *active_network_preferences, bool resuming_game, bool server_is_playing);
+
+// Reports joins to stdout; a dedicated host has nobody watching a dialog
+class DedicatedGatherCallbacks : public GatherCallbacks
+{
+public:
+	DedicatedGatherCallbacks(int inPlayerCount) : mPlayerCount(inPlayerCount) { }
+
+	void JoinSucceeded(const prospective_joiner_info *player) {
+		printf("%s joined (%d of %d players)\n", player->name, NetGetNumberOfPlayers() - 1, mPlayerCount);
+	}
+	void JoiningPlayerDropped(const prospective_joiner_info *player) { }
+	void JoinedPlayerDropped(const prospective_joiner_info *player) {
+		printf("a player dropped (%d of %d players)\n", NetGetNumberOfPlayers() - 1, mPlayerCount);
+	}
+
+private:
+	int mPlayerCount;
+};
+
+bool network_gather_dedicated(int inPlayerCount)
+{
+	game_info myGameInfo;
+	player_info myPlayerInfo;
+
+	// the gatherer's own player sits the game out (see server_is_playing)
+	game_information_from_preferences(&myPlayerInfo, &myGameInfo, network_preferences, false, false);
+	myPlayerInfo.desired_color= myPlayerInfo.color;
+	memset(myPlayerInfo.long_serial_number, 0, LONG_SERIAL_NUMBER_LENGTH);
+
+	if (!NetEnter())
+		return false;
+
+	if (!NetGather(&myGameInfo, sizeof(game_info), (void*) &myPlayerInfo, sizeof(myPlayerInfo), false))
+	{
+		NetExit();
+		return false;
+	}
+
+	DedicatedGatherCallbacks callbacks(inPlayerCount);
+	NetSetGatherCallbacks(&callbacks);
+
+	printf("Waiting for %d players to join %s\n", inPlayerCount, myGameInfo.level_name);
+
+	{
+		GathererAvailableAnnouncer announcer;
+
+		// joiners are gathered as they show up, as with autogather; the
+		// game starts once enough of them have accepted
+		while (NetGetNumberOfPlayers() < inPlayerCount + 1)
+		{
+			GathererAvailableAnnouncer::pump();
+
+			prospective_joiner_info info;
+			if (NetCheckForNewJoiner(info))
+				NetGatherPlayer(info, reassign_player_colors);
+
+			SDL_Delay(10);
+		}
+	}
+
+	NetSetGatherCallbacks(NULL);
+	NetDoneGathering();
+	return true;
+}
+
 GatherDialog::GatherDialog() {  }
 
 GatherDialog::~GatherDialog()
@@ -1040,6 +1106,96 @@ SetupNetgameDialog::~SetupNetgameDialog ()
 
 extern int32& hub_get_minimum_send_period();
 
+// fills in the game and the gatherer's player from the network preferences
+static void game_information_from_preferences (
+	player_info *player_information,
+	game_info *game_information,
+	const network_preferences_data *active_network_preferences,
+	bool resuming_game,
+	bool server_is_playing)
+{
+	strncpy (player_information->name, player_preferences->name, MAX_NET_PLAYER_NAME_LENGTH+1);
+	player_information->color = player_preferences->color;
+	player_information->team = player_preferences->team;
+
+	game_information->server_is_playing = server_is_playing;
+	game_information->net_game_type = active_network_preferences->game_type;
+	
+	game_information->game_options = active_network_preferences->game_options;
+	game_information->game_options |= (_ammo_replenishes | _weapons_replenish | _specials_replenish);
+	if (active_network_preferences->game_type == _game_of_cooperative_play)
+		game_information->game_options |= _overhead_map_is_omniscient;
+
+	// ZZZ: don't screw with the limits if resuming.
+	if (resuming_game)
+	{
+		game_information->time_limit = dynamic_world->game_information.game_time_remaining;
+		game_information->kill_limit = dynamic_world->game_information.kill_limit;
+	} else {
+		if (!active_network_preferences->game_is_untimed)
+			game_information->time_limit = active_network_preferences->time_limit;
+		else
+			game_information->time_limit = INT32_MAX;
+		
+		game_information->kill_limit = active_network_preferences->kill_limit;
+	}
+	
+	entry_point entry;
+	menu_index_to_level_entry (active_network_preferences->entry_point, NONE, &entry);
+	game_information->level_number = entry.level_number;
+	strncpy (game_information->level_name, entry.level_name, MAX_LEVEL_NAME_LENGTH+1);
+	game_information->parent_checksum = read_wad_file_checksum(get_map_file());
+	game_information->difficulty_level = active_network_preferences->difficulty_level;
+	game_information->allow_mic = active_network_preferences->allow_microphone;
+
+	int updates_per_packet = 1;
+	int update_latency = 0;
+	vassert(updates_per_packet > 0 && update_latency >= 0 && updates_per_packet < 16,
+		csprintf(temporary, "You idiot! updates_per_packet = %d, update_latency = %d", updates_per_packet, update_latency));
+	game_information->initial_updates_per_packet = updates_per_packet;
+	game_information->initial_update_latency = update_latency;
+	NetSetInitialParameters(updates_per_packet, update_latency);
+
+	game_information->initial_random_seed = resuming_game ? dynamic_world->random_seed : (uint16) machine_tick_count();
+
+#if mac
+	FileSpecifier theNetscriptFile;
+	theNetscriptFile.SetSpec (active_network_preferences->netscript_file);
+#else
+	FileSpecifier theNetscriptFile (active_network_preferences->netscript_file);
+#endif
+
+	// This will be set true below if appropriate
+	SetNetscriptStatus(false);
+
+	if (active_network_preferences->use_netscript)
+	{
+		OpenedFile script_file;
+
+		if (theNetscriptFile.Open (script_file))
+		{
+			int32 script_length;
+			script_file.GetLength (script_length);
+
+			// DeferredScriptSend will delete this storage the *next time* we call it (!)
+			byte* script_buffer = new byte [script_length];
+		
+			if (script_file.Read (script_length, script_buffer))
+			{
+				DeferredScriptSend (script_buffer, script_length);
+				SetNetscriptStatus (true);
+			}
+		
+			script_file.Close ();
+		}
+		else
+			// hmm failing quietly is probably not the best course of action, but ...
+			;
+	}
+
+	game_information->cheat_flags = active_network_preferences->cheat_flags;
+}
+
 bool SetupNetgameDialog::SetupNetworkGameByRunning (
 	player_info *player_information,
 	game_info *game_information,
@@ -1213,86 +1369,7 @@ bool SetupNetgameDialog::SetupNetworkGameByRunning (
 		// migrate widget settings to preferences structure
 		binders.migrate_all_first_to_second ();
 	
-		strncpy (player_information->name, player_preferences->name, MAX_NET_PLAYER_NAME_LENGTH+1);
-		player_information->color = player_preferences->color;
-		player_information->team = player_preferences->team;
-
-		game_information->server_is_playing = true;
-		game_information->net_game_type = active_network_preferences->game_type;
-		
-		game_information->game_options = active_network_preferences->game_options;
-		game_information->game_options |= (_ammo_replenishes | _weapons_replenish | _specials_replenish);
-		if (active_network_preferences->game_type == _game_of_cooperative_play)
-			game_information->game_options |= _overhead_map_is_omniscient;
-
-		// ZZZ: don't screw with the limits if resuming.
-		if (resuming_game)
-		{
-			game_information->time_limit = dynamic_world->game_information.game_time_remaining;
-			game_information->kill_limit = dynamic_world->game_information.kill_limit;
-		} else {
-			if (!active_network_preferences->game_is_untimed)
-				game_information->time_limit = m_timeLimitWidget->get_value () * TICKS_PER_SECOND * 60;
-			else
-				game_information->time_limit = INT32_MAX;
-			
-			game_information->kill_limit = active_network_preferences->kill_limit;
-		}
-		
-		entry_point entry;
-		menu_index_to_level_entry (active_network_preferences->entry_point, NONE, &entry);
-		game_information->level_number = entry.level_number;
-		strncpy (game_information->level_name, entry.level_name, MAX_LEVEL_NAME_LENGTH+1);
-		game_information->parent_checksum = read_wad_file_checksum(get_map_file());
-		game_information->difficulty_level = active_network_preferences->difficulty_level;
-		game_information->allow_mic = active_network_preferences->allow_microphone;
-
-		int updates_per_packet = 1;
-		int update_latency = 0;
-		vassert(updates_per_packet > 0 && update_latency >= 0 && updates_per_packet < 16,
-			csprintf(temporary, "You idiot! updates_per_packet = %d, update_latency = %d", updates_per_packet, update_latency));
-		game_information->initial_updates_per_packet = updates_per_packet;
-		game_information->initial_update_latency = update_latency;
-		NetSetInitialParameters(updates_per_packet, update_latency);
-	
-		game_information->initial_random_seed = resuming_game ? dynamic_world->random_seed : (uint16) machine_tick_count();
-
-#if mac
-		FileSpecifier theNetscriptFile;
-		theNetscriptFile.SetSpec (active_network_preferences->netscript_file);
-#else
-		FileSpecifier theNetscriptFile (active_network_preferences->netscript_file);
-#endif
-
-		// This will be set true below if appropriate
-		SetNetscriptStatus(false);
-	
-		if (active_network_preferences->use_netscript)
-		{
-			OpenedFile script_file;
-
-			if (theNetscriptFile.Open (script_file))
-			{
-				int32 script_length;
-				script_file.GetLength (script_length);
-
-				// DeferredScriptSend will delete this storage the *next time* we call it (!)
-				byte* script_buffer = new byte [script_length];
-			
-				if (script_file.Read (script_length, script_buffer))
-				{
-					DeferredScriptSend (script_buffer, script_length);
-					SetNetscriptStatus (true);
-				}
-			
-				script_file.Close ();
-			}
-			else
-				// hmm failing quietly is probably not the best course of action, but ...
-				;
-		}
-	
-		game_information->cheat_flags = active_network_preferences->cheat_flags;
+		game_information_from_preferences (player_information, game_information, active_network_preferences, resuming_game, true);
 
 		outAdvertiseGameOnMetaserver = active_network_preferences->advertise_on_metaserver;
 
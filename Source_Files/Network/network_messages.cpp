@@ -270,6 +270,65 @@ bool NetworkStatsMessage::reallyInflateFrom(AIStream& inputStream) {
 	return true;
 }
 
+void CachedDataListMessage::reallyDeflateTo(AOStream& outputStream) const {
+	for (std::vector<network_data_key>::const_iterator it = mKeys.begin(); it != mKeys.end(); ++it)
+	{
+		outputStream << it->crc;
+		outputStream << it->length;
+	}
+}
+
+bool CachedDataListMessage::reallyInflateFrom(AIStream& inputStream) {
+	while (inputStream.maxg() > inputStream.tellg())
+	{
+		network_data_key key;
+		inputStream >> key.crc;
+		inputStream >> key.length;
+
+		mKeys.push_back(key);
+	}
+	return true;
+}
+
+void CachedDataMessage::reallyDeflateTo(AOStream& outputStream) const {
+	outputStream << (int16) mKind;
+	outputStream << mKey.crc;
+	outputStream << mKey.length;
+}
+
+bool CachedDataMessage::reallyInflateFrom(AIStream& inputStream) {
+	int16 kind;
+	inputStream >> kind;
+	switch (kind) {
+		case kMap:
+			mKind = kMap;
+			break;
+		case kPhysics:
+			mKind = kPhysics;
+			break;
+		default:
+			return false;
+	}
+	inputStream >> mKey.crc;
+	inputStream >> mKey.length;
+	return true;
+}
+
+void CachedDataReplyMessage::reallyDeflateTo(AOStream& outputStream) const {
+	outputStream << mKey.crc;
+	outputStream << mKey.length;
+	outputStream << (uint8) mLoaded;
+}
+
+bool CachedDataReplyMessage::reallyInflateFrom(AIStream& inputStream) {
+	uint8 loaded;
+	inputStream >> mKey.crc;
+	inputStream >> mKey.length;
+	inputStream >> loaded;
+	mLoaded = (loaded != 0);
+	return true;
+}
+
 void ServerWarningMessage::reallyDeflateTo(AOStream& outputStream) const {
   outputStream << (uint16) mReason;
   write_string(outputStream, mString.c_str());
@@ -30,8 +30,11 @@
 #include "SDL_net.h"
 
 #include "network_capabilities.h"
+#include "network_data_cache.h"
 #include "network_private.h"
 
+#include <set>
+
 enum {
   kHELLO_MESSAGE = 700,
   kJOINER_INFO_MESSAGE,
@@ -52,7 +55,10 @@ enum {
   kZIPPED_PHYSICS_MESSAGE,
   kZIPPED_LUA_MESSAGE,
   kNETWORK_STATS_MESSAGE,
-  kGAME_SESSION_MESSAGE
+  kGAME_SESSION_MESSAGE,
+  kCACHED_DATA_LIST_MESSAGE,
+  kCACHED_DATA_MESSAGE,
+  kCACHED_DATA_REPLY_MESSAGE
 };
 
 template <MessageTypeID tMessageType, typename tValueType>
@@ -359,6 +365,86 @@ protected:
 	bool reallyInflateFrom(AIStream& inputStream);
 };
 
+// joiner to gatherer: the maps and physics I already have, sent on connecting
+// and again for each blob stored as it arrives
+class CachedDataListMessage : public SmallMessageHelper
+{
+public:
+	enum { kType = kCACHED_DATA_LIST_MESSAGE };
+
+	CachedDataListMessage() : SmallMessageHelper() { }
+	CachedDataListMessage(const std::vector<network_data_key>& keys) : SmallMessageHelper(), mKeys(keys) { }
+
+	CachedDataListMessage* clone() const {
+		return new CachedDataListMessage(*this);
+	}
+
+	MessageTypeID type() const { return kType; }
+
+	std::vector<network_data_key> mKeys;
+protected:
+	void reallyDeflateTo(AOStream& outputStream) const;
+	bool reallyInflateFrom(AIStream& inputStream);
+};
+
+// gatherer to joiner: load this map or physics from your cache
+class CachedDataMessage : public SmallMessageHelper
+{
+public:
+	enum { kType = kCACHED_DATA_MESSAGE };
+
+	enum Kind {
+		kMap,
+		kPhysics
+	};
+
+	CachedDataMessage() : SmallMessageHelper() { }
+	CachedDataMessage(Kind kind, const network_data_key& key) : SmallMessageHelper(), mKind(kind), mKey(key) { }
+
+	CachedDataMessage* clone() const {
+		return new CachedDataMessage(*this);
+	}
+
+	MessageTypeID type() const { return kType; }
+	Kind kind() const { return mKind; }
+	const network_data_key& key() const { return mKey; }
+
+protected:
+	void reallyDeflateTo(AOStream& outputStream) const;
+	bool reallyInflateFrom(AIStream& inputStream);
+
+private:
+	Kind mKind = kMap;
+	network_data_key mKey = {};
+};
+
+// joiner to gatherer: whether a CachedDataMessage could be loaded; if not,
+// the gatherer sends the data itself
+class CachedDataReplyMessage : public SmallMessageHelper
+{
+public:
+	enum { kType = kCACHED_DATA_REPLY_MESSAGE };
+
+	CachedDataReplyMessage() : SmallMessageHelper() { }
+	CachedDataReplyMessage(const network_data_key& key, bool loaded) : SmallMessageHelper(), mKey(key), mLoaded(loaded) { }
+
+	CachedDataReplyMessage* clone() const {
+		return new CachedDataReplyMessage(*this);
+	}
+
+	MessageTypeID type() const { return kType; }
+	const network_data_key& key() const { return mKey; }
+	bool loaded() const { return mLoaded; }
+
+protected:
+	void reallyDeflateTo(AOStream& outputStream) const;
+	bool reallyInflateFrom(AIStream& inputStream);
+
+private:
+	network_data_key mKey = {};
+	bool mLoaded = false;
+};
+
 class ServerWarningMessage : public SmallMessageHelper
 {
 public:
@@ -446,6 +532,7 @@ struct Client {
 	uint16 network_version;
 	Capabilities capabilities;
 	char name[MAX_NET_PLAYER_NAME_LENGTH];
+	std::set<network_data_key> cached_data; // what the joiner has on disk
 
 	static CheckPlayerProcPtr check_player;
 
@@ -466,6 +553,7 @@ struct Client {
 	void handleAcceptJoinMessage(AcceptJoinMessage*, CommunicationsChannel*);
 	void handleChatMessage(NetworkChatMessage*, CommunicationsChannel*);
 	void handleChangeColorsMessage(ChangeColorsMessage*, CommunicationsChannel*);
+	void handleCachedDataListMessage(CachedDataListMessage*, CommunicationsChannel*);
 
 	std::unique_ptr<MessageDispatcher> mDispatcher;
 	std::unique_ptr<MessageHandler> mJoinerInfoMessageHandler;
@@ -474,6 +562,7 @@ struct Client {
 	std::unique_ptr<MessageHandler> mAcceptJoinMessageHandler;
 	std::unique_ptr<MessageHandler> mChatMessageHandler;
 	std::unique_ptr<MessageHandler> mChangeColorsMessageHandler;
+	std::unique_ptr<MessageHandler> mCachedDataListMessageHandler;
 };
 
 typedef TemplatizedDataMessage<kGAME_SESSION_MESSAGE, BigChunkOfDataMessage> GameSessionMessage;
@@ -150,6 +150,10 @@ enum {
 	kDefaultSendPeriod = 1,
         kDefaultRecoverySendPeriod = TICKS_PER_SECOND / 2,
 	kDefaultMinimumSendPeriod = 5,
+	kDefaultMaximumSpokeSendPeriod = 3,
+	kSendPeriodRecoveryTicks = TICKS_PER_SECOND,
+	kLossSlackTicks = 2,
+	kMaximumLossyBytesPerPacket = 512,
 	kLossyByteStreamDataBufferSize = 1280,
 	kTypicalLossyByteStreamChunkSize = 56,
 	kLossyByteStreamDescriptorCount = kLossyByteStreamDataBufferSize / kTypicalLossyByteStreamChunkSize,
@@ -171,6 +175,7 @@ struct HubPreferences {
 	int32	mSendPeriod;
 	int32	mRecoverySendPeriod;
 	int32   mMinimumSendPeriod;
+	int32	mMaximumSpokeSendPeriod;
 	bool    mBandwidthReduction;
 };
 
@@ -247,6 +252,14 @@ struct NetworkPlayer_hub {
 	std::deque<int32> mLatencyBuffer;
 
 	NetworkStats mStats;
+
+	// Each spoke is paced separately (see update_spoke_send_period()): we send to him
+	// at most once every mSendPeriod network ticks, so a poor link gets fewer, larger
+	// packets without slowing everyone else's.
+	int32		mSendPeriod;
+	int32		mLastNetworkTickSent;
+	int32		mLastSendPeriodChange;
+	int32		mSmallestUnsentTick;	// incremental updates must cover every tick since his last packet
 };
 
 // Housekeeping queues:
@@ -333,6 +346,9 @@ static CircularQueue<HubLossyByteStreamChunkDescriptor> sOutgoingLossyByteStream
 // It's used in both directions, but that's ok because the routines that do so are mutex.
 static byte sScratchBuffer[kLossyByteStreamDataBufferSize];
 
+// Incoming action_flags are read into this a packet's worth at a time
+static action_flags_t sIncomingActionFlags[ddpMaxData / kActionFlagsSerializedLength];
+
 
 static myTMTaskPtr	sHubTickTask = NULL;
 static bool		sHubActive = false;	// used to enable the packet handler
@@ -351,6 +367,7 @@ static void process_messages(AIStream& ps, int inSenderIndex);
 static void process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType);
 static void make_player_netdead(int inPlayerIndex);
 static bool hub_tick();
+static void update_spoke_send_period(size_t inPlayerIndex);
 static void send_packets();
 
 
@@ -537,6 +554,11 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 		thePlayer.mStats.jitter = NetworkStats::invalid;
 		thePlayer.mStats.errors = 0;
 
+		thePlayer.mSendPeriod = sHubPreferences.mSendPeriod;
+		thePlayer.mLastNetworkTickSent = 0;
+		thePlayer.mLastSendPeriodChange = 0;
+		thePlayer.mSmallestUnsentTick = theFirstTick;
+
                 sFlagsQueues[i].reset(theFirstTick);
 		sLateFlagsQueues[i].reset(theFirstTick);
         }
@@ -845,6 +867,8 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
                 return;
 
         int32	theActionFlagsCount = theRemainingDataLength / kActionFlagsSerializedLength;
+	if(theActionFlagsCount > static_cast<int32>(sizeof(sIncomingActionFlags) / sizeof(sIncomingActionFlags[0])))
+		return;
 
         TickBasedActionQueue& theQueue = getFlagsQueue(inSenderIndex);
 	TickBasedActionQueue& theLateQueue = getLateFlagsQueue(inSenderIndex);
@@ -873,10 +897,10 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	assert(theQueue.getWriteTick() >= theLateQueue.getWriteTick());
 	// Enqueue late flags
 	int theLateActionFlagsCount = std::min(theQueue.getWriteTick() - theLateQueue.getWriteTick(), theActionFlagsCount - theRedundantActionFlagsCount);
+	ps.read(sIncomingActionFlags, theLateActionFlagsCount);
 	for (int i = 0; i < theLateActionFlagsCount; i++)
 	{
-		action_flags_t theActionFlags;
-		ps >> theActionFlags;
+		action_flags_t theActionFlags = sIncomingActionFlags[i];
 		// we consume these faster than we enqueue them (hopefully)
 		// so, not checking for capacity though we probably should
 		theLateQueue.enqueue(theActionFlags);
@@ -890,10 +914,10 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 
 	assert(!theEnqueueableFlagsCount || (theQueue.getWriteTick() == theLateQueue.getWriteTick()));
         
+	ps.read(sIncomingActionFlags, theEnqueueableFlagsCount);
         for(int i = 0; i < theEnqueueableFlagsCount; i++)
         {
-                action_flags_t theActionFlags;
-                ps >> theActionFlags;
+                action_flags_t theActionFlags = sIncomingActionFlags[i];
                 theQueue.enqueue(theActionFlags);
 		theLateQueue.enqueue(theActionFlags);
 		sLastFlagsReceived[inSenderIndex] = theActionFlags;
@@ -1325,6 +1349,9 @@ hub_tick()
 		
 	}
 			
+	for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+		update_spoke_send_period(i);
+
 	// if we're getting behind, make up flags
 	
 	if (sHubPreferences.mBandwidthReduction && sPlayerDataDisposition.getReadTick() >= sSmallestRealGameTick)
@@ -1442,22 +1469,79 @@ hub_tick()
 #define INT8_MIN -128
 #endif
 
+// A spoke with a long round trip won't notice a slightly longer send period, so that
+// sets a floor.  When his acknowledgements stall for longer than the round trip
+// explains, we're losing packets, so we back off one tick at a time - fewer, larger
+// packets for a congested link - and step back down once it has been clean for a while.
+static void
+update_spoke_send_period(size_t inPlayerIndex)
+{
+	NetworkPlayer_hub& thePlayer = getNetworkPlayer(inPlayerIndex);
+
+	if (!sHubPreferences.mBandwidthReduction || sPlayerDataDisposition.getReadTick() < sSmallestRealGameTick || inPlayerIndex == sLocalPlayerIndex || !thePlayer.mConnected)
+	{
+		thePlayer.mSendPeriod = sHubPreferences.mSendPeriod;
+		return;
+	}
+
+	int32 theMaximumPeriod = std::max(sHubPreferences.mSendPeriod, sHubPreferences.mMaximumSpokeSendPeriod);
+
+	int32 latencyCount = std::min(thePlayer.mLatencyBuffer.size(), static_cast<size_t>(kDisplayLatencyWindow));
+	int32 theRoundTrip = ((latencyCount > 0) ? thePlayer.mLatencyTicks / latencyCount : 0);
+	int32 theSmallestPeriod = PIN(theRoundTrip / 4, sHubPreferences.mSendPeriod, theMaximumPeriod);
+
+	int32 theOldestUnacknowledgedTick = thePlayer.mSmallestUnacknowledgedTick;
+	bool isStalled = (theOldestUnacknowledgedTick < sSmallestIncompleteTick
+			  && theOldestUnacknowledgedTick >= sFlagSendTimeQueue.getReadTick()
+			  && theOldestUnacknowledgedTick < sFlagSendTimeQueue.getWriteTick()
+			  && sNetworkTicker - sFlagSendTimeQueue.peek(theOldestUnacknowledgedTick) > theRoundTrip + 2 * thePlayer.mSendPeriod + kLossSlackTicks);
+
+	int32 theTicksSinceChange = sNetworkTicker - thePlayer.mLastSendPeriodChange;
+	if (isStalled)
+	{
+		// one step per round trip, so we see the effect before stepping again
+		if (thePlayer.mSendPeriod < theMaximumPeriod && theTicksSinceChange >= std::max(theRoundTrip, static_cast<int32>(1)))
+		{
+			thePlayer.mSendPeriod++;
+			thePlayer.mLastSendPeriodChange = sNetworkTicker;
+		}
+	}
+	else if (thePlayer.mSendPeriod > theSmallestPeriod && theTicksSinceChange >= kSendPeriodRecoveryTicks)
+	{
+		thePlayer.mSendPeriod--;
+		thePlayer.mLastSendPeriodChange = sNetworkTicker;
+	}
+
+	thePlayer.mSendPeriod = PIN(thePlayer.mSendPeriod, theSmallestPeriod, theMaximumPeriod);
+}
+
 static void
 send_packets()
 {
-	// Currently, at most one lossy data descriptor is used per trip through this function.  So,
-	// we do some processing here outside the loop since the results'd be the same every time.
-	HubLossyByteStreamChunkDescriptor theDescriptor = { 0, 0, 0, 0 };
-	bool haveLossyData = false;
-	if(sOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
+	// We send as many of the waiting lossy data chunks as fit in kMaximumLossyBytesPerPacket
+	// (always at least one) to everyone they're for, so a spoke we send to less often gets
+	// them together.  We do that processing here outside the loop since the results'd be
+	// the same every time.
+	unsigned int theLossyChunkCount = 0;
+	unsigned int theLossyByteCount = 0;
+	uint32 theLossyDestinations = 0;
+	while(theLossyChunkCount < sOutgoingLossyByteStreamDescriptors.getCountOfElements())
 	{
-		haveLossyData = true;
-		theDescriptor = sOutgoingLossyByteStreamDescriptors.peek();
+		const HubLossyByteStreamChunkDescriptor& theDescriptor = sOutgoingLossyByteStreamDescriptors.peek(theLossyChunkCount);
+		if(theLossyChunkCount > 0 && theLossyByteCount + theDescriptor.mLength > kMaximumLossyBytesPerPacket)
+			break;
+
+		theLossyByteCount += theDescriptor.mLength;
+		theLossyDestinations |= theDescriptor.mDestinations;
+		theLossyChunkCount++;
+	}
 
+	if(theLossyChunkCount > 0)
+	{
 		// XXX extraneous copy due to limited interfaces
-		// We assert here; the real "test" happened when it was enqueued.
-		assert(theDescriptor.mLength <= sizeof(sScratchBuffer));
-		sOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theDescriptor.mLength);
+		// We assert here; the real "test" happened when they were enqueued.
+		assert(theLossyByteCount <= sizeof(sScratchBuffer));
+		sOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theLossyByteCount);
 	}
 
 	// remember when we sent flags for the first time
@@ -1471,6 +1555,15 @@ send_packets()
                 NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
                 if(thePlayer.mConnected && thePlayer.mAddressKnown)
                 {
+			// Not his turn yet?  Whatever we'd have sent goes out with his next packet -
+			// except lossy data, which we don't keep around.
+			if(i != sLocalPlayerIndex
+			   && sNetworkTicker - thePlayer.mLastNetworkTickSent < thePlayer.mSendPeriod
+			   && (theLossyDestinations & (((uint32)1) << i)) == 0)
+				continue;
+
+			thePlayer.mLastNetworkTickSent = sNetworkTicker;
+
 			AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
                         AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
 
@@ -1499,18 +1592,24 @@ send_packets()
                                 }
 
 				// Lossy streaming data?
-				if(haveLossyData && ((theDescriptor.mDestinations & (((uint32)1) << i)) != 0))
+				unsigned int theLossyOffset = 0;
+				for(unsigned int c = 0; c < theLossyChunkCount; c++)
 				{
-					logDumpNMT("packet to player %d will contain %d bytes of lossy byte stream type %d from player %d", i, theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender);
-					// In AStreams, sizeof(packed scalar) == sizeof(unpacked scalar)
-					uint16 theMessageLength = sizeof(theDescriptor.mType) + sizeof(theDescriptor.mSender) + theDescriptor.mLength;
+					const HubLossyByteStreamChunkDescriptor& theDescriptor = sOutgoingLossyByteStreamDescriptors.peek(c);
+					if((theDescriptor.mDestinations & (((uint32)1) << i)) != 0)
+					{
+						logDumpNMT("packet to player %d will contain %d bytes of lossy byte stream type %d from player %d", i, theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender);
+						// In AStreams, sizeof(packed scalar) == sizeof(unpacked scalar)
+						uint16 theMessageLength = sizeof(theDescriptor.mType) + sizeof(theDescriptor.mSender) + theDescriptor.mLength;
 					
-					ps << (uint16)kHubToSpokeLossyByteStreamMessageType
-						<< theMessageLength
-						<< theDescriptor.mType
-						<< theDescriptor.mSender;
+						ps << (uint16)kHubToSpokeLossyByteStreamMessageType
+							<< theMessageLength
+							<< theDescriptor.mType
+							<< theDescriptor.mSender;
 
-					ps.write(sScratchBuffer, theDescriptor.mLength);
+						ps.write(&sScratchBuffer[theLossyOffset], theDescriptor.mLength);
+					}
+					theLossyOffset += theDescriptor.mLength;
 				}
         
                                 // End of messages
@@ -1559,9 +1658,13 @@ send_packets()
 					}
 					else
 					{
-						// send the last 3 flags
-						startTick = std::max(sSmallestIncompleteTick - 3, thePlayer.mSmallestUnacknowledgedTick);
-						endTick = sSmallestIncompleteTick;
+						// send the last 3 flags, or everything since his last packet if he's paced slower
+						startTick = std::max(std::min(sSmallestIncompleteTick - 3, thePlayer.mSmallestUnsentTick), thePlayer.mSmallestUnacknowledgedTick);
+
+						// that could be a lot after a capped recovery update; the rest goes next time
+						int bytesAvailableForFlags = ps.maxp() - ps.tellp() - 4;
+						int maxTicks = bytesAvailableForFlags / (sNetworkPlayers.size() * 4);
+						endTick = std::min(sSmallestIncompleteTick, startTick + maxTicks);
 					}
 				}
 				else 
@@ -1617,6 +1720,8 @@ send_packets()
                                         }
                                 }
 				
+				thePlayer.mSmallestUnsentTick = std::max(thePlayer.mSmallestUnsentTick, endTick);
+
 				hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic : kHubToSpokeGameDataPacketV1Magic);
 
 				// blank out the CRC field before calculating
@@ -1645,10 +1750,10 @@ send_packets()
         sLastNetworkTickSent = sNetworkTicker;
 	sSmallestUnsentTick = sSmallestIncompleteTick;
 
-	if(haveLossyData)
+	if(theLossyChunkCount > 0)
 	{
-		sOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
-		sOutgoingLossyByteStreamDescriptors.dequeue();
+		sOutgoingLossyByteStreamData.dequeue(theLossyByteCount);
+		sOutgoingLossyByteStreamDescriptors.dequeue(theLossyChunkCount);
 	}
 	
 } // send_packets()
@@ -1669,6 +1774,7 @@ enum {
 	kSendPeriodAttribute,
 	kRecoverySendPeriodAttribute,
 	kMinimumSendPeriodAttribute,
+	kMaximumSpokeSendPeriodAttribute,
 	kNumAttributes,
 };
 
@@ -1684,6 +1790,7 @@ static const char* sAttributeStrings[kNumAttributes] =
 	"send_period",
 	"recovery_send_period",
 	"latency_tolerance",
+	"maximum_spoke_send_period",
 };
 
 static int32* sAttributeDestinations[kNumAttributes] =
@@ -1698,6 +1805,7 @@ static int32* sAttributeDestinations[kNumAttributes] =
 	&sHubPreferences.mSendPeriod,
 	&sHubPreferences.mRecoverySendPeriod,
 	&sHubPreferences.mMinimumSendPeriod,
+	&sHubPreferences.mMaximumSpokeSendPeriod,
 };
 
 static const int32 sDefaultHubPreferences[kNumAttributes] = {
@@ -1710,6 +1818,7 @@ static const int32 sDefaultHubPreferences[kNumAttributes] = {
 	kDefaultSendPeriod,
 	kDefaultRecoverySendPeriod,
 	kDefaultMinimumSendPeriod,
+	kDefaultMaximumSpokeSendPeriod,
 };
 
 
@@ -1726,6 +1835,7 @@ void HubParsePreferencesTree(InfoTree prefs, std::string version)
 				case kInGameTicksBeforeNetDeathAttribute:
 				case kRecoverySendPeriodAttribute:
 				case kSendPeriodAttribute:
+				case kMaximumSpokeSendPeriodAttribute:
 				case kPregameWindowSizeAttribute:
 				case kInGameWindowSizeAttribute:
 					min = 1;
@@ -118,6 +118,7 @@ static bool sNeedToSendLocalOutgoingBuffer = false;
 static bool sHubIsLocal = false;
 static NetAddrBlock sHubAddress;
 static size_t sLocalPlayerIndex;
+static bool sLocalPlayerObserves = false; // dedicated host: send net-dead flags rather than input
 static int32 sSmallestUnreceivedTick;
 static WindowedNthElementFinder<int32> sNthElementFinder(kDefaultTimingWindowSize);
 static bool sTimingMeasurementValid;
@@ -208,7 +209,7 @@ check_send_packet_to_hub()
 
 
 void
-spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnected[], size_t inLocalPlayerIndex, bool inHubIsLocal)
+spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnected[], size_t inLocalPlayerIndex, bool inHubIsLocal, bool inLocalPlayerObserves)
 {
         assert(inNumberOfPlayers >= 1);
         assert(inLocalPlayerIndex < inNumberOfPlayers);
@@ -219,6 +220,7 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
         sHubAddress = inHubAddress;
 
         sLocalPlayerIndex = inLocalPlayerIndex;
+	sLocalPlayerObserves = inLocalPlayerObserves;
 
         sOutgoingFrame = NetDDPNewFrame();
 
@@ -947,7 +949,9 @@ spoke_tick()
 
 			logDumpNMT("enqueueing flags for tick %d", theTargetQueue.getWriteTick());
 
-			theTargetQueue.enqueue(parse_keymap());
+			// An observing player drops out on the first real tick, the
+			// same way for everyone, and never acts
+			theTargetQueue.enqueue(sLocalPlayerObserves ? static_cast<action_flags_t>(NET_DEAD_ACTION_FLAG) : parse_keymap());
 			shouldSend = true;
 			theNumberOfFlagsToProvide--;
 		}
@@ -34,6 +34,7 @@
 #include "cseries.h"
 #include "sdl_network.h"
 #include "network_private.h"
+#include "SDL_netx.h"
 
 #include <SDL_thread.h>
 
@@ -41,11 +42,18 @@
 #include "mytm.h" // mytm_mutex stuff
 
 // Global variables (most comments and "sSomething" variables are ZZZ)
-// Storage for incoming packet data
+// Storage for outgoing packet data
 static UDPpacket*		sUDPPacketBuffer	= NULL;
 
-// Storage for the DDP packet we pass back to the handler proc
-static DDPPacketBuffer		ddpPacketBuffer;
+// Most datagrams the receiving thread takes off the socket per wakeup
+enum { kReceiveBatchSize = 32 };
+
+// Storage for the DDP packets we pass back to the handler proc.  The UDP packets
+// point into them, so datagrams are received in place.  Only the receiving thread
+// touches these.
+static DDPPacketBuffer		sReceiveBuffers[kReceiveBatchSize];
+static UDPpacket		sReceivePackets[kReceiveBatchSize];
+static UDPpacket*		sReceivePacketPointers[kReceiveBatchSize];
 
 // Keep track of our one sending/receiving socket
 static UDPsocket 		sSocket			= NULL;
@@ -75,23 +83,25 @@ receive_thread_function(void*) {
             break;
         
         if(theResult > 0) {
-            theResult = SDLNet_UDP_Recv(sSocket, sUDPPacketBuffer);
-            if(theResult > 0) {
+            // Drain everything that's waiting, so a burst from many spokes costs one
+            // wakeup and one trip through the mutex rather than one per datagram
+            int theCount = SDLNetx_UDP_RecvBatch(sSocket, sReceivePacketPointers, kReceiveBatchSize);
+            if(theCount > 0) {
+                for(int i = 0; i < theCount; i++) {
+                    sReceiveBuffers[i].protocolType	= kPROTOCOL_TYPE;
+                    sReceiveBuffers[i].sourceAddress	= sReceivePackets[i].address;
+                    sReceiveBuffers[i].datagramSize	= sReceivePackets[i].len;
+                }
+
+                // The handlers share hub and spoke state with the mytm tasks.
                 if(take_mytm_mutex()) {
-                    ddpPacketBuffer.protocolType	= kPROTOCOL_TYPE;
-                    ddpPacketBuffer.sourceAddress	= sUDPPacketBuffer->address;
-                    ddpPacketBuffer.datagramSize	= sUDPPacketBuffer->len;
-                    
-                    // Hope the other guy is done using whatever's in there!
-                    // (As I recall, all uses happen in sPacketHandler and its progeny, so we should be fine.)
-                    memcpy(ddpPacketBuffer.datagramData, sUDPPacketBuffer->data, sUDPPacketBuffer->len);
-                    
-                    sPacketHandler(&ddpPacketBuffer);
+                    for(int i = 0; i < theCount; i++)
+                        sPacketHandler(&sReceiveBuffers[i]);
                     
                     release_mytm_mutex();
                 }
                 else
-                    fdprintf("could not take mytm mutex - incoming packet dropped");
+                    fdprintf("could not take mytm mutex - %d incoming packets dropped", theCount);
             }
         }
     }
@@ -146,6 +156,15 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
 		return -1;
 	}
 
+        // Point the receive packets at the buffers we hand to the packet handler
+        for(int i = 0; i < kReceiveBatchSize; i++) {
+            memset(&sReceivePackets[i], 0, sizeof(sReceivePackets[i]));
+            sReceivePackets[i].channel		= -1;
+            sReceivePackets[i].data		= sReceiveBuffers[i].datagramData;
+            sReceivePackets[i].maxlen		= sizeof(sReceiveBuffers[i].datagramData);
+            sReceivePacketPointers[i]		= &sReceivePackets[i];
+        }
+
         // Set up socket set
         sSocketSet = SDLNet_AllocSocketSet(1);
         SDLNet_UDP_AddSocket(sSocketSet, sSocket);
@@ -44,6 +44,11 @@ public:
 	// Rendering calls
 	// These are defined in scottish_textures.c (too great a name to change)
 	
+	// With more than one processor, everything between Begin() and End() is recorded
+	// and then drawn in horizontal screen bands, one thread per band
+	void Begin();
+	void End();
+	
 	void texture_horizontal_polygon(polygon_definition& textured_polygon);
 	
 	void texture_vertical_polygon(polygon_definition& textured_polygon);
@@ -34,6 +34,7 @@ Jan 30, 2000 (Loren Petrich):
 #include "preferences.h"
 #include "textures.h"
 #include "scottish_textures.h"
+#include "low_level_textures_simd.h"
 
 /* ---------- global state */
 
@@ -91,6 +92,22 @@ struct _vertical_polygon_line_data
 
 /* ---------- code */
 
+/* clips the lines y0 through y0+count-1 to the screen band band_top through band_bottom-1, and
+	returns how many lines were skipped at the top so the caller can advance its texture coordinates */
+inline int clip_to_band(
+	int &y0,
+	int &count,
+	int band_top,
+	int band_bottom)
+{
+	int skipped= PIN(band_top-y0, 0, MAX(count, 0));
+	
+	y0+= skipped, count-= skipped;
+	if (y0+count>band_bottom) count= MAX(band_bottom-y0, 0);
+	
+	return skipped;
+}
+
 // Find the next lower power of 2, and return the exponent
 inline int NextLowerExponent(int n)
 {
@@ -160,11 +177,22 @@ void texture_horizontal_polygon_lines
 	short *x0_table,
 	short *x1_table,
 	short line_count,
+	short band_top,
+	short band_bottom,
 	uint8 *opacity_table = 0
 )
 {
 	(void) (view);
 
+	/* skip the lines outside our band */
+	{
+		int first_line= y0, count= line_count;
+		int skipped= clip_to_band(first_line, count, band_top, band_bottom);
+		
+		x0_table+= skipped, x1_table+= skipped, data+= skipped;
+		y0= first_line, line_count= count;
+	}
+
 	pixel32 rmask = 0;
 	pixel32 gmask = 0;
 	pixel32 bmask = 0;
@@ -215,12 +243,23 @@ void landscape_horizontal_polygon_lines(
 	short y0,
 	short *x0_table,
 	short *x1_table,
-	short line_count)
+	short line_count,
+	short band_top,
+	short band_bottom)
 {
 	short landscape_texture_width_downshift= 32 - NextLowerExponent(texture->height);
 
 	(void) (view);
 
+	/* skip the lines outside our band */
+	{
+		int first_line= y0, count= line_count;
+		int skipped= clip_to_band(first_line, count, band_top, band_bottom);
+		
+		x0_table+= skipped, x1_table+= skipped, data+= skipped;
+		y0= first_line, line_count= count;
+	}
+
 	while ((line_count-= 1)>=0)
 	{
 		short x0= *x0_table++, x1= *x1_table++;
@@ -232,7 +271,11 @@ void landscape_horizontal_polygon_lines(
 		uint32 source_dx= data->source_dx;
 		short count= x1-x0;
 		
-		while ((count-= 1)>=0)
+		if (sizeof(T)==sizeof(pixel32) && landscape_line32 && landscape_texture_width_downshift<32)
+		{
+			landscape_line32((pixel32 *)write, read, (pixel32 *)shading_table, source_x, source_dx, landscape_texture_width_downshift, count);
+		}
+		else while ((count-= 1)>=0)
 		{
 			*write++= shading_table[read[source_x>>landscape_texture_width_downshift]];
 			source_x+= source_dx;
@@ -252,6 +295,37 @@ void inline copy_check_transparent(T *dst, pixel8 read, T *shading_table)
 	}
 }
 
+/* copies the part of one column from y0 to y1 that lies in our band, without blending;
+	texture_y is the texture coordinate at y0 */
+template <typename T, bool check_transparent>
+void inline copy_vertical_span(
+	struct bitmap_definition *screen,
+	int x,
+	int y0,
+	int y1,
+	short band_top,
+	short band_bottom,
+	pixel8 *read,
+	uint32 texture_y,
+	uint32 texture_dy,
+	int downshift,
+	T *shading_table)
+{
+	int bytes_per_row= screen->bytes_per_row;
+	int count= y1-y0;
+	T *write;
+
+	texture_y+= clip_to_band(y0, count, band_top, band_bottom)*texture_dy;
+	if (count<=0) return;
+
+	for (write= (T *)screen->row_addresses[y0] + x; count>0; --count)
+	{
+		copy_check_transparent<T, check_transparent>(write, read[texture_y>>downshift], shading_table);
+		write = (T *)((byte *)write + bytes_per_row);
+		texture_y+= texture_dy;
+	}
+}
+
 
 template <typename T, int sw_alpha_blend, bool check_transparent>
 void texture_vertical_polygon_lines(
@@ -260,6 +334,8 @@ void texture_vertical_polygon_lines(
 	struct _vertical_polygon_data *data,
 	short *y0_table,
 	short *y1_table, 
+	short band_top,
+	short band_bottom,
 	uint8 *opacity_table = 0)
 {
 	struct _vertical_polygon_line_data *line= (struct _vertical_polygon_line_data *) (data+1);
@@ -285,21 +361,26 @@ void texture_vertical_polygon_lines(
 		bmask = fmt->Bmask;
 	}
 
+	/* the columns are grouped, synced and desynced exactly as if the whole screen were one band,
+		then each span is clipped to our band; texture coordinates are recomputed from the top of
+		each column so every band lands on the same texels */
 	while (line_count>0)	
 	{
 		if (line_count<4 || (x&3) || aborted)
 		{
-			int y0= *y0_table++, y1= *y1_table++;
-			uint32 texture_y= line->texture_y;
+			int y0= *y0_table++;
 			uint32 texture_dy= line->texture_dy;
+			uint32 texture_y;
 			T *write, *shading_table;
 			pixel8 *read;
 
+			count= *y1_table++ - y0;
+			texture_y= line->texture_y + clip_to_band(y0, count, band_top, band_bottom)*texture_dy;
 			shading_table= (T *)line->shading_table;
 			read= line->texture;
 			write= (T *)screen->row_addresses[y0] + x;
 
-			for (count= y1-y0; count>0; --count)
+			for (; count>0; --count)
 			{
 				write_pixel<T, sw_alpha_blend, check_transparent>(write, read[texture_y>>downshift], shading_table, opacity_table, rmask, gmask, bmask);
 
@@ -315,33 +396,29 @@ void texture_vertical_polygon_lines(
 		}
 		else
 		{
-			uint32 texture_y0= line[0].texture_y, texture_dy0= line[0].texture_dy;
+			uint32 texture_dy0= line[0].texture_dy;
 			pixel8 *read0= line[0].texture;
 			T *shading_table0= (T *)line[0].shading_table;
 			
-			uint32 texture_y1= line[1].texture_y, texture_dy1= line[1].texture_dy;
+			uint32 texture_dy1= line[1].texture_dy;
 			pixel8 *read1= line[1].texture;
 			T *shading_table1= (T *)line[1].shading_table;
 			
-			uint32 texture_y2= line[2].texture_y, texture_dy2= line[2].texture_dy;
+			uint32 texture_dy2= line[2].texture_dy;
 			pixel8 *read2= line[2].texture;
 			T *shading_table2= (T *)line[2].shading_table;
 			
-			uint32 texture_y3= line[3].texture_y, texture_dy3= line[3].texture_dy;
+			uint32 texture_dy3= line[3].texture_dy;
 			pixel8 *read3= line[3].texture;
 			T *shading_table3= (T *)line[3].shading_table;
 			
-			T *write;
-
 			int ymax;
 			
 			/* sync */	
 			{
 				int y0= y0_table[0], y1= y0_table[1], y2= y0_table[2], y3= y0_table[3];
-				T *temp_write;
 				
 				ymax= MAX(y0, y1), ymax= MAX(ymax, y2), ymax= MAX(ymax, y3);
-				write= (T *)screen->row_addresses[ymax] + x;
 				
 				{
 					int ymin= MIN(y1_table[0], y1_table[1]);
@@ -356,33 +433,10 @@ void texture_vertical_polygon_lines(
 					}
 				}
 
-				for (count= ymax-y0, temp_write= (T *)screen->row_addresses[y0] + x; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write, read0[texture_y0>>downshift], shading_table0);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y0+= texture_dy0;
-				}
-				
-				for (count= ymax-y1, temp_write= (T *)screen->row_addresses[y1] + x; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 1, read1[texture_y1>>downshift], shading_table1);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y1+= texture_dy1;
-				}
-				
-				for (count= ymax-y2, temp_write= (T *)screen->row_addresses[y2] + x; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 2, read2[texture_y2>>downshift], shading_table2);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y2+= texture_dy2;
-				}
-		
-				for (count= ymax-y3, temp_write= (T *)screen->row_addresses[y3] + x; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 3, read3[texture_y3>>downshift], shading_table3);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y3+= texture_dy3;
-				}
+				copy_vertical_span<T, check_transparent>(screen, x, y0, ymax, band_top, band_bottom, read0, line[0].texture_y, texture_dy0, downshift, shading_table0);
+				copy_vertical_span<T, check_transparent>(screen, x+1, y1, ymax, band_top, band_bottom, read1, line[1].texture_y, texture_dy1, downshift, shading_table1);
+				copy_vertical_span<T, check_transparent>(screen, x+2, y2, ymax, band_top, band_bottom, read2, line[2].texture_y, texture_dy2, downshift, shading_table2);
+				copy_vertical_span<T, check_transparent>(screen, x+3, y3, ymax, band_top, band_bottom, read3, line[3].texture_y, texture_dy3, downshift, shading_table3);
 			}
 
 			/* parallel map (x4) */
@@ -391,60 +445,57 @@ void texture_vertical_polygon_lines(
 				int dy1= y1_table[1] - ymax;
 				int dy2= y1_table[2] - ymax;
 				int dy3= y1_table[3] - ymax;
+				int y= ymax;
 				
 				count= MIN(dy0, dy1), count= MIN(count, dy2), count= MIN(count, dy3);
 				ymax+= count;
 				
-				for (; count>0; --count)
+				clip_to_band(y, count, band_top, band_bottom);
+				if (count>0)
 				{
-					write_pixel<T, sw_alpha_blend, check_transparent>(write, read0[texture_y0>>downshift], shading_table0, opacity_table, rmask, gmask, bmask);
-					texture_y0+= texture_dy0;
-		
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+1, read1[texture_y1>>downshift], shading_table1, opacity_table, rmask, gmask, bmask);
-					texture_y1+= texture_dy1;
+					uint32 texture_y0= line[0].texture_y + (y - y0_table[0])*texture_dy0;
+					uint32 texture_y1= line[1].texture_y + (y - y0_table[1])*texture_dy1;
+					uint32 texture_y2= line[2].texture_y + (y - y0_table[2])*texture_dy2;
+					uint32 texture_y3= line[3].texture_y + (y - y0_table[3])*texture_dy3;
+					T *write= (T *)screen->row_addresses[y] + x;
+					vertical_lines32_x4_kernel kernel= (sizeof(T)==sizeof(pixel32) && sw_alpha_blend!=_sw_alpha_nice) ?
+						vertical_lines32_x4_kernels[sw_alpha_blend==_sw_alpha_fast][check_transparent] : NULL;
+					
+					if (kernel)
+					{
+						pixel8 *reads[4]= {read0, read1, read2, read3};
+						pixel32 *shading_tables[4]= {(pixel32 *)shading_table0, (pixel32 *)shading_table1, (pixel32 *)shading_table2, (pixel32 *)shading_table3};
+						uint32 texture_ys[4]= {texture_y0, texture_y1, texture_y2, texture_y3};
+						uint32 texture_dys[4]= {texture_dy0, texture_dy1, texture_dy2, texture_dy3};
+						
+						kernel((pixel32 *)write, bytes_per_row, count, downshift, reads, shading_tables, texture_ys, texture_dys);
+						count= 0;
+					}
+					
+					for (; count>0; --count)
+					{
+						write_pixel<T, sw_alpha_blend, check_transparent>(write, read0[texture_y0>>downshift], shading_table0, opacity_table, rmask, gmask, bmask);
+						texture_y0+= texture_dy0;
+			
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+1, read1[texture_y1>>downshift], shading_table1, opacity_table, rmask, gmask, bmask);
+						texture_y1+= texture_dy1;
 
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+2, read2[texture_y2>>downshift], shading_table2, opacity_table, rmask, gmask, bmask);
-					texture_y2+= texture_dy2;
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+2, read2[texture_y2>>downshift], shading_table2, opacity_table, rmask, gmask, bmask);
+						texture_y2+= texture_dy2;
 
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+3, read3[texture_y3>>downshift], shading_table3, opacity_table, rmask, gmask, bmask);
-					texture_y3+= texture_dy3;
-					
-					write = (T *)((byte *)write + bytes_per_row);
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+3, read3[texture_y3>>downshift], shading_table3, opacity_table, rmask, gmask, bmask);
+						texture_y3+= texture_dy3;
+						
+						write = (T *)((byte *)write + bytes_per_row);
+					}
 				}
 			}
 
 			/* desync */	
-			{
-				T *temp_write;
-				
-				for (count= y1_table[0] - ymax, temp_write= write; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write, read0[texture_y0>>downshift], shading_table0);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y0+= texture_dy0;
-				}
-				
-				for (count= y1_table[1] - ymax, temp_write= write; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 1, read1[texture_y1>>downshift], shading_table1);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y1+= texture_dy1;
-				}
-				
-				for (count= y1_table[2] - ymax, temp_write= write; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 2, read2[texture_y2>>downshift], shading_table2);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y2+= texture_dy2;
-				}
-		
-				for (count= y1_table[3] - ymax, temp_write= write; count>0; --count)
-				{
-					copy_check_transparent<T, check_transparent>(temp_write + 3, read3[texture_y3>>downshift], shading_table3);
-					temp_write = (T *)((byte *)temp_write + bytes_per_row);
-					texture_y3+= texture_dy3;
-				}
-			}
+			copy_vertical_span<T, check_transparent>(screen, x, ymax, y1_table[0], band_top, band_bottom, read0, line[0].texture_y + (ymax - y0_table[0])*texture_dy0, texture_dy0, downshift, shading_table0);
+			copy_vertical_span<T, check_transparent>(screen, x+1, ymax, y1_table[1], band_top, band_bottom, read1, line[1].texture_y + (ymax - y0_table[1])*texture_dy1, texture_dy1, downshift, shading_table1);
+			copy_vertical_span<T, check_transparent>(screen, x+2, ymax, y1_table[2], band_top, band_bottom, read2, line[2].texture_y + (ymax - y0_table[2])*texture_dy2, texture_dy2, downshift, shading_table2);
+			copy_vertical_span<T, check_transparent>(screen, x+3, ymax, y1_table[3], band_top, band_bottom, read3, line[3].texture_y + (ymax - y0_table[3])*texture_dy3, texture_dy3, downshift, shading_table3);
 
 			y0_table+= 4, y1_table+= 4;
 			line_count-= 4;
@@ -519,7 +570,9 @@ void tint_vertical_polygon_lines(
 	struct _vertical_polygon_data *data,
 	short *y0_table,
 	short *y1_table,
-	uint16 transfer_data)
+	uint16 transfer_data,
+	short band_top,
+	short band_bottom)
 {
 	short tint_table_index= transfer_data&0xff;
 	struct _vertical_polygon_line_data *line= (struct _vertical_polygon_line_data *) (data+1);
@@ -537,11 +590,11 @@ void tint_vertical_polygon_lines(
 
 	while ((line_count-= 1)>=0)
 	{
-		short y0= *y0_table++, y1= *y1_table++;
+		int y0= *y0_table++, count= *y1_table++ - y0;
+		_fixed texture_dy= line->texture_dy;
+		_fixed texture_y= line->texture_y + clip_to_band(y0, count, band_top, band_bottom)*texture_dy;
 		T *write= (T *) screen->row_addresses[y0] + x;
 		pixel8 *read= line->texture;
-		_fixed texture_y= line->texture_y, texture_dy= line->texture_dy;
-		short count= y1-y0;
 
 		while ((count-=1)>=0)
 		{
@@ -573,6 +626,8 @@ inline pixel32 randomize_vertical_polygon_lines_write<pixel32>(uint16 seed)
 	return (pixel32)seed^(((pixel32)seed)<<8);
 }
 
+/* the seed advances with every opaque pixel, so each band walks the whole polygon to stay in
+	step and only writes its own lines; an empty band just advances the seed */
 template <typename T, bool check_transparent>
 void randomize_vertical_polygon_lines(
 	struct bitmap_definition *screen,
@@ -580,13 +635,15 @@ void randomize_vertical_polygon_lines(
 	struct _vertical_polygon_data *data,
 	short *y0_table,
 	short *y1_table,
-	uint16 transfer_data)
+	uint16 transfer_data,
+	uint16 &seed,
+	short band_top,
+	short band_bottom)
 {
 	struct _vertical_polygon_line_data *line= (struct _vertical_polygon_line_data *) (data+1);
 	short bytes_per_row= screen->bytes_per_row;
 	int line_count= data->width;
 	int x= data->x0;
-	uint16 seed= texture_random_seed();
 	uint16 drop_less_than= transfer_data;
 
 	(void) (view);
@@ -597,13 +654,13 @@ void randomize_vertical_polygon_lines(
 		T *write= (T *) screen->row_addresses[y0] + x;
 		pixel8 *read= line->texture;
 		_fixed texture_y= line->texture_y, texture_dy= line->texture_dy;
-		short count= y1-y0;
+		short y;
 
-		while ((count-=1)>=0)
+		for (y= y0; y<y1; ++y)
 		{
 			if (!check_transparent || read[texture_y>>(data->downshift)])
 			{
-				if (seed >= drop_less_than) *write = randomize_vertical_polygon_lines_write<T>(seed);
+				if (seed >= drop_less_than && y>=band_top && y<band_bottom) *write = randomize_vertical_polygon_lines_write<T>(seed);
 				if (seed&1) seed= (seed>>1)^0xb400; else seed= seed>>1;
 			}
 
@@ -614,6 +671,4 @@ void randomize_vertical_polygon_lines(
 		line+= 1;
 		x+= 1;
 	}
-	
-	texture_random_seed() = seed;
 }
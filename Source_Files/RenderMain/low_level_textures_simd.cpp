@@ -0,0 +1,324 @@
+/*
+	Copyright (C) 2021 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Vector kernels for the software rasterizer's innermost loops
+
+	Texels are always fetched one byte at a time: a wider gather could read
+	past the end of a bitmap. The shading tables are looked up one pixel at a
+	time too, since hardware gathers turned out slower than scalar loads;
+	everything else (texture coordinates, blending, transparency, stores) is
+	done a vector at a time.
+*/
+
+#include "cseries.h"
+#include "low_level_textures_simd.h"
+
+#include <SDL_cpuinfo.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_KERNELS_SSE2
+#include <emmintrin.h>
+
+// AVX2 kernels are compiled for that target alone, and only used if the processor has it
+#if defined(__GNUC__) || defined(__clang__)
+#define TEXTURE_KERNELS_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TEXTURE_KERNELS_AVX2
+#define TARGET_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TEXTURE_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+vertical_lines32_x4_kernel vertical_lines32_x4_kernels[2][2];
+landscape_line32_kernel landscape_line32 = NULL;
+
+#ifdef TEXTURE_KERNELS_SSE2
+
+// average<pixel32>() and the transparency test from low_level_textures.h
+static inline __m128i finish_pixels_sse2(__m128i pixels, __m128i texels, pixel32 *write, bool average, bool check_transparent)
+{
+	if (average || check_transparent)
+	{
+		__m128i background = _mm_loadu_si128((const __m128i *) write);
+
+		if (average)
+		{
+			__m128i half_difference = _mm_srli_epi32(_mm_and_si128(_mm_xor_si128(pixels, background), _mm_set1_epi32(0xfffefefe)), 1);
+			pixels = _mm_add_epi32(half_difference, _mm_and_si128(pixels, background));
+		}
+		if (check_transparent)
+		{
+			__m128i transparent = _mm_cmpeq_epi32(texels, _mm_setzero_si128());
+			pixels = _mm_or_si128(_mm_and_si128(transparent, background), _mm_andnot_si128(transparent, pixels));
+		}
+	}
+
+	return pixels;
+}
+
+template <bool average, bool check_transparent>
+static void vertical_lines32_x4_sse2(pixel32 *write, int bytes_per_row, int count, int downshift,
+	pixel8 * const read[4], pixel32 * const shading_tables[4], const uint32 texture_y[4], const uint32 texture_dy[4])
+{
+	__m128i y = _mm_loadu_si128((const __m128i *) texture_y);
+	__m128i dy = _mm_loadu_si128((const __m128i *) texture_dy);
+	__m128i shift = _mm_cvtsi32_si128(downshift);
+	alignas(16) uint32 rows[4];
+
+	for (; count > 0; --count)
+	{
+		_mm_store_si128((__m128i *) rows, _mm_srl_epi32(y, shift));
+
+		pixel8 t0 = read[0][rows[0]], t1 = read[1][rows[1]], t2 = read[2][rows[2]], t3 = read[3][rows[3]];
+		__m128i texels = _mm_setr_epi32(t0, t1, t2, t3);
+		__m128i pixels = _mm_setr_epi32(shading_tables[0][t0], shading_tables[1][t1], shading_tables[2][t2], shading_tables[3][t3]);
+
+		_mm_storeu_si128((__m128i *) write, finish_pixels_sse2(pixels, texels, write, average, check_transparent));
+
+		y = _mm_add_epi32(y, dy);
+		write = (pixel32 *)((byte *) write + bytes_per_row);
+	}
+}
+
+static void landscape_line32_sse2(pixel32 *write, const pixel8 *read, const pixel32 *shading_table,
+	uint32 source_x, uint32 source_dx, int downshift, int count)
+{
+	__m128i x = _mm_setr_epi32(source_x, source_x + source_dx, source_x + 2*source_dx, source_x + 3*source_dx);
+	__m128i dx = _mm_set1_epi32(4*source_dx);
+	__m128i shift = _mm_cvtsi32_si128(downshift);
+	alignas(16) uint32 columns[4];
+
+	for (; count >= 4; count -= 4)
+	{
+		_mm_store_si128((__m128i *) columns, _mm_srl_epi32(x, shift));
+		_mm_storeu_si128((__m128i *) write, _mm_setr_epi32(shading_table[read[columns[0]]], shading_table[read[columns[1]]],
+			shading_table[read[columns[2]]], shading_table[read[columns[3]]]));
+
+		x = _mm_add_epi32(x, dx);
+		source_x += 4*source_dx;
+		write += 4;
+	}
+
+	for (; count > 0; --count)
+	{
+		*write++ = shading_table[read[source_x >> downshift]];
+		source_x += source_dx;
+	}
+}
+
+#endif
+
+#ifdef TEXTURE_KERNELS_AVX2
+
+// two lines of four columns at a time
+template <bool average, bool check_transparent>
+TARGET_AVX2
+static void vertical_lines32_x4_avx2(pixel32 *write, int bytes_per_row, int count, int downshift,
+	pixel8 * const read[4], pixel32 * const shading_tables[4], const uint32 texture_y[4], const uint32 texture_dy[4])
+{
+	__m128i y0 = _mm_loadu_si128((const __m128i *) texture_y);
+	__m128i dy = _mm_loadu_si128((const __m128i *) texture_dy);
+	__m256i y = _mm256_inserti128_si256(_mm256_castsi128_si256(y0), _mm_add_epi32(y0, dy), 1);
+	__m256i dy2 = _mm256_broadcastsi128_si256(_mm_add_epi32(dy, dy));
+	__m128i shift = _mm_cvtsi32_si128(downshift);
+	alignas(32) uint32 rows[8];
+
+	for (; count >= 2; count -= 2)
+	{
+		pixel32 *next_write = (pixel32 *)((byte *) write + bytes_per_row);
+
+		_mm256_store_si256((__m256i *) rows, _mm256_srl_epi32(y, shift));
+
+		pixel8 t0 = read[0][rows[0]], t1 = read[1][rows[1]], t2 = read[2][rows[2]], t3 = read[3][rows[3]];
+		pixel8 t4 = read[0][rows[4]], t5 = read[1][rows[5]], t6 = read[2][rows[6]], t7 = read[3][rows[7]];
+		__m256i pixels = _mm256_setr_epi32(shading_tables[0][t0], shading_tables[1][t1], shading_tables[2][t2], shading_tables[3][t3],
+			shading_tables[0][t4], shading_tables[1][t5], shading_tables[2][t6], shading_tables[3][t7]);
+
+		if (average || check_transparent)
+		{
+			__m256i background = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) write)),
+				_mm_loadu_si128((const __m128i *) next_write), 1);
+
+			if (average)
+			{
+				__m256i half_difference = _mm256_srli_epi32(_mm256_and_si256(_mm256_xor_si256(pixels, background), _mm256_set1_epi32(0xfffefefe)), 1);
+				pixels = _mm256_add_epi32(half_difference, _mm256_and_si256(pixels, background));
+			}
+			if (check_transparent)
+			{
+				__m256i texels = _mm256_setr_epi32(t0, t1, t2, t3, t4, t5, t6, t7);
+				pixels = _mm256_blendv_epi8(pixels, background, _mm256_cmpeq_epi32(texels, _mm256_setzero_si256()));
+			}
+		}
+		_mm_storeu_si128((__m128i *) write, _mm256_castsi256_si128(pixels));
+		_mm_storeu_si128((__m128i *) next_write, _mm256_extracti128_si256(pixels, 1));
+
+		y = _mm256_add_epi32(y, dy2);
+		write = (pixel32 *)((byte *) next_write + bytes_per_row);
+	}
+
+	if (count > 0)
+	{
+		alignas(16) uint32 last_y[4];
+
+		_mm_store_si128((__m128i *) last_y, _mm256_castsi256_si128(y));
+		vertical_lines32_x4_sse2<average, check_transparent>(write, bytes_per_row, count, downshift, read, shading_tables, last_y, texture_dy);
+	}
+}
+
+TARGET_AVX2
+static void landscape_line32_avx2(pixel32 *write, const pixel8 *read, const pixel32 *shading_table,
+	uint32 source_x, uint32 source_dx, int downshift, int count)
+{
+	__m256i x = _mm256_add_epi32(_mm256_set1_epi32(source_x), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(source_dx)));
+	__m256i dx = _mm256_set1_epi32(8*source_dx);
+	__m128i shift = _mm_cvtsi32_si128(downshift);
+	alignas(32) uint32 columns[8];
+
+	for (; count >= 8; count -= 8)
+	{
+		_mm256_store_si256((__m256i *) columns, _mm256_srl_epi32(x, shift));
+		_mm256_storeu_si256((__m256i *) write, _mm256_setr_epi32(
+			shading_table[read[columns[0]]], shading_table[read[columns[1]]], shading_table[read[columns[2]]], shading_table[read[columns[3]]],
+			shading_table[read[columns[4]]], shading_table[read[columns[5]]], shading_table[read[columns[6]]], shading_table[read[columns[7]]]));
+
+		x = _mm256_add_epi32(x, dx);
+		source_x += 8*source_dx;
+		write += 8;
+	}
+
+	for (; count > 0; --count)
+	{
+		*write++ = shading_table[read[source_x >> downshift]];
+		source_x += source_dx;
+	}
+}
+
+#endif
+
+#ifdef TEXTURE_KERNELS_NEON
+
+template <bool average, bool check_transparent>
+static void vertical_lines32_x4_neon(pixel32 *write, int bytes_per_row, int count, int downshift,
+	pixel8 * const read[4], pixel32 * const shading_tables[4], const uint32 texture_y[4], const uint32 texture_dy[4])
+{
+	uint32x4_t y = vld1q_u32(texture_y);
+	uint32x4_t dy = vld1q_u32(texture_dy);
+	int32x4_t shift = vdupq_n_s32(-downshift);
+	uint32 rows[4];
+
+	for (; count > 0; --count)
+	{
+		vst1q_u32(rows, vshlq_u32(y, shift));
+
+		uint32 texels[4] = { read[0][rows[0]], read[1][rows[1]], read[2][rows[2]], read[3][rows[3]] };
+		uint32 colors[4] = { shading_tables[0][texels[0]], shading_tables[1][texels[1]], shading_tables[2][texels[2]], shading_tables[3][texels[3]] };
+		uint32x4_t pixels = vld1q_u32(colors);
+
+		if (average || check_transparent)
+		{
+			uint32x4_t background = vld1q_u32(write);
+
+			if (average)
+			{
+				uint32x4_t half_difference = vshrq_n_u32(vandq_u32(veorq_u32(pixels, background), vdupq_n_u32(0xfffefefe)), 1);
+				pixels = vaddq_u32(half_difference, vandq_u32(pixels, background));
+			}
+			if (check_transparent)
+			{
+				pixels = vbslq_u32(vceqq_u32(vld1q_u32(texels), vdupq_n_u32(0)), background, pixels);
+			}
+		}
+		vst1q_u32(write, pixels);
+
+		y = vaddq_u32(y, dy);
+		write = (pixel32 *)((byte *) write + bytes_per_row);
+	}
+}
+
+static void landscape_line32_neon(pixel32 *write, const pixel8 *read, const pixel32 *shading_table,
+	uint32 source_x, uint32 source_dx, int downshift, int count)
+{
+	uint32 first[4] = { source_x, source_x + source_dx, source_x + 2*source_dx, source_x + 3*source_dx };
+	uint32x4_t x = vld1q_u32(first);
+	uint32x4_t dx = vdupq_n_u32(4*source_dx);
+	int32x4_t shift = vdupq_n_s32(-downshift);
+	uint32 columns[4];
+
+	for (; count >= 4; count -= 4)
+	{
+		vst1q_u32(columns, vshlq_u32(x, shift));
+
+		uint32 colors[4] = { shading_table[read[columns[0]]], shading_table[read[columns[1]]], shading_table[read[columns[2]]], shading_table[read[columns[3]]] };
+		vst1q_u32(write, vld1q_u32(colors));
+
+		x = vaddq_u32(x, dx);
+		source_x += 4*source_dx;
+		write += 4;
+	}
+
+	for (; count > 0; --count)
+	{
+		*write++ = shading_table[read[source_x >> downshift]];
+		source_x += source_dx;
+	}
+}
+
+#endif
+
+#define SET_VERTICAL_KERNELS(name) \
+	vertical_lines32_x4_kernels[0][0] = name<false, false>; \
+	vertical_lines32_x4_kernels[0][1] = name<false, true>; \
+	vertical_lines32_x4_kernels[1][0] = name<true, false>; \
+	vertical_lines32_x4_kernels[1][1] = name<true, true>
+
+const char *choose_texture_kernels()
+{
+#ifdef TEXTURE_KERNELS_AVX2
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+	if (SDL_HasAVX2())
+	{
+		SET_VERTICAL_KERNELS(vertical_lines32_x4_avx2);
+		landscape_line32 = landscape_line32_avx2;
+		return "AVX2";
+	}
+#endif
+#endif
+#ifdef TEXTURE_KERNELS_SSE2
+	if (SDL_HasSSE2())
+	{
+		SET_VERTICAL_KERNELS(vertical_lines32_x4_sse2);
+		landscape_line32 = landscape_line32_sse2;
+		return "SSE2";
+	}
+#endif
+#ifdef TEXTURE_KERNELS_NEON
+	// always there on the targets that define __ARM_NEON
+	SET_VERTICAL_KERNELS(vertical_lines32_x4_neon);
+	landscape_line32 = landscape_line32_neon;
+	return "NEON";
+#endif
+
+	return "scalar";
+}
@@ -0,0 +1,46 @@
+#ifndef LOW_LEVEL_TEXTURES_SIMD_H
+#define LOW_LEVEL_TEXTURES_SIMD_H
+
+/*
+	Copyright (C) 2021 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+*/
+
+#include "cstypes.h"
+
+// Vector versions of the innermost 32-bit loops in low_level_textures.h,
+// chosen at launch from what the processor supports (AVX2 or SSE2 on x86,
+// NEON on ARM). Each writes exactly the pixels the scalar loop it replaces
+// would; where a kernel is NULL, the scalar loop is used.
+
+// Four adjacent wall columns drawn together for count lines, as in the
+// parallel part of texture_vertical_polygon_lines(); texture_y is where each
+// column is at the first line.
+typedef void (*vertical_lines32_x4_kernel)(pixel32 *write, int bytes_per_row, int count, int downshift,
+	pixel8 * const read[4], pixel32 * const shading_tables[4], const uint32 texture_y[4], const uint32 texture_dy[4]);
+
+// One line of landscape_horizontal_polygon_lines(); downshift must be less than 32
+typedef void (*landscape_line32_kernel)(pixel32 *write, const pixel8 *read, const pixel32 *shading_table,
+	uint32 source_x, uint32 source_dx, int downshift, int count);
+
+// [averaged with what's already there (_sw_alpha_fast)][skip transparent texels]
+extern vertical_lines32_x4_kernel vertical_lines32_x4_kernels[2][2];
+extern landscape_line32_kernel landscape_line32;
+
+// Call once at launch; returns the name of the instruction set chosen
+const char *choose_texture_kernels();
+
+#endif
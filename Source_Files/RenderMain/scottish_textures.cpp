@@ -120,6 +120,9 @@ not only that, but texture_horizontal_polygon() is actually faster than texture_
 
 #include "preferences.h"
 #include "SW_Texture_Extras.h"
+#include "Logging.h"
+
+#include <vector>
 
 
 /* ---------- constants */
@@ -175,10 +178,77 @@ static void calculate_shading_table(void * &result,view_data *view, void *shadin
 /* these tables are used by the polygon rasterizer (to store the x-coordinates of the left and
 	right lines of the current polygon), the trapezoid rasterizer (to store the y-coordinates
 	of the top and bottom of the current trapezoid) and the rectangle mapper (for its
-	vertical and if necessary horizontal distortion tables).  these are not necessary as
-	globals, just as global storage. */
-static short *scratch_table0 = NULL, *scratch_table1 = NULL;
-static void *precalculation_table = NULL;
+	vertical and if necessary horizontal distortion tables).  while commands are being deferred
+	for screen bands every command keeps its own piece of them until the frame is drawn, so they
+	grow as needed. */
+static vector<short> scratch_tables;
+static size_t scratch_tables_used= 0;
+
+union precalculation_entry
+{
+	struct _horizontal_polygon_line_data horizontal;
+	struct _vertical_polygon_data vertical_header;
+	struct _vertical_polygon_line_data vertical;
+};
+
+static vector<precalculation_entry> precalculation_table;
+static size_t precalculation_table_used= 0;
+
+/* ---------- screen bands */
+
+/* once the mode-specific data has been precalculated, a polygon or rectangle is drawn by one of
+	these; with more than one processor they are all recorded and then drawn in horizontal bands
+	of the screen, one band per thread, each clipped to its own lines */
+enum /* rasterizer command types */
+{
+	_horizontal_polygon_command,
+	_landscape_polygon_command,
+	_vertical_polygon_command,
+	_static_polygon_command,
+	_tinted_polygon_command
+};
+
+struct rasterizer_command
+{
+	int16 type;
+	int16 alpha_blending; /* _sw_alpha_off, _sw_alpha_fast or _sw_alpha_nice */
+	bool check_transparent;
+	uint16 transfer_data;
+	uint16 random_seed; /* texture_random_seed() when the command was recorded */
+	
+	struct bitmap_definition *texture; /* horizontal polygons only */
+	uint8 *opacity_table;
+	
+	short y0; /* horizontal polygons only */
+	short line_count;
+	size_t table_offset; /* two tables of line_count entries */
+	size_t data_offset;
+};
+
+enum
+{
+	MAXIMUM_RASTERIZER_BANDS= 16,
+	MINIMUM_RASTERIZER_BAND_HEIGHT= 32
+};
+
+struct rasterizer_band
+{
+	short top, bottom;
+	
+	SDL_Thread *thread;
+	SDL_sem *start;
+};
+
+static vector<rasterizer_command> rasterizer_commands;
+static bool defer_rasterizer_commands= false;
+
+static rasterizer_band rasterizer_bands[MAXIMUM_RASTERIZER_BANDS];
+static short rasterizer_band_count= 0; /* 0 until the band threads have been started */
+static SDL_sem *rasterizer_bands_done= NULL;
+static bool quit_rasterizer_bands= false;
+static void (*band_procedure)(short top, short bottom)= NULL;
+static struct bitmap_definition *band_screen= NULL;
+static struct view_data *band_view= NULL;
 
 /* ---------- private prototypes */
 
@@ -197,6 +267,21 @@ static void _prelandscape_horizontal_polygon_lines(struct polygon_definition *po
 	struct bitmap_definition *screen, struct view_data *view, struct _horizontal_polygon_line_data *data,
 	short y0, short *x0_table, short *x1_table, short line_count);
 
+static void new_rasterizer_command(struct rasterizer_command *command);
+static short *allocate_scratch_tables(struct rasterizer_command *command, short line_count);
+static precalculation_entry *allocate_precalculation_table(struct rasterizer_command *command, size_t entry_count);
+static void choose_alpha_blending(struct rasterizer_command *command, struct polygon_definition *polygon);
+static void submit_rasterizer_command(struct rasterizer_command *command, struct bitmap_definition *screen,
+	struct view_data *view);
+static uint16 draw_rasterizer_command(struct rasterizer_command *command, struct bitmap_definition *screen,
+	struct view_data *view, short band_top, short band_bottom);
+
+static void start_rasterizer_bands(void);
+static void stop_rasterizer_bands(void);
+static void draw_rasterizer_band(short top, short bottom);
+static void draw_rasterizer_bands(struct bitmap_definition *screen, struct view_data *view);
+static int rasterizer_band_thread(void *data);
+
 /* ---------- code */
 
 /* set aside memory at launch for two line tables (remember, we precalculate all the y-values
@@ -204,10 +289,29 @@ static void _prelandscape_horizontal_polygon_lines(struct polygon_definition *po
 void allocate_texture_tables(
 	void)
 {
-	scratch_table0= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	scratch_table1= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	precalculation_table= (void*)new char[MAXIMUM_PRECALCULATION_TABLE_ENTRY_SIZE*MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	fc_assert(scratch_table0&&scratch_table1&&precalculation_table);
+	scratch_tables.resize(2*MAXIMUM_SCRATCH_TABLE_ENTRIES);
+	precalculation_table.resize(MAXIMUM_SCRATCH_TABLE_ENTRIES);
+	
+	logNote("software rasterizer using %s texture kernels", choose_texture_kernels());
+}
+
+/* if we can draw in bands, start recording commands instead of drawing them */
+void Rasterizer_SW_Class::Begin()
+{
+	start_rasterizer_bands();
+	
+	rasterizer_commands.clear();
+	scratch_tables_used= precalculation_table_used= 0;
+	defer_rasterizer_commands= rasterizer_band_count>1 && screen->height>=rasterizer_band_count*MINIMUM_RASTERIZER_BAND_HEIGHT;
+}
+
+void Rasterizer_SW_Class::End()
+{
+	if (defer_rasterizer_commands)
+	{
+		draw_rasterizer_bands(screen, view);
+		defer_rasterizer_commands= false;
+	}
 }
 
 void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& textured_polygon)
@@ -243,7 +347,8 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		short left_line_count, right_line_count, total_line_count;
 		short aggregate_left_line_count, aggregate_right_line_count, aggregate_total_line_count;
 		short left_vertex, right_vertex;
-		short *left_table= scratch_table0, *right_table= scratch_table1;
+		struct rasterizer_command command;
+		short *left_table, *right_table;
 
 		left_line_count= right_line_count= 0; /* zero counts so the left and right lines get initialized */
 		aggregate_left_line_count= aggregate_right_line_count= 0; /* weve precalculated nothing initially */
@@ -251,6 +356,9 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		total_line_count= vertices[lowest_vertex].y-vertices[highest_vertex].y; /* calculate vertical line count */
 
 		fc_assert(total_line_count<MAXIMUM_SCRATCH_TABLE_ENTRIES); /* make sure we have enough scratch space */
+		new_rasterizer_command(&command);
+		left_table= allocate_scratch_tables(&command, total_line_count);
+		right_table= left_table+total_line_count;
 		
 		/* precalculate high and low y-coordinates for every x-coordinate */			
 		aggregate_total_line_count= total_line_count;
@@ -308,122 +416,30 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		switch (polygon->transfer_mode)
 		{
 			case _textured_transfer:
-				_pretexture_horizontal_polygon_lines(polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
+				command.type= _horizontal_polygon_command;
+				choose_alpha_blending(&command, polygon);
+				_pretexture_horizontal_polygon_lines(polygon, screen, view, &allocate_precalculation_table(&command, aggregate_total_line_count)->horizontal,
 					vertices[highest_vertex].y, left_table, right_table,
 					aggregate_total_line_count);
 				break;
 
 			case _big_landscaped_transfer:
-				_prelandscape_horizontal_polygon_lines(polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
+				command.type= _landscape_polygon_command;
+				_prelandscape_horizontal_polygon_lines(polygon, screen, view, &allocate_precalculation_table(&command, aggregate_total_line_count)->horizontal,
 					vertices[highest_vertex].y, left_table, right_table,
 					aggregate_total_line_count);
 				break;
 			
 			default:
 				VHALT_DEBUG(csprintf(temporary, "horizontal_polygons dont support mode #%d", polygon->transfer_mode));
+				fc_assert(false);
+				return;
 		}
 		
 		/* render all lines */
-		switch (bit_depth)
-		{
-			case 8:
-				switch (polygon->transfer_mode)
-				{
-	
-					case _textured_transfer:
-						texture_horizontal_polygon_lines<pixel8, _sw_alpha_off>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-							vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						break;
-					case _big_landscaped_transfer:
-						landscape_horizontal_polygon_lines<pixel8>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-							vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						break;
-						
-					default:
-						fc_assert(false);
-						break;
-				}
-				break;
-
-			case 16:
-				switch (polygon->transfer_mode)
-				{
-					case _textured_transfer:
-					{
-						SW_Texture *sw_texture = 0;
-						if (graphics_preferences->software_alpha_blending)
-						{
-							sw_texture = SW_Texture_Extras::instance()->GetTexture(polygon->ShapeDesc);
-						}
-						if (sw_texture && !polygon->VoidPresent && sw_texture->opac_type())
-						{
-							if (graphics_preferences->software_alpha_blending == _sw_alpha_fast) {
-								texture_horizontal_polygon_lines<pixel16, _sw_alpha_fast>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table, vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-							}
-							else if (graphics_preferences->software_alpha_blending == _sw_alpha_nice) {
-								texture_horizontal_polygon_lines<pixel16, _sw_alpha_nice>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *) precalculation_table, vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count, sw_texture->opac_table());
-							}
-						} else {
-							texture_horizontal_polygon_lines<pixel16, _sw_alpha_off>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-											  vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						}
-					}
-					break;
-						
-				case _big_landscaped_transfer:
-						landscape_horizontal_polygon_lines<pixel16>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-							vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						break;
-					default:
-						fc_assert(false);
-						break;
-				}
-				break;
-
-			case 32:
-				switch (polygon->transfer_mode)
-				{
-				case _textured_transfer:
-				{
-					SW_Texture *sw_texture = 0;
-					if (graphics_preferences->software_alpha_blending)
-					{
-						sw_texture = SW_Texture_Extras::instance()->GetTexture(polygon->ShapeDesc);
-					}
-					if (sw_texture && sw_texture->opac_type() && !polygon->VoidPresent)
-					{
-						if (graphics_preferences->software_alpha_blending == _sw_alpha_fast)
-						{
-							texture_horizontal_polygon_lines<pixel32, _sw_alpha_fast>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table, vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						} 
-						else if (graphics_preferences->software_alpha_blending == _sw_alpha_nice)
-						{
-							texture_horizontal_polygon_lines<pixel32, _sw_alpha_nice>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *) precalculation_table, vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count, sw_texture->opac_table());
-						}
-					}
-					else 
-					{
-						texture_horizontal_polygon_lines<pixel32, _sw_alpha_off>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-											  vertices[highest_vertex].y, left_table, right_table,
-											  aggregate_total_line_count);
-					}
-				}
-				break;
-					case _big_landscaped_transfer:
-						landscape_horizontal_polygon_lines<pixel32>(polygon->texture, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
-							vertices[highest_vertex].y, left_table, right_table, aggregate_total_line_count);
-						break;
-					
-					default:
-						fc_assert(false);
-						break;
-				}
-				break;
-
-			default:
-				fc_assert(false);
-				break;
-		}
+		command.texture= polygon->texture;
+		command.y0= vertices[highest_vertex].y;
+		submit_rasterizer_command(&command, screen, view);
 	}
 }
 
@@ -463,7 +479,8 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		short left_line_count, right_line_count, total_line_count;
 		short aggregate_left_line_count, aggregate_right_line_count, aggregate_total_line_count;
 		short left_vertex, right_vertex;
-		short *left_table= scratch_table0, *right_table= scratch_table1;
+		struct rasterizer_command command;
+		short *left_table, *right_table;
 
 		left_line_count= right_line_count= 0; /* zero counts so the left and right lines get initialized */
 		aggregate_left_line_count= aggregate_right_line_count= 0; /* weve precalculated nothing initially */
@@ -471,6 +488,9 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		total_line_count= vertices[lowest_vertex].x-vertices[highest_vertex].x; /* calculate vertical line count */
 
 		fc_assert(total_line_count<MAXIMUM_SCRATCH_TABLE_ENTRIES); /* make sure we have enough scratch space */
+		new_rasterizer_command(&command);
+		left_table= allocate_scratch_tables(&command, total_line_count);
+		right_table= left_table+total_line_count;
 		
 		/* precalculate high and low y-coordinates for every x-coordinate */			
 		aggregate_total_line_count= total_line_count;
@@ -523,136 +543,29 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		fc_assert(aggregate_left_line_count==aggregate_total_line_count);
 
 		/* precalculate mode-specific data */
-
-          if ((polygon->transfer_mode == _textured_transfer) || (polygon->transfer_mode == _static_transfer))
-          {
-              _pretexture_vertical_polygon_lines(polygon, screen, view, (struct _vertical_polygon_data *)precalculation_table, vertices[highest_vertex].x, left_table, right_table, aggregate_total_line_count);
-          }
-          else VHALT_DEBUG(csprintf(temporary, "vertical_polygons dont support mode #%d", polygon->transfer_mode));
-          
-		/* render all lines */
-		switch (bit_depth)
+		switch (polygon->transfer_mode)
 		{
-			case 8:
-				switch (polygon->transfer_mode)
-				{
-					case _textured_transfer:
-						if (polygon->texture->flags&_TRANSPARENT_BIT)
-							texture_vertical_polygon_lines<pixel8, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-						else
-							texture_vertical_polygon_lines<pixel8, _sw_alpha_off, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-						break;
-					case _static_transfer:
-						if (polygon->texture->flags&_TRANSPARENT_BIT)
-							randomize_vertical_polygon_lines<pixel8, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-						else
-							randomize_vertical_polygon_lines<pixel8, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-						break;
-						
-				default:
-					fc_assert(false);
-					break;
-				}
-				break;
-				
-			case 16:
-				switch (polygon->transfer_mode)
-				{
-				case _textured_transfer:
-				{
-					SW_Texture *sw_texture =0 ;
-					if (graphics_preferences->software_alpha_blending)
-					{
-						sw_texture = SW_Texture_Extras::instance()->GetTexture(polygon->ShapeDesc);
-					}
-					if (sw_texture && !polygon->VoidPresent && sw_texture->opac_type())
-					{
-						if (graphics_preferences->software_alpha_blending == _sw_alpha_fast) {
-							if (polygon->texture->flags & _TRANSPARENT_BIT) {
-								texture_vertical_polygon_lines<pixel16, _sw_alpha_fast, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-							} else {
-								texture_vertical_polygon_lines<pixel16, _sw_alpha_fast, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-							}
-						} 
-						else if (graphics_preferences->software_alpha_blending == _sw_alpha_nice) {
-							if (polygon->texture->flags & _TRANSPARENT_BIT)  {
-								texture_vertical_polygon_lines<pixel16, _sw_alpha_nice, true>(screen, view, (struct _vertical_polygon_data *) precalculation_table, left_table, right_table, sw_texture->opac_table());
-							} else {
-								texture_vertical_polygon_lines<pixel16, _sw_alpha_nice, false>(screen, view, (struct _vertical_polygon_data *) precalculation_table, left_table, right_table, sw_texture->opac_table());
-							}
-						}
-					} else {
-						if (polygon->texture->flags & _TRANSPARENT_BIT) {
-							texture_vertical_polygon_lines<pixel16, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-						} else {
-							texture_vertical_polygon_lines<pixel16, _sw_alpha_off, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-						}
-					}
-				}
-				break;
-				case _static_transfer:
-					if (polygon->texture->flags & _TRANSPARENT_BIT) {
-						randomize_vertical_polygon_lines<pixel16, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-					} else {
-						randomize_vertical_polygon_lines<pixel16, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-					}
-					break;
-				default:
-					fc_assert(false);
-					break;
-				}
+			case _textured_transfer:
+				command.type= _vertical_polygon_command;
+				choose_alpha_blending(&command, polygon);
 				break;
-				
-			case 32:
-				switch (polygon->transfer_mode)
-				{
-					case _textured_transfer:
-					{
-						SW_Texture *sw_texture = 0;
-						if (graphics_preferences->software_alpha_blending)
-						{
-							sw_texture = SW_Texture_Extras::instance()->GetTexture(polygon->ShapeDesc);
-						}
-						if (sw_texture && !polygon->VoidPresent && sw_texture->opac_type())
-						{
-							if (graphics_preferences->software_alpha_blending == _sw_alpha_fast) {
-								if (polygon->texture->flags&_TRANSPARENT_BIT)
-									texture_vertical_polygon_lines<pixel32, _sw_alpha_fast, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-								else
-									texture_vertical_polygon_lines<pixel32, _sw_alpha_fast, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-							}
-							else if (graphics_preferences->software_alpha_blending == _sw_alpha_nice) 
-							{
-								if (polygon->texture->flags & _TRANSPARENT_BIT)
-									texture_vertical_polygon_lines<pixel32, _sw_alpha_nice, true>(screen, view, (struct _vertical_polygon_data *) precalculation_table, left_table, right_table, sw_texture->opac_table());
-								else
-									texture_vertical_polygon_lines<pixel32, _sw_alpha_nice, false>(screen, view, (struct _vertical_polygon_data *) precalculation_table, left_table, right_table, sw_texture->opac_table());
-							}
-						} else {
-							if (polygon->texture->flags & _TRANSPARENT_BIT)
-								texture_vertical_polygon_lines<pixel32, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-							else
-								texture_vertical_polygon_lines<pixel32, _sw_alpha_off, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table);
-						}
-						break;
-					}
-					case _static_transfer:
-						if (polygon->texture->flags & _TRANSPARENT_BIT)
-							randomize_vertical_polygon_lines<pixel32, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-						else
-							randomize_vertical_polygon_lines<pixel32, false>(screen, view, (struct _vertical_polygon_data *)precalculation_table, left_table, right_table, polygon->transfer_data);
-						break;
-						
-				default:
-					fc_assert(false);
-					break;
-				}
+			
+			case _static_transfer:
+				command.type= _static_polygon_command;
+				command.transfer_data= polygon->transfer_data;
 				break;
-				
-		default:
-			fc_assert(false);
-			break;
+			
+			default:
+				VHALT_DEBUG(csprintf(temporary, "vertical_polygons dont support mode #%d", polygon->transfer_mode));
+				fc_assert(false);
+				return;
 		}
+		command.check_transparent= (polygon->texture->flags&_TRANSPARENT_BIT) ? true : false;
+		_pretexture_vertical_polygon_lines(polygon, screen, view, &allocate_precalculation_table(&command, aggregate_total_line_count+1)->vertical_header,
+			vertices[highest_vertex].x, left_table, right_table, aggregate_total_line_count);
+		
+		/* render all lines */
+		submit_rasterizer_command(&command, screen, view);
 	}
 }
 
@@ -685,9 +598,10 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 			short screen_x= rectangle->x0;
 			struct bitmap_definition *texture= rectangle->texture;
 	
-			short *y0_table= scratch_table0, *y1_table= scratch_table1;
-			struct _vertical_polygon_data *header= (struct _vertical_polygon_data *)precalculation_table;
-			struct _vertical_polygon_line_data *data= (struct _vertical_polygon_line_data *) (header+1);
+			struct rasterizer_command command;
+			short *y0_table, *y1_table;
+			struct _vertical_polygon_data *header;
+			struct _vertical_polygon_line_data *data;
 			
 			_fixed texture_dx= INTEGER_TO_FIXED(texture->width)/screen_width;
 			_fixed texture_x= texture_dx>>1;
@@ -733,6 +647,12 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 	
 				texture_y1= texture_y0 + screen_height*texture_dy;
 				
+				new_rasterizer_command(&command);
+				y0_table= allocate_scratch_tables(&command, screen_width);
+				y1_table= y0_table+screen_width;
+				header= &allocate_precalculation_table(&command, screen_width+1)->vertical_header;
+				data= (struct _vertical_polygon_line_data *) (header+1);
+				
 				header->downshift= FIXED_FRACTIONAL_BITS;
 				header->width= screen_width;
 				header->x0= screen_x;
@@ -804,83 +724,19 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 					fc_assert(y1<=screen->height);
 				}
 		
-				switch (bit_depth)
+				switch (rectangle->transfer_mode)
 				{
-					case 8:
-						switch (rectangle->transfer_mode)
-						{
-							case _textured_transfer:
-								texture_vertical_polygon_lines<pixel8, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1);
-								break;
-							
-							case _static_transfer:
-								randomize_vertical_polygon_lines<pixel8, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							case _tinted_transfer:
-								tint_vertical_polygon_lines<pixel8>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							default:
-								fc_assert(false);
-								break;
-						}
-						break;
-		
-					case 16:
-						switch (rectangle->transfer_mode)
-						{
-							case _textured_transfer:
-								texture_vertical_polygon_lines<pixel16, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table, scratch_table0, scratch_table1);
-								break;
-								
-							case _static_transfer:
-								randomize_vertical_polygon_lines<pixel16, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							case _tinted_transfer:
-								tint_vertical_polygon_lines<pixel16>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							default:
-								fc_assert(false);
-								break;
-						}
-						break;
-		
-					case 32:
-						switch (rectangle->transfer_mode)
-						{
-							case _textured_transfer:
-								texture_vertical_polygon_lines<pixel32, _sw_alpha_off, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1);
-								break;
-							
-							case _static_transfer:
-								randomize_vertical_polygon_lines<pixel32, true>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							case _tinted_transfer:
-								tint_vertical_polygon_lines<pixel32>(screen, view, (struct _vertical_polygon_data *)precalculation_table,
-									scratch_table0, scratch_table1, rectangle->transfer_data);
-								break;
-							
-							default:
-								fc_assert(false);
-								break;
-						}
-						break;
-		
+					case _textured_transfer: command.type= _vertical_polygon_command; break;
+					case _static_transfer: command.type= _static_polygon_command; break;
+					case _tinted_transfer: command.type= _tinted_polygon_command; break;
+					
 					default:
 						fc_assert(false);
-						break;
+						return;
 				}
+				command.check_transparent= true;
+				command.transfer_data= rectangle->transfer_data;
+				submit_rasterizer_command(&command, screen, view);
 			}
 		}
 	}
@@ -1292,3 +1148,309 @@ static short *build_y_table(
 	
 	return table;
 }
+
+
+/* ---------- rasterizer commands */
+
+static void new_rasterizer_command(
+	struct rasterizer_command *command)
+{
+	obj_clear(*command);
+	command->random_seed= texture_random_seed();
+	
+	/* when drawing right away, nothing needs the last command's tables any more */
+	if (!defer_rasterizer_commands)
+	{
+		scratch_tables_used= precalculation_table_used= 0;
+	}
+}
+
+/* two tables of line_count entries, one after the other */
+static short *allocate_scratch_tables(
+	struct rasterizer_command *command,
+	short line_count)
+{
+	size_t needed= scratch_tables_used + 2*line_count;
+	
+	if (needed>scratch_tables.size()) scratch_tables.resize(MAX(needed, 2*scratch_tables.size()));
+	
+	command->table_offset= scratch_tables_used;
+	command->line_count= line_count;
+	scratch_tables_used= needed;
+	
+	return &scratch_tables[command->table_offset];
+}
+
+static precalculation_entry *allocate_precalculation_table(
+	struct rasterizer_command *command,
+	size_t entry_count)
+{
+	size_t needed= precalculation_table_used + entry_count;
+	
+	if (needed>precalculation_table.size()) precalculation_table.resize(MAX(needed, 2*precalculation_table.size()));
+	
+	command->data_offset= precalculation_table_used;
+	precalculation_table_used= needed;
+	
+	return &precalculation_table[command->data_offset];
+}
+
+/* textured polygons may be alpha-blended in 16- and 32-bit modes */
+static void choose_alpha_blending(
+	struct rasterizer_command *command,
+	struct polygon_definition *polygon)
+{
+	command->alpha_blending= _sw_alpha_off;
+	
+	if (bit_depth!=8 && graphics_preferences->software_alpha_blending)
+	{
+		SW_Texture *sw_texture= SW_Texture_Extras::instance()->GetTexture(polygon->ShapeDesc);
+		
+		if (sw_texture && !polygon->VoidPresent && sw_texture->opac_type())
+		{
+			command->alpha_blending= graphics_preferences->software_alpha_blending;
+			command->opacity_table= sw_texture->opac_table();
+		}
+	}
+}
+
+static void submit_rasterizer_command(
+	struct rasterizer_command *command,
+	struct bitmap_definition *screen,
+	struct view_data *view)
+{
+	if (defer_rasterizer_commands)
+	{
+		rasterizer_commands.push_back(*command);
+		
+		/* static draws from the random seed as it goes; find out where the next command's starts */
+		if (command->type==_static_polygon_command)
+		{
+			texture_random_seed()= draw_rasterizer_command(command, screen, view, 0, 0);
+		}
+	}
+	else
+	{
+		texture_random_seed()= draw_rasterizer_command(command, screen, view, 0, screen->height);
+	}
+}
+
+template <typename T, bool check_transparent>
+static void draw_vertical_polygon_command(
+	struct rasterizer_command *command,
+	struct bitmap_definition *screen,
+	struct view_data *view,
+	short band_top,
+	short band_bottom)
+{
+	struct _vertical_polygon_data *data= &precalculation_table[command->data_offset].vertical_header;
+	short *y0_table= &scratch_tables[command->table_offset];
+	short *y1_table= y0_table+command->line_count;
+	
+	switch (command->alpha_blending)
+	{
+		case _sw_alpha_off:
+			texture_vertical_polygon_lines<T, _sw_alpha_off, check_transparent>(screen, view, data, y0_table, y1_table, band_top, band_bottom);
+			break;
+		case _sw_alpha_fast:
+			texture_vertical_polygon_lines<T, _sw_alpha_fast, check_transparent>(screen, view, data, y0_table, y1_table, band_top, band_bottom);
+			break;
+		case _sw_alpha_nice:
+			texture_vertical_polygon_lines<T, _sw_alpha_nice, check_transparent>(screen, view, data, y0_table, y1_table, band_top, band_bottom, command->opacity_table);
+			break;
+	}
+}
+
+/* returns the random seed following this command */
+template <typename T>
+static uint16 draw_rasterizer_command(
+	struct rasterizer_command *command,
+	struct bitmap_definition *screen,
+	struct view_data *view,
+	short band_top,
+	short band_bottom)
+{
+	short *table0= &scratch_tables[command->table_offset];
+	short *table1= table0+command->line_count;
+	precalculation_entry *data= &precalculation_table[command->data_offset];
+	uint16 seed= command->random_seed;
+	
+	switch (command->type)
+	{
+		case _horizontal_polygon_command:
+			switch (command->alpha_blending)
+			{
+				case _sw_alpha_off:
+					texture_horizontal_polygon_lines<T, _sw_alpha_off>(command->texture, screen, view, &data->horizontal,
+						command->y0, table0, table1, command->line_count, band_top, band_bottom);
+					break;
+				case _sw_alpha_fast:
+					texture_horizontal_polygon_lines<T, _sw_alpha_fast>(command->texture, screen, view, &data->horizontal,
+						command->y0, table0, table1, command->line_count, band_top, band_bottom);
+					break;
+				case _sw_alpha_nice:
+					texture_horizontal_polygon_lines<T, _sw_alpha_nice>(command->texture, screen, view, &data->horizontal,
+						command->y0, table0, table1, command->line_count, band_top, band_bottom, command->opacity_table);
+					break;
+			}
+			break;
+		
+		case _landscape_polygon_command:
+			landscape_horizontal_polygon_lines<T>(command->texture, screen, view, &data->horizontal,
+				command->y0, table0, table1, command->line_count, band_top, band_bottom);
+			break;
+		
+		case _vertical_polygon_command:
+			if (command->check_transparent)
+				draw_vertical_polygon_command<T, true>(command, screen, view, band_top, band_bottom);
+			else
+				draw_vertical_polygon_command<T, false>(command, screen, view, band_top, band_bottom);
+			break;
+		
+		case _static_polygon_command:
+			if (command->check_transparent)
+				randomize_vertical_polygon_lines<T, true>(screen, view, &data->vertical_header, table0, table1, command->transfer_data, seed, band_top, band_bottom);
+			else
+				randomize_vertical_polygon_lines<T, false>(screen, view, &data->vertical_header, table0, table1, command->transfer_data, seed, band_top, band_bottom);
+			break;
+		
+		case _tinted_polygon_command:
+			tint_vertical_polygon_lines<T>(screen, view, &data->vertical_header, table0, table1, command->transfer_data, band_top, band_bottom);
+			break;
+		
+		default:
+			fc_assert(false);
+			break;
+	}
+	
+	return seed;
+}
+
+static uint16 draw_rasterizer_command(
+	struct rasterizer_command *command,
+	struct bitmap_definition *screen,
+	struct view_data *view,
+	short band_top,
+	short band_bottom)
+{
+	switch (bit_depth)
+	{
+		case 8: return draw_rasterizer_command<pixel8>(command, screen, view, band_top, band_bottom);
+		case 16: return draw_rasterizer_command<pixel16>(command, screen, view, band_top, band_bottom);
+		case 32: return draw_rasterizer_command<pixel32>(command, screen, view, band_top, band_bottom);
+		
+		default:
+			fc_assert(false);
+			return command->random_seed;
+	}
+}
+
+/* ---------- screen bands */
+
+/* one band per processor; the main thread draws the first band and a worker thread draws each
+	of the others */
+static void start_rasterizer_bands(
+	void)
+{
+	if (rasterizer_band_count) return;
+	
+	rasterizer_band_count= 1;
+	rasterizer_bands_done= SDL_CreateSemaphore(0);
+	if (!rasterizer_bands_done) return;
+	
+	for (int i= 1; i<PIN(SDL_GetCPUCount(), 1, MAXIMUM_RASTERIZER_BANDS); ++i)
+	{
+		struct rasterizer_band *band= &rasterizer_bands[i];
+		
+		band->start= SDL_CreateSemaphore(0);
+		if (!band->start) break;
+		band->thread= SDL_CreateThread(rasterizer_band_thread, "Rasterizer_SW_bandThread", band);
+		if (!band->thread)
+		{
+			SDL_DestroySemaphore(band->start);
+			break;
+		}
+		
+		rasterizer_band_count+= 1;
+	}
+	
+	atexit(stop_rasterizer_bands);
+}
+
+static void stop_rasterizer_bands(
+	void)
+{
+	quit_rasterizer_bands= true;
+	for (short i= 1; i<rasterizer_band_count; ++i)
+	{
+		SDL_SemPost(rasterizer_bands[i].start);
+		SDL_WaitThread(rasterizer_bands[i].thread, NULL);
+		SDL_DestroySemaphore(rasterizer_bands[i].start);
+	}
+	SDL_DestroySemaphore(rasterizer_bands_done);
+	
+	rasterizer_band_count= 1;
+}
+
+/* splits lines 0 through height-1 into bands at least minimum_band_height tall, at most one per
+	band thread, and calls procedure on each band from its own thread; returns when all of them
+	are done */
+void run_in_screen_bands(
+	short height,
+	short minimum_band_height,
+	void (*procedure)(short top, short bottom))
+{
+	short i, count;
+	
+	start_rasterizer_bands();
+	count= PIN(height/MAX(minimum_band_height, 1), 1, rasterizer_band_count);
+	
+	band_procedure= procedure;
+	for (i= 0; i<count; ++i)
+	{
+		rasterizer_bands[i].top= (height*i)/count;
+		rasterizer_bands[i].bottom= (height*(i+1))/count;
+	}
+	
+	for (i= 1; i<count; ++i) SDL_SemPost(rasterizer_bands[i].start);
+	procedure(rasterizer_bands[0].top, rasterizer_bands[0].bottom);
+	for (i= 1; i<count; ++i) SDL_SemWait(rasterizer_bands_done);
+}
+
+static void draw_rasterizer_band(
+	short top,
+	short bottom)
+{
+	for (size_t i= 0; i<rasterizer_commands.size(); ++i)
+	{
+		draw_rasterizer_command(&rasterizer_commands[i], band_screen, band_view, top, bottom);
+	}
+}
+
+/* replays every recorded command in every band; the bands don't overlap, and each one sees the
+	commands in the order they were recorded, so the result is the same as drawing them directly */
+static void draw_rasterizer_bands(
+	struct bitmap_definition *screen,
+	struct view_data *view)
+{
+	band_screen= screen;
+	band_view= view;
+	run_in_screen_bands(screen->height, MINIMUM_RASTERIZER_BAND_HEIGHT, draw_rasterizer_band);
+}
+
+static int rasterizer_band_thread(
+	void *data)
+{
+	struct rasterizer_band *band= (struct rasterizer_band *) data;
+	
+	for (;;)
+	{
+		SDL_SemWait(band->start);
+		if (quit_rasterizer_bands) break;
+		
+		band_procedure(band->top, band->bottom);
+		SDL_SemPost(rasterizer_bands_done);
+	}
+	
+	return 0;
+}
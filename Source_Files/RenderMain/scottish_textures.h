@@ -216,4 +216,8 @@ extern short number_of_shading_tables, shading_table_fractional_bits, shading_ta
 
 void allocate_texture_tables(void);
 
+/* runs procedure over horizontal bands of a screen height lines tall, in parallel on the
+	software rasterizer's band threads (which must not be drawing at the time) */
+void run_in_screen_bands(short height, short minimum_band_height, void (*procedure)(short top, short bottom));
+
 #endif
@@ -208,7 +208,8 @@ static bool collection_loaded(struct collection_header *header);
 static void unload_collection(struct collection_header *header);
 static void unlock_collection(struct collection_header *header);
 static void lock_collection(struct collection_header *header);
-static bool load_collection(short collection_index, bool strip);
+static bool read_collection(short collection_index, LoadedResource& source);
+static bool load_collection(short collection_index, bool strip, LoadedResource& source);
 
 static void shutdown_shape_handler(void);
 static void close_shapes_file(void);
@@ -744,49 +745,111 @@ static void allocate_shading_tables(short collection_index, bool strip)
 }
 
 /*
- *  Load collection
+ *  Collection jobs
  */
 
-static bool load_collection(short collection_index, bool strip)
+// Collections decode and shade independently of one another, so that work
+// runs on a thread per CPU; the main thread takes jobs too
+struct collection_jobs
+{
+	short collection_indexes[MAXIMUM_COLLECTIONS];
+	short count;
+	SDL_atomic_t next;
+	void (*job)(short collection_index, void *data);
+	void *data;
+};
+
+static int collection_job_thread(void *p)
 {
-	SDL_RWops* p;
-	boost::shared_ptr<SDL_RWops> m1_p; // automatic deallocation
-	LoadedResource r;
-	int32 src_offset;
+	collection_jobs *jobs = static_cast<collection_jobs *>(p);
+	for (int i = SDL_AtomicAdd(&jobs->next, 1); i < jobs->count; i = SDL_AtomicAdd(&jobs->next, 1))
+	{
+		jobs->job(jobs->collection_indexes[i], jobs->data);
+	}
+	return 0;
+}
+
+static void run_collection_jobs(collection_jobs& jobs)
+{
+	SDL_AtomicSet(&jobs.next, 0);
+
+	std::vector<SDL_Thread *> threads;
+	for (int i = 1; i < std::min<int>(SDL_GetCPUCount(), jobs.count); ++i)
+	{
+		SDL_Thread *thread = SDL_CreateThread(collection_job_thread, "Shapes_collectionThread", &jobs);
+		if (!thread)
+			break;
+		threads.push_back(thread);
+	}
+
+	collection_job_thread(&jobs);
+
+	for (std::vector<SDL_Thread *>::iterator it = threads.begin(); it != threads.end(); ++it)
+	{
+		SDL_WaitThread(*it, NULL);
+	}
+}
+
+/*
+ *  Read collection
+ */
 
+// Reads a collection's data from the shapes file in one piece, so it can be
+// decoded from memory, and on any thread; the shapes file is only ever
+// touched from the main thread
+static bool read_collection(short collection_index, LoadedResource& source)
+{
 	collection_header *header = get_collection_header(collection_index);
-	
+
 	if (shapes_file_version == M1_SHAPES_VERSION)
 	{
 		// Collections are stored in .256 resources
-		if (!M1ShapesFile.Get('.', '2', '5', '6', 128 + collection_index, r))
+		return M1ShapesFile.Get('.', '2', '5', '6', 128 + collection_index, source);
+	}
+
+	// Get offset and length of data in source file from header
+	int32 offset, length;
+	if (bit_depth == 8 || header->offset16 == -1) {
+		if (header->offset == -1)
 		{
 			return false;
 		}
-
-		m1_p.reset(SDL_RWFromConstMem(r.GetPointer(), r.GetLength()), SDL_FreeRW);
-		p = m1_p.get();
-		src_offset = 0;
+		offset = header->offset;
+		length = header->length;
+	} else {
+		offset = header->offset16;
+		length = header->length16;
 	}
-	else
-	{
-		// Get offset and length of data in source file from header
-		
-		if (bit_depth == 8 || header->offset16 == -1) {
-			if (header->offset == -1)
-			{
-				return false;
-			}
-			src_offset = header->offset;
-		} else {
-			src_offset = header->offset16;
-		}
 
-		p = ShapesFile.GetRWops();
-		ShapesFile.SetPosition(0);
-		src_offset += SDL_RWtell(p);
+	if (length <= 0)
+		return false;
+
+	void *data = malloc(length);
+	if (!data)
+		return false;
+
+	if (!ShapesFile.SetPosition(offset) || !ShapesFile.Read(length, data))
+	{
+		free(data);
+		return false;
 	}
 
+	source.SetData(data, length);
+	return true;
+}
+
+/*
+ *  Load collection
+ */
+
+static bool load_collection(short collection_index, bool strip, LoadedResource& source)
+{
+	boost::shared_ptr<SDL_RWops> p_owner(SDL_RWFromConstMem(source.GetPointer(), source.GetLength()), SDL_FreeRW); // automatic deallocation
+	SDL_RWops* p = p_owner.get();
+	const int32 src_offset = 0;
+
+	collection_header *header = get_collection_header(collection_index);
+
 	// Read collection definition
 	std::unique_ptr<collection_definition> cd(new collection_definition);
 	SDL_RWseek(p, src_offset, RW_SEEK_SET);
@@ -857,6 +920,24 @@ static bool load_collection(short collection_index, bool strip)
 	// Everything OK
 	return true;
 }	
+
+// the collections being loaded, and what became of each
+struct collection_load
+{
+	LoadedResource sources[MAXIMUM_COLLECTIONS];
+	bool loaded[MAXIMUM_COLLECTIONS];
+};
+
+static void load_collection_job(short collection_index, void *data)
+{
+	collection_load *load = static_cast<collection_load *>(data);
+	collection_header *header = get_collection_header(collection_index);
+
+	load->loaded[collection_index] = load_collection(collection_index, (header->status&markSTRIP) ? true : false, load->sources[collection_index]);
+
+	// done with the file data
+	load->sources[collection_index].Unload();
+}
 			
 
 /*
@@ -1414,11 +1495,16 @@ void load_collections(
 		}
 	}
 	
-	/* ... then go back through the list of collections and load any that we were asked to */
+	/* ... then go back through the list of collections and read any that we were asked to load */
+	std::unique_ptr<collection_load> load(new collection_load);
+	collection_jobs jobs;
+	jobs.count= 0;
 	for (collection_index= 0, header= collection_headers; collection_index<MAXIMUM_COLLECTIONS; ++collection_index, ++header)
 	{
 //		if (with_progress_bar)
 //			draw_progress_bar(MAXIMUM_COLLECTIONS+collection_index, 2*MAXIMUM_COLLECTIONS);
+		load->loaded[collection_index]= true;
+		
 		/* dont reload collections which are already in memory, but do lock them */
 		if (collection_loaded(header))
 		{
@@ -1430,17 +1516,33 @@ void load_collections(
 		{
 			if (header->status&markLOAD)
 			{
-				/* load and decompress collection */
-				if (!load_collection(collection_index, (header->status&markSTRIP) ? true : false))
+				if (read_collection(collection_index, load->sources[collection_index]))
 				{
-					if (shapes_file_version != M1_SHAPES_VERSION)
-					{
-						alert_out_of_memory();
-					}
+					jobs.collection_indexes[jobs.count++]= collection_index;
+				}
+				else
+				{
+					load->loaded[collection_index]= false;
 				}
-//				OGL_LoadModelsImages(collection_index);
 			}
 		}
+	}
+	
+	/* ... and decompress them all at once */
+	jobs.job= load_collection_job;
+	jobs.data= load.get();
+	run_collection_jobs(jobs);
+	
+	for (collection_index= 0, header= collection_headers; collection_index<MAXIMUM_COLLECTIONS; ++collection_index, ++header)
+	{
+		if (!load->loaded[collection_index])
+		{
+			if (shapes_file_version != M1_SHAPES_VERSION)
+			{
+				alert_out_of_memory();
+			}
+		}
+//		OGL_LoadModelsImages(collection_index);
 		
 		/* clear action flags */
 		header->status= markNONE;
@@ -1595,134 +1697,194 @@ static short find_or_add_color(
 	return (*color_count)++;
 }
 
-static void update_color_environment(
+/* adds the colors from a loaded collection to the aggregate color table, remaps its bitmaps
+	to it and builds the collection's shading and tinting tables */
+static void build_collection_color_tables(
+	short collection_index,
+	struct rgb_color_value *colors,
+	short *color_count,
+	pixel8 *remapping_table,
 	bool is_opengl)
 {
-	short color_count;
-	short collection_index;
+	struct collection_definition *collection= get_collection_definition(collection_index);
 	short bitmap_index;
+
+	struct rgb_color_value *primary_colors= get_collection_colors(collection_index, 0)+NUMBER_OF_PRIVATE_COLORS;
+	assert(primary_colors);
+	short color_index, clut_index;
+
+//	if (collection_index==15) dprintf("primary clut %p", primary_colors);
+//	dprintf("primary clut %d entries;dm #%d #%d", collection->color_count, primary_colors, collection->color_count*sizeof(ColorSpec));
+
+	/* add the colors from this collections primary color table to the aggregate color
+		table and build the remapping table */
+	for (color_index=0;color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS;++color_index)
+	{
+		primary_colors[color_index].value= remapping_table[primary_colors[color_index].value]= 
+			find_or_add_color(&primary_colors[color_index], colors, color_count);
+	}
 	
-	pixel8 remapping_table[PIXEL8_MAXIMUM_COLORS];
-	struct rgb_color_value colors[PIXEL8_MAXIMUM_COLORS];
+	/* then remap the collection and recalculate the base addresses of each bitmap */
+	for (bitmap_index= 0; bitmap_index<collection->bitmap_count; ++bitmap_index)
+	{
+		struct bitmap_definition *bitmap= get_bitmap_definition(collection_index, bitmap_index);
+		assert(bitmap);
+		
+		/* calculate row base addresses ... */
+		bitmap->row_addresses[0]= calculate_bitmap_origin(bitmap);
+		precalculate_bitmap_row_addresses(bitmap);
+
+		/* ... and remap it */
+		remap_bitmap(bitmap, remapping_table);
+	}
+	
+	/* build a shading table for each clut in this collection */
+	for (clut_index= 0; clut_index<collection->clut_count; ++clut_index)
+	{
+		void *primary_shading_table= get_collection_shading_tables(collection_index, 0);
+		short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
+
+		if (clut_index)
+		{
+			struct rgb_color_value *alternate_colors= get_collection_colors(collection_index, clut_index)+NUMBER_OF_PRIVATE_COLORS;
+			assert(alternate_colors);
+			void *alternate_shading_table= get_collection_shading_tables(collection_index, clut_index);
+			pixel8 shading_remapping_table[PIXEL8_MAXIMUM_COLORS];
+			
+			memset(shading_remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
+			
+//			dprintf("alternate clut %d entries;dm #%d #%d", collection->color_count, alternate_colors, collection->color_count*sizeof(ColorSpec));
+			
+			/* build a remapping table for the primary shading table which we can use to
+				calculate this alternate shading table */
+			for (color_index= 0; color_index<PIXEL8_MAXIMUM_COLORS; ++color_index) shading_remapping_table[color_index]= static_cast<pixel8>(color_index);
+			for (color_index= 0; color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS; ++color_index)
+			{
+				shading_remapping_table[find_or_add_color(&primary_colors[color_index], colors, color_count, false)]= 
+					find_or_add_color(&alternate_colors[color_index], colors, color_count);
+			}
+//			shading_remapping_table[iBLACK]= iBLACK; /* make iBLACK==>iBLACK remapping explicit */
+
+			switch (collection_bit_depth)
+			{
+				case 8:
+					/* duplicate the primary shading table and remap it */
+					memcpy(alternate_shading_table, primary_shading_table, get_shading_table_size(collection_index));
+					map_bytes((unsigned char *)alternate_shading_table, shading_remapping_table, get_shading_table_size(collection_index));
+					break;
+				
+				case 16:
+					build_shading_tables16(colors, *color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+					break;
+				
+				case 32:
+					build_shading_tables32(colors, *color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+					break;
+				
+				default:
+					assert(false);
+					break;
+			}
+		}
+		else
+		{
+			/* build the primary shading table */
+			switch (collection_bit_depth)
+			{
+			case 8: build_shading_tables8(colors, *color_count, (unsigned char *)primary_shading_table); break;
+			case 16: build_shading_tables16(colors, *color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+			case 32: build_shading_tables32(colors, *color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+				default:
+					assert(false);
+					break;
+			}
+		}
+	}
+	
+	build_collection_tinting_table(colors, *color_count, collection_index, is_opengl);
+}
 
+static void initialize_color_table(
+	struct rgb_color_value *colors,
+	short *color_count,
+	pixel8 *remapping_table)
+{
 	memset(remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
 
 	// dummy color to hold the first index (zero) for transparent pixels
 	colors[0].red= colors[0].green= colors[0].blue= 65535;
 	colors[0].flags= colors[0].value= 0;
-	color_count= 1;
+	*color_count= 1;
+}
 
-	/* loop through all collections, only paying attention to the loaded ones.  were
-		depending on finding the gray run (white to black) first; so its the responsibility
-		of the lowest numbered loaded collection to give us this */
-	for (collection_index=0;collection_index<MAXIMUM_COLLECTIONS;++collection_index)
-	{
-		struct collection_definition *collection= get_collection_definition(collection_index);
+static void build_collection_color_tables_job(
+	short collection_index,
+	void *data)
+{
+	bool is_opengl= *static_cast<bool *>(data);
+	pixel8 remapping_table[PIXEL8_MAXIMUM_COLORS];
+	struct rgb_color_value colors[PIXEL8_MAXIMUM_COLORS];
+	short color_count;
 
-//		dprintf("collection #%d", collection_index);
-		
-		if (collection && collection->bitmap_count)
-		{
-			struct rgb_color_value *primary_colors= get_collection_colors(collection_index, 0)+NUMBER_OF_PRIVATE_COLORS;
-			assert(primary_colors);
-			short color_index, clut_index;
+	initialize_color_table(colors, &color_count, remapping_table);
+	build_collection_color_tables(collection_index, colors, &color_count, remapping_table, is_opengl);
+}
+
+static void update_color_environment(
+	bool is_opengl)
+{
+	short color_count;
+	short collection_index;
+	
+	pixel8 remapping_table[PIXEL8_MAXIMUM_COLORS];
+	struct rgb_color_value colors[PIXEL8_MAXIMUM_COLORS];
 
-//			if (collection_index==15) dprintf("primary clut %p", primary_colors);
-//			dprintf("primary clut %d entries;dm #%d #%d", collection->color_count, primary_colors, collection->color_count*sizeof(ColorSpec));
+	initialize_color_table(colors, &color_count, remapping_table);
 
-			/* add the colors from this collections primary color table to the aggregate color
-				table and build the remapping table */
-			for (color_index=0;color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS;++color_index)
-			{
-				primary_colors[color_index].value= remapping_table[primary_colors[color_index].value]= 
-					find_or_add_color(&primary_colors[color_index], colors, &color_count);
-			}
+	if (bit_depth==8)
+	{
+		/* loop through all collections, only paying attention to the loaded ones.  were
+			depending on finding the gray run (white to black) first; so its the responsibility
+			of the lowest numbered loaded collection to give us this */
+		for (collection_index=0;collection_index<MAXIMUM_COLLECTIONS;++collection_index)
+		{
+			struct collection_definition *collection= get_collection_definition(collection_index);
 			
-			/* then remap the collection and recalculate the base addresses of each bitmap */
-			for (bitmap_index= 0; bitmap_index<collection->bitmap_count; ++bitmap_index)
+			if (collection && collection->bitmap_count)
 			{
-				struct bitmap_definition *bitmap= get_bitmap_definition(collection_index, bitmap_index);
-				assert(bitmap);
-				
-				/* calculate row base addresses ... */
-				bitmap->row_addresses[0]= calculate_bitmap_origin(bitmap);
-				precalculate_bitmap_row_addresses(bitmap);
-
-				/* ... and remap it */
-				remap_bitmap(bitmap, remapping_table);
+				build_collection_color_tables(collection_index, colors, &color_count, remapping_table, is_opengl);
 			}
+		}
+	}
+	else
+	{
+		/* if were not in 8-bit, we dont have to carry our colors over into the next collection,
+			so each one starts from the transparent color alone and they can all be built at once */
+		collection_jobs jobs;
+		jobs.count= 0;
+		for (collection_index=0;collection_index<MAXIMUM_COLLECTIONS;++collection_index)
+		{
+			struct collection_definition *collection= get_collection_definition(collection_index);
 			
-			/* build a shading table for each clut in this collection */
-			for (clut_index= 0; clut_index<collection->clut_count; ++clut_index)
+			if (collection && collection->bitmap_count)
 			{
-				void *primary_shading_table= get_collection_shading_tables(collection_index, 0);
-				short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
-
-				if (clut_index)
+				if (collection_index==_collection_interface && interface_bit_depth==8)
 				{
-					struct rgb_color_value *alternate_colors= get_collection_colors(collection_index, clut_index)+NUMBER_OF_PRIVATE_COLORS;
-					assert(alternate_colors);
-					void *alternate_shading_table= get_collection_shading_tables(collection_index, clut_index);
-					pixel8 shading_remapping_table[PIXEL8_MAXIMUM_COLORS];
-					
-					memset(shading_remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
-					
-//					dprintf("alternate clut %d entries;dm #%d #%d", collection->color_count, alternate_colors, collection->color_count*sizeof(ColorSpec));
-					
-					/* build a remapping table for the primary shading table which we can use to
-						calculate this alternate shading table */
-					for (color_index= 0; color_index<PIXEL8_MAXIMUM_COLORS; ++color_index) shading_remapping_table[color_index]= static_cast<pixel8>(color_index);
-					for (color_index= 0; color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS; ++color_index)
-					{
-						shading_remapping_table[find_or_add_color(&primary_colors[color_index], colors, &color_count, false)]= 
-							find_or_add_color(&alternate_colors[color_index], colors, &color_count);
-					}
-//					shading_remapping_table[iBLACK]= iBLACK; /* make iBLACK==>iBLACK remapping explicit */
-
-					switch (collection_bit_depth)
-					{
-						case 8:
-							/* duplicate the primary shading table and remap it */
-							memcpy(alternate_shading_table, primary_shading_table, get_shading_table_size(collection_index));
-							map_bytes((unsigned char *)alternate_shading_table, shading_remapping_table, get_shading_table_size(collection_index));
-							break;
-						
-						case 16:
-							build_shading_tables16(colors, color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
-							break;
-						
-						case 32:
-							build_shading_tables32(colors, color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
-							break;
-						
-						default:
-							assert(false);
-							break;
-					}
+					/* 8-bit interface, non-8-bit main window; remember interface CLUT separately */
+					build_collection_color_tables(collection_index, colors, &color_count, remapping_table, is_opengl);
+					_change_clut(change_interface_clut, colors, color_count);
+					initialize_color_table(colors, &color_count, remapping_table);
 				}
 				else
 				{
-					/* build the primary shading table */
-					switch (collection_bit_depth)
-					{
-					case 8: build_shading_tables8(colors, color_count, (unsigned char *)primary_shading_table); break;
-					case 16: build_shading_tables16(colors, color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
-					case 32: build_shading_tables32(colors, color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
-						default:
-							assert(false);
-							break;
-					}
+					jobs.collection_indexes[jobs.count++]= collection_index;
 				}
 			}
-			
-			build_collection_tinting_table(colors, color_count, collection_index, is_opengl);
-			
-			/* 8-bit interface, non-8-bit main window; remember interface CLUT separately */
-			if (collection_index==_collection_interface && interface_bit_depth==8 && bit_depth!=interface_bit_depth) _change_clut(change_interface_clut, colors, color_count);
-			
-			/* if were not in 8-bit, we dont have to carry our colors over into the next collection */
-			if (bit_depth!=8) color_count= 1;
 		}
+		
+		jobs.job= build_collection_color_tables_job;
+		jobs.data= &is_opengl;
+		run_collection_jobs(jobs);
 	}
 
 #ifdef DEBUG
@@ -1550,11 +1550,71 @@ static inline void quadruple_surface(const T *src, int src_pitch, T *dst, int ds
 	}
 }
 
-static void apply_gamma(SDL_Surface *src, SDL_Surface *dst)
+/*
+ *  Gamma correction of the software buffers
+ */
+
+// Per-channel tables from a source channel value straight to the bits it
+// becomes in a destination pixel, so each pixel is three lookups and two ORs
+struct gamma_lookup {
+	uint32 red[256];
+	uint32 green[256];
+	uint32 blue[256];
+};
+
+static gamma_lookup gamma_tables;
+static SDL_Surface *gamma_src = NULL;
+static SDL_Surface *gamma_dst = NULL;
+static void (*gamma_rows)(short first_row, short last_row) = NULL;
+
+// Rows are corrected in bands on the software rasterizer's band threads
+const int MIN_GAMMA_BAND_HEIGHT = 64;
+
+// Fills one channel's table the same way the generic loop would convert it
+static bool build_gamma_channel(uint32 *table, const uint16 *gamma, uint32 smask, uint32 sshift, uint32 sloss, uint32 dmask, uint32 dshift, uint32 dloss)
 {
-	if (SDL_MUSTLOCK(dst)) {
-	    if (SDL_LockSurface(dst) < 0) return;
+	uint32 max_value = smask >> sshift;
+	if (max_value > 255)
+		return false;
+
+	for (uint32 i = 0; i <= max_value; ++i) {
+		uint8 src_c = i << sloss;
+		uint8 dst_c = gamma[src_c] >> 8;
+		table[i] = ((dst_c >> dloss) << dshift) & dmask;
+	}
+	return true;
+}
+
+// Returns false for formats with channels wider than 8 bits
+static bool build_gamma_lookup(const SDL_PixelFormat *src, const SDL_PixelFormat *dst, gamma_lookup &lookup)
+{
+	return build_gamma_channel(lookup.red, current_gamma_r, src->Rmask, src->Rshift, src->Rloss, dst->Rmask, dst->Rshift, dst->Rloss) &&
+		build_gamma_channel(lookup.green, current_gamma_g, src->Gmask, src->Gshift, src->Gloss, dst->Gmask, dst->Gshift, dst->Gloss) &&
+		build_gamma_channel(lookup.blue, current_gamma_b, src->Bmask, src->Bshift, src->Bloss, dst->Bmask, dst->Bshift, dst->Bloss);
+}
+
+template <class S, class D>
+static void apply_gamma_rows(short first_row, short last_row)
+{
+	const SDL_PixelFormat *f = gamma_src->format;
+	const uint32 srm = f->Rmask, sgm = f->Gmask, sbm = f->Bmask;
+	const uint32 srs = f->Rshift, sgs = f->Gshift, sbs = f->Bshift;
+	const uint32 *red = gamma_tables.red, *green = gamma_tables.green, *blue = gamma_tables.blue;
+	const int width = gamma_src->w;
+
+	for (int y = first_row; y < last_row; ++y) {
+		const S *sptr = reinterpret_cast<const S *>(static_cast<uint8 *>(gamma_src->pixels) + y * gamma_src->pitch);
+		D *dptr = reinterpret_cast<D *>(static_cast<uint8 *>(gamma_dst->pixels) + y * gamma_dst->pitch);
+		for (int x = 0; x < width; ++x) {
+			uint32 px = sptr[x];
+			dptr[x] = red[(px & srm) >> srs] | green[(px & sgm) >> sgs] | blue[(px & sbm) >> sbs];
+		}
 	}
+}
+
+// Any pixel format with 16- or 32-bit pixels; used when a channel doesn't fit the tables
+static void apply_gamma_generic(SDL_Surface *src, SDL_Surface *dst)
+{
 	uint32 px, dst_px;
 	uint8 src_r, src_g, src_b;
 	uint8 dst_r, dst_g, dst_b;
@@ -1568,42 +1628,72 @@ static void apply_gamma(SDL_Surface *src, SDL_Surface *dst)
 	
 	int sbpp = src->format->BytesPerPixel;
 	int dbpp = dst->format->BytesPerPixel;
-	uint8 *sptr = static_cast<uint8*>(src->pixels);
-	uint8 *dptr = static_cast<uint8*>(dst->pixels);
-	size_t numpixels = src->w * src->h;
-	for (size_t i = 0; i < numpixels; ++i) {
-		switch (sbpp) {
-			case 2:
-				px = reinterpret_cast<uint16*>(sptr)[i];
-				break;
-			case 4:
-				px = reinterpret_cast<uint32*>(sptr)[i];
-				break;
-			default:
-				return;
-		}
+	for (int y = 0; y < src->h; ++y) {
+		uint8 *sptr = static_cast<uint8*>(src->pixels) + y * src->pitch;
+		uint8 *dptr = static_cast<uint8*>(dst->pixels) + y * dst->pitch;
+		for (int i = 0; i < src->w; ++i) {
+			switch (sbpp) {
+				case 2:
+					px = reinterpret_cast<uint16*>(sptr)[i];
+					break;
+				case 4:
+					px = reinterpret_cast<uint32*>(sptr)[i];
+					break;
+				default:
+					return;
+			}
 	
-		src_r = ((px & srm) >> srs) << srl;
-		src_g = ((px & sgm) >> sgs) << sgl;
-		src_b = ((px & sbm) >> sbs) << sbl;
-		dst_r = current_gamma_r[src_r] >> 8;
-		dst_g = current_gamma_g[src_g] >> 8;
-		dst_b = current_gamma_b[src_b] >> 8;
-		dst_px = (((dst_r >> drl) << drs) & drm) |
-				 (((dst_g >> dgl) << dgs) & dgm) |
-				 (((dst_b >> dbl) << dbs) & dbm);
+			src_r = ((px & srm) >> srs) << srl;
+			src_g = ((px & sgm) >> sgs) << sgl;
+			src_b = ((px & sbm) >> sbs) << sbl;
+			dst_r = current_gamma_r[src_r] >> 8;
+			dst_g = current_gamma_g[src_g] >> 8;
+			dst_b = current_gamma_b[src_b] >> 8;
+			dst_px = (((dst_r >> drl) << drs) & drm) |
+					 (((dst_g >> dgl) << dgs) & dgm) |
+					 (((dst_b >> dbl) << dbs) & dbm);
 			
-		switch (dbpp) {
-			case 2:
-				reinterpret_cast<uint16*>(dptr)[i] = dst_px;
-				break;
-			case 4:
-				reinterpret_cast<uint32*>(dptr)[i] = dst_px;
-				break;
-			default:
-				return;
+			switch (dbpp) {
+				case 2:
+					reinterpret_cast<uint16*>(dptr)[i] = dst_px;
+					break;
+				case 4:
+					reinterpret_cast<uint32*>(dptr)[i] = dst_px;
+					break;
+				default:
+					return;
+			}
 		}
 	}
+}
+
+static void apply_gamma(SDL_Surface *src, SDL_Surface *dst)
+{
+	if (SDL_MUSTLOCK(dst)) {
+	    if (SDL_LockSurface(dst) < 0) return;
+	}
+
+	int sbpp = src->format->BytesPerPixel;
+	int dbpp = dst->format->BytesPerPixel;
+	gamma_rows = NULL;
+	// The tables are only 768 entries, cheaper to rebuild every frame than to track
+	// every change of gamma, fade or surface
+	if ((sbpp == 2 || sbpp == 4) && (dbpp == 2 || dbpp == 4) && build_gamma_lookup(src->format, dst->format, gamma_tables)) {
+		if (sbpp == 4)
+			gamma_rows = (dbpp == 4) ? apply_gamma_rows<uint32, uint32> : apply_gamma_rows<uint32, uint16>;
+		else
+			gamma_rows = (dbpp == 4) ? apply_gamma_rows<uint16, uint32> : apply_gamma_rows<uint16, uint16>;
+	}
+
+	if (gamma_rows) {
+		gamma_src = src;
+		gamma_dst = dst;
+
+		run_in_screen_bands(src->h, MIN_GAMMA_BAND_HEIGHT, gamma_rows);
+	} else {
+		apply_gamma_generic(src, dst);
+	}
+
 	if (SDL_MUSTLOCK(dst))
 		SDL_UnlockSurface(dst);
 }
@@ -22,10 +22,75 @@
 #include "Mixer.h"
 #include "interface.h" // for strERRORS
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIXER_NEON
+#include <arm_neon.h>
+#endif
+
 extern bool option_nosound;
 
+// [cutoff][phase][tap]: a Blackman-windowed sinc for each fraction of the
+// way from one source frame to the next. Cutoff 0 is at the source's Nyquist
+// frequency; cutoff n is at (FILTER_CUTOFFS - n) / FILTER_CUTOFFS of it, for
+// sources played faster than the output rate, whose Nyquist is above ours
+alignas(16) static float filter_coefficients[Mixer::FILTER_CUTOFFS][Mixer::FILTER_PHASES][Mixer::FILTER_TAPS];
+static bool filter_coefficients_built = false;
+
+static void build_filter_coefficients()
+{
+	const int cutoffs = Mixer::FILTER_CUTOFFS;
+	const int phases = Mixer::FILTER_PHASES;
+	const int taps = Mixer::FILTER_TAPS;
+	const double pi = 3.14159265358979323846;
+
+	for (int cutoff = 0; cutoff < cutoffs; ++cutoff)
+	{
+		double scale = static_cast<double>(cutoffs - cutoff) / cutoffs;
+		for (int phase = 0; phase < phases; ++phase)
+		{
+			double fraction = static_cast<double>(phase) / phases;
+			double coefficients[taps];
+			double sum = 0;
+			for (int tap = 0; tap < taps; ++tap)
+			{
+				// distance from the output frame to this tap, in source frames
+				double x = tap - taps / 2 - fraction;
+				double sinc = (x == 0) ? 1 : std::sin(pi * scale * x) / (pi * scale * x);
+				double window = 0.42 + 0.5 * std::cos(pi * x / (taps / 2)) + 0.08 * std::cos(2 * pi * x / (taps / 2));
+				coefficients[tap] = sinc * window;
+				sum += coefficients[tap];
+			}
+
+			// unity gain at DC, so nothing gets louder or quieter with pitch
+			for (int tap = 0; tap < taps; ++tap)
+			{
+				filter_coefficients[cutoff][phase][tap] = static_cast<float>(coefficients[tap] / sum);
+			}
+		}
+	}
+
+	filter_coefficients_built = true;
+}
+
+// The highest cutoff at or below the output's Nyquist frequency, in source
+// terms min(1, 1 / rate); the lowest there is for anything faster
+static int filter_cutoff(_fixed rate)
+{
+	if (rate <= FIXED_ONE)
+		return 0;
+
+	int steps = (Mixer::FILTER_CUTOFFS << 16) / rate;
+	return Mixer::FILTER_CUTOFFS - std::max(steps, 1);
+}
+
 void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels, float db, uint16 samples)
 {
+	if (!filter_coefficients_built)
+		build_filter_coefficients();
+
 	sound_channel_count = num_channels;
 	main_volume = from_db(db);
 	desired.freq = rate;
@@ -51,10 +116,14 @@ void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels,
 	{
 		// initialize the channels
 		channels.resize(num_channels + EXTRA_CHANNELS);
+		sounds_buffered.reset(new std::atomic<uint32>[num_channels + EXTRA_CHANNELS]);
+		sounds_started.reset(new std::atomic<uint32>[num_channels + EXTRA_CHANNELS]);
 		for (int i = 0; i < num_channels + EXTRA_CHANNELS; ++i)
 		{
 			channels[i].sound_manager_index = i;
 			channels[i].source = Channel::SOURCE_SOUND_HEADERS;
+			sounds_buffered[i] = 0;
+			sounds_started[i] = 0;
 		}
 
 		channels[sound_channel_count + MUSIC_CHANNEL].source = Channel::SOURCE_MUSIC;
@@ -68,23 +137,105 @@ void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels,
 void Mixer::Stop()
 {
 	SDL_CloseAudio();
+
+	// drop anything still queued for the old channels
+	for (uint32 i = command_queue_read; i != command_queue_write; ++i)
+	{
+		command_queue[i % COMMAND_QUEUE_SIZE].data.reset();
+	}
+	command_queue_read.store(command_queue_write.load());
+
 	channels.clear();
 	sound_channel_count = 0;
 }
 
 void Mixer::BufferSound(int channel, const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch)
 {
-	SDL_LockAudio();
-	if (channels[channel].active)
+	if (!channels.size()) return;
+
+	Command command(Command::BUFFER_SOUND, channel);
+	command.header = header;
+	command.data = data;
+	command.pitch = pitch;
+
+	++sounds_buffered[channel];
+	PostCommand(command);
+}
+
+void Mixer::PostCommand(Command& command)
+{
+	if (!channels.size()) return;
+
+	uint32 write = command_queue_write.load(std::memory_order_relaxed);
+	if (write - command_queue_read.load(std::memory_order_acquire) == COMMAND_QUEUE_SIZE)
 	{
-		// queue the header
-		channels[channel].BufferSoundHeader(header, data, pitch);
-	} else {
-		// load it directly
-		channels[channel].active = true;
-		channels[channel].LoadSoundHeader(header, data, pitch);
+		// the audio thread has fallen behind (or isn't running); keep
+		// everything in order by catching up on its behalf
+		SDL_LockAudio();
+		ApplyCommands();
+		SDL_UnlockAudio();
+	}
+
+	std::swap(command_queue[write % COMMAND_QUEUE_SIZE], command);
+	command_queue_write.store(write + 1, std::memory_order_release);
+}
+
+// Only the audio thread calls this, except with the audio locked
+void Mixer::ApplyCommands()
+{
+	uint32 read = command_queue_read.load(std::memory_order_relaxed);
+	uint32 write = command_queue_write.load(std::memory_order_acquire);
+
+	while (read != write)
+	{
+		Command& command = command_queue[read % COMMAND_QUEUE_SIZE];
+		ApplyCommand(command);
+		command.data.reset();
+
+		command_queue_read.store(++read, std::memory_order_release);
+	}
+}
+
+void Mixer::ApplyCommand(Command& command)
+{
+	Channel *c = &channels[command.channel];
+
+	switch (command.type)
+	{
+	case Command::BUFFER_SOUND:
+		if (c->active && !c->ending)
+		{
+			// queue the header
+			c->BufferSoundHeader(command.header, command.data, command.pitch);
+		} else {
+			// load it directly
+			c->active = true;
+			c->ResetFilter();
+			c->LoadSoundHeader(command.header, command.data, command.pitch);
+		}
+		++sounds_started[command.channel];
+		break;
+
+	case Command::QUIET:
+		c->Quiet();
+		break;
+
+	case Command::SET_VOLUMES:
+		c->left_volume = command.left_volume;
+		c->right_volume = command.right_volume;
+		break;
+
+	case Command::PLAY_RESOURCE:
+		c->active = true;
+		c->ResetFilter();
+		c->LoadSoundHeader(command.header, command.data, command.pitch);
+		c->left_volume = c->right_volume = 0x100;
+		break;
+
+	case Command::STOP_RESOURCE:
+		c->active = false;
+		break;
 	}
-	SDL_UnlockAudio();
 }
 
 void Mixer::MixerCallback(void *usr, uint8 *stream, int len)
@@ -113,6 +264,7 @@ void Mixer::StartMusicChannel(bool sixteen_bit, bool stereo, bool signed_8bit, i
 	c->counter = 0;
 	c->rate = rate;
 	c->left_volume = c->right_volume = 0x100;
+	c->ResetFilter();
 	c->active = true;
 	c->loop_length = 0;
 }
@@ -139,6 +291,7 @@ void Mixer::EnsureNetworkAudioPlaying()
 		if (sNetworkAudioBufferDesc)
 		{
 			SDL_LockAudio();
+			ApplyCommands();
 			c->info.stereo = kNetworkAudioIsStereo;
 			c->info.sixteen_bit = kNetworkAudioIs16Bit;
 			c->info.signed_8bit = kNetworkAudioIsSigned8Bit;
@@ -151,6 +304,7 @@ void Mixer::EnsureNetworkAudioPlaying()
 			c->left_volume = 0x100;
 			c->right_volume = 0x100;
 			c->counter = 0;
+			c->ResetFilter();
 			c->active = true;
 
 			SDL_UnlockAudio();
@@ -166,6 +320,7 @@ void Mixer::StopNetworkAudio()
 #if !defined(DISABLE_NETWORKING)
 	if (!channels.size()) return;
 	SDL_LockAudio();
+	ApplyCommands();
 	channels[sound_channel_count + NETWORK_AUDIO_CHANNEL].active = false;
 	if (sNetworkAudioBufferDesc)
 	{
@@ -181,29 +336,25 @@ void Mixer::PlaySoundResource(LoadedResource &rsrc, _fixed pitch)
 {
 	if (!channels.size()) return;
 
-	Channel *c = &channels[sound_channel_count + RESOURCE_CHANNEL];
-
 	SoundHeader header;
 	if (header.Load(rsrc))
 	{
 		boost::shared_ptr<SoundData> data = header.LoadData(rsrc);
 		if (data.get())
 		{
-			SDL_LockAudio();
-			c->active = true;
-			c->LoadSoundHeader(header, data, pitch);
-			c->left_volume = c->right_volume = 0x100;
-			SDL_UnlockAudio();
+			Command command(Command::PLAY_RESOURCE, sound_channel_count + RESOURCE_CHANNEL);
+			command.header = header;
+			command.data = data;
+			command.pitch = pitch;
+			PostCommand(command);
 		}
 	}
 }
 
 void Mixer::StopSoundResource()
 {
-	if (!channels.size()) return;
-	SDL_LockAudio();
-	channels[sound_channel_count + RESOURCE_CHANNEL].active = false;
-	SDL_UnlockAudio();
+	Command command(Command::STOP_RESOURCE, sound_channel_count + RESOURCE_CHANNEL);
+	PostCommand(command);
 }
 
 Mixer::Channel::Channel() :
@@ -218,6 +369,20 @@ Mixer::Channel::Channel() :
 	right_volume(0x100),
 	next_pitch(0)
 {
+	ResetFilter();
+}
+
+// Before a channel starts a new sound from silence
+void Mixer::Channel::ResetFilter()
+{
+	std::fill_n(history_left, 2 * FILTER_TAPS, 0.f);
+	std::fill_n(history_right, 2 * FILTER_TAPS, 0.f);
+	history_position = 0;
+
+	// enough to put the first frame in the middle of the window
+	frames_to_read = FILTER_TAPS / 2;
+	ending = false;
+	ending_frames = 0;
 }
 
 void Mixer::Channel::LoadSoundHeader(const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch)
@@ -327,79 +492,115 @@ static inline int16 Convert(uint8 i)
 	return (int8)(i ^ 0x80) * 256;
 }
 
-static inline int32 lerp(int32 x0, int32 x1, _fixed rate)
+// One output frame from a window of FILTER_TAPS source frames
+static inline void filter_frame(const float* coefficients, const float* window_left, const float* window_right, float* left, float* right)
 {
-	int32 v = x0 + ((1LL*x1 - x0) * (rate & 0xffff)) / 65536;
-	return v;
+#if defined(MIXER_SSE2)
+	__m128 c0 = _mm_load_ps(coefficients);
+	__m128 c1 = _mm_load_ps(coefficients + 4);
+	__m128 l = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(window_left), c0), _mm_mul_ps(_mm_loadu_ps(window_left + 4), c1));
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(window_right), c0), _mm_mul_ps(_mm_loadu_ps(window_right + 4), c1));
+	// {l0 + l2, r0 + r2, l1 + l3, r1 + r3}, then both sums in the low lanes
+	__m128 sums = _mm_add_ps(_mm_unpacklo_ps(l, r), _mm_unpackhi_ps(l, r));
+	sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+	_mm_store_ss(left, sums);
+	_mm_store_ss(right, _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 1, 1, 1)));
+#elif defined(MIXER_NEON)
+	float32x4_t c0 = vld1q_f32(coefficients);
+	float32x4_t c1 = vld1q_f32(coefficients + 4);
+	float32x4_t l = vmlaq_f32(vmulq_f32(vld1q_f32(window_left), c0), vld1q_f32(window_left + 4), c1);
+	float32x4_t r = vmlaq_f32(vmulq_f32(vld1q_f32(window_right), c0), vld1q_f32(window_right + 4), c1);
+	float32x2_t sums = vpadd_f32(vadd_f32(vget_low_f32(l), vget_high_f32(l)), vadd_f32(vget_low_f32(r), vget_high_f32(r)));
+	*left = vget_lane_f32(sums, 0);
+	*right = vget_lane_f32(sums, 1);
+#else
+	float l = 0, r = 0;
+	for (int tap = 0; tap < Mixer::FILTER_TAPS; ++tap)
+	{
+		l += window_left[tap] * coefficients[tap];
+		r += window_right[tap] * coefficients[tap];
+	}
+	*left = l;
+	*right = r;
+#endif
 }
 
 template<class T, bool stereo, bool le_or_signed>
-void Mixer::Resample_(Channel* c, int16* left, int16* right, int& samples)
+void Mixer::Resample_(Channel* c, float* left, float* right, int& samples)
 {
-	while (samples--)
-	{
+	const float (*coefficients)[FILTER_TAPS] = filter_coefficients[filter_cutoff(c->rate)];
 
-		if (c->active)
+	while (samples)
+	{
+		if (!c->active)
 		{
-			int32 left0, right0;
-			const T* data = reinterpret_cast<const T*>(c->data);
+			std::fill_n(left, samples, 0.f);
+			std::fill_n(right, samples, 0.f);
+			samples = 0;
+			return;
+		}
 
-			left0 = Convert<le_or_signed>(*data++);
-			if (stereo)
-			{
-				right0 = Convert<le_or_signed>(*data++);
-			}
-		
-			if ((c->counter & 0xffff) && c->length > c->info.bytes_per_frame)
-			{
-				int32 left1 = Convert<le_or_signed>(*data++);
-				if (stereo) 
-				{
-					int32 right1 = Convert<le_or_signed>(*data++);
-					*left++ = lerp(left0, left1, c->counter);
-					*right++ = lerp(right0, right1, c->counter);
-				}
-				else
-				{
-					*left++ = *right++ = lerp(left0, left1, c->counter);
-				}
-			}
-			else
+		// bring the window up to the current source frame
+		while (c->frames_to_read)
+		{
+			if (c->length <= 0)
 			{
-				if (stereo)
-				{
-					*left++ = left0;
-					*right++ = right0;
-				} 
-				else
+				if (!c->ending)
 				{
-					*left++ = *right++ = left0;
+					c->GetMoreData();
+					if (c->active)
+						return;  // sample format may have changed
+
+					// the last frames are still short of the middle of the
+					// window; play them out against silence
+					c->active = true;
+					c->ending = true;
+					c->ending_frames = FILTER_TAPS / 2;
 				}
-			}
 
-			c->counter += c->rate;
-			if (c->counter >= 0x10000)
-			{
-				int count = c->counter >> 16;
-				c->counter &= 0xffff;
-				c->data += c->info.bytes_per_frame * count;
-				c->length -= c->info.bytes_per_frame * count;
-			
-				if (c->length <= 0) 
+				if (c->ending_frames == 0)
 				{
-					c->GetMoreData();
-					return;  // sample format may have changed
+					c->active = false;
+					return;
 				}
+
+				c->PushFrame(0.f, 0.f);
+				--c->ending_frames;
+				--c->frames_to_read;
+				continue;
 			}
-		} 
+
+			const T* data = reinterpret_cast<const T*>(c->data);
+			float left0 = Convert<le_or_signed>(data[0]);
+			float right0 = stereo ? Convert<le_or_signed>(data[1]) : left0;
+			c->PushFrame(left0, right0);
+
+			c->data += c->info.bytes_per_frame;
+			c->length -= c->info.bytes_per_frame;
+			--c->frames_to_read;
+		}
+
+		const float* window_left = &c->history_left[c->history_position];
+		const float* window_right = &c->history_right[c->history_position];
+		if (c->rate == FIXED_ONE && c->counter == 0)
+		{
+			// nothing to resample
+			*left++ = window_left[FILTER_TAPS / 2];
+			*right++ = window_right[FILTER_TAPS / 2];
+		}
 		else
 		{
-			*left++ = *right++ = 0;
+			filter_frame(coefficients[c->counter * FILTER_PHASES >> 16], window_left, window_right, left++, right++);
 		}
+		--samples;
+
+		c->counter += c->rate;
+		c->frames_to_read += c->counter >> 16;
+		c->counter &= 0xffff;
 	}
 }
 
-void Mixer::Resample(Channel* c, int16* left, int16* right, int samples)
+void Mixer::Resample(Channel* c, float* left, float* right, int samples)
 {
 	int left_to_process = samples;
 	while (left_to_process > 0)
@@ -408,7 +609,7 @@ void Mixer::Resample(Channel* c, int16* left, int16* right, int samples)
 	}
 }
 
-void Mixer::ResampleInner(Channel* c, int16* left, int16* right, int& samples)
+void Mixer::ResampleInner(Channel* c, float* left, float* right, int& samples)
 {
 	if (c->info.stereo)
 	{
@@ -462,25 +663,67 @@ void Mixer::ResampleInner(Channel* c, int16* left, int16* right, int& samples)
 	}
 }
 
-static inline void apply_volume_and_clip(int32* v, float main_volume, int samples)
+// output += input * gain
+static inline void mix_channel(float* output, const float* input, float gain, int samples)
 {
-	while (samples--)
+	int i = 0;
+#if defined(MIXER_SSE2)
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= samples; i += 4)
+	{
+		_mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(input + i), g)));
+	}
+#elif defined(MIXER_NEON)
+	for (; i + 4 <= samples; i += 4)
+	{
+		vst1q_f32(output + i, vmlaq_n_f32(vld1q_f32(output + i), vld1q_f32(input + i), gain));
+	}
+#endif
+	for (; i < samples; ++i)
+	{
+		output[i] += input[i] * gain;
+	}
+}
+
+// Scales by the main volume and clips to 16 bits
+static inline void apply_volume_and_clip(int16* output, const float* input, float main_volume, int samples)
+{
+	int i = 0;
+#if defined(MIXER_SSE2)
+	__m128 v = _mm_set1_ps(main_volume);
+	for (; i + 8 <= samples; i += 8)
+	{
+		__m128i lo = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i), v));
+		__m128i hi = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 4), v));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(lo, hi));
+	}
+#elif defined(MIXER_NEON)
+	for (; i + 8 <= samples; i += 8)
+	{
+		int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i), main_volume));
+		int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 4), main_volume));
+		vst1q_s16(output + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+#endif
+	for (; i < samples; ++i)
 	{
-		*v = static_cast<int32>(*v * main_volume);
-		if (*v > INT16_MAX)
+		float v = input[i] * main_volume;
+		if (v > INT16_MAX)
 		{
-			*v = INT16_MAX;
+			output[i] = INT16_MAX;
 		}
-		else if (*v < INT16_MIN)
+		else if (v < INT16_MIN)
 		{
-			*v = INT16_MIN;
+			output[i] = INT16_MIN;
+		}
+		else
+		{
+			output[i] = static_cast<int16>(v);
 		}
-
-		++v;
 	}
 }
 
-void Output(int16* output, int32* left, int32* right, int samples, bool)
+void Output(int16* output, const int16* left, const int16* right, int samples, bool)
 {
 	while (samples--)
 	{
@@ -489,7 +732,7 @@ void Output(int16* output, int32* left, int32* right, int samples, bool)
 	}
 }
 
-void Output(int16* output, int32* left, int samples, bool)
+void Output(int16* output, const int16* left, int samples, bool)
 {
 	while (samples--)
 	{
@@ -497,7 +740,7 @@ void Output(int16* output, int32* left, int samples, bool)
 	}
 }
 
-void Output(int8* output, int32* left, int32* right, int samples, bool is_signed)
+void Output(int8* output, const int16* left, const int16* right, int samples, bool is_signed)
 {
 	if (is_signed)
 	{
@@ -517,7 +760,7 @@ void Output(int8* output, int32* left, int32* right, int samples, bool is_signed
 	}
 }
 
-void Output(int8* output, int32* left, int samples, bool is_signed)
+void Output(int8* output, const int16* left, int samples, bool is_signed)
 {
 	if (is_signed)
 	{
@@ -537,17 +780,23 @@ void Output(int8* output, int32* left, int samples, bool is_signed)
 
 void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_signed)
 {
+	// the movie recorder mixes from the game thread, with the audio paused
+	ApplyCommands();
+
 	const int FRAME_SIZE = 512;
-	int16 channel_left[FRAME_SIZE];
-	int16 channel_right[FRAME_SIZE];
+	float channel_left[FRAME_SIZE];
+	float channel_right[FRAME_SIZE];
+
+	float output_left[FRAME_SIZE];
+	float output_right[FRAME_SIZE];
 
-	int32 output_left[FRAME_SIZE];
-	int32 output_right[FRAME_SIZE];
+	int16 clipped_left[FRAME_SIZE];
+	int16 clipped_right[FRAME_SIZE];
 
 	while (len)
 	{
-		std::fill_n(output_left, FRAME_SIZE, 0);
-		std::fill_n(output_right, FRAME_SIZE, 0);
+		std::fill_n(output_left, FRAME_SIZE, 0.f);
+		std::fill_n(output_right, FRAME_SIZE, 0.f);
 
 		int samples = std::min(len, FRAME_SIZE);
 		
@@ -555,6 +804,8 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 		for (int channel = 0; channel < channel_count; ++channel)
 		{
 			Channel* c = &channels[channel];
+			if (!c->active) continue;
+
 			Resample(c, channel_left, channel_right, samples);
 
 			int16 left_volume = c->left_volume;
@@ -564,11 +815,8 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 				left_volume = right_volume = SoundManager::instance()->GetNetmicVolumeAdjustment();
 			}
 
-			for (int i = 0; i < samples; ++i)
-			{
-				output_left[i] += (channel_left[i] * left_volume) >> 8;
-				output_right[i] += (channel_right[i] * right_volume) >> 8;
-			}
+			mix_channel(output_left, channel_left, left_volume / 256.f, samples);
+			mix_channel(output_right, channel_right, right_volume / 256.f, samples);
 		}
 
 		if (game_is_networked &&
@@ -591,26 +839,26 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 			{
 				for (int i = 0; i < samples; ++i)
 				{
-					output_left[i] = (output_left[i] + output_right[i]) / 2;
+					output_left[i] = (output_left[i] + output_right[i]) * 0.5f;
 				}
 			}
 
-			apply_volume_and_clip(output_left, main_volume, samples);
+			apply_volume_and_clip(clipped_left, output_left, main_volume, samples);
 			if (stereo)
 			{
-				apply_volume_and_clip(output_right, main_volume, samples);
+				apply_volume_and_clip(clipped_right, output_right, main_volume, samples);
 			}
 
 			if (stereo)
 			{
 				if (is_sixteen_bit)
 				{
-					Output(reinterpret_cast<int16*>(p), output_left, output_right, samples, is_signed);
+					Output(reinterpret_cast<int16*>(p), clipped_left, clipped_right, samples, is_signed);
 					p += samples * 4;
 				}
 				else
 				{
-					Output(reinterpret_cast<int8*>(p), output_left, output_right, samples, is_signed);
+					Output(reinterpret_cast<int8*>(p), clipped_left, clipped_right, samples, is_signed);
 					p += samples * 2;
 				}
 			}
@@ -618,12 +866,12 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 			{
 				if (is_sixteen_bit)
 				{
-					Output(reinterpret_cast<int16*>(p), output_left, samples, is_signed);
+					Output(reinterpret_cast<int16*>(p), clipped_left, samples, is_signed);
 					p += samples * 2;
 				}
 				else
 				{
-					Output(reinterpret_cast<int8*>(p), output_left, samples, is_signed);
+					Output(reinterpret_cast<int8*>(p), clipped_left, samples, is_signed);
 					p += samples;
 				}
 			}
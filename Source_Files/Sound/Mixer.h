@@ -22,7 +22,9 @@
 
 */
 
+#include <atomic>
 #include <cmath>
+#include <memory>
 
 #include <SDL_endian.h>
 #include "cseries.h"
@@ -58,30 +60,53 @@ public:
 
 	void SetVolume(float db) { main_volume = from_db(db); }
 
+	// Taps of the polyphase resampling filter, how finely it divides the
+	// distance between two source frames, and how many cutoffs it has for
+	// downsampling
+	enum {
+		FILTER_TAPS = 8,
+		FILTER_PHASES = 256,
+		FILTER_CUTOFFS = 8
+	};
+
+	// The game thread doesn't touch the channels while the audio thread
+	// might be mixing them; it queues a Command instead, and the audio
+	// thread applies everything queued before it mixes each buffer
+
 	void BufferSound(int channel, const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch);
 
 	// returns the number of normal/ambient channels
 	int SoundChannelCount() { return sound_channel_count; }
 
 	void QuietChannel(int channel) {
-		SDL_LockAudio();
-		channels[channel].Quiet();
-		SDL_UnlockAudio();
+		Command command(Command::QUIET, channel);
+		PostCommand(command);
 	}
 	
 	void SetChannelVolumes(int channel, int16 left, int16 right) { 
-		channels[channel].left_volume = left; 
-		channels[channel].right_volume = right; 
+		Command command(Command::SET_VOLUMES, channel);
+		command.left_volume = left;
+		command.right_volume = right;
+		PostCommand(command);
 	}
 
-	bool ChannelBusy(int channel) { return channels[channel].active; }
+	// a sound buffered on an idle channel counts as playing before the
+	// audio thread gets to it
+	bool ChannelBusy(int channel) { return channels[channel].active || sounds_buffered[channel] != sounds_started[channel]; }
 
 	// activates the channel
 	void StartMusicChannel(bool sixteen_bit, bool stereo, bool signed_8bit, int bytes_per_frame, _fixed rate, bool little_endian);
 	void UpdateMusicChannel(uint8* data, int len);
 	bool MusicPlaying() { return channels[sound_channel_count + MUSIC_CHANNEL].active; }
-	void StopMusicChannel() { SDL_LockAudio(); channels[sound_channel_count + MUSIC_CHANNEL].active = false; SDL_UnlockAudio(); }
-	void SetMusicChannelVolume(int16 volume) { channels[sound_channel_count + MUSIC_CHANNEL].left_volume = channels[sound_channel_count + MUSIC_CHANNEL].right_volume = volume; }
+	// Music reuses its decoder and buffer as soon as this returns, so the
+	// stop has to have happened by then
+	void StopMusicChannel() {
+		SDL_LockAudio();
+		ApplyCommands();
+		channels[sound_channel_count + MUSIC_CHANNEL].active = false;
+		SDL_UnlockAudio();
+	}
+	void SetMusicChannelVolume(int16 volume) { SetChannelVolumes(sound_channel_count + MUSIC_CHANNEL, volume, volume); }
 
 	SDL_AudioSpec desired, obtained;
 
@@ -92,8 +117,7 @@ public:
 	void StopSoundResource();
 
 private:
-        Mixer() : sNetworkAudioBufferDesc(0) { };
-	
+        Mixer() : command_queue_read(0), command_queue_write(0), sNetworkAudioBufferDesc(0) { };
 	
 	struct Channel {
 		SoundInfo info;
@@ -115,8 +139,24 @@ private:
 		boost::shared_ptr<SoundData> next_data;
 		_fixed next_pitch;		// Pitch of next queued sound header
 
+		// The last FILTER_TAPS source frames, oldest first from
+		// history_position, each stored twice so that a whole window
+		// can be read without wrapping around
+		float history_left[2 * FILTER_TAPS];
+		float history_right[2 * FILTER_TAPS];
+		int history_position;
+		int frames_to_read;		// source frames to move into the history before the next output frame
+		bool ending;			// the sound has run out, and silence is being read in its place
+		int ending_frames;		// frames of silence still to read before the channel goes idle
+
 		Channel();
 		void LoadSoundHeader(const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch);
+		void ResetFilter();
+		void PushFrame(float left, float right) {
+			history_left[history_position] = history_left[history_position + FILTER_TAPS] = left;
+			history_right[history_position] = history_right[history_position + FILTER_TAPS] = right;
+			history_position = (history_position + 1) & (FILTER_TAPS - 1);
+		}
 		void BufferSoundHeader(const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch) {
 			next_header = header;
 			next_data = data;
@@ -141,6 +181,40 @@ private:
 
 	std::vector<Channel> channels;
 
+	struct Command {
+		enum Type {
+			BUFFER_SOUND,
+			QUIET,
+			SET_VOLUMES,
+			PLAY_RESOURCE,
+			STOP_RESOURCE
+		} type;
+
+		int channel;
+		SoundInfo header;
+		boost::shared_ptr<SoundData> data;
+		_fixed pitch;
+		int16 left_volume;
+		int16 right_volume;
+
+		Command() : type(QUIET), channel(0), pitch(0), left_volume(0), right_volume(0) { }
+		Command(Type t, int c) : type(t), channel(c), pitch(0), left_volume(0), right_volume(0) { }
+	};
+
+	// Single producer (the game thread), single consumer (the audio thread)
+	enum { COMMAND_QUEUE_SIZE = 256 };
+	Command command_queue[COMMAND_QUEUE_SIZE];
+	std::atomic<uint32> command_queue_read;
+	std::atomic<uint32> command_queue_write;
+
+	// per channel; counted by the game thread and the audio thread respectively
+	std::unique_ptr<std::atomic<uint32>[]> sounds_buffered;
+	std::unique_ptr<std::atomic<uint32>[]> sounds_started;
+
+	void PostCommand(Command& command);
+	void ApplyCommands();
+	void ApplyCommand(Command& command);
+
 	enum
 	{
 		MUSIC_CHANNEL,
@@ -152,10 +226,10 @@ private:
 	float main_volume;
 	int sound_channel_count;
 
-	void Resample(Channel* c, int16* left, int16* right, int samples);
-	void ResampleInner(Channel* c, int16* left, int16* right, int& samples);
+	void Resample(Channel* c, float* left, float* right, int samples);
+	void ResampleInner(Channel* c, float* left, float* right, int& samples);
 	template<class T, bool stereo, bool le_or_signed>
-	static void Resample_(Channel* c, int16* left, int16* right, int& samples);
+	static void Resample_(Channel* c, float* left, float* right, int& samples);
 
 	static void MixerCallback(void *user, uint8 *stream, int len);
 	void Callback(uint8 *stream, int len);
@@ -149,12 +149,21 @@ bool option_nosound = false;          // Disable sound output
 bool option_nogamma = false;	      // Disable gamma table effects (menu fades)
 bool option_debug = false;
 bool option_nojoystick = false;
+bool option_timedemo = false;         // Replay a film unthrottled and report timings
+std::string option_export;            // Render a film unthrottled into this movie file
+static short export_width = 0;        // Film export resolution, if not the preferred one
+static short export_height = 0;
+bool option_dedicated = false;        // Host netgames with no window, sound or local player
+static int dedicated_players = 0;     // Joiners to wait for before starting each one
 bool insecure_lua = false;
 static bool force_fullscreen = false; // Force fullscreen mode
 static bool force_windowed = false;   // Force windowed mode
 
 // Prototypes
 static void main_event_loop(void);
+static void run_timedemo(void);
+static void run_film_export(void);
+static void run_dedicated_server(void);
 extern int process_keyword_key(char key);
 extern void handle_keyword(int type_of_cheat);
 
@@ -207,6 +216,15 @@ static void usage(const char *prg_name)
 	  "\t[-s | --nosound]       Do not access the sound card\n"
 	  "\t[-m | --nogamma]       Disable gamma table effects (menu fades)\n"
           "\t[-j | --nojoystick]    Do not initialize joysticks\n"
+	  "\t[-t | --timedemo]      Replay the film as fast as possible without\n"
+	  "\t                       window or sound, then print timings\n"
+	  "\t[-e | --export movie]   Render the film into a movie file as fast as\n"
+	  "\t                       possible, without a visible window\n"
+	  "\t[-r | --resolution WxH] Resolution for --export\n"
+#if !defined(DISABLE_NETWORKING)
+	  "\t[-D | --dedicated n]   Host network games for n players, with no\n"
+	  "\t                       window, sound or local player\n"
+#endif
 	  // Documenting this might be a bad idea?
 	  // "\t[-i | --insecure_lua]  Allow Lua netscripts to take over your computer\n"
 	  "\tdirectory              Directory containing scenario data files\n"
@@ -315,6 +333,30 @@ int main(int argc, char **argv)
 			option_nosound = true;
                 } else if (strcmp(*argv, "-j") == 0 || strcmp(*argv, "--nojoystick") == 0) {
                         option_nojoystick = true;
+		} else if (strcmp(*argv, "-t") == 0 || strcmp(*argv, "--timedemo") == 0) {
+			option_timedemo = true;
+			option_nosound = true;
+			option_nojoystick = true;
+		} else if (strcmp(*argv, "-e") == 0 || strcmp(*argv, "--export") == 0) {
+			if (argc < 2)
+				usage(prg_name);
+			argc--;
+			argv++;
+			option_export = *argv;
+			option_nojoystick = true;
+		} else if (strcmp(*argv, "-r") == 0 || strcmp(*argv, "--resolution") == 0) {
+			if (argc < 2 || sscanf(argv[1], "%hdx%hd", &export_width, &export_height) != 2 || export_width <= 0 || export_height <= 0)
+				usage(prg_name);
+			argc--;
+			argv++;
+		} else if (strcmp(*argv, "-D") == 0 || strcmp(*argv, "--dedicated") == 0) {
+			if (argc < 2 || sscanf(argv[1], "%d", &dedicated_players) != 1 || dedicated_players < 1 || dedicated_players >= MAXIMUM_NUMBER_OF_PLAYERS)
+				usage(prg_name);
+			argc--;
+			argv++;
+			option_dedicated = true;
+			option_nosound = true;
+			option_nojoystick = true;
 		} else if (strcmp(*argv, "-m") == 0 || strcmp(*argv, "--nogamma") == 0) {
 			option_nogamma = true;
 		} else if (strcmp(*argv, "-i") == 0 || strcmp(*argv, "--insecure_lua") == 0) {
@@ -346,6 +388,13 @@ int main(int argc, char **argv)
 		// Initialize everything
 		initialize_application();
 
+		if (option_timedemo)
+			run_timedemo();
+		if (!option_export.empty())
+			run_film_export();
+		if (option_dedicated)
+			run_dedicated_server();
+
 		for (std::vector<std::string>::iterator it = arg_files.begin(); it != arg_files.end(); ++it)
 		{
 			if (handle_open_document(*it))
@@ -395,6 +444,19 @@ static void initialize_application(void)
 	SDL_setenv("SDL_AUDIODRIVER", "directsound", 0);
 #endif
 
+	// The timedemo and a dedicated host never draw, so don't open a real
+	// window for them
+	if (option_timedemo || option_dedicated)
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+
+	// Film export draws in software and mixes its own audio, so it needs
+	// neither a real window nor a sound card
+	if (!option_export.empty())
+	{
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	}
+
 	// Initialize SDL
 	int retval = SDL_Init(SDL_INIT_VIDEO |
 						  (option_nosound ? 0 : SDL_INIT_AUDIO) |
@@ -578,6 +640,21 @@ static void initialize_application(void)
 		graphics_preferences->screen_mode.fullscreen = false;
 	write_preferences();
 
+	// There is no OpenGL context behind the dummy video driver; don't save
+	// this, so the user's renderer choice survives the timedemo or export
+	if (option_timedemo || !option_export.empty() || option_dedicated)
+	{
+		graphics_preferences->screen_mode.acceleration = _no_acceleration;
+		graphics_preferences->screen_mode.fullscreen = false;
+	}
+	if (!option_export.empty() && export_width > 0)
+	{
+		graphics_preferences->screen_mode.width = export_width;
+		graphics_preferences->screen_mode.height = export_height;
+		graphics_preferences->screen_mode.auto_resolution = false;
+		graphics_preferences->screen_mode.high_dpi = false;
+	}
+
 	Plugins::instance()->load_mml();
 
 //	SDL_WM_SetCaption(application_name, application_name);
@@ -751,6 +828,162 @@ short get_level_number_from_user(void)
 	return level;
 }
 
+// Replays the film given on the command line with no heartbeat throttle,
+// then prints the simulation rate, the time spent in each subsystem of the
+// world update and a checksum of the final game state, and exits
+static void run_timedemo(void)
+{
+	if (arg_files.empty())
+	{
+		fprintf(stderr, "--timedemo requires a film to replay\n");
+		exit(1);
+	}
+
+	FileSpecifier film(arg_files.front());
+	if (film.GetType() != _typecode_film || !handle_open_replay(film))
+	{
+		fprintf(stderr, "Couldn't start replay of %s\n", arg_files.front().c_str());
+		exit(1);
+	}
+
+	reset_world_subsystem_timing();
+	reset_lua_trigger_timing();
+
+	int32 ticks = 0;
+	uint64_t world_counter = 0;
+	uint64_t start_counter = SDL_GetPerformanceCounter();
+	while (get_game_state() == _game_in_progress)
+	{
+		// Pull the next tick's flags from the film now, rather than when
+		// the heartbeat timer task would have
+		input_controller();
+
+		uint64_t update_counter = SDL_GetPerformanceCounter();
+		ticks += update_world().second;
+		world_counter += SDL_GetPerformanceCounter() - update_counter;
+	}
+
+	const double frequency = SDL_GetPerformanceFrequency();
+	double elapsed = (SDL_GetPerformanceCounter() - start_counter) / frequency;
+	double world_seconds = world_counter / frequency;
+
+	printf("Timedemo: %d ticks in %.3f seconds (%.1f ticks/sec)\n",
+	       ticks, elapsed, elapsed > 0 ? ticks / elapsed : 0.0);
+	printf("update_world: %.3f seconds (%.1f ticks/sec)\n",
+	       world_seconds, world_seconds > 0 ? ticks / world_seconds : 0.0);
+	printf("\n%-20s %12s %12s %8s\n", "subsystem", "total ms", "us/tick", "%");
+	for (short i = 0; i < NUMBER_OF_WORLD_SUBSYSTEMS; ++i)
+	{
+		double seconds = get_world_subsystem_seconds(i);
+		printf("%-20s %12.3f %12.3f %7.2f%%\n",
+		       get_world_subsystem_name(i),
+		       seconds * 1000.0,
+		       ticks ? seconds * 1000000.0 / ticks : 0.0,
+		       world_seconds > 0 ? 100.0 * seconds / world_seconds : 0.0);
+	}
+
+	bool printed_trigger_header = false;
+	for (short i = 0; i < NUMBER_OF_LUA_TRIGGERS; ++i)
+	{
+		int32 calls = get_lua_trigger_calls(i);
+		if (!calls)
+			continue;
+
+		if (!printed_trigger_header)
+		{
+			printf("\n%-20s %12s %12s %8s\n", "lua trigger", "calls", "total ms", "us/call");
+			printed_trigger_header = true;
+		}
+
+		double seconds = get_lua_trigger_seconds(i);
+		printf("%-20s %12d %12.3f %8.2f\n",
+		       get_lua_trigger_name(i), calls,
+		       seconds * 1000.0, seconds * 1000000.0 / calls);
+	}
+	printf("\nGame state checksum: %08x\n", calculate_game_state_checksum());
+
+	exit(0);
+}
+
+// Replays the film given on the command line straight into the movie
+// encoder, one rendered frame per tick, with no heartbeat or event loop
+// pacing it, and exits
+static void run_film_export(void)
+{
+	if (arg_files.empty())
+	{
+		fprintf(stderr, "--export requires a film to replay\n");
+		exit(1);
+	}
+
+	// Start recording before the replay begins, so that chapter screens
+	// and level movies are skipped as they are for any recording
+	Movie::instance()->StartRecording(option_export);
+
+	FileSpecifier film(arg_files.front());
+	if (film.GetType() != _typecode_film || !handle_open_replay(film))
+	{
+		fprintf(stderr, "Couldn't start replay of %s\n", arg_files.front().c_str());
+		exit(1);
+	}
+
+	int32 ticks = 0;
+	uint64_t start_counter = SDL_GetPerformanceCounter();
+	while (get_game_state() == _game_in_progress)
+	{
+		// While recording, update_world() runs at most one tick per call,
+		// so every tick gets exactly one frame
+		input_controller();
+
+		std::pair<bool, int16> result = update_world();
+		if (result.first)
+		{
+			render_screen(result.second);
+			ticks += result.second;
+		}
+	}
+
+	Movie::instance()->StopRecording();
+
+	double elapsed = (SDL_GetPerformanceCounter() - start_counter) / double(SDL_GetPerformanceFrequency());
+	printf("Exported %d ticks (%.1f seconds of film) in %.3f seconds (%.2fx real time)\n",
+	       ticks, ticks / double(TICKS_PER_SECOND), elapsed,
+	       elapsed > 0 ? ticks / double(TICKS_PER_SECOND) / elapsed : 0.0);
+
+	exit(0);
+}
+
+// Hosts network games one after another, with the game set up from the
+// network preferences. The hub and the local spoke run on their own timer
+// threads; this loop only keeps the world, which nobody watches, in step
+static void run_dedicated_server(void)
+{
+	for (;;)
+	{
+		if (!host_dedicated_network_game(dedicated_players))
+		{
+			fprintf(stderr, "Couldn't host a network game\n");
+			exit(1);
+		}
+
+		printf("Game started\n");
+		while (get_game_state() != _display_main_menu)
+		{
+			SDL_Event event;
+			while (SDL_PollEvent(&event))
+			{
+				if (event.type == SDL_QUIT)
+					exit(0);
+			}
+
+			execute_timer_tasks(SDL_GetTicks());
+			idle_game_state(SDL_GetTicks());
+			SDL_Delay(1);
+		}
+		printf("Game over\n");
+	}
+}
+
 const uint32 TICKS_BETWEEN_EVENT_POLL = 16; // 60 Hz
 static void main_event_loop(void)
 {
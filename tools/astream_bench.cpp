@@ -0,0 +1,99 @@
+/*
+ *  astream_bench.cpp - Time encoding and decoding game data packets with AStream
+ *
+ *  Builds packets shaped like the hub's game data packets (an acknowledgement,
+ *  an end of messages marker, a start tick and a run of action flags, 8
+ *  players by 30 ticks by default) and decodes them again through an
+ *  AIStream&, the way the network code does, once a value at a time and
+ *  once with the bulk list reads and writes, and checks the round trip.
+ *
+ *  usage: astream_bench [flags per packet [packets]]
+ */
+
+#include "AStream.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+enum { kPacketHeaderSize = 4, kEndOfMessagesMessageType = 0x454d };
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32 encode(AOStream& ps, int32 tick, std::vector<uint32>& flags, bool bulk)
+{
+	ps << tick << uint16(kEndOfMessagesMessageType) << tick;
+	if (bulk)
+		ps.write(flags.data(), static_cast<uint32>(flags.size()));
+	else
+		for (size_t i = 0; i < flags.size(); ++i)
+			ps << flags[i];
+	return ps.tellp();
+}
+
+static uint32 decode(AIStream& ps, std::vector<uint32>& flags, bool bulk)
+{
+	int32 ack = 0, start_tick = 0;
+	uint16 message_type = 0;
+	ps >> ack >> message_type >> start_tick;
+
+	uint32 count = (ps.maxg() - ps.tellg()) / 4;
+	if (bulk)
+		ps.read(flags.data(), count);
+	else
+		for (uint32 i = 0; i < count; ++i)
+			ps >> flags[i];
+	return ack ^ start_tick ^ message_type;
+}
+
+int main(int argc, char** argv)
+{
+	int flag_count = argc > 1 ? atoi(argv[1]) : 240;
+	int packets = argc > 2 ? atoi(argv[2]) : 200000;
+
+	std::vector<uint32> flags(flag_count), decoded(flag_count);
+	for (int i = 0; i < flag_count; ++i)
+		flags[i] = 0x9e3779b9u * (i + 1);
+
+	std::vector<uint8> packet(kPacketHeaderSize + 10 + 4 * flag_count);
+	bool ok = true;
+
+	for (int bulk = 0; bulk < 2; ++bulk)
+	{
+		uint32 length = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < packets; ++i)
+		{
+			AOStreamBE ps(packet.data(), static_cast<uint32>(packet.size()), kPacketHeaderSize);
+			flags[0] = i;
+			length = encode(ps, i, flags, bulk);
+		}
+		double encode_ms = milliseconds_since(start);
+
+		uint32 check = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < packets; ++i)
+		{
+			AIStreamBE ps(packet.data(), length, kPacketHeaderSize);
+			check += decode(ps, decoded, bulk);
+		}
+		double decode_ms = milliseconds_since(start);
+
+		// every pass decodes the last packet encoded, whose acknowledgement
+		// and start tick are the same
+		ok = ok && decoded == flags && check == uint32(packets) * kEndOfMessagesMessageType;
+
+		double megabytes = static_cast<double>(length) * packets / (1024 * 1024);
+		printf("%s: %d packets of %u bytes, encode %.1f ms (%.0f MB/s), decode %.1f ms (%.0f MB/s)\n",
+		       bulk ? "bulk" : "per value", packets, length,
+		       encode_ms, megabytes / (encode_ms / 1000), decode_ms, megabytes / (decode_ms / 1000));
+	}
+
+	if (!ok)
+		printf("ROUND TRIP FAILED\n");
+	return ok ? 0 : 1;
+}
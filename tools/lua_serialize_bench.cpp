@@ -0,0 +1,135 @@
+/*
+ *  lua_serialize_bench.cpp - Time Lua state serialization on synthetic tables
+ *
+ *  Builds a table shaped like scenario-managed state (100000 records by
+ *  default, each a small table with repeated field names, a shared
+ *  reference and a mix of integral and fractional numbers), then saves and
+ *  restores it with lua_save()/lua_restore() and checks the round trip.
+ *
+ *  usage: lua_serialize_bench [entries [iterations]]
+ */
+
+#include "lua_serialize.h"
+#include "Logging.h"
+
+#include <chrono>
+#include <sstream>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Dummy logger to avoid linking the game's logging
+const char* logDomain = "global";
+
+class StderrLogger : public Logger {
+public:
+	void pushLogContextV(const char*, int, const char*, va_list) {}
+	void popLogContext() {}
+	void logMessageV(const char*, int, const char*, int, const char* inMessage, va_list inArgs) {
+		vfprintf(stderr, inMessage, inArgs);
+		fputc('\n', stderr);
+	}
+	void flush() {}
+};
+
+void Logger::pushLogContext(const char*, int, const char*, ...) {}
+void Logger::logMessage(const char* inDomain, int inLevel, const char* inFile, int inLine, const char* inMessage, ...) {
+	va_list list;
+	va_start(list, inMessage);
+	logMessageV(inDomain, inLevel, inFile, inLine, inMessage, list);
+	va_end(list);
+}
+void Logger::logMessageNMT(const char*, int, const char*, int, const char*, ...) {}
+Logger::~Logger() {}
+
+Logger* GetCurrentLogger()
+{
+	static StderrLogger logger;
+	return &logger;
+}
+
+static const char* kBuildScript =
+	"local n = ...\n"
+	"local shared = { kind = 'shared' }\n"
+	"local t = { records = {}, by_name = {} }\n"
+	"for i = 1, n do\n"
+	"  local r = { id = i, name = 'monster' .. (i % 64), x = i * 3, y = -i, facing = i / 7,\n"
+	"              alive = (i % 2 == 0), owner = shared }\n"
+	"  t.records[i] = r\n"
+	"  t.by_name['k' .. i] = r\n"
+	"end\n"
+	"return t\n";
+
+static const char* kCheckScript =
+	"local t, n = ...\n"
+	"local shared = t.records[1].owner\n"
+	"for i = 1, n do\n"
+	"  local r = t.records[i]\n"
+	"  if r.id ~= i or r.name ~= 'monster' .. (i % 64) or r.x ~= i * 3 or r.y ~= -i\n"
+	"     or r.facing ~= i / 7 or r.alive ~= (i % 2 == 0) or r.owner ~= shared\n"
+	"     or t.by_name['k' .. i] ~= r then\n"
+	"    return false\n"
+	"  end\n"
+	"end\n"
+	"return shared.kind == 'shared'\n";
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	int entries = argc > 1 ? atoi(argv[1]) : 100000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+	lua_State* L = luaL_newstate();
+	luaL_openlibs(L);
+
+	if (luaL_loadstring(L, kBuildScript) != LUA_OK)
+	{
+		fprintf(stderr, "%s\n", lua_tostring(L, -1));
+		return 1;
+	}
+	lua_pushinteger(L, entries);
+	lua_call(L, 1, 1);
+
+	std::string saved;
+	double save_ms = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		std::stringbuf sb;
+		auto start = std::chrono::steady_clock::now();
+		if (!lua_save(L, &sb))
+			return 1;
+		save_ms += milliseconds_since(start);
+		saved = sb.str();
+	}
+	lua_pop(L, 1);
+
+	double restore_ms = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		std::stringbuf sb(saved);
+		auto start = std::chrono::steady_clock::now();
+		if (!lua_restore(L, &sb))
+			return 1;
+		restore_ms += milliseconds_since(start);
+		if (i + 1 < iterations)
+			lua_pop(L, 1);
+	}
+
+	luaL_loadstring(L, kCheckScript);
+	lua_insert(L, -2);
+	lua_pushinteger(L, entries);
+	lua_call(L, 2, 1);
+	bool ok = lua_toboolean(L, -1);
+
+	printf("%d entries: %lu bytes, save %.1f ms, restore %.1f ms (mean of %d)%s\n",
+	       entries, static_cast<unsigned long>(saved.size()),
+	       save_ms / iterations, restore_ms / iterations, iterations,
+	       ok ? "" : "; ROUND TRIP FAILED");
+
+	lua_close(L);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+ *  zip_archive_bench.cpp - Time opening and reading every file in a zip archive
+ *
+ *  Lists the archive (Plugins/Foo.zip), then opens each member by the path
+ *  the game uses for it (Plugins/Foo/sub/bar.png) and reads it to the end,
+ *  first through the shared archive index and then, when built with zziplib,
+ *  through SDL_RWFromZZIP, and checks both read the same data.
+ *
+ *  usage: zip_archive_bench archive.zip [iterations]
+ */
+
+#include "cseries.h"
+#include "zip_archive_cache.h"
+
+#ifdef HAVE_ZZIP
+#include "SDL_rwops_zzip.h"
+#endif
+
+#include <zlib.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// reads f to the end and closes it; the CRC of what was read, or 0 if f is NULL
+static uLong read_all(SDL_RWops *f, size_t& length)
+{
+	uLong crc = crc32(0, Z_NULL, 0);
+	if (!f)
+		return 0;
+
+	static Bytef buffer[64 * 1024];
+	size_t read;
+	while ((read = SDL_RWread(f, buffer, 1, sizeof(buffer))) > 0)
+	{
+		crc = crc32(crc, buffer, static_cast<uInt>(read));
+		length += read;
+	}
+	SDL_RWclose(f);
+	return crc;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s archive.zip [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	std::string archive = argv[1];
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+	size_t extension = archive.rfind('.');
+	if (extension == std::string::npos)
+	{
+		fprintf(stderr, "%s has no extension\n", archive.c_str());
+		return 1;
+	}
+	std::string prefix = archive.substr(0, extension) + "/";
+
+	std::vector<std::string> names;
+	auto start = std::chrono::steady_clock::now();
+	if (!read_zip_archive_directory(archive, names))
+	{
+		fprintf(stderr, "could not read %s\n", archive.c_str());
+		return 1;
+	}
+	double index_ms = milliseconds_since(start);
+
+	std::vector<std::string> paths;
+	for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+	{
+		if (!it->empty() && (*it)[it->size() - 1] != '/')
+			paths.push_back(prefix + *it);
+	}
+
+	std::vector<uLong> crcs(paths.size());
+	size_t length = 0;
+	int missing = 0;
+	double indexed_ms = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		length = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t j = 0; j < paths.size(); ++j)
+		{
+			SDL_RWops *f = open_zip_archive_member(paths[j]);
+			if (!f && i == 0)
+				++missing;
+			crcs[j] = read_all(f, length);
+		}
+		indexed_ms += milliseconds_since(start);
+	}
+
+	printf("%lu files, %lu bytes: index %.1f ms, open and read all %.1f ms (mean of %d)%s\n",
+	       static_cast<unsigned long>(paths.size()), static_cast<unsigned long>(length),
+	       index_ms, indexed_ms / iterations, iterations,
+	       missing ? "; SOME FILES NOT OPENED" : "");
+
+	bool ok = !missing;
+
+#ifdef HAVE_ZZIP
+	int mismatched = 0;
+	double zzip_ms = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		length = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t j = 0; j < paths.size(); ++j)
+		{
+			uLong crc = read_all(SDL_RWFromZZIP(paths[j].c_str(), zzip_get_default_io()), length);
+			if (i == 0 && crc != crcs[j])
+				++mismatched;
+		}
+		zzip_ms += milliseconds_since(start);
+	}
+
+	printf("zziplib: open and read all %.1f ms (mean of %d)%s\n",
+	       zzip_ms / iterations, iterations,
+	       mismatched ? "; CONTENTS DIFFER" : "");
+
+	ok = ok && !mismatched;
+#endif
+
+	return ok ? 0 : 1;
+}